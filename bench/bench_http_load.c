@@ -0,0 +1,472 @@
+/**
+ * @file bench_http_load.c
+ * @brief Prueba de carga de /metrics con N conexiones keep-alive concurrentes.
+ *
+ * Cada conexion corre en su propio hilo y pide la ruta una y otra vez sobre el
+ * mismo socket HTTP/1.1 durante el tiempo indicado, como un tablero que
+ * consulta al exportador. Las respuestas se leen completas, con Content-Length
+ * o en chunks. Al final imprime la cantidad de pedidos, los pedidos por
+ * segundo y los percentiles p50 y p99 de la latencia de cada scrape, ademas de
+ * los errores y las reconexiones (el servidor cerro la conexion keep-alive).
+ *
+ * Uso: bench_http_load [-c conexiones] [-d segundos] [-z] [host [puerto [ruta]]]
+ *   -z agrega Accept-Encoding: gzip a los pedidos.
+ */
+
+#define _GNU_SOURCE
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+/**
+ * @brief Conexiones concurrentes por defecto.
+ */
+#define BENCH_CONNECTIONS 16
+
+/**
+ * @brief Duracion por defecto de la prueba en segundos.
+ */
+#define BENCH_SECONDS 10
+
+/**
+ * @brief Tamaño del buffer de lectura de cada conexion.
+ */
+#define BENCH_BUFFER_SIZE 65536
+
+/**
+ * @brief Parametros de la prueba, compartidos por todos los hilos.
+ */
+static struct
+{
+    struct addrinfo* address; /**< Direccion del servidor */
+    char request[512];        /**< Pedido HTTP completo */
+    size_t request_length;    /**< Longitud del pedido */
+    double deadline;          /**< Instante en que los hilos dejan de pedir */
+} bench;
+
+/**
+ * @brief Estado de una conexion y sus mediciones.
+ */
+typedef struct
+{
+    pthread_t thread;                /**< Hilo de la conexion */
+    int fd;                          /**< Socket, -1 si no esta conectado */
+    char buffer[BENCH_BUFFER_SIZE];  /**< Datos leidos y aun no consumidos */
+    size_t start;                    /**< Comienzo de los datos no consumidos */
+    size_t end;                      /**< Fin de los datos leidos */
+    double* latencies;               /**< Latencia de cada pedido en segundos */
+    size_t count;                    /**< Pedidos completados */
+    size_t capacity;                 /**< Capacidad de latencies */
+    unsigned long errors;            /**< Pedidos fallidos */
+    unsigned long reconnects;        /**< Conexiones abiertas despues de la primera */
+    unsigned long long bytes;        /**< Bytes de cuerpo recibidos */
+} bench_connection_t;
+
+/**
+ * @brief Lee CLOCK_MONOTONIC en segundos.
+ *
+ * @return Segundos.
+ */
+static double now_seconds(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+/**
+ * @brief Compara dos latencias para qsort.
+ */
+static int compare_doubles(const void* a, const void* b)
+{
+    double x = *(const double*)a;
+    double y = *(const double*)b;
+    return x < y ? -1 : x > y;
+}
+
+/**
+ * @brief Abre la conexion TCP con el servidor.
+ *
+ * @param connection Conexion a abrir.
+ * @return 0 en caso de exito, -1 en caso de error.
+ */
+static int connection_open(bench_connection_t* connection)
+{
+    connection->fd = socket(bench.address->ai_family, SOCK_STREAM, 0);
+    if (connection->fd < 0)
+    {
+        return -1;
+    }
+    if (connect(connection->fd, bench.address->ai_addr, bench.address->ai_addrlen) != 0)
+    {
+        close(connection->fd);
+        connection->fd = -1;
+        return -1;
+    }
+    int one = 1;
+    setsockopt(connection->fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    connection->start = 0;
+    connection->end = 0;
+    return 0;
+}
+
+/**
+ * @brief Cierra la conexion si esta abierta.
+ *
+ * @param connection Conexion a cerrar.
+ */
+static void connection_close(bench_connection_t* connection)
+{
+    if (connection->fd >= 0)
+    {
+        close(connection->fd);
+        connection->fd = -1;
+    }
+}
+
+/**
+ * @brief Lee mas datos del socket al final del buffer, compactandolo antes si hace falta.
+ *
+ * @param connection Conexion de la que leer.
+ * @return Bytes leidos, 0 si el servidor cerro la conexion, -1 en caso de error.
+ */
+static ssize_t connection_fill(bench_connection_t* connection)
+{
+    if (connection->start > 0)
+    {
+        memmove(connection->buffer, connection->buffer + connection->start, connection->end - connection->start);
+        connection->end -= connection->start;
+        connection->start = 0;
+    }
+    if (connection->end == sizeof(connection->buffer))
+    {
+        return -1;
+    }
+    ssize_t n = recv(connection->fd, connection->buffer + connection->end, sizeof(connection->buffer) - connection->end, 0);
+    if (n > 0)
+    {
+        connection->end += (size_t)n;
+    }
+    return n;
+}
+
+/**
+ * @brief Devuelve la siguiente linea terminada en CRLF, sin el CRLF.
+ *
+ * @param connection Conexion de la que leer.
+ * @return La linea, valida hasta la siguiente lectura, o NULL si la conexion se cerro o fallo.
+ */
+static char* connection_line(bench_connection_t* connection)
+{
+    for (;;)
+    {
+        char* line = connection->buffer + connection->start;
+        char* crlf = memmem(line, connection->end - connection->start, "\r\n", 2);
+        if (crlf != NULL)
+        {
+            *crlf = '\0';
+            connection->start = (size_t)(crlf + 2 - connection->buffer);
+            return line;
+        }
+        if (connection_fill(connection) <= 0)
+        {
+            return NULL;
+        }
+    }
+}
+
+/**
+ * @brief Descarta length bytes del cuerpo.
+ *
+ * @param connection Conexion de la que leer.
+ * @param length Bytes a descartar.
+ * @return 0 en caso de exito, -1 si la conexion se cerro o fallo antes.
+ */
+static int connection_skip(bench_connection_t* connection, unsigned long long length)
+{
+    while (length > 0)
+    {
+        if (connection->start == connection->end && connection_fill(connection) <= 0)
+        {
+            return -1;
+        }
+        size_t available = connection->end - connection->start;
+        size_t n = available < length ? available : (size_t)length;
+        connection->start += n;
+        length -= n;
+        connection->bytes += n;
+    }
+    return 0;
+}
+
+/**
+ * @brief Envia un pedido y lee la respuesta completa.
+ *
+ * @param connection Conexion sobre la que pedir.
+ * @param keep_alive Se pone en 0 si el servidor indico que cierra la conexion.
+ * @return 0 si la respuesta fue 200 y se leyo completa, -1 en otro caso.
+ */
+static int connection_request(bench_connection_t* connection, int* keep_alive)
+{
+    if (send(connection->fd, bench.request, bench.request_length, MSG_NOSIGNAL) != (ssize_t)bench.request_length)
+    {
+        return -1;
+    }
+
+    char* line = connection_line(connection);
+    int status = 0;
+    if (line == NULL || sscanf(line, "HTTP/1.%*d %d", &status) != 1)
+    {
+        return -1;
+    }
+
+    long long content_length = -1;
+    int chunked = 0;
+    *keep_alive = 1;
+    while ((line = connection_line(connection)) != NULL && line[0] != '\0')
+    {
+        if (strncasecmp(line, "Content-Length:", 15) == 0)
+        {
+            content_length = atoll(line + 15);
+        }
+        else if (strncasecmp(line, "Transfer-Encoding:", 18) == 0 && strcasestr(line + 18, "chunked") != NULL)
+        {
+            chunked = 1;
+        }
+        else if (strncasecmp(line, "Connection:", 11) == 0 && strcasestr(line + 11, "close") != NULL)
+        {
+            *keep_alive = 0;
+        }
+    }
+    if (line == NULL)
+    {
+        return -1;
+    }
+
+    if (chunked)
+    {
+        for (;;)
+        {
+            line = connection_line(connection);
+            if (line == NULL)
+            {
+                return -1;
+            }
+            unsigned long long size = strtoull(line, NULL, 16);
+            if (size == 0)
+            {
+                // Trailers opcionales hasta la linea vacia
+                while ((line = connection_line(connection)) != NULL && line[0] != '\0')
+                {
+                }
+                if (line == NULL)
+                {
+                    return -1;
+                }
+                break;
+            }
+            if (connection_skip(connection, size) != 0 || connection_skip(connection, 2) != 0)
+            {
+                return -1;
+            }
+            connection->bytes -= 2;
+        }
+    }
+    else if (content_length >= 0)
+    {
+        if (connection_skip(connection, (unsigned long long)content_length) != 0)
+        {
+            return -1;
+        }
+    }
+    else
+    {
+        // Sin longitud: el cuerpo termina cuando el servidor cierra la conexion
+        while (connection_skip(connection, sizeof(connection->buffer)) == 0)
+        {
+        }
+        *keep_alive = 0;
+    }
+    return status == 200 ? 0 : -1;
+}
+
+/**
+ * @brief Funcion de cada hilo: pide la ruta sobre su conexion hasta el final de la prueba.
+ *
+ * @param arg La conexion del hilo.
+ * @return NULL
+ */
+static void* connection_main(void* arg)
+{
+    bench_connection_t* connection = arg;
+    int opened = 0;
+
+    while (now_seconds() < bench.deadline)
+    {
+        if (connection->fd < 0)
+        {
+            if (connection_open(connection) != 0)
+            {
+                connection->errors++;
+                usleep(10000);
+                continue;
+            }
+            if (opened++ > 0)
+            {
+                connection->reconnects++;
+            }
+        }
+
+        int keep_alive = 1;
+        double start = now_seconds();
+        int rc = connection_request(connection, &keep_alive);
+        double latency = now_seconds() - start;
+        if (rc != 0)
+        {
+            connection->errors++;
+            connection_close(connection);
+            continue;
+        }
+        if (!keep_alive)
+        {
+            connection_close(connection);
+        }
+
+        if (connection->count == connection->capacity)
+        {
+            size_t capacity = connection->capacity > 0 ? connection->capacity * 2 : 1024;
+            double* latencies = realloc(connection->latencies, capacity * sizeof(double));
+            if (latencies == NULL)
+            {
+                break;
+            }
+            connection->latencies = latencies;
+            connection->capacity = capacity;
+        }
+        connection->latencies[connection->count++] = latency;
+    }
+
+    connection_close(connection);
+    return NULL;
+}
+
+/**
+ * @brief Programa principal.
+ *
+ * @param argc
+ * @param argv
+ * @return int
+ */
+int main(int argc, char* argv[])
+{
+    int connection_count = BENCH_CONNECTIONS;
+    double seconds = BENCH_SECONDS;
+    int gzip = 0;
+    int option;
+    while ((option = getopt(argc, argv, "c:d:z")) != -1)
+    {
+        switch (option)
+        {
+        case 'c':
+            connection_count = atoi(optarg);
+            break;
+        case 'd':
+            seconds = atof(optarg);
+            break;
+        case 'z':
+            gzip = 1;
+            break;
+        default:
+            fprintf(stderr, "Uso: %s [-c conexiones] [-d segundos] [-z] [host [puerto [ruta]]]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    const char* host = optind < argc ? argv[optind] : "127.0.0.1";
+    const char* port = optind + 1 < argc ? argv[optind + 1] : "8000";
+    const char* path = optind + 2 < argc ? argv[optind + 2] : "/metrics";
+    if (connection_count <= 0 || seconds <= 0)
+    {
+        fprintf(stderr, "La cantidad de conexiones y la duracion deben ser positivas\n");
+        return EXIT_FAILURE;
+    }
+
+    struct addrinfo hints = {.ai_family = AF_UNSPEC, .ai_socktype = SOCK_STREAM};
+    int rc = getaddrinfo(host, port, &hints, &bench.address);
+    if (rc != 0)
+    {
+        fprintf(stderr, "Error al resolver %s:%s: %s\n", host, port, gai_strerror(rc));
+        return EXIT_FAILURE;
+    }
+    bench.request_length = (size_t)snprintf(bench.request, sizeof(bench.request),
+                                            "GET %s HTTP/1.1\r\nHost: %s:%s\r\n%sConnection: keep-alive\r\n\r\n", path,
+                                            host, port, gzip ? "Accept-Encoding: gzip\r\n" : "");
+
+    bench_connection_t* connections = calloc((size_t)connection_count, sizeof(bench_connection_t));
+    if (connections == NULL)
+    {
+        perror("Error al reservar las conexiones");
+        return EXIT_FAILURE;
+    }
+    double start = now_seconds();
+    bench.deadline = start + seconds;
+    for (int i = 0; i < connection_count; i++)
+    {
+        connections[i].fd = -1;
+        if (pthread_create(&connections[i].thread, NULL, connection_main, &connections[i]) != 0)
+        {
+            fprintf(stderr, "Error al crear el hilo de la conexion %d\n", i);
+            return EXIT_FAILURE;
+        }
+    }
+
+    size_t total = 0;
+    unsigned long errors = 0;
+    unsigned long reconnects = 0;
+    unsigned long long bytes = 0;
+    for (int i = 0; i < connection_count; i++)
+    {
+        pthread_join(connections[i].thread, NULL);
+        total += connections[i].count;
+        errors += connections[i].errors;
+        reconnects += connections[i].reconnects;
+        bytes += connections[i].bytes;
+    }
+    double elapsed = now_seconds() - start;
+
+    double* latencies = malloc((total > 0 ? total : 1) * sizeof(double));
+    size_t offset = 0;
+    for (int i = 0; i < connection_count; i++)
+    {
+        if (connections[i].count > 0)
+        {
+            memcpy(latencies + offset, connections[i].latencies, connections[i].count * sizeof(double));
+            offset += connections[i].count;
+        }
+        free(connections[i].latencies);
+    }
+    qsort(latencies, total, sizeof(double), compare_doubles);
+
+    printf("%s:%s%s, %d conexiones keep-alive, %.1f s%s\n", host, port, path, connection_count, elapsed,
+           gzip ? ", gzip" : "");
+    printf("pedidos %zu (%.1f/s), errores %lu, reconexiones %lu, cuerpo medio %.0f bytes\n", total,
+           (double)total / elapsed, errors, reconnects, total > 0 ? (double)bytes / (double)total : 0.0);
+    if (total > 0)
+    {
+        printf("latencia ms: p50 %.2f p99 %.2f max %.2f\n", latencies[total / 2] * 1e3,
+               latencies[total * 99 / 100] * 1e3, latencies[total - 1] * 1e3);
+    }
+
+    free(latencies);
+    free(connections);
+    freeaddrinfo(bench.address);
+    return errors > 0 && total == 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,160 @@
+/**
+ * @file bench_process_scan.c
+ * @brief Mide el tiempo de una pasada de process_scan_run() segun la cantidad de PID y de hilos.
+ *
+ * Agrega procesos hijos dormidos por tandas hasta la cantidad pedida y, en
+ * cada nivel, mide con cada cantidad de hilos una primera pasada con la tabla
+ * de procesos vacia y la media de las pasadas siguientes, que solo releen los
+ * procesos conocidos. Los hijos esperan el cierre de un pipe, por lo que
+ * terminan solos aunque el benchmark se interrumpa.
+ *
+ * Uso: bench_process_scan [procesos_extra [pasadas]]
+ */
+
+#define _GNU_SOURCE
+#include "process_scan.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+/**
+ * @brief Cantidad de procesos extra por defecto en el ultimo nivel.
+ */
+#define BENCH_MAX_CHILDREN 8000
+
+/**
+ * @brief Pasadas medidas por defecto despues de la primera.
+ */
+#define BENCH_PASSES 10
+
+/**
+ * @brief Cantidades de hilos que se comparan en cada nivel.
+ */
+static const size_t thread_counts[] = {1, 2, 4, 8};
+
+/**
+ * @brief Lee CLOCK_MONOTONIC en segundos.
+ *
+ * @return Segundos.
+ */
+static double now_seconds(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+/**
+ * @brief Crea hijos que duermen hasta que se cierre el extremo de escritura del pipe.
+ *
+ * @param children Arreglo donde se guardan los PID.
+ * @param count Cantidad de hijos ya creados; se actualiza.
+ * @param target Cantidad total de hijos a alcanzar.
+ * @param pipe_fds Extremos de lectura y escritura del pipe.
+ * @return 0 en caso de exito, -1 si no se pudo crear algun hijo.
+ */
+static int spawn_children(pid_t* children, size_t* count, size_t target, const int pipe_fds[2])
+{
+    while (*count < target)
+    {
+        pid_t pid = fork();
+        if (pid < 0)
+        {
+            perror("fork");
+            return -1;
+        }
+        if (pid == 0)
+        {
+            char byte;
+            close(pipe_fds[1]);
+            while (read(pipe_fds[0], &byte, 1) > 0)
+            {
+            }
+            _exit(0);
+        }
+        children[(*count)++] = pid;
+    }
+    return 0;
+}
+
+/**
+ * @brief Programa principal.
+ *
+ * @param argc
+ * @param argv
+ * @return int
+ */
+int main(int argc, char* argv[])
+{
+    size_t max_children = argc > 1 ? (size_t)atol(argv[1]) : BENCH_MAX_CHILDREN;
+    int passes = argc > 2 ? atoi(argv[2]) : BENCH_PASSES;
+    if (passes <= 0)
+    {
+        passes = BENCH_PASSES;
+    }
+
+    pid_t* children = malloc((max_children + 1) * sizeof(pid_t));
+    int fds[2];
+    if (children == NULL || pipe(fds) != 0)
+    {
+        perror("Error al preparar los procesos hijos");
+        return EXIT_FAILURE;
+    }
+
+    printf("%8s %8s %12s %12s\n", "pids", "hilos", "primera ms", "siguiente ms");
+    size_t count = 0;
+    int status = EXIT_SUCCESS;
+    for (size_t level = 0;; level = level == 0 ? 1000 : level * 2)
+    {
+        if (level > max_children)
+        {
+            level = max_children;
+        }
+        if (spawn_children(children, &count, level, fds) != 0)
+        {
+            status = EXIT_FAILURE;
+            break;
+        }
+
+        for (size_t t = 0; t < sizeof(thread_counts) / sizeof(thread_counts[0]); t++)
+        {
+            process_states_t states;
+            if (process_scan_init(thread_counts[t]) != 0)
+            {
+                status = EXIT_FAILURE;
+                break;
+            }
+
+            double start = now_seconds();
+            process_scan_run(&states);
+            double first = now_seconds() - start;
+
+            start = now_seconds();
+            for (int pass = 0; pass < passes; pass++)
+            {
+                process_scan_run(&states);
+            }
+            double next = (now_seconds() - start) / passes;
+
+            printf("%8d %8zu %12.2f %12.2f\n", states.total, thread_counts[t], first * 1e3, next * 1e3);
+            process_scan_destroy();
+        }
+
+        if (status != EXIT_SUCCESS || level == max_children)
+        {
+            break;
+        }
+    }
+
+    /* Al cerrar el pipe los hijos leen EOF y terminan */
+    close(fds[1]);
+    close(fds[0]);
+    for (size_t i = 0; i < count; i++)
+    {
+        waitpid(children[i], NULL, 0);
+    }
+    free(children);
+    return status;
+}
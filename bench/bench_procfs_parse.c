@@ -0,0 +1,285 @@
+/**
+ * @file bench_procfs_parse.c
+ * @brief Compara los parsers de procfs_parse con el camino anterior basado en sscanf.
+ *
+ * Carga capturas de /proc/stat, /proc/meminfo y /proc/net/dev (por defecto las
+ * de bench/fixtures, o las rutas pasadas como argumentos) y mide el tiempo
+ * medio por analisis de cada parser y de su equivalente con sscanf, que extrae
+ * los mismos campos linea por linea como lo hacia metrics.c. Antes de medir
+ * verifica que ambos caminos obtengan los mismos valores.
+ *
+ * Uso: bench_procfs_parse [stat meminfo net_dev [iteraciones]]
+ */
+
+#define _GNU_SOURCE
+#include "procfs_parse.h"
+#include "procfs_source.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/**
+ * @brief Iteraciones por defecto de cada medicion.
+ */
+#define BENCH_ITERATIONS 200000
+
+/**
+ * @brief Resultados acumulados para que el compilador no elimine los analisis.
+ */
+static volatile unsigned long long sink;
+
+/**
+ * @brief Lee CLOCK_MONOTONIC en nanosegundos.
+ *
+ * @return Nanosegundos.
+ */
+static long long now_ns(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (long long)now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+/**
+ * @brief Avanza hasta el comienzo de la linea siguiente, como fgets sobre el archivo.
+ *
+ * @param line Linea actual.
+ * @return Comienzo de la linea siguiente, o NULL si no hay mas.
+ */
+static const char* next_line(const char* line)
+{
+    const char* newline = strchr(line, '\n');
+    return newline == NULL || newline[1] == '\0' ? NULL : newline + 1;
+}
+
+/**
+ * @brief Lineas "cpu" y "cpuN" de /proc/stat con sscanf.
+ */
+static int sscanf_cpus(const char* buffer, procfs_cpu_snapshot_t* snapshot)
+{
+    snapshot->count = 0;
+    for (const char* line = buffer; line != NULL && snapshot->count <= PROCFS_CPU_MAX_CPUS; line = next_line(line))
+    {
+        unsigned long long v[PROCFS_CPU_MODE_COUNT];
+        int id = -1;
+        int matched;
+        if (strncmp(line, "cpu ", 4) == 0)
+        {
+            matched = sscanf(line, "cpu %llu %llu %llu %llu %llu %llu %llu %llu", &v[0], &v[1], &v[2], &v[3], &v[4],
+                             &v[5], &v[6], &v[7]);
+        }
+        else if (sscanf(line, "cpu%d", &id) == 1)
+        {
+            matched = sscanf(line, "cpu%*d %llu %llu %llu %llu %llu %llu %llu %llu", &v[0], &v[1], &v[2], &v[3], &v[4],
+                             &v[5], &v[6], &v[7]);
+        }
+        else
+        {
+            break;
+        }
+        if (matched < PROCFS_CPU_MODE_COUNT)
+        {
+            return -1;
+        }
+
+        size_t index = snapshot->count++;
+        snapshot->id[index] = id;
+        for (int mode = 0; mode < PROCFS_CPU_MODE_COUNT; mode++)
+        {
+            snapshot->jiffies[mode][index] = v[mode];
+        }
+    }
+    return snapshot->count > 0 ? 0 : -1;
+}
+
+/**
+ * @brief Campos de /proc/meminfo con sscanf, un patron por clave.
+ */
+static int sscanf_meminfo(const char* buffer, procfs_meminfo_t* meminfo)
+{
+    static const char* const patterns[] = {"MemTotal: %llu kB",  "MemFree: %llu kB",   "MemAvailable: %llu kB",
+                                           "Buffers: %llu kB",   "Cached: %llu kB",    "SwapTotal: %llu kB",
+                                           "SwapFree: %llu kB"};
+    unsigned long long* fields[] = {&meminfo->mem_total, &meminfo->mem_free,   &meminfo->mem_available,
+                                    &meminfo->buffers,   &meminfo->cached,     &meminfo->swap_total,
+                                    &meminfo->swap_free};
+
+    memset(meminfo, 0, sizeof(*meminfo));
+    for (const char* line = buffer; line != NULL; line = next_line(line))
+    {
+        for (size_t i = 0; i < sizeof(patterns) / sizeof(patterns[0]); i++)
+        {
+            if (sscanf(line, patterns[i], fields[i]) == 1)
+            {
+                break;
+            }
+        }
+    }
+    return (meminfo->mem_total != 0 && meminfo->mem_available != 0) ? 0 : -1;
+}
+
+/**
+ * @brief Contadores de todas las interfaces de /proc/net/dev con sscanf.
+ */
+static int sscanf_net_dev(const char* buffer, procfs_net_dev_t* net_dev)
+{
+    net_dev->count = 0;
+    const char* line = next_line(buffer);
+    line = line == NULL ? NULL : next_line(line);
+    for (; line != NULL && net_dev->count < PROCFS_NET_DEV_MAX_INTERFACES; line = next_line(line))
+    {
+        procfs_net_dev_interface_t* interface = &net_dev->interfaces[net_dev->count];
+        if (sscanf(line, " %15[^:]: %llu %llu %llu %llu %*u %*u %*u %*u %llu %llu %llu %llu", interface->name,
+                   &interface->rx_bytes, &interface->rx_packets, &interface->rx_errors, &interface->rx_drops,
+                   &interface->tx_bytes, &interface->tx_packets, &interface->tx_errors, &interface->tx_drops) == 9)
+        {
+            net_dev->count++;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Carga un archivo completo en una fuente.
+ *
+ * @param source Fuente a leer.
+ * @return 0 en caso de exito, -1 en caso de error.
+ */
+static int load(procfs_source_t* source)
+{
+    if (procfs_source_read(source) < 0)
+    {
+        perror(source->path);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Imprime el tiempo medio por analisis de los dos caminos y la aceleracion.
+ */
+static void report(const char* name, long long parse_ns, long long sscanf_ns, long iterations)
+{
+    double parse = (double)parse_ns / iterations;
+    double scanned = (double)sscanf_ns / iterations;
+    printf("%-8s procfs_parse %9.1f ns  sscanf %9.1f ns  x%.1f\n", name, parse, scanned, scanned / parse);
+}
+
+/**
+ * @brief Programa principal.
+ *
+ * @param argc
+ * @param argv
+ * @return int
+ */
+int main(int argc, char* argv[])
+{
+    procfs_source_t stat_source = PROCFS_SOURCE_INIT(argc > 3 ? argv[1] : BENCH_FIXTURES_DIR "/stat");
+    procfs_source_t meminfo_source = PROCFS_SOURCE_INIT(argc > 3 ? argv[2] : BENCH_FIXTURES_DIR "/meminfo");
+    procfs_source_t net_dev_source = PROCFS_SOURCE_INIT(argc > 3 ? argv[3] : BENCH_FIXTURES_DIR "/net_dev");
+    long iterations = argc > 4 ? atol(argv[4]) : BENCH_ITERATIONS;
+
+    if (iterations <= 0 || load(&stat_source) != 0 || load(&meminfo_source) != 0 || load(&net_dev_source) != 0)
+    {
+        return EXIT_FAILURE;
+    }
+
+    static procfs_cpu_snapshot_t cpus, cpus_sscanf;
+    static procfs_net_dev_t net_dev, net_dev_sscanf;
+    procfs_meminfo_t meminfo, meminfo_sscanf;
+
+    /* Ambos caminos deben obtener los mismos valores */
+    if (procfs_parse_cpus(stat_source.buffer, stat_source.length, &cpus) != 0 ||
+        sscanf_cpus(stat_source.buffer, &cpus_sscanf) != 0 || cpus.count != cpus_sscanf.count ||
+        memcmp(cpus.id, cpus_sscanf.id, cpus.count * sizeof(int)) != 0)
+    {
+        fprintf(stderr, "Los parsers de /proc/stat no coinciden\n");
+        return EXIT_FAILURE;
+    }
+    for (int mode = 0; mode < PROCFS_CPU_MODE_COUNT; mode++)
+    {
+        if (memcmp(cpus.jiffies[mode], cpus_sscanf.jiffies[mode], cpus.count * sizeof(unsigned long long)) != 0)
+        {
+            fprintf(stderr, "Los parsers de /proc/stat no coinciden\n");
+            return EXIT_FAILURE;
+        }
+    }
+    if (procfs_parse_meminfo(meminfo_source.buffer, meminfo_source.length, &meminfo) != 0 ||
+        sscanf_meminfo(meminfo_source.buffer, &meminfo_sscanf) != 0 ||
+        memcmp(&meminfo, &meminfo_sscanf, sizeof(meminfo)) != 0)
+    {
+        fprintf(stderr, "Los parsers de /proc/meminfo no coinciden\n");
+        return EXIT_FAILURE;
+    }
+    if (procfs_parse_net_dev(net_dev_source.buffer, net_dev_source.length, &net_dev) != 0 ||
+        sscanf_net_dev(net_dev_source.buffer, &net_dev_sscanf) != 0 || net_dev.count != net_dev_sscanf.count)
+    {
+        fprintf(stderr, "Los parsers de /proc/net/dev no coinciden\n");
+        return EXIT_FAILURE;
+    }
+    for (size_t i = 0; i < net_dev.count; i++)
+    {
+        const procfs_net_dev_interface_t* a = &net_dev.interfaces[i];
+        const procfs_net_dev_interface_t* b = &net_dev_sscanf.interfaces[i];
+        if (strcmp(a->name, b->name) != 0 || a->rx_bytes != b->rx_bytes || a->rx_packets != b->rx_packets ||
+            a->rx_errors != b->rx_errors || a->rx_drops != b->rx_drops || a->tx_bytes != b->tx_bytes ||
+            a->tx_packets != b->tx_packets || a->tx_errors != b->tx_errors || a->tx_drops != b->tx_drops)
+        {
+            fprintf(stderr, "Los parsers de /proc/net/dev no coinciden en %s\n", a->name);
+            return EXIT_FAILURE;
+        }
+    }
+
+    printf("%zu CPU, %zu interfaces, %ld iteraciones\n", cpus.count - 1, net_dev.count, iterations);
+
+    long long start = now_ns();
+    for (long i = 0; i < iterations; i++)
+    {
+        procfs_parse_cpus(stat_source.buffer, stat_source.length, &cpus);
+        sink += cpus.jiffies[PROCFS_CPU_USER][0];
+    }
+    long long parse_ns = now_ns() - start;
+    start = now_ns();
+    for (long i = 0; i < iterations; i++)
+    {
+        sscanf_cpus(stat_source.buffer, &cpus_sscanf);
+        sink += cpus_sscanf.jiffies[PROCFS_CPU_USER][0];
+    }
+    report("stat", parse_ns, now_ns() - start, iterations);
+
+    start = now_ns();
+    for (long i = 0; i < iterations; i++)
+    {
+        procfs_parse_meminfo(meminfo_source.buffer, meminfo_source.length, &meminfo);
+        sink += meminfo.mem_available;
+    }
+    parse_ns = now_ns() - start;
+    start = now_ns();
+    for (long i = 0; i < iterations; i++)
+    {
+        sscanf_meminfo(meminfo_source.buffer, &meminfo_sscanf);
+        sink += meminfo_sscanf.mem_available;
+    }
+    report("meminfo", parse_ns, now_ns() - start, iterations);
+
+    start = now_ns();
+    for (long i = 0; i < iterations; i++)
+    {
+        procfs_parse_net_dev(net_dev_source.buffer, net_dev_source.length, &net_dev);
+        sink += net_dev.interfaces[0].rx_bytes;
+    }
+    parse_ns = now_ns() - start;
+    start = now_ns();
+    for (long i = 0; i < iterations; i++)
+    {
+        sscanf_net_dev(net_dev_source.buffer, &net_dev_sscanf);
+        sink += net_dev_sscanf.interfaces[0].rx_bytes;
+    }
+    report("net_dev", parse_ns, now_ns() - start, iterations);
+
+    procfs_source_close(&stat_source);
+    procfs_source_close(&meminfo_source);
+    procfs_source_close(&net_dev_source);
+    return EXIT_SUCCESS;
+}
@@ -14,7 +14,11 @@
  */
 
 #include "metrics.h"
+#include "proc_events.h"
+#include "process_scan.h"
+#include "scheduler.h"
 #include <errno.h>
+#include <math.h>
 #include <prom.h>
 #include <promhttp.h>
 #include <pthread.h>
@@ -26,23 +30,83 @@
 /**
  * @brief Cantida de metricas a exponer.
  */
-#define METRICS_COUNT 14
+#define METRICS_COUNT 28
 
 /**
- * @brief Tiempo de espera entre actualizaciones de metricas.
- *
- * Se actualizan cada segundo.
+ * @brief Tiempo de espera del hilo del servidor HTTP entre comprobaciones.
  */
 #define SLEEP_TIME 1
 
 /**
- * @brief Interfaz de red para monitorear la velocidad de descarga.
+ * @brief Puerto del servidor HTTP.
+ */
+#define HTTP_PORT 8000
+
+/**
+ * @brief Cantidad de hilos del servidor HTTP.
+ *
+ * Cada hilo atiende con epoll su parte de las conexiones, por lo que una
+ * recoleccion lenta solo demora a las conexiones de su hilo.
+ */
+#define HTTP_THREADS 4
+
+/**
+ * @brief Cantidad maxima de conexiones abiertas a la vez.
+ */
+#define HTTP_CONNECTION_LIMIT 256
+
+/**
+ * @brief Cantidad maxima de conexiones abiertas a la vez desde una misma direccion IP.
+ */
+#define HTTP_PER_IP_CONNECTION_LIMIT 64
+
+/**
+ * @brief Segundos que una conexion keep-alive puede quedar inactiva antes de cerrarse.
+ *
+ * Debe superar el intervalo de recoleccion de Prometheus para que la conexion
+ * se reutilice entre dos recolecciones.
+ */
+#define HTTP_CONNECTION_TIMEOUT 120
+
+/**
+ * @brief Intervalos de recoleccion de cada coleccionista, en milisegundos.
+ */
+#define CPU_INTERVAL_MS 250
+#define MEMORY_INTERVAL_MS 1000
+#define DISK_INTERVAL_MS 30000
+#define BATTERY_INTERVAL_MS 5000
+#define CPU_TEMPERATURE_INTERVAL_MS 1000
+#define PROCESS_STATES_INTERVAL_MS 5000
+#define PROCESS_EVENTS_INTERVAL_MS 1000
+#define NETWORK_INTERVAL_MS 1000
+#define BATTERY_POWER_INTERVAL_MS 1000
+#define SCHEDULER_INTERVAL_MS 1000
+
+/**
+ * @brief Tiempo maximo de ejecucion de los coleccionistas que leen /sys, en milisegundos.
  *
- * Cambiar a la interfaz de red que se desea monitorear.
+ * Algunos firmwares dejan colgada la lectura de /sys/class/power_supply; el
+ * resto de los coleccionistas usa su intervalo como tiempo maximo.
+ */
+#define SYSFS_TIMEOUT_MS 500
+
+/**
+ * @brief Cantidad de hilos del pool que ejecuta los coleccionistas.
+ */
+#define COLLECTOR_WORKERS 4
+
+/**
+ * @brief Cantidad maxima de hilos del pool que pueden ocupar a la vez los coleccionistas que leen /sys.
  *
- * Para obtener la interfaz de red correcta, ejecutar el comando `ip a` en la terminal.
+ * Una lectura colgada de /sys no termina nunca; con este limite, aunque se
+ * cuelguen todos, el resto del pool sigue libre para los demas coleccionistas.
  */
-#define RED_INTERFACE "wlp0s20f3"
+#define SYSFS_MAX_WORKERS 1
+
+/**
+ * @brief Cantidad de hilos que recorren /proc para contar los estados de los procesos.
+ */
+#define PROCESS_SCAN_THREADS 4
 
 /**
  * @brief Registra las metricas en el registro de coleccionistas de Prometheus.
@@ -80,15 +144,37 @@ void update_cpu_temperature_gauge(void);
 void update_process_states_gauge(void);
 
 /**
- * @brief Actualiza la metrica de velocidad de descarga.
+ * @brief Actualiza los contadores de procesos creados, llamadas a exec y procesos terminados.
+ *
+ * No hace nada si el colector del proc connector no esta activo.
  */
-void update_downloaded_bytes(void);
+void update_process_events_counters(void);
+
+/**
+ * @brief Actualiza las metricas de tasas de red de todas las interfaces.
+ */
+void update_network_gauges(void);
 
 /**
  * @brief Actualiza la metrica de potencia del sistema.
  */
 void update_battery_power_gauge(void);
 
+/**
+ * @brief Actualiza los contadores de plazos perdidos y ejecuciones vencidas de cada coleccionista.
+ */
+void update_scheduler_counters(void);
+
+/**
+ * @brief Registra la duracion de una ejecucion de un coleccionista en el histograma y en el resumen de cuantiles.
+ *
+ * Se pasa al planificador con scheduler_set_observer().
+ *
+ * @param index Indice del coleccionista en el planificador.
+ * @param seconds Duracion de la ejecucion en segundos.
+ */
+void observe_collector_duration(size_t index, double seconds);
+
 /**
  * @brief Funcion del hilo para exponer las metricas via HTTP en el puerto 8000.
  * @param arg Argumento no utilizado.
@@ -97,11 +183,11 @@ void update_battery_power_gauge(void);
 void* expose_metrics(void* arg);
 
 /**
- * @brief Inicializar mutex y metricas.
+ * @brief Inicializar metricas.
  */
 void init_metrics(void);
 
 /**
- * @brief Destructor de mutex
+ * @brief Detiene el colector de eventos y libera el escaner de procesos.
  */
-void destroy_mutex(void);
+void destroy_metrics(void);
@@ -10,21 +10,62 @@
  * como /proc/meminfo, /proc/stat, /proc/statvfs, /sys/class/power_supply y /sys/class/thermal.
  */
 
+#include "procfs_parse.h"
 #include <ctype.h>
 #include <dirent.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/statvfs.h>
+#include <time.h>
 #include <unistd.h>
 
 /**
- * @def BUFFER_SIZE
- * @brief El tamaño del buffer utilizado para almacenar datos.
+ * @brief Porcentaje de tiempo en cada modo para el agregado y cada CPU.
  *
- * Este macro define que el tamaño del buffer será de 512 bytes.
+ * Mismo esquema que procfs_cpu_snapshot_t: la entrada 0 es el agregado y cada
+ * modo es un arreglo contiguo indexado por entrada.
  */
-#define BUFFER_SIZE 512
+typedef struct
+{
+    /** Entradas validas */
+    size_t count;
+    /** Numero de CPU de cada entrada, -1 para el agregado */
+    int id[PROCFS_CPU_MAX_CPUS + 1];
+    /** Porcentaje (0.0 a 100.0) de tiempo, indexado por modo y por entrada */
+    double percentage[PROCFS_CPU_MODE_COUNT][PROCFS_CPU_MAX_CPUS + 1];
+} cpu_usage_t;
+
+/**
+ * @brief Contadores de /proc/net/dev de los que se calcula la tasa por segundo.
+ */
+typedef enum
+{
+    NET_RX_BYTES,
+    NET_RX_PACKETS,
+    NET_RX_ERRORS,
+    NET_RX_DROPS,
+    NET_TX_BYTES,
+    NET_TX_PACKETS,
+    NET_TX_ERRORS,
+    NET_TX_DROPS,
+    NET_COUNTER_COUNT
+} net_counter_t;
+
+/**
+ * @brief Tasas por segundo de cada contador para todas las interfaces de red.
+ *
+ * Cada contador es un arreglo contiguo indexado por interfaz.
+ */
+typedef struct
+{
+    /** Interfaces validas */
+    size_t count;
+    /** Nombre de cada interfaz */
+    char name[PROCFS_NET_DEV_MAX_INTERFACES][PROCFS_NET_DEV_NAME_SIZE];
+    /** Tasa por segundo, indexada por contador y por interfaz */
+    double rate[NET_COUNTER_COUNT][PROCFS_NET_DEV_MAX_INTERFACES];
+} network_rates_t;
 
 /**
  * @brief Obtiene el porcentaje de uso de memoria desde /proc/meminfo.
@@ -37,14 +78,19 @@
 double get_memory_usage(void);
 
 /**
- * @brief Obtiene el porcentaje de uso de CPU desde /proc/stat.
+ * @brief Obtiene el porcentaje de uso de CPU por modo, para el agregado y cada CPU, desde /proc/stat.
  *
- * Lee los tiempos de CPU desde /proc/stat y calcula el porcentaje de uso de CPU
- * en un intervalo de tiempo.
+ * Lee los tiempos de todas las lineas "cpu" de /proc/stat y calcula el
+ * porcentaje de cada modo respecto de la lectura anterior. Las dos ultimas
+ * lecturas se guardan alternadamente en dos instantaneas, sin copiarlas. En la
+ * primera llamada, o si cambio el conjunto de CPU en linea, no hay lectura
+ * anterior comparable: la lectura queda como referencia para la siguiente y
+ * usage->count es 0.
  *
- * @return Uso de CPU como porcentaje (0.0 a 100.0), o -1.0 en caso de error.
+ * @param usage Estructura donde se guardan los porcentajes.
+ * @return 0 en caso de exito (con usage->count en 0 si no hay datos), -1 en caso de error.
  */
-double get_cpu_usage(void);
+int get_cpu_usage(cpu_usage_t* usage);
 
 /**
  * @brief Obtiene el porcentaje de uso de disco desde /proc/statvfs.
@@ -80,7 +126,15 @@ double get_cpu_temperature(void);
  * @brief Obtiene la cantidad de procesos en cada estado desde /proc.
  *
  * Lee el estado de cada proceso desde /proc y cuenta la cantidad de procesos
- * totales, suspendidos y listos.
+ * totales, suspendidos y listos. El recorrido se reparte entre los hilos del
+ * escaner de procesos (ver process_scan.h).
+ *
+ * Si el colector del proc connector esta activo (ver proc_events.h), el total
+ * se mantiene con los eventos de fork y exit y /proc solo se recorre cada
+ * PROC_EVENTS_RECONCILE_INTERVAL llamadas para reconciliar la cuenta y
+ * actualizar los estados. Entre dos reconciliaciones la cantidad de cada
+ * estado, incluidos los procesos en ejecucion, es la del ultimo recorrido, por
+ * lo que su suma puede diferir del total.
  *
  * @param total Puntero a la variable donde se almacenara la cantidad total de procesos.
  * @param suspended Puntero a la variable donde se almacenara la cantidad de procesos suspendidos.
@@ -95,24 +149,18 @@ void get_process_states(int* total, int* suspended, int* ready, int* uninterrupt
                         int* running);
 
 /**
- * @brief Obtiene la cantidad de bytes recibidos por una interfaz de red.
- *
- * @param interface
- * @return unsigned long
- */
-unsigned long get_bytes_received(const char* interface);
-
-/**
- * @brief Obtiene la velocidad de bajada de una interfaz de red.
+ * @brief Obtiene las tasas por segundo de bytes, paquetes, errores y descartes de todas las interfaces de red.
  *
- * Lee la cantidad de bytes recibidos por una interfaz de red en dos momentos
- * y calcula la velocidad de bajada en bytes por segundo.
+ * Lee /proc/net/dev sin bloquear y calcula las tasas a partir de la diferencia
+ * con la lectura anterior, dividida por el tiempo transcurrido entre ambas
+ * segun CLOCK_MONOTONIC. En la primera llamada no hay lectura anterior y no se
+ * informa ninguna interfaz. Las interfaces nuevas o cuyos contadores se
+ * reiniciaron se informan con tasa 0 hasta la lectura siguiente.
  *
- * @param interface Nombre de la interfaz de red (ej.: eth0 o wlan0).
- * @param interval Intervalo de tiempo en segundos.
- * @return Velocidad de bajada en bytes por segundo, o -1.0 en caso de error.
+ * @param rates Estructura donde se guardan las tasas.
+ * @return 0 en caso de exito, -1 en caso de error.
  */
-double get_downloaded_bytes(const char* interface, int interval);
+int get_network_rates(network_rates_t* rates);
 
 /**
  * @brief Obtiene el consumo de energia del sistema desde /sys/class/power_supply/BAT0.
@@ -0,0 +1,83 @@
+/**
+ * @file proc_events.h
+ * @brief Recoleccion de eventos de procesos a traves del proc connector del kernel.
+ *
+ * Un hilo se suscribe al proc connector (NETLINK_CONNECTOR, CN_IDX_PROC) y
+ * cuenta los eventos PROC_EVENT_FORK, PROC_EVENT_EXEC y PROC_EVENT_EXIT de los
+ * procesos (no de los hilos). Con esos contadores se mantiene la cantidad de
+ * procesos vivos de forma incremental, sin recorrer /proc en cada ciclo, y se
+ * ven tambien los procesos que nacen y mueren entre dos ciclos.
+ *
+ * Suscribirse requiere CAP_NET_ADMIN. Si el socket no esta disponible,
+ * proc_events_start() falla y quien llama debe seguir usando el recorrido de
+ * /proc (ver process_scan.h).
+ */
+
+#ifndef PROC_EVENTS_H
+#define PROC_EVENTS_H
+
+/**
+ * @brief Ciclos entre dos reconciliaciones con un recorrido completo de /proc.
+ */
+#define PROC_EVENTS_RECONCILE_INTERVAL 10
+
+/**
+ * @brief Contadores acumulados de eventos desde que se inicio el colector.
+ */
+typedef struct
+{
+    unsigned long long forks; /**< Procesos creados */
+    unsigned long long execs; /**< Llamadas a exec */
+    unsigned long long exits; /**< Procesos terminados */
+} proc_events_counters_t;
+
+/**
+ * @brief Se suscribe al proc connector e inicia el hilo que recibe los eventos.
+ *
+ * @return 0 en caso de exito, -1 si el socket no esta disponible o no hay permisos.
+ */
+int proc_events_start(void);
+
+/**
+ * @brief Indica si el colector de eventos esta en ejecucion.
+ *
+ * @return 1 si esta en ejecucion, 0 en caso contrario.
+ */
+int proc_events_running(void);
+
+/**
+ * @brief Obtiene los contadores acumulados de eventos.
+ *
+ * @param counters Estructura donde se guardan los contadores.
+ */
+void proc_events_get_counters(proc_events_counters_t* counters);
+
+/**
+ * @brief Cantidad de procesos vivos estimada a partir de la ultima reconciliacion y de los eventos posteriores.
+ *
+ * @return Cantidad de procesos vivos.
+ */
+long proc_events_process_count(void);
+
+/**
+ * @brief Fija la cantidad de procesos vivos a partir de un recorrido completo de /proc.
+ *
+ * @param total Cantidad de procesos encontrados en el recorrido.
+ */
+void proc_events_reconcile(long total);
+
+/**
+ * @brief Indica si se perdieron eventos desde la ultima reconciliacion.
+ *
+ * Sucede cuando el buffer del socket se desborda (ENOBUFS).
+ *
+ * @return 1 si hace falta reconciliar antes de tiempo, 0 en caso contrario.
+ */
+int proc_events_needs_reconcile(void);
+
+/**
+ * @brief Cancela la suscripcion y detiene el hilo del colector.
+ */
+void proc_events_stop(void);
+
+#endif // PROC_EVENTS_H
@@ -0,0 +1,99 @@
+/**
+ * @file process_scan.h
+ * @brief Recorrido paralelo de /proc/<pid>/stat con un pool de hilos.
+ *
+ * El hilo que llama lista los PID de /proc (con un descriptor de /proc abierto
+ * una sola vez) y reparte la lista en porciones iguales entre los hilos del
+ * pool. Cada hilo abre /proc/<pid>/stat con openat() relativo a ese descriptor,
+ * cuenta los estados en contadores propios y al final se suman los parciales.
+ *
+ * Los procesos se guardan en una tabla persistente indexada por PID y tiempo
+ * de inicio que se conserva entre pasadas: los PID nuevos se agregan, los que
+ * desaparecieron se eliminan y de los conocidos solo se releen los campos que
+ * cambian. Los procesos que sobreviven varias pasadas conservan abierto su
+ * descriptor de stat, por lo que el costo de una pasada depende de la cantidad
+ * de procesos que aparecen y desaparecen y no del total.
+ */
+
+#ifndef PROCESS_SCAN_H
+#define PROCESS_SCAN_H
+
+#include <stddef.h>
+#include <sys/types.h>
+
+/**
+ * @brief Cantidad de hilos por defecto si no se llama a process_scan_init().
+ */
+#define PROCESS_SCAN_DEFAULT_THREADS 4
+
+/**
+ * @brief Cantidad maxima de hilos del pool.
+ */
+#define PROCESS_SCAN_MAX_THREADS 64
+
+/**
+ * @brief Cantidad maxima de descriptores de stat que se mantienen abiertos.
+ */
+#define PROCESS_SCAN_MAX_CACHED_FDS 1024
+
+/**
+ * @brief Pasadas que debe sobrevivir un proceso para conservar abierto su descriptor.
+ */
+#define PROCESS_SCAN_FD_MIN_AGE 3
+
+/**
+ * @brief Cantidad de procesos en cada estado.
+ */
+typedef struct
+{
+    int total;           /**< Procesos totales */
+    int suspended;       /**< Procesos durmiendo (S) */
+    int ready;           /**< Procesos listos (R) */
+    int uninterruptible; /**< Procesos en suspension ininterrumpible (D) */
+    int stopped;         /**< Procesos detenidos (T) */
+    int zombie;          /**< Procesos zombie (Z) */
+    int running;         /**< Procesos en cualquier otro estado */
+} process_states_t;
+
+/**
+ * @brief Entrada de la tabla de procesos.
+ */
+typedef struct
+{
+    pid_t pid;                     /**< PID del proceso (0 si la entrada esta libre) */
+    unsigned long long start_time; /**< Tiempo de inicio en ticks desde el arranque */
+    char state;                    /**< Estado del proceso (R, S, D, ...) */
+    int fd;                        /**< Descriptor de stat cacheado, o -1 */
+    unsigned int age;              /**< Pasadas consecutivas en las que se vio el proceso */
+    unsigned long seen;            /**< Ultima pasada en la que se vio el proceso */
+} process_entry_t;
+
+/**
+ * @brief Inicializa el escaner con la cantidad de hilos indicada.
+ *
+ * El hilo que llama a process_scan_run() tambien procesa una porcion, por lo
+ * que se crean thread_count - 1 hilos adicionales. Si el escaner ya estaba
+ * inicializado no hace nada.
+ *
+ * @param thread_count Cantidad de hilos (entre 1 y PROCESS_SCAN_MAX_THREADS).
+ * @return 0 en caso de exito, -1 en caso de error.
+ */
+int process_scan_init(size_t thread_count);
+
+/**
+ * @brief Recorre /proc, actualiza la tabla de procesos y cuenta los procesos en cada estado.
+ *
+ * Inicializa el escaner con PROCESS_SCAN_DEFAULT_THREADS hilos si hace falta.
+ * No debe llamarse desde varios hilos a la vez.
+ *
+ * @param states Estructura donde se guardan los contadores.
+ * @return 0 en caso de exito, -1 en caso de error.
+ */
+int process_scan_run(process_states_t* states);
+
+/**
+ * @brief Detiene los hilos del pool y libera los recursos del escaner.
+ */
+void process_scan_destroy(void);
+
+#endif // PROCESS_SCAN_H
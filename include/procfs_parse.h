@@ -0,0 +1,141 @@
+/**
+ * @file procfs_parse.h
+ * @brief Parsers sin asignaciones de memoria para /proc/stat, /proc/meminfo y /proc/net/dev.
+ *
+ * Cada parser recorre el buffer una sola vez, acumula los digitos a mano (sin
+ * sscanf ni strtoull) y compara las claves por longitud y memcmp. El resultado
+ * se guarda en una estructura de tamaño fijo provista por quien llama.
+ */
+
+#ifndef PROCFS_PARSE_H
+#define PROCFS_PARSE_H
+
+#include <stddef.h>
+
+/**
+ * @brief Cantidad maxima de interfaces de red que se leen de /proc/net/dev.
+ */
+#define PROCFS_NET_DEV_MAX_INTERFACES 256
+
+/**
+ * @brief Longitud maxima del nombre de una interfaz, incluyendo el '\0' (IFNAMSIZ).
+ */
+#define PROCFS_NET_DEV_NAME_SIZE 16
+
+/**
+ * @brief Cantidad maxima de lineas "cpuN" que se leen de /proc/stat.
+ */
+#define PROCFS_CPU_MAX_CPUS 512
+
+/**
+ * @brief Modos de tiempo de CPU de /proc/stat, en el orden en que aparecen.
+ */
+typedef enum
+{
+    PROCFS_CPU_USER,
+    PROCFS_CPU_NICE,
+    PROCFS_CPU_SYSTEM,
+    PROCFS_CPU_IDLE,
+    PROCFS_CPU_IOWAIT,
+    PROCFS_CPU_IRQ,
+    PROCFS_CPU_SOFTIRQ,
+    PROCFS_CPU_STEAL,
+    PROCFS_CPU_MODE_COUNT
+} procfs_cpu_mode_t;
+
+/**
+ * @brief Nombres de los modos de CPU, indexados por procfs_cpu_mode_t.
+ */
+extern const char* const procfs_cpu_mode_names[PROCFS_CPU_MODE_COUNT];
+
+/**
+ * @brief Tiempos de todas las lineas "cpu" y "cpuN" de /proc/stat como estructura de arreglos.
+ *
+ * Cada modo es un arreglo contiguo indexado por CPU, para que los calculos
+ * sobre todos los nucleos sean bucles simples que el compilador pueda
+ * vectorizar. La entrada 0 es la linea agregada "cpu".
+ */
+typedef struct
+{
+    /** Entradas validas */
+    size_t count;
+    /** Numero de CPU de cada entrada, -1 para el agregado */
+    int id[PROCFS_CPU_MAX_CPUS + 1];
+    /** Tiempos en jiffies, indexados por modo y por entrada */
+    unsigned long long jiffies[PROCFS_CPU_MODE_COUNT][PROCFS_CPU_MAX_CPUS + 1];
+} procfs_cpu_snapshot_t;
+
+/**
+ * @brief Contenido relevante de /proc/meminfo, en kB.
+ */
+typedef struct
+{
+    unsigned long long mem_total;     /**< MemTotal */
+    unsigned long long mem_free;      /**< MemFree */
+    unsigned long long mem_available; /**< MemAvailable */
+    unsigned long long buffers;       /**< Buffers */
+    unsigned long long cached;        /**< Cached */
+    unsigned long long swap_total;    /**< SwapTotal */
+    unsigned long long swap_free;     /**< SwapFree */
+} procfs_meminfo_t;
+
+/**
+ * @brief Contadores de una interfaz de /proc/net/dev.
+ */
+typedef struct
+{
+    char name[PROCFS_NET_DEV_NAME_SIZE]; /**< Nombre de la interfaz */
+    unsigned long long rx_bytes;         /**< Bytes recibidos */
+    unsigned long long rx_packets;       /**< Paquetes recibidos */
+    unsigned long long rx_errors;        /**< Errores de recepcion */
+    unsigned long long rx_drops;         /**< Paquetes descartados al recibir */
+    unsigned long long tx_bytes;         /**< Bytes transmitidos */
+    unsigned long long tx_packets;       /**< Paquetes transmitidos */
+    unsigned long long tx_errors;        /**< Errores de transmision */
+    unsigned long long tx_drops;         /**< Paquetes descartados al transmitir */
+} procfs_net_dev_interface_t;
+
+/**
+ * @brief Contenido de /proc/net/dev.
+ */
+typedef struct
+{
+    size_t count;                                                          /**< Cantidad de interfaces leidas */
+    procfs_net_dev_interface_t interfaces[PROCFS_NET_DEV_MAX_INTERFACES]; /**< Contadores por interfaz */
+} procfs_net_dev_t;
+
+/**
+ * @brief Analiza las lineas "cpu" y "cpuN" del comienzo de /proc/stat.
+ *
+ * Las CPU que excedan PROCFS_CPU_MAX_CPUS se ignoran.
+ *
+ * @param buffer Contenido del archivo.
+ * @param length Cantidad de bytes validos en el buffer.
+ * @param snapshot Estructura donde se guarda el resultado.
+ * @return 0 si se encontro la linea "cpu", -1 en caso contrario.
+ */
+int procfs_parse_cpus(const char* buffer, size_t length, procfs_cpu_snapshot_t* snapshot);
+
+/**
+ * @brief Analiza el contenido de /proc/meminfo.
+ *
+ * @param buffer Contenido del archivo.
+ * @param length Cantidad de bytes validos en el buffer.
+ * @param meminfo Estructura donde se guarda el resultado.
+ * @return 0 si se encontraron MemTotal y MemAvailable, -1 en caso contrario.
+ */
+int procfs_parse_meminfo(const char* buffer, size_t length, procfs_meminfo_t* meminfo);
+
+/**
+ * @brief Analiza el contenido de /proc/net/dev.
+ *
+ * Las interfaces que excedan PROCFS_NET_DEV_MAX_INTERFACES se ignoran.
+ *
+ * @param buffer Contenido del archivo.
+ * @param length Cantidad de bytes validos en el buffer.
+ * @param net_dev Estructura donde se guarda el resultado.
+ * @return 0 en caso de exito, -1 si el contenido no tiene el formato esperado.
+ */
+int procfs_parse_net_dev(const char* buffer, size_t length, procfs_net_dev_t* net_dev);
+
+#endif // PROCFS_PARSE_H
@@ -0,0 +1,79 @@
+/**
+ * @file procfs_source.h
+ * @brief Lectura de archivos de /proc y /sys con descriptores persistentes.
+ *
+ * Cada fuente abre su archivo una sola vez, conserva el descriptor y lo vuelve a
+ * leer con pread() desde el offset 0 en un buffer preasignado. De esta forma cada
+ * muestra cuesta una unica llamada al sistema por archivo, sin fopen/fclose ni
+ * buffers de stdio.
+ *
+ * Si el archivo desaparece (por ejemplo, al desconectar la bateria) el descriptor
+ * se cierra y se vuelve a abrir de forma transparente en la siguiente lectura.
+ */
+
+#ifndef PROCFS_SOURCE_H
+#define PROCFS_SOURCE_H
+
+#include <stddef.h>
+#include <sys/types.h>
+
+/**
+ * @brief Capacidad inicial del buffer de cada fuente, en bytes.
+ *
+ * El buffer crece al doble cuando el contenido del archivo no entra completo.
+ */
+#define PROCFS_SOURCE_INITIAL_CAPACITY 4096
+
+/**
+ * @brief Capacidad maxima del buffer de cada fuente, en bytes.
+ *
+ * Evita crecer sin limite con archivos muy grandes; el contenido se trunca a este tamaño.
+ */
+#define PROCFS_SOURCE_MAX_CAPACITY (1024 * 1024)
+
+/**
+ * @brief Archivo de /proc o /sys abierto de forma persistente.
+ */
+typedef struct
+{
+    const char* path; /**< Ruta del archivo */
+    int fd;           /**< Descriptor abierto, o -1 si esta cerrado */
+    char* buffer;     /**< Buffer con el contenido de la ultima lectura, terminado en '\0' */
+    size_t capacity;  /**< Tamaño asignado al buffer en bytes */
+    size_t length;    /**< Cantidad de bytes validos en el buffer */
+} procfs_source_t;
+
+/**
+ * @brief Inicializador estatico de una fuente.
+ *
+ * El archivo se abre y el buffer se reserva en la primera lectura.
+ *
+ * @param file_path Ruta del archivo a leer.
+ */
+#define PROCFS_SOURCE_INIT(file_path)                                                                                  \
+    {                                                                                                                  \
+        .path = (file_path), .fd = -1, .buffer = NULL, .capacity = 0, .length = 0                                      \
+    }
+
+/**
+ * @brief Lee el contenido actual del archivo en el buffer de la fuente.
+ *
+ * Abre el archivo si todavia no esta abierto. Si la lectura falla porque el
+ * archivo dejo de existir, cierra el descriptor y reintenta una vez con un
+ * descriptor nuevo.
+ *
+ * @param source Fuente a leer.
+ * @return Cantidad de bytes leidos, o -1 en caso de error (errno queda establecido).
+ */
+ssize_t procfs_source_read(procfs_source_t* source);
+
+/**
+ * @brief Cierra el descriptor y libera el buffer de la fuente.
+ *
+ * La fuente puede volver a leerse despues; se reabrira en la proxima lectura.
+ *
+ * @param source Fuente a cerrar.
+ */
+void procfs_source_close(procfs_source_t* source);
+
+#endif // PROCFS_SOURCE_H
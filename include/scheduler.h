@@ -0,0 +1,149 @@
+/**
+ * @file scheduler.h
+ * @brief Planificador de coleccionistas con intervalos propios, sin deriva y con un pool de hilos.
+ *
+ * Cada coleccionista se registra con su intervalo y su tiempo maximo de
+ * ejecucion. Un hilo despachador duerme con
+ * clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME) hasta el proximo plazo
+ * absoluto (inicio + k * intervalo) y encola los coleccionistas vencidos; un
+ * pool fijo de hilos los ejecuta en paralelo. El tiempo de recoleccion no se
+ * acumula y las muestras quedan equiespaciadas.
+ *
+ * Un coleccionista nunca corre dos veces a la vez: si sigue en ejecucion al
+ * llegar su plazo, ese plazo se saltea y se cuenta como perdido, sin bloquear
+ * a los demas. Si una ejecucion supera su tiempo maximo se cuenta una vez como
+ * vencida. Una lectura colgada ocupa un solo hilo del pool; para que varios
+ * coleccionistas de la misma clase (por ejemplo los que leen /sys) no puedan
+ * colgar el pool entero, se los agrupa con scheduler_add_group(), que limita
+ * cuantos hilos puede ocupar el grupo a la vez. Los del grupo que no tienen
+ * lugar esperan en la cola sin bloquear a los demas coleccionistas.
+ */
+
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <stddef.h>
+
+/**
+ * @brief Cantidad maxima de coleccionistas registrados.
+ */
+#define SCHEDULER_MAX_TASKS 32
+
+/**
+ * @brief Cantidad de hilos del pool si se pasa 0 a scheduler_start().
+ */
+#define SCHEDULER_DEFAULT_WORKERS 4
+
+/**
+ * @brief Cantidad maxima de hilos del pool.
+ */
+#define SCHEDULER_MAX_WORKERS 64
+
+/**
+ * @brief Cantidad maxima de grupos de coleccionistas.
+ */
+#define SCHEDULER_MAX_GROUPS 8
+
+/**
+ * @brief Grupo de los coleccionistas que no tienen limite propio de hilos.
+ */
+#define SCHEDULER_NO_GROUP (-1)
+
+/**
+ * @brief Funcion de recoleccion de un coleccionista.
+ */
+typedef void (*scheduler_collect_t)(void);
+
+/**
+ * @brief Funcion que recibe la duracion de cada ejecucion de un coleccionista.
+ *
+ * Se llama desde el hilo del pool que ejecuto al coleccionista.
+ *
+ * @param index Indice del coleccionista.
+ * @param seconds Duracion de la ejecucion en segundos.
+ */
+typedef void (*scheduler_observer_t)(size_t index, double seconds);
+
+/**
+ * @brief Registra un coleccionista. Debe llamarse antes de scheduler_start().
+ *
+ * @param name Nombre del coleccionista (se usa como etiqueta en las metricas).
+ * @param collect Funcion de recoleccion.
+ * @param interval_ms Intervalo entre recolecciones en milisegundos.
+ * @param timeout_ms Tiempo maximo de una ejecucion en milisegundos; 0 para usar el intervalo.
+ * @param group Grupo devuelto por scheduler_add_group(), o SCHEDULER_NO_GROUP.
+ * @return Indice del coleccionista, o -1 si no hay lugar o algun argumento no es valido.
+ */
+int scheduler_register(const char* name, scheduler_collect_t collect, long interval_ms, long timeout_ms, int group);
+
+/**
+ * @brief Crea un grupo de coleccionistas que comparte un limite de hilos del pool. Debe llamarse antes de
+ * scheduler_start().
+ *
+ * @param max_workers Cantidad maxima de coleccionistas del grupo que pueden ejecutarse a la vez (al menos 1).
+ * @return Identificador del grupo, o -1 si no hay lugar o el limite no es valido.
+ */
+int scheduler_add_group(size_t max_workers);
+
+/**
+ * @brief Fija la funcion que recibe la duracion de cada ejecucion. Debe llamarse antes de scheduler_start().
+ *
+ * @param observer Funcion a llamar, o NULL para ninguna.
+ */
+void scheduler_set_observer(scheduler_observer_t observer);
+
+/**
+ * @brief Inicia el hilo despachador y el pool de hilos.
+ *
+ * Todos los coleccionistas corren por primera vez al iniciar y comparten el
+ * mismo instante de referencia para sus plazos.
+ *
+ * @param worker_count Cantidad de hilos del pool (0 para SCHEDULER_DEFAULT_WORKERS).
+ * @return 0 en caso de exito, -1 si no se pudo crear algun hilo.
+ */
+int scheduler_start(size_t worker_count);
+
+/**
+ * @brief Espera a que terminen el despachador y los hilos del pool.
+ */
+void scheduler_wait(void);
+
+/**
+ * @brief Detiene el despachador y los hilos del pool y espera a que terminen.
+ *
+ * Las ejecuciones en curso no se interrumpen.
+ */
+void scheduler_stop(void);
+
+/**
+ * @brief Cantidad de coleccionistas registrados.
+ *
+ * @return Cantidad de coleccionistas.
+ */
+size_t scheduler_task_count(void);
+
+/**
+ * @brief Nombre de un coleccionista.
+ *
+ * @param index Indice del coleccionista.
+ * @return Nombre con el que se registro.
+ */
+const char* scheduler_task_name(size_t index);
+
+/**
+ * @brief Cantidad de plazos perdidos por un coleccionista desde que se inicio.
+ *
+ * @param index Indice del coleccionista.
+ * @return Plazos perdidos.
+ */
+unsigned long long scheduler_missed_deadlines(size_t index);
+
+/**
+ * @brief Cantidad de ejecuciones de un coleccionista que superaron su tiempo maximo.
+ *
+ * @param index Indice del coleccionista.
+ * @return Ejecuciones vencidas.
+ */
+unsigned long long scheduler_timeouts(size_t index);
+
+#endif // SCHEDULER_H
@@ -0,0 +1,90 @@
+/**
+ * Copyright 2019-2020 DigitalOcean Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Compares prom_dtoa with the snprintf("%.17g") it replaced, over a mix of values shaped like samples: whole-number
+// gauges and counters, percentages, byte rates and latencies. Prints the mean time per value and the bytes written.
+//
+// Usage: prom_dtoa_bench [iterations]
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+// Private
+#include "prom_dtoa_i.h"
+
+#define PROM_DTOA_BENCH_VALUES 4096
+#define PROM_DTOA_BENCH_ITERATIONS 500
+
+static volatile size_t sink;
+
+static long long prom_dtoa_bench_now_ns(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (long long)now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+int main(int argc, char **argv) {
+  long iterations = argc > 1 ? atol(argv[1]) : PROM_DTOA_BENCH_ITERATIONS;
+  if (iterations <= 0) iterations = PROM_DTOA_BENCH_ITERATIONS;
+
+  static double values[PROM_DTOA_BENCH_VALUES];
+  srand(1);
+  for (int i = 0; i < PROM_DTOA_BENCH_VALUES; i++) {
+    switch (i % 5) {
+      case 0:  // process counts, file descriptors
+        values[i] = (double)(rand() % 5000);
+        break;
+      case 1:  // byte counters
+        values[i] = (double)rand() * 4096.0;
+        break;
+      case 2:  // percentages with two decimals
+        values[i] = (double)(rand() % 10000) / 100.0;
+        break;
+      case 3:  // rates: a counter delta over an elapsed time
+        values[i] = (double)(rand() % 100000000) / (1.0 + (double)(rand() % 1000) / 997.0);
+        break;
+      default:  // latencies in seconds
+        values[i] = (double)rand() / RAND_MAX * 0.25;
+        break;
+    }
+  }
+
+  char buffer[PROM_DTOA_BUFFER_SIZE];
+  size_t dtoa_bytes = 0;
+  size_t printf_bytes = 0;
+  for (int i = 0; i < PROM_DTOA_BENCH_VALUES; i++) {
+    dtoa_bytes += prom_dtoa(values[i], buffer);
+    printf_bytes += (size_t)snprintf(buffer, sizeof(buffer), "%.17g", values[i]);
+  }
+
+  long long start = prom_dtoa_bench_now_ns();
+  for (long n = 0; n < iterations; n++) {
+    for (int i = 0; i < PROM_DTOA_BENCH_VALUES; i++) sink += prom_dtoa(values[i], buffer);
+  }
+  double dtoa_ns = (double)(prom_dtoa_bench_now_ns() - start) / ((double)iterations * PROM_DTOA_BENCH_VALUES);
+
+  start = prom_dtoa_bench_now_ns();
+  for (long n = 0; n < iterations; n++) {
+    for (int i = 0; i < PROM_DTOA_BENCH_VALUES; i++) sink += snprintf(buffer, sizeof(buffer), "%.17g", values[i]);
+  }
+  double printf_ns = (double)(prom_dtoa_bench_now_ns() - start) / ((double)iterations * PROM_DTOA_BENCH_VALUES);
+
+  printf("prom_dtoa %8.1f ns/value %8zu bytes\n", dtoa_ns, dtoa_bytes);
+  printf("%%.17g     %8.1f ns/value %8zu bytes\n", printf_ns, printf_bytes);
+  return 0;
+}
@@ -0,0 +1,112 @@
+/**
+ * Copyright 2019-2020 DigitalOcean Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Compares the encode time and payload size of the text, protobuf and OpenMetrics expositions of the same registry:
+// per-CPU gauges, labelled counters and histograms, with fractional values as real samples have. Every family is
+// updated before each scrape so that no format is served from an unchanged render.
+//
+// Usage: prom_exposition_bench [label_sets [scrapes]]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "prom.h"
+
+#define PROM_EXPOSITION_BENCH_LABEL_SETS 2000
+#define PROM_EXPOSITION_BENCH_SCRAPES 20
+
+static const char *prom_exposition_bench_modes[] = {"user", "nice", "system", "idle", "iowait", "irq", "softirq", "steal"};
+
+static double prom_exposition_bench_now_ms(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (double)now.tv_sec * 1e3 + (double)now.tv_nsec / 1e6;
+}
+
+/**
+ * @brief Reads a whole exposition and returns its size in bytes
+ */
+static size_t prom_exposition_bench_scrape(prom_exposition_format_t format) {
+  prom_collector_registry_stream_t *stream = prom_collector_registry_stream_new(PROM_COLLECTOR_REGISTRY_DEFAULT, format);
+  if (stream == NULL) return 0;
+  static char buffer[65536];
+  size_t total = 0;
+  ssize_t n;
+  while ((n = prom_collector_registry_stream_read(stream, buffer, sizeof(buffer))) > 0) total += (size_t)n;
+  prom_collector_registry_stream_destroy(stream);
+  return total;
+}
+
+int main(int argc, char **argv) {
+  int label_sets = argc > 1 ? atoi(argv[1]) : PROM_EXPOSITION_BENCH_LABEL_SETS;
+  int scrapes = argc > 2 ? atoi(argv[2]) : PROM_EXPOSITION_BENCH_SCRAPES;
+  if (label_sets <= 0) label_sets = PROM_EXPOSITION_BENCH_LABEL_SETS;
+  if (scrapes <= 0) scrapes = PROM_EXPOSITION_BENCH_SCRAPES;
+
+  prom_collector_registry_default_init();
+  prom_gauge_t *cpu = prom_collector_registry_must_register_metric(
+      prom_gauge_new("cpu_usage_percentage", "Porcentaje de uso de CPU", 2, (const char *[]){"cpu", "mode"}));
+  prom_counter_t *bytes = prom_collector_registry_must_register_metric(
+      prom_counter_new("network_receive_bytes_total", "Bytes recibidos", 1, (const char *[]){"interface"}));
+  prom_histogram_t *latency = prom_collector_registry_must_register_metric(
+      prom_histogram_new("request_duration_seconds", "Duracion de las solicitudes",
+                         prom_histogram_buckets_exponential(0.0005, 2, 12), 1, (const char *[]){"path"}));
+
+  char label[32];
+  srand(1);
+  for (int i = 0; i < label_sets; i++) {
+    snprintf(label, sizeof(label), "cpu%d", i);
+    for (size_t mode = 0; mode < sizeof(prom_exposition_bench_modes) / sizeof(prom_exposition_bench_modes[0]); mode++) {
+      prom_gauge_set(cpu, (double)rand() / RAND_MAX * 100.0, (const char *[]){label, prom_exposition_bench_modes[mode]});
+    }
+    snprintf(label, sizeof(label), "eth%d", i);
+    prom_counter_add(bytes, (double)rand() * 1536.0, (const char *[]){label});
+    snprintf(label, sizeof(label), "/api/v1/item/%d", i);
+    for (int n = 0; n < 8; n++) {
+      prom_histogram_observe(latency, (double)rand() / RAND_MAX * 0.5, (const char *[]){label});
+    }
+  }
+
+  static const struct {
+    prom_exposition_format_t format;
+    const char *name;
+  } formats[] = {
+      {PROM_EXPOSITION_TEXT, "text"},
+      {PROM_EXPOSITION_PROTOBUF, "protobuf"},
+      {PROM_EXPOSITION_OPENMETRICS, "openmetrics"},
+  };
+
+  printf("%d label sets, %d scrapes\n", label_sets, scrapes);
+  for (size_t f = 0; f < sizeof(formats) / sizeof(formats[0]); f++) {
+    size_t size = 0;
+    double elapsed = 0;
+    for (int s = 0; s < scrapes; s++) {
+      prom_gauge_add(cpu, 0.25, (const char *[]){"cpu0", "user"});
+      prom_counter_add(bytes, 1500, (const char *[]){"eth0"});
+      prom_histogram_observe(latency, 0.0125, (const char *[]){"/api/v1/item/0"});
+
+      double start = prom_exposition_bench_now_ms();
+      size = prom_exposition_bench_scrape(formats[f].format);
+      elapsed += prom_exposition_bench_now_ms() - start;
+    }
+    printf("%-12s %9.2f ms/scrape %10zu bytes\n", formats[f].name, elapsed / scrapes, size);
+  }
+
+  prom_collector_registry_destroy(PROM_COLLECTOR_REGISTRY_DEFAULT);
+  PROM_COLLECTOR_REGISTRY_DEFAULT = NULL;
+  return 0;
+}
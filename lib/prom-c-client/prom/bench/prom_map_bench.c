@@ -0,0 +1,348 @@
+/**
+ * Copyright 2019-2020 DigitalOcean Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Compares prom_map with the chained map it replaced, at 10, 1k, 100k and 1M keys. For each size and table it times
+// inserting every key into an empty map, looking up every key in shuffled order, looking up as many absent keys, and
+// deleting a sample of the keys, and prints the mean time per operation. Both tables remove a deleted key from their
+// insertion-ordered keys list with a linear scan, so deletes are sampled rather than run over every key. Small sizes
+// are repeated over fresh maps until each measurement covers about a million operations.
+//
+// Usage: prom_map_bench [max_keys]
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Public
+#include "prom_alloc.h"
+
+// Private
+#include "prom_linked_list_i.h"
+#include "prom_linked_list_t.h"
+#include "prom_map_i.h"
+#include "prom_map_t.h"
+
+#define PROM_MAP_BENCH_MAX_KEYS 1000000
+#define PROM_MAP_BENCH_OPERATIONS 1000000
+#define PROM_MAP_BENCH_DELETES 256
+
+static volatile size_t sink;
+
+static long long prom_map_bench_now_ns(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (long long)now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// prom_map_bench_chained: the chained prom_map as it was before the Robin Hood table, kept here as the baseline. Only
+// the delete path differs: the original removed the bucket node by passing the list node to the key comparison and
+// then read the key of the freed map node, so it removes by map node and unlinks the key first.
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#define PROM_MAP_BENCH_CHAINED_INITIAL_SIZE 32
+
+typedef struct prom_map_bench_chained_node {
+  const char *key;
+  void *value;
+} prom_map_bench_chained_node_t;
+
+typedef struct prom_map_bench_chained {
+  size_t size;
+  size_t max_size;
+  prom_linked_list_t *keys;
+  prom_linked_list_t **addrs;
+  pthread_rwlock_t rwlock;
+} prom_map_bench_chained_t;
+
+static prom_map_bench_chained_node_t *prom_map_bench_chained_node_new(const char *key, void *value) {
+  prom_map_bench_chained_node_t *self = prom_malloc(sizeof(prom_map_bench_chained_node_t));
+  self->key = prom_strdup(key);
+  self->value = value;
+  return self;
+}
+
+static void prom_map_bench_chained_node_free(void *item) {
+  prom_map_bench_chained_node_t *self = (prom_map_bench_chained_node_t *)item;
+  prom_free((void *)self->key);
+  prom_free(self);
+}
+
+static prom_linked_list_compare_t prom_map_bench_chained_node_compare(void *item_a, void *item_b) {
+  return strcmp(((prom_map_bench_chained_node_t *)item_a)->key, ((prom_map_bench_chained_node_t *)item_b)->key);
+}
+
+static prom_linked_list_t **prom_map_bench_chained_addrs_new(size_t max_size) {
+  prom_linked_list_t **addrs = prom_malloc(sizeof(prom_linked_list_t *) * max_size);
+  for (size_t i = 0; i < max_size; i++) {
+    addrs[i] = prom_linked_list_new();
+    prom_linked_list_set_free_fn(addrs[i], prom_map_bench_chained_node_free);
+    prom_linked_list_set_compare_fn(addrs[i], prom_map_bench_chained_node_compare);
+  }
+  return addrs;
+}
+
+static void *prom_map_bench_chained_new(void) {
+  prom_map_bench_chained_t *self = prom_malloc(sizeof(prom_map_bench_chained_t));
+  self->size = 0;
+  self->max_size = PROM_MAP_BENCH_CHAINED_INITIAL_SIZE;
+  self->keys = prom_linked_list_new();
+  prom_linked_list_set_free_fn(self->keys, prom_linked_list_no_op_free);
+  self->addrs = prom_map_bench_chained_addrs_new(self->max_size);
+  pthread_rwlock_init(&self->rwlock, NULL);
+  return self;
+}
+
+static void prom_map_bench_chained_destroy(void *map) {
+  prom_map_bench_chained_t *self = (prom_map_bench_chained_t *)map;
+  prom_linked_list_destroy(self->keys);
+  for (size_t i = 0; i < self->max_size; i++) prom_linked_list_destroy(self->addrs[i]);
+  prom_free(self->addrs);
+  pthread_rwlock_destroy(&self->rwlock);
+  prom_free(self);
+}
+
+static size_t prom_map_bench_chained_index(const char *key, size_t max_size) {
+  size_t index;
+  size_t a = 31415, b = 27183;
+  for (index = 0; *key != '\0'; key++, a = a * b % (max_size - 1)) {
+    index = (a * index + *key) % max_size;
+  }
+  return index;
+}
+
+static void *prom_map_bench_chained_get(void *map, const char *key) {
+  prom_map_bench_chained_t *self = (prom_map_bench_chained_t *)map;
+  pthread_rwlock_wrlock(&self->rwlock);
+  prom_linked_list_t *list = self->addrs[prom_map_bench_chained_index(key, self->max_size)];
+  prom_map_bench_chained_node_t *temp = prom_map_bench_chained_node_new(key, NULL);
+  void *payload = NULL;
+  for (prom_linked_list_node_t *node = list->head; node != NULL; node = node->next) {
+    if (prom_linked_list_compare(list, node->item, temp) == PROM_EQUAL) {
+      payload = ((prom_map_bench_chained_node_t *)node->item)->value;
+      break;
+    }
+  }
+  prom_map_bench_chained_node_free(temp);
+  pthread_rwlock_unlock(&self->rwlock);
+  return payload;
+}
+
+static void prom_map_bench_chained_set_internal(prom_linked_list_t *keys, prom_linked_list_t **addrs, size_t max_size,
+                                                size_t *size, const char *key, void *value) {
+  prom_map_bench_chained_node_t *map_node = prom_map_bench_chained_node_new(key, value);
+  prom_linked_list_t *list = addrs[prom_map_bench_chained_index(key, max_size)];
+  for (prom_linked_list_node_t *node = list->head; node != NULL; node = node->next) {
+    if (prom_linked_list_compare(list, node->item, map_node) == PROM_EQUAL) {
+      prom_map_bench_chained_node_free(node->item);
+      node->item = map_node;
+      return;
+    }
+  }
+  prom_linked_list_append(list, map_node);
+  prom_linked_list_append(keys, (char *)map_node->key);
+  (*size)++;
+}
+
+static void prom_map_bench_chained_ensure_space(prom_map_bench_chained_t *self) {
+  if (self->size <= self->max_size / 2) return;
+
+  size_t new_max = self->max_size * 2;
+  size_t new_size = 0;
+  prom_linked_list_t *new_keys = prom_linked_list_new();
+  prom_linked_list_set_free_fn(new_keys, prom_linked_list_no_op_free);
+  prom_linked_list_t **new_addrs = prom_map_bench_chained_addrs_new(new_max);
+
+  // Every node is copied into the new table, key included, and the old one freed
+  for (size_t i = 0; i < self->max_size; i++) {
+    prom_linked_list_node_t *node = self->addrs[i]->head;
+    while (node != NULL) {
+      prom_map_bench_chained_node_t *map_node = (prom_map_bench_chained_node_t *)node->item;
+      prom_map_bench_chained_set_internal(new_keys, new_addrs, new_max, &new_size, map_node->key, map_node->value);
+      prom_linked_list_node_t *next = node->next;
+      prom_free(node);
+      prom_map_bench_chained_node_free(map_node);
+      node = next;
+    }
+    prom_free(self->addrs[i]);
+  }
+  prom_linked_list_destroy(self->keys);
+  prom_free(self->addrs);
+
+  self->size = new_size;
+  self->max_size = new_max;
+  self->keys = new_keys;
+  self->addrs = new_addrs;
+}
+
+static void prom_map_bench_chained_set(void *map, const char *key, void *value) {
+  prom_map_bench_chained_t *self = (prom_map_bench_chained_t *)map;
+  pthread_rwlock_wrlock(&self->rwlock);
+  prom_map_bench_chained_ensure_space(self);
+  prom_map_bench_chained_set_internal(self->keys, self->addrs, self->max_size, &self->size, key, value);
+  pthread_rwlock_unlock(&self->rwlock);
+}
+
+static void prom_map_bench_chained_delete(void *map, const char *key) {
+  prom_map_bench_chained_t *self = (prom_map_bench_chained_t *)map;
+  pthread_rwlock_wrlock(&self->rwlock);
+  prom_linked_list_t *list = self->addrs[prom_map_bench_chained_index(key, self->max_size)];
+  prom_map_bench_chained_node_t *temp = prom_map_bench_chained_node_new(key, NULL);
+  for (prom_linked_list_node_t *node = list->head; node != NULL; node = node->next) {
+    prom_map_bench_chained_node_t *map_node = (prom_map_bench_chained_node_t *)node->item;
+    if (prom_linked_list_compare(list, map_node, temp) == PROM_EQUAL) {
+      prom_linked_list_remove(self->keys, (char *)map_node->key);
+      prom_linked_list_remove(list, map_node);
+      self->size--;
+      break;
+    }
+  }
+  prom_map_bench_chained_node_free(temp);
+  pthread_rwlock_unlock(&self->rwlock);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// prom_map
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void *prom_map_bench_robin_hood_new(void) { return prom_map_new(); }
+
+static void prom_map_bench_robin_hood_destroy(void *map) { prom_map_destroy((prom_map_t *)map); }
+
+static void *prom_map_bench_robin_hood_get(void *map, const char *key) { return prom_map_get((prom_map_t *)map, key); }
+
+static void prom_map_bench_robin_hood_set(void *map, const char *key, void *value) {
+  prom_map_set((prom_map_t *)map, key, value);
+}
+
+static void prom_map_bench_robin_hood_delete(void *map, const char *key) { prom_map_delete((prom_map_t *)map, key); }
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Benchmark
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+typedef struct prom_map_bench_table {
+  const char *name;
+  void *(*new_fn)(void);
+  void (*destroy_fn)(void *);
+  void *(*get_fn)(void *, const char *);
+  void (*set_fn)(void *, const char *, void *);
+  void (*delete_fn)(void *, const char *);
+} prom_map_bench_table_t;
+
+static const prom_map_bench_table_t prom_map_bench_tables[] = {
+    {"chained", prom_map_bench_chained_new, prom_map_bench_chained_destroy, prom_map_bench_chained_get,
+     prom_map_bench_chained_set, prom_map_bench_chained_delete},
+    {"prom_map", prom_map_bench_robin_hood_new, prom_map_bench_robin_hood_destroy, prom_map_bench_robin_hood_get,
+     prom_map_bench_robin_hood_set, prom_map_bench_robin_hood_delete},
+};
+
+/**
+ * @brief Returns count keys shaped like the label values a sample map is keyed by, built with the given prefix
+ */
+static char **prom_map_bench_keys(const char *prefix, size_t count) {
+  char **keys = malloc(count * sizeof(char *));
+  char key[64];
+  for (size_t i = 0; i < count; i++) {
+    snprintf(key, sizeof(key), "%s%zu-%zx", prefix, i, (i * 2654435761u) & 0xffff);
+    keys[i] = strdup(key);
+  }
+  return keys;
+}
+
+static void prom_map_bench_shuffle(size_t *order, size_t count) {
+  for (size_t i = 0; i < count; i++) order[i] = i;
+  for (size_t i = count; i > 1; i--) {
+    size_t j = (size_t)rand() % i;
+    size_t swap = order[i - 1];
+    order[i - 1] = order[j];
+    order[j] = swap;
+  }
+}
+
+static int prom_map_bench_run(const prom_map_bench_table_t *table, char **keys, char **misses, size_t *order,
+                              size_t count) {
+  size_t rounds = count < PROM_MAP_BENCH_OPERATIONS ? PROM_MAP_BENCH_OPERATIONS / count : 1;
+  size_t deletes = count < PROM_MAP_BENCH_DELETES ? count : PROM_MAP_BENCH_DELETES;
+  long long set_ns = 0, hit_ns = 0, miss_ns = 0, delete_ns = 0;
+
+  for (size_t round = 0; round < rounds; round++) {
+    void *map = table->new_fn();
+
+    long long start = prom_map_bench_now_ns();
+    for (size_t i = 0; i < count; i++) table->set_fn(map, keys[i], keys[i]);
+    set_ns += prom_map_bench_now_ns() - start;
+
+    start = prom_map_bench_now_ns();
+    for (size_t i = 0; i < count; i++) {
+      const char *key = keys[order[i]];
+      if (table->get_fn(map, key) != key) return 1;
+    }
+    hit_ns += prom_map_bench_now_ns() - start;
+
+    start = prom_map_bench_now_ns();
+    for (size_t i = 0; i < count; i++) sink += table->get_fn(map, misses[order[i]]) != NULL;
+    miss_ns += prom_map_bench_now_ns() - start;
+
+    // Spread the sampled keys over the whole insertion order, since both tables scan the keys list to unlink them
+    start = prom_map_bench_now_ns();
+    for (size_t i = 0; i < deletes; i++) table->delete_fn(map, keys[i * (count / deletes)]);
+    delete_ns += prom_map_bench_now_ns() - start;
+
+    if (table->get_fn(map, keys[0]) != NULL) return 1;
+    table->destroy_fn(map);
+  }
+
+  double operations = (double)rounds * (double)count;
+  printf("%8zu %-9s %9.1f %9.1f %9.1f %9.1f\n", count, table->name, (double)set_ns / operations,
+         (double)hit_ns / operations, (double)miss_ns / operations,
+         (double)delete_ns / ((double)rounds * (double)deletes));
+  return 0;
+}
+
+int main(int argc, char **argv) {
+  size_t max_keys = argc > 1 ? (size_t)atol(argv[1]) : PROM_MAP_BENCH_MAX_KEYS;
+  if (max_keys == 0) max_keys = PROM_MAP_BENCH_MAX_KEYS;
+
+  char **keys = prom_map_bench_keys("value-", max_keys);
+  char **misses = prom_map_bench_keys("absent-", max_keys);
+  size_t *order = malloc(max_keys * sizeof(size_t));
+  srand(1);
+
+  printf("%8s %-9s %9s %9s %9s %9s\n", "keys", "table", "set ns", "hit ns", "miss ns", "delete ns");
+  static const size_t sizes[] = {10, 1000, 100000, 1000000};
+  for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]) && sizes[s] <= max_keys; s++) {
+    prom_map_bench_shuffle(order, sizes[s]);
+    for (size_t t = 0; t < sizeof(prom_map_bench_tables) / sizeof(prom_map_bench_tables[0]); t++) {
+      if (prom_map_bench_run(&prom_map_bench_tables[t], keys, misses, order, sizes[s])) {
+        fprintf(stderr, "%s returned a wrong value\n", prom_map_bench_tables[t].name);
+        return 1;
+      }
+    }
+  }
+
+  for (size_t i = 0; i < max_keys; i++) {
+    free(keys[i]);
+    free(misses[i]);
+  }
+  free(keys);
+  free(misses);
+  free(order);
+  return 0;
+}
@@ -0,0 +1,195 @@
+/**
+ * Copyright 2019-2020 DigitalOcean Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Measures how lookups scale with the number of threads. For 1, 2, 4, ... 64 reader threads, each thread alternates
+// prom_map_get on a pre-filled map with prom_counter_inc on one of the pre-filled label sets of a counter, for a fixed
+// time, once alone and once next to a writer thread that keeps inserting new keys into the map and new label sets
+// into the counter. Each configuration runs twice: "rdlock" calls the library as it is, where lookups share the read
+// lock, and "wrlock" takes one exclusive lock around every operation, which serializes lookups the way the write lock
+// in prom_map_get used to. Prints the aggregate reader operations per second.
+//
+// Usage: prom_map_contention_bench [seconds [keys [max_threads]]]
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "prom.h"
+
+// Private
+#include "prom_map_i.h"
+
+#define PROM_MAP_CONTENTION_BENCH_SECONDS 0.5
+#define PROM_MAP_CONTENTION_BENCH_KEYS 10000
+#define PROM_MAP_CONTENTION_BENCH_MAX_THREADS 64
+
+// Keys the writer keeps in the map at once. Older ones are deleted, so the map does not grow for the whole run
+#define PROM_MAP_CONTENTION_BENCH_WRITER_WINDOW 1024
+
+static prom_map_t *prom_map_contention_bench_map;
+static prom_counter_t *prom_map_contention_bench_counter;
+static char **prom_map_contention_bench_keys;
+static int prom_map_contention_bench_key_count;
+static bool prom_map_contention_bench_exclusive;
+static pthread_rwlock_t prom_map_contention_bench_lock = PTHREAD_RWLOCK_INITIALIZER;
+static atomic_int prom_map_contention_bench_stop;
+static unsigned long prom_map_contention_bench_generation;
+
+typedef struct prom_map_contention_bench_thread {
+  pthread_t thread;
+  unsigned seed;
+  unsigned long operations;
+} prom_map_contention_bench_thread_t;
+
+static double prom_map_contention_bench_now(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+static void prom_map_contention_bench_lock_acquire(void) {
+  if (prom_map_contention_bench_exclusive) pthread_rwlock_wrlock(&prom_map_contention_bench_lock);
+}
+
+static void prom_map_contention_bench_lock_release(void) {
+  if (prom_map_contention_bench_exclusive) pthread_rwlock_unlock(&prom_map_contention_bench_lock);
+}
+
+static void *prom_map_contention_bench_reader(void *arg) {
+  prom_map_contention_bench_thread_t *self = (prom_map_contention_bench_thread_t *)arg;
+  while (!atomic_load_explicit(&prom_map_contention_bench_stop, memory_order_relaxed)) {
+    self->seed = self->seed * 1103515245 + 12345;
+    unsigned index = (self->seed >> 8) % (unsigned)prom_map_contention_bench_key_count;
+    const char *key = prom_map_contention_bench_keys[index];
+
+    prom_map_contention_bench_lock_acquire();
+    if (prom_map_get(prom_map_contention_bench_map, key) == NULL) abort();
+    prom_map_contention_bench_lock_release();
+
+    prom_map_contention_bench_lock_acquire();
+    prom_counter_inc(prom_map_contention_bench_counter, (const char *[]){key});
+    prom_map_contention_bench_lock_release();
+
+    self->operations += 2;
+  }
+  return NULL;
+}
+
+static void *prom_map_contention_bench_writer(void *arg) {
+  prom_map_contention_bench_thread_t *self = (prom_map_contention_bench_thread_t *)arg;
+  char key[64];
+  for (unsigned long i = 0; !atomic_load_explicit(&prom_map_contention_bench_stop, memory_order_relaxed); i++) {
+    snprintf(key, sizeof(key), "new-%lu-%lu", prom_map_contention_bench_generation, i);
+    prom_map_contention_bench_lock_acquire();
+    prom_map_set(prom_map_contention_bench_map, key, prom_map_contention_bench_keys[0]);
+    prom_map_contention_bench_lock_release();
+
+    if (i >= PROM_MAP_CONTENTION_BENCH_WRITER_WINDOW) {
+      snprintf(key, sizeof(key), "new-%lu-%lu", prom_map_contention_bench_generation,
+               i - PROM_MAP_CONTENTION_BENCH_WRITER_WINDOW);
+      prom_map_contention_bench_lock_acquire();
+      prom_map_delete(prom_map_contention_bench_map, key);
+      prom_map_contention_bench_lock_release();
+    }
+
+    // Label sets cannot be removed, so the counter only gets a new one on 1 write in 16
+    if (i % 16 == 0) {
+      prom_map_contention_bench_lock_acquire();
+      prom_counter_inc(prom_map_contention_bench_counter, (const char *[]){key});
+      prom_map_contention_bench_lock_release();
+    }
+    self->operations++;
+  }
+  return NULL;
+}
+
+/**
+ * @brief Runs thread_count readers, and a writer if requested, for the given time and returns reader operations per
+ * second
+ */
+static double prom_map_contention_bench_run(int thread_count, bool writer, double seconds) {
+  prom_map_contention_bench_thread_t threads[PROM_MAP_CONTENTION_BENCH_MAX_THREADS + 1];
+  memset(threads, 0, sizeof(threads));
+  atomic_store(&prom_map_contention_bench_stop, 0);
+  prom_map_contention_bench_generation++;
+
+  double start = prom_map_contention_bench_now();
+  for (int i = 0; i < thread_count; i++) {
+    threads[i].seed = (unsigned)i * 7919 + 1;
+    pthread_create(&threads[i].thread, NULL, prom_map_contention_bench_reader, &threads[i]);
+  }
+  if (writer) {
+    pthread_create(&threads[thread_count].thread, NULL, prom_map_contention_bench_writer, &threads[thread_count]);
+  }
+
+  struct timespec sleep = {.tv_sec = (time_t)seconds, .tv_nsec = (long)((seconds - (double)(time_t)seconds) * 1e9)};
+  nanosleep(&sleep, NULL);
+  atomic_store(&prom_map_contention_bench_stop, 1);
+
+  unsigned long operations = 0;
+  for (int i = 0; i < thread_count; i++) {
+    pthread_join(threads[i].thread, NULL);
+    operations += threads[i].operations;
+  }
+  if (writer) pthread_join(threads[thread_count].thread, NULL);
+  return (double)operations / (prom_map_contention_bench_now() - start);
+}
+
+int main(int argc, char **argv) {
+  double seconds = argc > 1 ? atof(argv[1]) : PROM_MAP_CONTENTION_BENCH_SECONDS;
+  prom_map_contention_bench_key_count = argc > 2 ? atoi(argv[2]) : PROM_MAP_CONTENTION_BENCH_KEYS;
+  int max_threads = argc > 3 ? atoi(argv[3]) : PROM_MAP_CONTENTION_BENCH_MAX_THREADS;
+  if (seconds <= 0 || prom_map_contention_bench_key_count <= 0 || max_threads <= 0 ||
+      max_threads > PROM_MAP_CONTENTION_BENCH_MAX_THREADS) {
+    fprintf(stderr, "usage: %s [seconds [keys [max_threads <= %d]]]\n", argv[0],
+            PROM_MAP_CONTENTION_BENCH_MAX_THREADS);
+    return 1;
+  }
+
+  prom_collector_registry_default_init();
+  prom_map_contention_bench_counter = prom_collector_registry_must_register_metric(
+      prom_counter_new("bench_lookups_total", "Lookups", 1, (const char *[]){"key"}));
+  prom_map_contention_bench_map = prom_map_new();
+
+  char key[64];
+  prom_map_contention_bench_keys = malloc((size_t)prom_map_contention_bench_key_count * sizeof(char *));
+  for (int i = 0; i < prom_map_contention_bench_key_count; i++) {
+    snprintf(key, sizeof(key), "value-%d", i);
+    prom_map_contention_bench_keys[i] = strdup(key);
+    prom_map_set(prom_map_contention_bench_map, key, prom_map_contention_bench_keys[i]);
+    prom_counter_inc(prom_map_contention_bench_counter, (const char *[]){key});
+  }
+
+  printf("%d keys, %.2f s per run, reader ops/s\n", prom_map_contention_bench_key_count, seconds);
+  printf("%8s %14s %14s %14s %14s\n", "threads", "rdlock", "wrlock", "rdlock+writer", "wrlock+writer");
+  for (int thread_count = 1; thread_count <= max_threads; thread_count *= 2) {
+    double results[4];
+    for (int run = 0; run < 4; run++) {
+      prom_map_contention_bench_exclusive = run % 2 == 1;
+      results[run] = prom_map_contention_bench_run(thread_count, run >= 2, seconds);
+    }
+    printf("%8d %14.0f %14.0f %14.0f %14.0f\n", thread_count, results[0], results[1], results[2], results[3]);
+  }
+
+  prom_map_destroy(prom_map_contention_bench_map);
+  for (int i = 0; i < prom_map_contention_bench_key_count; i++) free(prom_map_contention_bench_keys[i]);
+  free(prom_map_contention_bench_keys);
+  return 0;
+}
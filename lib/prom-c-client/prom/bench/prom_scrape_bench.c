@@ -0,0 +1,200 @@
+/**
+ * Copyright 2019-2020 DigitalOcean Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Measures update and scrape latency while both run concurrently. Each scraper thread reads the text exposition a fixed
+// number of times, as the HTTP server's threads do, while writer threads increment a counter and observe a histogram,
+// creating a new label set on 1 update in 100, until the scrapers are done. Next to the two busy families the registry
+// holds families that never change, so scrapes also copy cached expositions. Prints the update latency percentiles over
+// all writers and the scrape latency percentiles over all scrapers, with the CPU time each group used, since on a machine
+// with fewer CPUs than threads the latencies mostly show how the CPU was shared.
+//
+// Usage: prom_scrape_bench [writers [scrapers [series [scrapes]]]]
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "prom.h"
+
+#define PROM_SCRAPE_BENCH_WRITERS 4
+#define PROM_SCRAPE_BENCH_SCRAPERS 4
+#define PROM_SCRAPE_BENCH_SERIES 20000
+#define PROM_SCRAPE_BENCH_SCRAPES 10
+#define PROM_SCRAPE_BENCH_MAX_UPDATES 2000000
+#define PROM_SCRAPE_BENCH_STATIC_FAMILIES 50
+#define PROM_SCRAPE_BENCH_STATIC_SERIES 200
+
+static prom_counter_t *prom_scrape_bench_counter;
+static prom_histogram_t *prom_scrape_bench_histogram;
+static int prom_scrape_bench_series;
+static int prom_scrape_bench_scrapes;
+static atomic_int prom_scrape_bench_stop;
+
+typedef struct prom_scrape_bench_thread {
+  pthread_t thread;
+  long id;
+  double *latencies; /**< latencies in seconds */
+  int count;         /**< count of latencies */
+  double cpu;        /**< cpu time used by the thread in seconds */
+} prom_scrape_bench_thread_t;
+
+static double prom_scrape_bench_now(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+static double prom_scrape_bench_cpu(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+  return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+static int prom_scrape_bench_compare(const void *a, const void *b) {
+  double x = *(const double *)a;
+  double y = *(const double *)b;
+  return x < y ? -1 : x > y;
+}
+
+static void *prom_scrape_bench_writer(void *arg) {
+  prom_scrape_bench_thread_t *self = (prom_scrape_bench_thread_t *)arg;
+  unsigned seed = (unsigned)self->id * 7919 + 1;
+  char key[32];
+  for (int i = 0; i < PROM_SCRAPE_BENCH_MAX_UPDATES && !atomic_load(&prom_scrape_bench_stop); i++) {
+    seed = seed * 1103515245 + 12345;
+    if (i % 100 == 0) {
+      snprintf(key, sizeof(key), "n%ld-%d", self->id, i);
+    } else {
+      snprintf(key, sizeof(key), "v%u", (seed >> 8) % (unsigned)prom_scrape_bench_series);
+    }
+    double start = prom_scrape_bench_now();
+    prom_counter_inc(prom_scrape_bench_counter, (const char *[]){key});
+    prom_histogram_observe(prom_scrape_bench_histogram, (seed % 100) / 100.0, (const char *[]){key});
+    self->latencies[self->count++] = prom_scrape_bench_now() - start;
+  }
+  self->cpu = prom_scrape_bench_cpu();
+  return NULL;
+}
+
+static void *prom_scrape_bench_scraper(void *arg) {
+  prom_scrape_bench_thread_t *self = (prom_scrape_bench_thread_t *)arg;
+  char buffer[65536];
+  while (self->count < prom_scrape_bench_scrapes) {
+    double start = prom_scrape_bench_now();
+    prom_collector_registry_stream_t *stream =
+        prom_collector_registry_stream_new(PROM_COLLECTOR_REGISTRY_DEFAULT, PROM_EXPOSITION_TEXT);
+    if (stream == NULL) break;
+    while (prom_collector_registry_stream_read(stream, buffer, sizeof(buffer)) > 0) {
+    }
+    prom_collector_registry_stream_destroy(stream);
+    self->latencies[self->count++] = prom_scrape_bench_now() - start;
+  }
+  self->cpu = prom_scrape_bench_cpu();
+  return NULL;
+}
+
+/**
+ * @brief Sorts the latencies of all threads together and returns the array, of count entries
+ */
+static double *prom_scrape_bench_merge(prom_scrape_bench_thread_t *threads, int thread_count, size_t *count,
+                                       double *cpu) {
+  *count = 0;
+  *cpu = 0;
+  for (int i = 0; i < thread_count; i++) {
+    *count += (size_t)threads[i].count;
+    *cpu += threads[i].cpu;
+  }
+  double *all = (double *)malloc((*count > 0 ? *count : 1) * sizeof(double));
+  size_t offset = 0;
+  for (int i = 0; i < thread_count; i++) {
+    memcpy(all + offset, threads[i].latencies, (size_t)threads[i].count * sizeof(double));
+    offset += (size_t)threads[i].count;
+  }
+  qsort(all, *count, sizeof(double), prom_scrape_bench_compare);
+  return all;
+}
+
+int main(int argc, char **argv) {
+  int writer_count = argc > 1 ? atoi(argv[1]) : PROM_SCRAPE_BENCH_WRITERS;
+  int scraper_count = argc > 2 ? atoi(argv[2]) : PROM_SCRAPE_BENCH_SCRAPERS;
+  prom_scrape_bench_series = argc > 3 ? atoi(argv[3]) : PROM_SCRAPE_BENCH_SERIES;
+  prom_scrape_bench_scrapes = argc > 4 ? atoi(argv[4]) : PROM_SCRAPE_BENCH_SCRAPES;
+  if (writer_count <= 0 || scraper_count <= 0 || prom_scrape_bench_series <= 0 || prom_scrape_bench_scrapes <= 0) {
+    fprintf(stderr, "usage: %s [writers [scrapers [series [scrapes]]]]\n", argv[0]);
+    return 1;
+  }
+
+  prom_collector_registry_default_init();
+  prom_scrape_bench_counter = prom_collector_registry_must_register_metric(
+      prom_counter_new("bench_requests_total", "Requests", 1, (const char *[]){"key"}));
+  prom_scrape_bench_histogram = prom_collector_registry_must_register_metric(
+      prom_histogram_new("bench_request_duration_seconds", "Request duration", NULL, 1, (const char *[]){"key"}));
+
+  char key[64];
+  for (int i = 0; i < prom_scrape_bench_series; i++) {
+    snprintf(key, sizeof(key), "v%d", i);
+    prom_counter_inc(prom_scrape_bench_counter, (const char *[]){key});
+    prom_histogram_observe(prom_scrape_bench_histogram, 0.1, (const char *[]){key});
+  }
+  for (int f = 0; f < PROM_SCRAPE_BENCH_STATIC_FAMILIES; f++) {
+    snprintf(key, sizeof(key), "bench_static_%d", f);
+    prom_gauge_t *gauge =
+        prom_collector_registry_must_register_metric(prom_gauge_new(strdup(key), "Static", 1, (const char *[]){"key"}));
+    for (int i = 0; i < PROM_SCRAPE_BENCH_STATIC_SERIES; i++) {
+      snprintf(key, sizeof(key), "s%d", i);
+      prom_gauge_set(gauge, i * 0.37, (const char *[]){key});
+    }
+  }
+
+  prom_scrape_bench_thread_t *writers = calloc((size_t)writer_count, sizeof(prom_scrape_bench_thread_t));
+  prom_scrape_bench_thread_t *scrapers = calloc((size_t)scraper_count, sizeof(prom_scrape_bench_thread_t));
+  for (long i = 0; i < writer_count; i++) {
+    writers[i].id = i;
+    writers[i].latencies = malloc(PROM_SCRAPE_BENCH_MAX_UPDATES * sizeof(double));
+    pthread_create(&writers[i].thread, NULL, prom_scrape_bench_writer, &writers[i]);
+  }
+  double start = prom_scrape_bench_now();
+  for (long i = 0; i < scraper_count; i++) {
+    scrapers[i].id = i;
+    scrapers[i].latencies = malloc((size_t)prom_scrape_bench_scrapes * sizeof(double));
+    pthread_create(&scrapers[i].thread, NULL, prom_scrape_bench_scraper, &scrapers[i]);
+  }
+  for (int i = 0; i < scraper_count; i++) pthread_join(scrapers[i].thread, NULL);
+  double elapsed = prom_scrape_bench_now() - start;
+  atomic_store(&prom_scrape_bench_stop, 1);
+  for (int i = 0; i < writer_count; i++) pthread_join(writers[i].thread, NULL);
+
+  size_t count;
+  double cpu;
+  double *all = prom_scrape_bench_merge(writers, writer_count, &count, &cpu);
+  printf("%d writers, %d scrapers, %d series, %d scrapes each in %.2f s\n", writer_count, scraper_count,
+         prom_scrape_bench_series, prom_scrape_bench_scrapes, elapsed);
+  printf("update us: n %zu p50 %.2f p99 %.2f p99.9 %.1f max %.0f, cpu %.2f s (%.2f us/update)\n", count,
+         all[count / 2] * 1e6, all[count * 99 / 100] * 1e6, all[count * 999 / 1000] * 1e6, all[count - 1] * 1e6, cpu,
+         cpu / (double)count * 1e6);
+  free(all);
+
+  all = prom_scrape_bench_merge(scrapers, scraper_count, &count, &cpu);
+  if (count > 0) {
+    printf("scrape ms: n %zu p50 %.1f p99 %.1f max %.1f, cpu %.2f s (%.1f ms/scrape)\n", count, all[count / 2] * 1e3,
+           all[count * 99 / 100] * 1e3, all[count - 1] * 1e3, cpu, cpu / (double)count * 1e3);
+  }
+  free(all);
+  return 0;
+}
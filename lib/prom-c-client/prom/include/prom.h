@@ -130,5 +130,7 @@ limitations under the License.
 #include "prom_metric.h"
 #include "prom_metric_sample.h"
 #include "prom_metric_sample_histogram.h"
+#include "prom_metric_sample_summary.h"
+#include "prom_summary.h"
 
 #endif //  PROM_INCLUDED
\ No newline at end of file
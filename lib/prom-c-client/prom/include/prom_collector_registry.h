@@ -22,6 +22,9 @@ limitations under the License.
 #ifndef PROM_REGISTRY_H
 #define PROM_REGISTRY_H
 
+#include <stdint.h>
+#include <sys/types.h>
+
 #include "prom_collector.h"
 #include "prom_metric.h"
 
@@ -30,6 +33,22 @@ limitations under the License.
  */
 typedef struct prom_collector_registry prom_collector_registry_t;
 
+/**
+ * @brief The exposition formats a prom_collector_registry_stream_t can produce
+ */
+typedef enum prom_exposition_format {
+  PROM_EXPOSITION_TEXT,        /**< text/plain; version=0.0.4 */
+  PROM_EXPOSITION_PROTOBUF,    /**< application/vnd.google.protobuf; proto=io.prometheus.client.MetricFamily;
+                                    encoding=delimited */
+  PROM_EXPOSITION_OPENMETRICS, /**< application/openmetrics-text; version=1.0.0, with _created series and the
+                                    exemplars of histogram buckets */
+} prom_exposition_format_t;
+
+/**
+ * @brief A prom_collector_registry_stream_t reads the string exposition of a registry one metric family at a time
+ */
+typedef struct prom_collector_registry_stream prom_collector_registry_stream_t;
+
 /**
  * @brief Initialize the default registry by calling prom_collector_registry_init within your program. You MUST NOT
  * modify this value.
@@ -106,6 +125,51 @@ int prom_collector_registry_register_collector(prom_collector_registry_t *self,
  */
 const char *prom_collector_registry_bridge(prom_collector_registry_t *self);
 
+/**
+ * @brief Constructs a prom_collector_registry_stream_t* that reads the exposition of a registry in the given format
+ * without building it whole in memory. In PROM_EXPOSITION_TEXT it reads the same text as prom_collector_registry_bridge.
+ *
+ * Metric families are rendered one at a time as they are read, so memory stays proportional to the largest family
+ * rather than to the registry. Each stream has its own buffer: several streams may read the same registry concurrently.
+ * Collectors and metrics MUST NOT be registered while a stream is open.
+ *
+ * @param self The target prom_collector_registry_t*
+ * @param format The exposition format
+ * @return The constructed prom_collector_registry_stream_t*, or NULL upon failure
+ */
+prom_collector_registry_stream_t *prom_collector_registry_stream_new(prom_collector_registry_t *self,
+                                                                     prom_exposition_format_t format);
+
+/**
+ * @brief Copies the next bytes of the exposition into buffer
+ * @param self The target prom_collector_registry_stream_t*
+ * @param buffer The destination
+ * @param size The size of buffer in bytes
+ * @return The number of bytes copied, which is less than size only at the end of the exposition. 0 once the whole
+ *         exposition has been read, and -1 upon failure.
+ */
+ssize_t prom_collector_registry_stream_read(prom_collector_registry_stream_t *self, char *buffer, size_t size);
+
+/**
+ * @brief Destroys a prom_collector_registry_stream_t*. You MUST set self to NULL after destruction.
+ * @param self The target prom_collector_registry_stream_t*
+ * @return A non-zero integer value upon failure
+ */
+int prom_collector_registry_stream_destroy(prom_collector_registry_stream_t *self);
+
+/**
+ * @brief Stores in generation a value that changes whenever a metric is registered or a sample is added or updated.
+ *
+ * It allows callers to reuse an exposition, for instance a compressed body, while nothing changed. Two things are not
+ * covered: metrics refreshed by a custom collect function, such as the process metrics, and the quantiles of a summary
+ * as its window slides. A cache keyed on the generation should also bound its age.
+ *
+ * @param self The target prom_collector_registry_t*
+ * @param generation Where the generation is stored
+ * @return A non-zero integer value upon failure
+ */
+int prom_collector_registry_generation(prom_collector_registry_t *self, uint64_t *generation);
+
 /**
  *@brief Validates that the given metric name complies with the specification:
  *
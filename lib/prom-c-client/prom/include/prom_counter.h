@@ -55,6 +55,26 @@ typedef prom_metric_t prom_counter_t;
  */
 prom_counter_t *prom_counter_new(const char *name, const char *help, size_t label_key_count, const char **label_keys);
 
+/**
+ * @brief Constructs a sharded prom_counter_t*. Takes the same arguments as prom_counter_new.
+ *
+ * Each sample of a sharded counter is spread over cache-line padded slots, one per configured CPU, and
+ * prom_counter_inc / prom_counter_add update the slot of the CPU the caller runs on. The slots are summed when the
+ * counter is exposed. Use it for counters updated from many threads at once, where a single shared value turns
+ * every update into a contended compare-and-swap. Each sample then costs one cache line per CPU.
+ *
+ * Sharding is fixed at construction: a counter created with prom_counter_new stays unsharded, and every sample of a
+ * counter created here is sharded.
+ *
+ * *Example*
+ *
+ *     prom_counter_t *requests = prom_counter_new_sharded("requests_total", "Handled requests", 1,
+ *                                                         (const char*[]) { "path" });
+ *     prom_counter_inc(requests, (const char*[]) { "/metrics" });
+ */
+prom_counter_t *prom_counter_new_sharded(const char *name, const char *help, size_t label_key_count,
+                                         const char **label_keys);
+
 /**
  * @brief Destroys a prom_counter_t*. You must set self to NULL after destruction. A non-zero integer value will be
  *        returned on failure.
@@ -100,4 +120,42 @@ int prom_counter_inc(prom_counter_t *self, const char **label_values);
  */
 int prom_counter_add(prom_counter_t *self, double r_value, const char **label_values);
 
+/**
+ * @brief A handle to a single sample of a prom_counter_t, resolved once from its label values.
+ *
+ * A handle stays valid for the lifetime of the counter. Updating through a handle is a single atomic operation: it
+ * skips formatting the label values and looking up the sample, which prom_counter_inc and prom_counter_add do on every
+ * call.
+ */
+typedef prom_metric_sample_t prom_counter_handle_t;
+
+/**
+ * @brief Resolve the sample for the given label values, creating it if needed. Returns NULL on failure.
+ * @param self The target prom_counter_t*
+ * @param label_values The label values of the sample. The number of labels must match the value passed to
+ *                     label_key_count in the counter's constructor. If no label values are necessary, pass NULL.
+ * @return The prom_counter_handle_t* for the sample
+ *
+ * *Example*
+ *
+ *     prom_counter_handle_t *handle = prom_counter_handle(foo_counter, (const char**) { "bar", "bang" });
+ *     prom_counter_handle_inc(handle);
+ */
+prom_counter_handle_t *prom_counter_handle(prom_counter_t *self, const char **label_values);
+
+/**
+ * @brief Increment the counter sample referenced by handle by 1.
+ * @param handle A prom_counter_handle_t* returned by prom_counter_handle
+ * @return A non-zero integer value upon failure.
+ */
+int prom_counter_handle_inc(prom_counter_handle_t *handle);
+
+/**
+ * @brief Add the value to the counter sample referenced by handle.
+ * @param handle A prom_counter_handle_t* returned by prom_counter_handle
+ * @param r_value The double to add. The value MUST be greater than or equal to 0.
+ * @return A non-zero integer value upon failure.
+ */
+int prom_counter_handle_add(prom_counter_handle_t *handle, double r_value);
+
 #endif  // PROM_COUNTER_H
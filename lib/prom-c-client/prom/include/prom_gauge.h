@@ -152,4 +152,64 @@ int prom_gauge_sub(prom_gauge_t *self, double r_value, const char **label_values
  */
 int prom_gauge_set(prom_gauge_t *self, double r_value, const char **label_values);
 
+/**
+ * @brief A handle to a single sample of a prom_gauge_t, resolved once from its label values.
+ *
+ * A handle stays valid for the lifetime of the gauge. Updating through a handle is a single atomic operation: it skips
+ * formatting the label values and looking up the sample, which the prom_gauge_* functions do on every call.
+ */
+typedef prom_metric_sample_t prom_gauge_handle_t;
+
+/**
+ * @brief Resolve the sample for the given label values, creating it if needed. Returns NULL on failure.
+ * @param self The target prom_gauge_t*
+ * @param label_values The label values of the sample. The number of labels must match the value passed to
+ *                     label_key_count in the gauge's constructor. If no label values are necessary, pass NULL.
+ * @return The prom_gauge_handle_t* for the sample
+ *
+ * *Example*
+ *
+ *     prom_gauge_handle_t *handle = prom_gauge_handle(foo_gauge, (const char**) { "bar", "bang" });
+ *     prom_gauge_handle_set(handle, 22);
+ */
+prom_gauge_handle_t *prom_gauge_handle(prom_gauge_t *self, const char **label_values);
+
+/**
+ * @brief Increment the gauge sample referenced by handle by 1.
+ * @param handle A prom_gauge_handle_t* returned by prom_gauge_handle
+ * @return A non-zero integer value upon failure.
+ */
+int prom_gauge_handle_inc(prom_gauge_handle_t *handle);
+
+/**
+ * @brief Decrement the gauge sample referenced by handle by 1.
+ * @param handle A prom_gauge_handle_t* returned by prom_gauge_handle
+ * @return A non-zero integer value upon failure.
+ */
+int prom_gauge_handle_dec(prom_gauge_handle_t *handle);
+
+/**
+ * @brief Add the value to the gauge sample referenced by handle.
+ * @param handle A prom_gauge_handle_t* returned by prom_gauge_handle
+ * @param r_value The double to add.
+ * @return A non-zero integer value upon failure.
+ */
+int prom_gauge_handle_add(prom_gauge_handle_t *handle, double r_value);
+
+/**
+ * @brief Subtract the value from the gauge sample referenced by handle.
+ * @param handle A prom_gauge_handle_t* returned by prom_gauge_handle
+ * @param r_value The double to subtract.
+ * @return A non-zero integer value upon failure.
+ */
+int prom_gauge_handle_sub(prom_gauge_handle_t *handle, double r_value);
+
+/**
+ * @brief Set the value of the gauge sample referenced by handle.
+ * @param handle A prom_gauge_handle_t* returned by prom_gauge_handle
+ * @param r_value The new value.
+ * @return A non-zero integer value upon failure.
+ */
+int prom_gauge_handle_set(prom_gauge_handle_t *handle, double r_value);
+
 #endif  // PROM_GAUGE_H
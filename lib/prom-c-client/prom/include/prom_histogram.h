@@ -60,6 +60,36 @@ typedef prom_metric_t prom_histogram_t;
 prom_histogram_t *prom_histogram_new(const char *name, const char *help, prom_histogram_buckets_t *buckets,
                                      size_t label_key_count, const char **label_keys);
 
+/**
+ * @brief Construct a sparse prom_histogram_t* whose buckets are not declared up front.
+ *
+ * Every power of two between 2^-64 and 2^64 is split into 2^schema buckets of equal width, so each bucket is at most
+ * 2^-schema wider, relative to its lower bound, than the values it holds. The buckets of a power of two are allocated
+ * the first time a value falls in it, and the bucket of a value is computed in constant time from the bits of the
+ * double. Values less than or equal to zero are counted in a le="0.0" bucket; larger values than the last bucket only
+ * count towards +Inf.
+ *
+ * Samples are exposed as regular cumulative le buckets, one per allocated bucket. Use it for distributions spanning
+ * many orders of magnitude, such as latencies from microseconds to minutes, where a fixed bucket list would need
+ * dozens of buckets for every label set.
+ *
+ * @param name The name of the metric
+ * @param help The metric description
+ * @param schema Log2 of the number of buckets per power of two, from 0 (one bucket per doubling) to 8 (256)
+ * @param label_key_count is the number of labels associated with the given metric. Pass 0 if the metric does not
+ *                        require labels.
+ * @param label_keys A collection of label keys. The number of keys MUST match the value passed as label_key_count. If
+ *                   no labels are required, pass NULL.
+ * @return The constructed prom_histogram_t*
+ *
+ * *Example*
+ *
+ *     // Four buckets per doubling: each bucket spans at most 25% of its lower bound
+ *     prom_histogram_new_sparse("latency_seconds", "Request latency", 2, 1, (const char**) { "path" });
+ */
+prom_histogram_t *prom_histogram_new_sparse(const char *name, const char *help, int schema, size_t label_key_count,
+                                            const char **label_keys);
+
 /**
  * @brief Destroy a prom_histogram_t*. self MUSTS be set to NULL after destruction. Returns a non-zero integer value
  *        upon failure.
@@ -78,4 +108,68 @@ int prom_histogram_destroy(prom_histogram_t *self);
  */
 int prom_histogram_observe(prom_histogram_t *self, double value, const char **label_values);
 
+/**
+ * @brief Observe the value and attach an exemplar, such as the id of the trace it was measured in, to its bucket. See
+ *        prom_metric_sample_histogram_observe_with_exemplar.
+ *
+ * Exemplars apply to fixed-bucket histograms only. On a histogram created with prom_histogram_new_sparse the value is
+ * observed but the exemplar is dropped, and a non-zero value is returned.
+ *
+ * @param self The target prom_histogram_t*
+ * @param value The value to observe
+ * @param label_values The label values of the sample, as for prom_histogram_observe
+ * @param exemplar_label_count The number of exemplar labels
+ * @param exemplar_label_keys The exemplar label keys
+ * @param exemplar_label_values The exemplar label values
+ * @return Non-zero value upon failure
+ *
+ * *Example*
+ *
+ *     prom_histogram_observe_with_exemplar(foo_histogram, 0.25, NULL, 1, (const char *[]){"trace_id"},
+ *                                          (const char *[]){trace_id});
+ */
+int prom_histogram_observe_with_exemplar(prom_histogram_t *self, double value, const char **label_values,
+                                         size_t exemplar_label_count, const char **exemplar_label_keys,
+                                         const char **exemplar_label_values);
+
+/**
+ * @brief A handle to a single sample of a prom_histogram_t, resolved once from its label values.
+ *
+ * A handle stays valid for the lifetime of the histogram. Observing through a handle skips formatting the label values
+ * and looking up the sample, which prom_histogram_observe does on every call.
+ */
+typedef prom_metric_sample_histogram_t prom_histogram_handle_t;
+
+/**
+ * @brief Resolve the sample for the given label values, creating it if needed. Returns NULL on failure.
+ * @param self The target prom_histogram_t*
+ * @param label_values The label values of the sample. The number of labels must match the value passed to
+ *                     label_key_count in the histogram's constructor. If no label values are necessary, pass NULL.
+ * @return The prom_histogram_handle_t* for the sample
+ *
+ * *Example*
+ *
+ *     prom_histogram_handle_t *handle = prom_histogram_handle(foo_histogram, (const char**) { "bar" });
+ *     prom_histogram_handle_observe(handle, 0.25);
+ */
+prom_histogram_handle_t *prom_histogram_handle(prom_histogram_t *self, const char **label_values);
+
+/**
+ * @brief Observe the value on the histogram sample referenced by handle.
+ * @param handle A prom_histogram_handle_t* returned by prom_histogram_handle
+ * @param value The value to observe
+ * @return Non-zero value upon failure
+ */
+int prom_histogram_handle_observe(prom_histogram_handle_t *handle, double value);
+
+/**
+ * @brief Observe the value on the histogram sample referenced by handle and attach an exemplar to its bucket. See
+ *        prom_metric_sample_histogram_observe_with_exemplar. As for prom_histogram_observe_with_exemplar, exemplars
+ *        apply to fixed-bucket histograms only.
+ * @return Non-zero value upon failure
+ */
+int prom_histogram_handle_observe_with_exemplar(prom_histogram_handle_t *handle, double value,
+                                                size_t exemplar_label_count, const char **exemplar_label_keys,
+                                                const char **exemplar_label_values);
+
 #endif  // PROM_HISTOGRAM_INCLUDED
@@ -36,4 +36,26 @@ typedef struct prom_metric_sample_histogram prom_metric_sample_histogram_t;
  */
 int prom_metric_sample_histogram_observe(prom_metric_sample_histogram_t *self, double value);
 
+/**
+ * @brief Observe the double and keep it, with the given labels, as the exemplar of the bucket it falls in
+ *
+ * Each bucket holds its last exemplar in a fixed-size slot. Only the first exemplar of a sample allocates, to create
+ * the slots; later ones are recorded without locks or allocation. Exemplars are exposed in the OpenMetrics format.
+ * Exemplars apply to fixed-bucket histograms only. On a sparse histogram the value is observed, the exemplar is
+ * dropped and a non-zero value is returned.
+ *
+ * @param self The target prom_metric_sample_histogram_t*
+ * @param value The value to observe.
+ * @param label_count The number of exemplar labels
+ * @param label_keys The exemplar label keys, e.g. (const char *[]){"trace_id"}
+ * @param label_values The exemplar label values. Keys and values together must render to at most 128 bytes as
+ *                     key="value" pairs separated by commas, after escaping backslashes, double quotes and line feeds
+ *                     in the values.
+ * @return Non-zero integer value upon failure. The value is observed even if the exemplar is not kept because its
+ *         labels are too long or the histogram is sparse.
+ */
+int prom_metric_sample_histogram_observe_with_exemplar(prom_metric_sample_histogram_t *self, double value,
+                                                       size_t label_count, const char **label_keys,
+                                                       const char **label_values);
+
 #endif  // PROM_METRIC_SAMPLE_HISOTGRAM_H
@@ -0,0 +1,123 @@
+/*
+Copyright 2019-2020 DigitalOcean Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+
+/**
+ * @file prom_summary.h
+ * @brief https://prometheus.io/docs/concepts/metric_types/#summary
+ */
+
+#ifndef PROM_SUMMARY_INCLUDED
+#define PROM_SUMMARY_INCLUDED
+
+#include <stdlib.h>
+
+#include "prom_metric.h"
+#include "prom_metric_sample_summary.h"
+
+/**
+ * @brief A prometheus summary.
+ *
+ * Each label set keeps a CKMS targeted-quantile sketch (Cormode, Korn, Muthukrishnan, Srivastava, "Effective
+ * Computation of Biased Quantiles over Data Streams") that answers the configured quantiles within their allowed rank
+ * error, in memory that grows with the logarithm of the observation count rather than with the count itself.
+ *
+ * Quantiles cover a sliding window of max_age seconds: the window is split into age_buckets sketches started one
+ * after another, every observation goes into all of them, and the oldest one is answered from and then reset each
+ * max_age / age_buckets seconds. _sum and _count cover every observation since the summary was created.
+ *
+ * Observations are first appended to a small per-CPU buffer. A buffer is merged into the sketches when it fills up
+ * and on every scrape, so the sketches are locked once per batch instead of once per observation.
+ *
+ * References
+ * * See https://prometheus.io/docs/concepts/metric_types/#summary
+ */
+typedef prom_metric_t prom_summary_t;
+
+/**
+ * @brief The quantiles and the window of a prom_summary_t
+ */
+typedef struct prom_summary_opts {
+  size_t quantile_count;   /**< Number of entries in quantiles and errors */
+  const double *quantiles; /**< Quantiles to expose, each between 0 and 1 */
+  const double *errors;    /**< Allowed rank error of each quantile, e.g. 0.001 for a p99 between p98.9 and p99.1 */
+  double max_age;          /**< Length of the sliding window in seconds */
+  size_t age_buckets;      /**< Number of sketches the window is split into */
+} prom_summary_opts_t;
+
+/**
+ * @brief Construct a prom_summary_t*
+ * @param name The name of the metric
+ * @param help The metric description
+ * @param opts The quantiles and window of the summary, copied into the summary. Pass NULL for p50 (error 0.05), p90
+ *             (0.01), p99 (0.001) and p999 (0.0001) over a 10 minute window split into 5 sketches.
+ * @param label_key_count is the number of labels associated with the given metric. Pass 0 if the metric does not
+ *                        require labels.
+ * @param label_keys A collection of label keys. The number of keys MUST match the value passed as label_key_count. If
+ *                   no labels are required, pass NULL. The "quantile" key is reserved.
+ * @return The constructed prom_summary_t*, or NULL if opts is not valid
+ *
+ * *Example*
+ *
+ *     // p99 and p999 of the last minute
+ *     prom_summary_opts_t opts = {2, (const double[]){0.99, 0.999}, (const double[]){0.001, 0.0001}, 60.0, 6};
+ *     prom_summary_new("latency_seconds", "Request latency", &opts, 1, (const char**) { "path" });
+ */
+prom_summary_t *prom_summary_new(const char *name, const char *help, const prom_summary_opts_t *opts,
+                                 size_t label_key_count, const char **label_keys);
+
+/**
+ * @brief Destroy a prom_summary_t*. self MUST be set to NULL after destruction.
+ * @return Non-zero value upon failure.
+ */
+int prom_summary_destroy(prom_summary_t *self);
+
+/**
+ * @brief Observe the prom_summary_t given the value and labels
+ * @param self The target prom_summary_t*
+ * @param value The value to observe
+ * @param label_values The label values of the sample. The number of labels must match the value passed to
+ *                     label_key_count in the summary's constructor. If no label values are necessary, pass NULL.
+ * @return Non-zero value upon failure
+ */
+int prom_summary_observe(prom_summary_t *self, double value, const char **label_values);
+
+/**
+ * @brief A handle to a single sample of a prom_summary_t, resolved once from its label values.
+ *
+ * A handle stays valid for the lifetime of the summary. Observing through a handle skips formatting the label values
+ * and looking up the sample, which prom_summary_observe does on every call.
+ */
+typedef prom_metric_sample_summary_t prom_summary_handle_t;
+
+/**
+ * @brief Resolve the sample for the given label values, creating it if needed. Returns NULL on failure.
+ * @param self The target prom_summary_t*
+ * @param label_values The label values of the sample. The number of labels must match the value passed to
+ *                     label_key_count in the summary's constructor. If no label values are necessary, pass NULL.
+ * @return The prom_summary_handle_t* for the sample
+ */
+prom_summary_handle_t *prom_summary_handle(prom_summary_t *self, const char **label_values);
+
+/**
+ * @brief Observe the value on the summary sample referenced by handle.
+ * @param handle A prom_summary_handle_t* returned by prom_summary_handle
+ * @param value The value to observe
+ * @return Non-zero value upon failure
+ */
+int prom_summary_handle_observe(prom_summary_handle_t *handle, double value);
+
+#endif  // PROM_SUMMARY_INCLUDED
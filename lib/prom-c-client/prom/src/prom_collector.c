@@ -24,6 +24,7 @@
 
 // Private
 #include "prom_assert.h"
+#include "prom_collector_i.h"
 #include "prom_collector_t.h"
 #include "prom_log.h"
 #include "prom_map_i.h"
@@ -17,6 +17,7 @@
 #include <pthread.h>
 #include <regex.h>
 #include <stdio.h>
+#include <string.h>
 
 // Public
 #include "prom_alloc.h"
@@ -25,6 +26,7 @@
 
 // Private
 #include "prom_assert.h"
+#include "prom_collector_i.h"
 #include "prom_collector_registry_t.h"
 #include "prom_collector_t.h"
 #include "prom_errors.h"
@@ -33,7 +35,9 @@
 #include "prom_metric_formatter_i.h"
 #include "prom_metric_i.h"
 #include "prom_metric_t.h"
+#include "prom_openmetrics_i.h"
 #include "prom_process_limits_i.h"
+#include "prom_protobuf_i.h"
 #include "prom_string_builder_i.h"
 
 prom_collector_registry_t *PROM_COLLECTOR_REGISTRY_DEFAULT;
@@ -215,3 +219,133 @@ const char *prom_collector_registry_bridge(prom_collector_registry_t *self) {
   prom_metric_formatter_load_metrics(self->metric_formatter, self->collectors);
   return (const char *)prom_metric_formatter_dump(self->metric_formatter);
 }
+
+int prom_collector_registry_generation(prom_collector_registry_t *self, uint64_t *generation) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL) return 1;
+
+  uint64_t sum = 0;
+  for (prom_linked_list_node_t *collector_node = self->collectors->keys->head; collector_node != NULL;
+       collector_node = collector_node->next) {
+    prom_collector_t *collector =
+        (prom_collector_t *)prom_map_get(self->collectors, (const char *)collector_node->item);
+    if (collector == NULL) return 1;
+    // Other collect functions refresh their metrics during the exposition, which is exactly what is being avoided
+    if (collector->collect_fn != &prom_collector_default_collect) continue;
+
+    sum += collector->metrics->size;
+    for (prom_linked_list_node_t *metric_node = collector->metrics->keys->head; metric_node != NULL;
+         metric_node = metric_node->next) {
+      prom_metric_t *metric = (prom_metric_t *)prom_map_get(collector->metrics, (const char *)metric_node->item);
+      if (metric == NULL) return 1;
+
+      int r = pthread_rwlock_rdlock(metric->rwlock);
+      if (r) {
+        PROM_LOG(PROM_PTHREAD_RWLOCK_LOCK_ERROR);
+        return r;
+      }
+      // A non-zero value only tells that the exposition also ages; the generation is filled in either way
+      uint64_t metric_generation = 0;
+      prom_metric_generation(metric, &metric_generation);
+      r = pthread_rwlock_unlock(metric->rwlock);
+      if (r) {
+        PROM_LOG(PROM_PTHREAD_RWLOCK_UNLOCK_ERROR);
+        return r;
+      }
+      sum += metric_generation;
+    }
+  }
+  *generation = sum;
+  return 0;
+}
+
+prom_collector_registry_stream_t *prom_collector_registry_stream_new(prom_collector_registry_t *self,
+                                                                     prom_exposition_format_t format) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL) return NULL;
+
+  prom_collector_registry_stream_t *stream =
+      (prom_collector_registry_stream_t *)prom_malloc(sizeof(prom_collector_registry_stream_t));
+  stream->registry = self;
+  stream->format = format;
+  stream->formatter = prom_metric_formatter_new();
+  if (stream->formatter == NULL) {
+    prom_free(stream);
+    return NULL;
+  }
+  stream->offset = 0;
+  stream->collector_node = self->collectors->keys->head;
+  stream->metrics = NULL;
+  stream->metric_node = NULL;
+  stream->done = false;
+  return stream;
+}
+
+/**
+ * @brief API PRIVATE Replaces the stream's buffer with the next metric family, or sets done when there is none left
+ */
+static int prom_collector_registry_stream_load_next(prom_collector_registry_stream_t *self) {
+  int r = prom_metric_formatter_clear(self->formatter);
+  if (r) return r;
+  self->offset = 0;
+
+  while (self->metric_node == NULL) {
+    if (self->collector_node == NULL) {
+      self->done = true;
+      if (self->format == PROM_EXPOSITION_OPENMETRICS) {
+        return prom_string_builder_add_str(self->formatter->string_builder, PROM_OPENMETRICS_EOF);
+      }
+      return 0;
+    }
+    const char *collector_name = (const char *)self->collector_node->item;
+    self->collector_node = self->collector_node->next;
+    prom_collector_t *collector = (prom_collector_t *)prom_map_get(self->registry->collectors, collector_name);
+    if (collector == NULL) return 1;
+
+    self->metrics = collector->collect_fn(collector);
+    if (self->metrics == NULL) return 1;
+    self->metric_node = self->metrics->keys->head;
+  }
+
+  const char *metric_name = (const char *)self->metric_node->item;
+  self->metric_node = self->metric_node->next;
+  prom_metric_t *metric = (prom_metric_t *)prom_map_get(self->metrics, metric_name);
+  if (metric == NULL) return 1;
+  switch (self->format) {
+    case PROM_EXPOSITION_PROTOBUF:
+      return prom_protobuf_load_metric(self->formatter, metric);
+    case PROM_EXPOSITION_OPENMETRICS:
+      return prom_openmetrics_load_metric(self->formatter, metric);
+    default:
+      return prom_metric_formatter_load_metric(self->formatter, metric);
+  }
+}
+
+ssize_t prom_collector_registry_stream_read(prom_collector_registry_stream_t *self, char *buffer, size_t size) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL) return -1;
+
+  size_t written = 0;
+  while (written < size) {
+    prom_string_builder_t *family = self->formatter->string_builder;
+    size_t available = prom_string_builder_len(family) - self->offset;
+    if (available == 0) {
+      if (self->done) break;
+      if (prom_collector_registry_stream_load_next(self)) return -1;
+      continue;
+    }
+    size_t n = available < size - written ? available : size - written;
+    memcpy(buffer + written, prom_string_builder_str(family) + self->offset, n);
+    self->offset += n;
+    written += n;
+  }
+  return (ssize_t)written;
+}
+
+int prom_collector_registry_stream_destroy(prom_collector_registry_stream_t *self) {
+  if (self == NULL) return 0;
+  int r = prom_metric_formatter_destroy(self->formatter);
+  self->formatter = NULL;
+  prom_free(self);
+  return r;
+}
@@ -24,6 +24,7 @@
 #include "prom_collector_registry.h"
 
 // Private
+#include "prom_linked_list_t.h"
 #include "prom_map_t.h"
 #include "prom_metric_formatter_t.h"
 #include "prom_string_builder_t.h"
@@ -37,4 +38,15 @@ struct prom_collector_registry {
   pthread_rwlock_t *lock;                    /**< mutex for safety against concurrent registration */
 };
 
+struct prom_collector_registry_stream {
+  prom_collector_registry_t *registry;        /**< The registry being exposed */
+  prom_exposition_format_t format;            /**< The format metric families are rendered in */
+  prom_metric_formatter_t *formatter;         /**< Holds the metric family currently being read */
+  size_t offset;                              /**< Bytes of the current metric family already read */
+  prom_linked_list_node_t *collector_node;    /**< Next collector to collect */
+  prom_map_t *metrics;                        /**< Metrics of the collector being exposed */
+  prom_linked_list_node_t *metric_node;       /**< Next metric of that collector */
+  bool done;                                  /**< Every metric family has been rendered */
+};
+
 #endif  // PROM_REGISTRY_T_H
@@ -14,6 +14,8 @@
  * limitations under the License.
  */
 
+#include <unistd.h>
+
 // Public
 #include "prom_counter.h"
 
@@ -28,10 +30,29 @@
 #include "prom_metric_sample_t.h"
 #include "prom_metric_t.h"
 
+// Upper bound on the per-CPU slots of each sample of a sharded counter
+#define PROM_COUNTER_MAX_SHARDS 256
+
 prom_counter_t *prom_counter_new(const char *name, const char *help, size_t label_key_count, const char **label_keys) {
   return (prom_counter_t *)prom_metric_new(PROM_COUNTER, name, help, label_key_count, label_keys);
 }
 
+prom_counter_t *prom_counter_new_sharded(const char *name, const char *help, size_t label_key_count,
+                                         const char **label_keys) {
+  prom_counter_t *self = prom_counter_new(name, help, label_key_count, label_keys);
+  if (self == NULL) return NULL;
+
+  long cpus = sysconf(_SC_NPROCESSORS_CONF);
+  size_t shard_count = cpus > 0 ? (size_t)cpus : 1;
+  if (shard_count > PROM_COUNTER_MAX_SHARDS) shard_count = PROM_COUNTER_MAX_SHARDS;
+
+  if (prom_metric_set_shard_count(self, shard_count)) {
+    prom_metric_destroy(self);
+    return NULL;
+  }
+  return self;
+}
+
 int prom_counter_destroy(prom_counter_t *self) {
   PROM_ASSERT(self != NULL);
   if (self == NULL) return 0;
@@ -41,26 +62,36 @@ int prom_counter_destroy(prom_counter_t *self) {
   return r;
 }
 
-int prom_counter_inc(prom_counter_t *self, const char **label_values) {
+prom_counter_handle_t *prom_counter_handle(prom_counter_t *self, const char **label_values) {
   PROM_ASSERT(self != NULL);
-  if (self == NULL) return 1;
+  if (self == NULL) return NULL;
   if (self->type != PROM_COUNTER) {
     PROM_LOG(PROM_METRIC_INCORRECT_TYPE);
-    return 1;
+    return NULL;
   }
-  prom_metric_sample_t *sample = prom_metric_sample_from_labels(self, label_values);
-  if (sample == NULL) return 1;
-  return prom_metric_sample_add(sample, 1.0);
+  return prom_metric_sample_from_labels(self, label_values);
+}
+
+int prom_counter_handle_inc(prom_counter_handle_t *handle) {
+  PROM_ASSERT(handle != NULL);
+  if (handle == NULL) return 1;
+  return prom_metric_sample_add(handle, 1.0);
+}
+
+int prom_counter_handle_add(prom_counter_handle_t *handle, double r_value) {
+  PROM_ASSERT(handle != NULL);
+  if (handle == NULL) return 1;
+  return prom_metric_sample_add(handle, r_value);
+}
+
+int prom_counter_inc(prom_counter_t *self, const char **label_values) {
+  prom_counter_handle_t *handle = prom_counter_handle(self, label_values);
+  if (handle == NULL) return 1;
+  return prom_counter_handle_inc(handle);
 }
 
 int prom_counter_add(prom_counter_t *self, double r_value, const char **label_values) {
-  PROM_ASSERT(self != NULL);
-  if (self == NULL) return 1;
-  if (self->type != PROM_COUNTER) {
-    PROM_LOG(PROM_METRIC_INCORRECT_TYPE);
-    return 1;
-  }
-  prom_metric_sample_t *sample = prom_metric_sample_from_labels(self, label_values);
-  if (sample == NULL) return 1;
-  return prom_metric_sample_add(sample, r_value);
+  prom_counter_handle_t *handle = prom_counter_handle(self, label_values);
+  if (handle == NULL) return 1;
+  return prom_counter_handle_add(handle, r_value);
 }
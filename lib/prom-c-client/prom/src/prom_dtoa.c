@@ -0,0 +1,458 @@
+/**
+ * Copyright 2019-2020 DigitalOcean Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Shortest round-trip formatting of doubles with Grisu2, after Florian Loitsch, "Printing Floating-Point Numbers
+// Quickly and Accurately with Integers" (PLDI 2010).
+
+#include <float.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Private
+#include "prom_dtoa_i.h"
+
+#define PROM_DTOA_SIGNIFICAND_SIZE 52
+#define PROM_DTOA_EXPONENT_BIAS (0x3FF + PROM_DTOA_SIGNIFICAND_SIZE)
+#define PROM_DTOA_MIN_EXPONENT (-PROM_DTOA_EXPONENT_BIAS)
+#define PROM_DTOA_HIDDEN_BIT UINT64_C(0x0010000000000000)
+#define PROM_DTOA_SIGNIFICAND_MASK UINT64_C(0x000FFFFFFFFFFFFF)
+#define PROM_DTOA_EXPONENT_MASK UINT64_C(0x7FF0000000000000)
+
+// Every decimal with this many significant digits or fewer maps to a distinct double (DBL_DIG)
+#define PROM_DTOA_SAFE_DIGITS 15
+
+// Whole numbers below this are exact in a double and are written by the integer fast path
+#define PROM_DTOA_MAX_EXACT_INTEGER 9007199254740992.0
+
+// Largest power of ten that is exact in a double
+#define PROM_DTOA_MAX_EXACT_POW10 22
+
+/**
+ * @brief API PRIVATE A floating point number f * 2^e with a 64-bit significand
+ */
+typedef struct prom_dtoa_fp {
+  uint64_t f;
+  int e;
+} prom_dtoa_fp_t;
+
+// Normalized significands and binary exponents of 10^k for k = -348, -340, ..., 340
+static const uint64_t prom_dtoa_cached_powers_f[87] = {
+    UINT64_C(0xfa8fd5a0081c0288), UINT64_C(0xbaaee17fa23ebf76), UINT64_C(0x8b16fb203055ac76),
+    UINT64_C(0xcf42894a5dce35ea), UINT64_C(0x9a6bb0aa55653b2d), UINT64_C(0xe61acf033d1a45df),
+    UINT64_C(0xab70fe17c79ac6ca), UINT64_C(0xff77b1fcbebcdc4f), UINT64_C(0xbe5691ef416bd60c),
+    UINT64_C(0x8dd01fad907ffc3c), UINT64_C(0xd3515c2831559a83), UINT64_C(0x9d71ac8fada6c9b5),
+    UINT64_C(0xea9c227723ee8bcb), UINT64_C(0xaecc49914078536d), UINT64_C(0x823c12795db6ce57),
+    UINT64_C(0xc21094364dfb5637), UINT64_C(0x9096ea6f3848984f), UINT64_C(0xd77485cb25823ac7),
+    UINT64_C(0xa086cfcd97bf97f4), UINT64_C(0xef340a98172aace5), UINT64_C(0xb23867fb2a35b28e),
+    UINT64_C(0x84c8d4dfd2c63f3b), UINT64_C(0xc5dd44271ad3cdba), UINT64_C(0x936b9fcebb25c996),
+    UINT64_C(0xdbac6c247d62a584), UINT64_C(0xa3ab66580d5fdaf6), UINT64_C(0xf3e2f893dec3f126),
+    UINT64_C(0xb5b5ada8aaff80b8), UINT64_C(0x87625f056c7c4a8b), UINT64_C(0xc9bcff6034c13053),
+    UINT64_C(0x964e858c91ba2655), UINT64_C(0xdff9772470297ebd), UINT64_C(0xa6dfbd9fb8e5b88f),
+    UINT64_C(0xf8a95fcf88747d94), UINT64_C(0xb94470938fa89bcf), UINT64_C(0x8a08f0f8bf0f156b),
+    UINT64_C(0xcdb02555653131b6), UINT64_C(0x993fe2c6d07b7fac), UINT64_C(0xe45c10c42a2b3b06),
+    UINT64_C(0xaa242499697392d3), UINT64_C(0xfd87b5f28300ca0e), UINT64_C(0xbce5086492111aeb),
+    UINT64_C(0x8cbccc096f5088cc), UINT64_C(0xd1b71758e219652c), UINT64_C(0x9c40000000000000),
+    UINT64_C(0xe8d4a51000000000), UINT64_C(0xad78ebc5ac620000), UINT64_C(0x813f3978f8940984),
+    UINT64_C(0xc097ce7bc90715b3), UINT64_C(0x8f7e32ce7bea5c70), UINT64_C(0xd5d238a4abe98068),
+    UINT64_C(0x9f4f2726179a2245), UINT64_C(0xed63a231d4c4fb27), UINT64_C(0xb0de65388cc8ada8),
+    UINT64_C(0x83c7088e1aab65db), UINT64_C(0xc45d1df942711d9a), UINT64_C(0x924d692ca61be758),
+    UINT64_C(0xda01ee641a708dea), UINT64_C(0xa26da3999aef774a), UINT64_C(0xf209787bb47d6b85),
+    UINT64_C(0xb454e4a179dd1877), UINT64_C(0x865b86925b9bc5c2), UINT64_C(0xc83553c5c8965d3d),
+    UINT64_C(0x952ab45cfa97a0b3), UINT64_C(0xde469fbd99a05fe3), UINT64_C(0xa59bc234db398c25),
+    UINT64_C(0xf6c69a72a3989f5c), UINT64_C(0xb7dcbf5354e9bece), UINT64_C(0x88fcf317f22241e2),
+    UINT64_C(0xcc20ce9bd35c78a5), UINT64_C(0x98165af37b2153df), UINT64_C(0xe2a0b5dc971f303a),
+    UINT64_C(0xa8d9d1535ce3b396), UINT64_C(0xfb9b7cd9a4a7443c), UINT64_C(0xbb764c4ca7a44410),
+    UINT64_C(0x8bab8eefb6409c1a), UINT64_C(0xd01fef10a657842c), UINT64_C(0x9b10a4e5e9913129),
+    UINT64_C(0xe7109bfba19c0c9d), UINT64_C(0xac2820d9623bf429), UINT64_C(0x80444b5e7aa7cf85),
+    UINT64_C(0xbf21e44003acdd2d), UINT64_C(0x8e679c2f5e44ff8f), UINT64_C(0xd433179d9c8cb841),
+    UINT64_C(0x9e19db92b4e31ba9), UINT64_C(0xeb96bf6ebadf77d9), UINT64_C(0xaf87023b9bf0ee6b),
+};
+
+static const int16_t prom_dtoa_cached_powers_e[87] = {
+    -1220, -1193, -1166, -1140, -1113, -1087, -1060, -1034, -1007, -980, -954, -927, -901, -874, -847, -821, -794,
+    -768, -741, -715, -688, -661, -635, -608, -582, -555, -529, -502, -475, -449, -422, -396, -369, -343, -316, -289,
+    -263, -236, -210, -183, -157, -130, -103, -77, -50, -24, 3, 30, 56, 83, 109, 136, 162, 189, 216, 242, 269, 295,
+    322, 348, 375, 402, 428, 455, 481, 508, 534, 561, 588, 614, 641, 667, 694, 720, 747, 774, 800, 827, 853, 880,
+    907, 933, 960, 986, 1013, 1039, 1066,
+};
+
+static const uint64_t prom_dtoa_pow10[20] = {1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL,
+    100000000ULL, 1000000000ULL, 10000000000ULL, 100000000000ULL, 1000000000000ULL, 10000000000000ULL,
+    100000000000000ULL, 1000000000000000ULL, 10000000000000000ULL, 100000000000000000ULL, 1000000000000000000ULL,
+    10000000000000000000ULL};
+
+static const double prom_dtoa_exact_pow10[PROM_DTOA_MAX_EXACT_POW10 + 1] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,
+    1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+static prom_dtoa_fp_t prom_dtoa_fp_from_double(double value) {
+  uint64_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  int biased_e = (int)((bits & PROM_DTOA_EXPONENT_MASK) >> PROM_DTOA_SIGNIFICAND_SIZE);
+  uint64_t significand = bits & PROM_DTOA_SIGNIFICAND_MASK;
+  prom_dtoa_fp_t fp;
+  if (biased_e != 0) {
+    fp.f = significand + PROM_DTOA_HIDDEN_BIT;
+    fp.e = biased_e - PROM_DTOA_EXPONENT_BIAS;
+  } else {
+    fp.f = significand;
+    fp.e = PROM_DTOA_MIN_EXPONENT + 1;
+  }
+  return fp;
+}
+
+/**
+ * @brief API PRIVATE Upper 64 bits of the 128-bit product of the significands, rounded
+ */
+static prom_dtoa_fp_t prom_dtoa_fp_multiply(prom_dtoa_fp_t x, prom_dtoa_fp_t y) {
+  const uint64_t mask = UINT64_C(0xFFFFFFFF);
+  uint64_t a = x.f >> 32;
+  uint64_t b = x.f & mask;
+  uint64_t c = y.f >> 32;
+  uint64_t d = y.f & mask;
+  uint64_t ac = a * c;
+  uint64_t bc = b * c;
+  uint64_t ad = a * d;
+  uint64_t bd = b * d;
+  uint64_t tmp = (bd >> 32) + (ad & mask) + (bc & mask);
+  tmp += UINT64_C(1) << 31;
+  return (prom_dtoa_fp_t){ac + (ad >> 32) + (bc >> 32) + (tmp >> 32), x.e + y.e + 64};
+}
+
+static prom_dtoa_fp_t prom_dtoa_fp_normalize(prom_dtoa_fp_t fp) {
+  while (!(fp.f & (UINT64_C(1) << 63))) {
+    fp.f <<= 1;
+    fp.e--;
+  }
+  return fp;
+}
+
+/**
+ * @brief API PRIVATE Computes the boundaries m- and m+ halfway to the neighbouring doubles, normalized to the same
+ *        exponent
+ */
+static void prom_dtoa_fp_boundaries(prom_dtoa_fp_t fp, prom_dtoa_fp_t *minus, prom_dtoa_fp_t *plus) {
+  prom_dtoa_fp_t pl = {(fp.f << 1) + 1, fp.e - 1};
+  while (!(pl.f & (PROM_DTOA_HIDDEN_BIT << 1))) {
+    pl.f <<= 1;
+    pl.e--;
+  }
+  pl.f <<= 64 - PROM_DTOA_SIGNIFICAND_SIZE - 2;
+  pl.e -= 64 - PROM_DTOA_SIGNIFICAND_SIZE - 2;
+
+  // The gap below a power of two is half the gap above it
+  prom_dtoa_fp_t mi = fp.f == PROM_DTOA_HIDDEN_BIT ? (prom_dtoa_fp_t){(fp.f << 2) - 1, fp.e - 2}
+                                                   : (prom_dtoa_fp_t){(fp.f << 1) - 1, fp.e - 1};
+  mi.f <<= mi.e - pl.e;
+  mi.e = pl.e;
+  *plus = pl;
+  *minus = mi;
+}
+
+/**
+ * @brief API PRIVATE Returns the cached power of ten c_k such that multiplying a number with binary exponent e by it
+ *        brings the exponent into [-60, -32], and sets k to minus its decimal exponent
+ */
+static prom_dtoa_fp_t prom_dtoa_cached_power(int e, int *k) {
+  double dk = (-61 - e) * 0.30102999566398114 + 347;
+  int ik = (int)dk;
+  if (dk - ik > 0.0) ik++;
+  unsigned index = (unsigned)((ik >> 3) + 1);
+  *k = -(-348 + (int)(index << 3));
+  return (prom_dtoa_fp_t){prom_dtoa_cached_powers_f[index], prom_dtoa_cached_powers_e[index]};
+}
+
+/**
+ * @brief API PRIVATE Moves the last digit down while the result stays inside the boundaries and gets closer to w
+ */
+static void prom_dtoa_round(char *buffer, int length, uint64_t delta, uint64_t rest, uint64_t ten_kappa,
+                            uint64_t wp_w) {
+  while (rest < wp_w && delta - rest >= ten_kappa &&
+         (rest + ten_kappa < wp_w || wp_w - rest > rest + ten_kappa - wp_w)) {
+    buffer[length - 1]--;
+    rest += ten_kappa;
+  }
+}
+
+static int prom_dtoa_count_digits(uint32_t n) {
+  int digits = 1;
+  while (n >= 10) {
+    n /= 10;
+    digits++;
+  }
+  return digits;
+}
+
+/**
+ * @brief API PRIVATE Generates the shortest digits of a number between the scaled boundaries
+ */
+static void prom_dtoa_digit_gen(prom_dtoa_fp_t w, prom_dtoa_fp_t mp, uint64_t delta, char *buffer, int *length,
+                                int *k) {
+  prom_dtoa_fp_t one = {UINT64_C(1) << -mp.e, mp.e};
+  uint64_t wp_w = mp.f - w.f;
+  uint32_t p1 = (uint32_t)(mp.f >> -one.e);
+  uint64_t p2 = mp.f & (one.f - 1);
+  int kappa = prom_dtoa_count_digits(p1);
+  *length = 0;
+
+  while (kappa > 0) {
+    uint32_t divisor = (uint32_t)prom_dtoa_pow10[kappa - 1];
+    uint32_t d = p1 / divisor;
+    p1 %= divisor;
+    if (d || *length) buffer[(*length)++] = (char)('0' + d);
+    kappa--;
+    uint64_t tmp = ((uint64_t)p1 << -one.e) + p2;
+    if (tmp <= delta) {
+      *k += kappa;
+      prom_dtoa_round(buffer, *length, delta, tmp, prom_dtoa_pow10[kappa] << -one.e, wp_w);
+      return;
+    }
+  }
+
+  for (;;) {
+    p2 *= 10;
+    delta *= 10;
+    char d = (char)(p2 >> -one.e);
+    if (d || *length) buffer[(*length)++] = (char)('0' + d);
+    p2 &= one.f - 1;
+    kappa--;
+    if (p2 < delta) {
+      *k += kappa;
+      int index = -kappa;
+      prom_dtoa_round(buffer, *length, delta, p2, one.f, wp_w * (index < 20 ? prom_dtoa_pow10[index] : 0));
+      return;
+    }
+  }
+}
+
+/**
+ * @brief API PRIVATE Writes the digits of a positive value into buffer, so that value = digits * 10^k
+ */
+static void prom_dtoa_grisu2(double value, char *buffer, int *length, int *k) {
+  prom_dtoa_fp_t v = prom_dtoa_fp_from_double(value);
+  prom_dtoa_fp_t w_m, w_p;
+  prom_dtoa_fp_boundaries(v, &w_m, &w_p);
+
+  prom_dtoa_fp_t c_mk = prom_dtoa_cached_power(w_p.e, k);
+  prom_dtoa_fp_t w = prom_dtoa_fp_multiply(prom_dtoa_fp_normalize(v), c_mk);
+  prom_dtoa_fp_t wp = prom_dtoa_fp_multiply(w_p, c_mk);
+  prom_dtoa_fp_t wm = prom_dtoa_fp_multiply(w_m, c_mk);
+  wm.f++;
+  wp.f--;
+  prom_dtoa_digit_gen(w, wp, wp.f - wm.f, buffer, length, k);
+}
+
+/**
+ * @brief API PRIVATE Writes a signed decimal integer and returns its length
+ */
+static size_t prom_dtoa_write_int(int value, char *buffer) {
+  size_t len = 0;
+  unsigned magnitude = value < 0 ? (unsigned)-value : (unsigned)value;
+  if (value < 0) buffer[len++] = '-';
+  char digits[10];
+  size_t count = 0;
+  do {
+    digits[count++] = (char)('0' + magnitude % 10);
+    magnitude /= 10;
+  } while (magnitude > 0);
+  while (count > 0) buffer[len++] = digits[--count];
+  return len;
+}
+
+/**
+ * @brief API PRIVATE Rounds digits to n significant digits, down or up, and checks that the result parses back to
+ * value. On success the candidate is written to candidate, candidate_length and candidate_k.
+ */
+static int prom_dtoa_try_digits(double value, const char *digits, int n, int k, int up, char *candidate,
+                                int *candidate_length, int *candidate_k) {
+  memcpy(candidate, digits, (size_t)n);
+  *candidate_k = k;
+  if (up) {
+    int i = n - 1;
+    while (i >= 0 && candidate[i] == '9') candidate[i--] = '0';
+    if (i >= 0) {
+      candidate[i]++;
+    } else {
+      // 999 rounds up to 1000
+      candidate[0] = '1';
+      (*candidate_k)++;
+    }
+  }
+  *candidate_length = n;
+  while (*candidate_length > 1 && candidate[*candidate_length - 1] == '0') {
+    (*candidate_length)--;
+    (*candidate_k)++;
+  }
+
+#if FLT_EVAL_METHOD == 0
+  // Clinger's fast path: when the digits and the power of ten are both exact doubles, one correctly rounded multiply
+  // or divide gives the same double strtod would
+  uint64_t significand = 0;
+  for (int i = 0; i < *candidate_length; i++) significand = significand * 10 + (uint64_t)(candidate[i] - '0');
+  if ((double)significand < PROM_DTOA_MAX_EXACT_INTEGER && *candidate_k >= -PROM_DTOA_MAX_EXACT_POW10 &&
+      *candidate_k <= PROM_DTOA_MAX_EXACT_POW10) {
+    double parsed = *candidate_k < 0 ? (double)significand / prom_dtoa_exact_pow10[-*candidate_k]
+                                     : (double)significand * prom_dtoa_exact_pow10[*candidate_k];
+    return parsed == value;
+  }
+#endif
+
+  char text[PROM_DTOA_BUFFER_SIZE];
+  memcpy(text, candidate, (size_t)*candidate_length);
+  size_t len = (size_t)*candidate_length;
+  text[len++] = 'e';
+  len += prom_dtoa_write_int(*candidate_k, text + len);
+  text[len] = '\0';
+  return strtod(text, NULL) == value;
+}
+
+/**
+ * @brief API PRIVATE Looks for fewer digits than Grisu2 produced.
+ *
+ * Grisu2 works on slightly narrowed boundaries, so for a small share of values it returns 16 or 17 digits where
+ * fewer would do, e.g. 0.0006894960000000001 for 0.000689496. The digits are cut to 15 and then 16 significant digits,
+ * rounded to nearest first and the other way second, since Grisu2's last digit is not always the closest one (it gives
+ * 5190293939.7976475, which rounds up to a 16-digit string that misses, while 5190293939.797647 parses back). A
+ * candidate is kept only if it parses back to value, which is checked with Clinger's exact fast path when it applies
+ * and with strtod otherwise. strtod is given the digits and an exponent without a decimal point, so its result does
+ * not depend on the locale.
+ */
+static void prom_dtoa_shorten(double value, char *digits, int *length, int *k) {
+  for (int n = PROM_DTOA_SAFE_DIGITS; n < *length; n++) {
+    char candidate[PROM_DTOA_BUFFER_SIZE];
+    int candidate_length;
+    int candidate_k;
+    int up = digits[n] >= '5';
+    if (prom_dtoa_try_digits(value, digits, n, *k + (*length - n), up, candidate, &candidate_length, &candidate_k) ||
+        prom_dtoa_try_digits(value, digits, n, *k + (*length - n), !up, candidate, &candidate_length, &candidate_k)) {
+      memcpy(digits, candidate, (size_t)candidate_length);
+      *length = candidate_length;
+      *k = candidate_k;
+      return;
+    }
+  }
+}
+
+/**
+ * @brief API PRIVATE Writes e+XX or e-XX, with at least two exponent digits as printf does
+ */
+static size_t prom_dtoa_write_exponent(int exponent, char *buffer) {
+  size_t len = 0;
+  buffer[len++] = 'e';
+  if (exponent < 0) {
+    buffer[len++] = '-';
+    exponent = -exponent;
+  } else {
+    buffer[len++] = '+';
+  }
+  if (exponent >= 100) {
+    buffer[len++] = (char)('0' + exponent / 100);
+    exponent %= 100;
+  }
+  buffer[len++] = (char)('0' + exponent / 10);
+  buffer[len++] = (char)('0' + exponent % 10);
+  return len;
+}
+
+/**
+ * @brief API PRIVATE Lays out digits * 10^k in fixed or exponent notation
+ */
+static size_t prom_dtoa_prettify(char *buffer, int length, int k) {
+  int kk = length + k;  // 10^(kk - 1) <= value < 10^kk
+
+  if (k >= 0 && kk <= 21) {
+    // 1234e3 -> 1234000
+    memset(buffer + length, '0', (size_t)k);
+    return (size_t)kk;
+  }
+  if (kk > 0 && kk <= 21) {
+    // 1234e-2 -> 12.34
+    memmove(buffer + kk + 1, buffer + kk, (size_t)(length - kk));
+    buffer[kk] = '.';
+    return (size_t)length + 1;
+  }
+  if (kk > -4 && kk <= 0) {
+    // 1234e-6 -> 0.001234
+    int offset = 2 - kk;
+    memmove(buffer + offset, buffer, (size_t)length);
+    buffer[0] = '0';
+    buffer[1] = '.';
+    memset(buffer + 2, '0', (size_t)(offset - 2));
+    return (size_t)(length + offset);
+  }
+  if (length == 1) {
+    // 1e30
+    return 1 + prom_dtoa_write_exponent(kk - 1, buffer + 1);
+  }
+  // 1234e30 -> 1.234e+33
+  memmove(buffer + 2, buffer + 1, (size_t)(length - 1));
+  buffer[1] = '.';
+  return (size_t)length + 1 + prom_dtoa_write_exponent(kk - 1, buffer + length + 1);
+}
+
+/**
+ * @brief API PRIVATE Writes a non-negative integer below 2^63
+ */
+static size_t prom_dtoa_write_integer(uint64_t value, char *buffer) {
+  char digits[20];
+  size_t count = 0;
+  do {
+    digits[count++] = (char)('0' + value % 10);
+    value /= 10;
+  } while (value > 0);
+  for (size_t i = 0; i < count; i++) buffer[i] = digits[count - 1 - i];
+  return count;
+}
+
+size_t prom_dtoa(double value, char *buffer) {
+  size_t len = 0;
+
+  if (value != value) {
+    memcpy(buffer, "NaN", 4);
+    return 3;
+  }
+
+  uint64_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  if (bits >> 63) {
+    buffer[len++] = '-';
+    value = -value;
+  }
+
+  if (value > 1.7976931348623157e308) {
+    // Infinity: +Inf, or -Inf after the sign
+    if (len == 0) buffer[len++] = '+';
+    memcpy(buffer + len, "Inf", 4);
+    return len + 3;
+  }
+
+  if (value < PROM_DTOA_MAX_EXACT_INTEGER) {
+    uint64_t integer = (uint64_t)value;
+    if ((double)integer == value) {
+      len += prom_dtoa_write_integer(integer, buffer + len);
+      buffer[len] = '\0';
+      return len;
+    }
+  }
+
+  int length = 0;
+  int k = 0;
+  prom_dtoa_grisu2(value, buffer + len, &length, &k);
+  if (length > PROM_DTOA_SAFE_DIGITS) prom_dtoa_shorten(value, buffer + len, &length, &k);
+  len += prom_dtoa_prettify(buffer + len, length, k);
+  buffer[len] = '\0';
+  return len;
+}
@@ -0,0 +1,39 @@
+/**
+ * Copyright 2019-2020 DigitalOcean Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PROM_DTOA_I_H
+#define PROM_DTOA_I_H
+
+#include <stddef.h>
+
+// Room needed by prom_dtoa for the longest output, "-2.2250738585072014e-308", and the terminating null byte
+#define PROM_DTOA_BUFFER_SIZE 32
+
+/**
+ * @brief API PRIVATE Writes value as the shortest decimal string that parses back to the same double.
+ *
+ * Whole numbers below 2^53 are written as plain integers without going through the general algorithm. Other values
+ * use Grisu2, with a parse-back check when it yields more than 15 digits, and are written in fixed notation when their
+ * decimal exponent is between -4 and 20, and in exponent notation (1.5e-07, 2e+21) otherwise. NaN and the infinities
+ * are written as NaN, +Inf and -Inf. The output does not depend on the locale.
+ *
+ * @param value The value to format
+ * @param buffer Receives the string; must have room for PROM_DTOA_BUFFER_SIZE bytes
+ * @return The length of the string, without the terminating null byte
+ */
+size_t prom_dtoa(double value, char *buffer);
+
+#endif  // PROM_DTOA_I_H
@@ -0,0 +1,111 @@
+/**
+ * Copyright 2019-2020 DigitalOcean Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include <string.h>
+
+// Private
+#include "prom_assert.h"
+#include "prom_exemplar_i.h"
+#include "prom_exemplar_t.h"
+#include "prom_metric_formatter_i.h"
+
+// Reads of a slot given up on when writers keep replacing it
+#define PROM_EXEMPLAR_READ_ATTEMPTS 4
+
+#define PROM_EXEMPLAR_WORDS (PROM_EXEMPLAR_LABELS_SIZE / sizeof(uint64_t))
+
+void prom_exemplar_init(prom_exemplar_t *self, size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    atomic_init(&self[i].sequence, 0);
+    for (size_t j = 0; j < PROM_EXEMPLAR_WORDS; j++) atomic_init(&self[i].labels[j], 0);
+    atomic_init(&self[i].value, 0.0);
+    atomic_init(&self[i].timestamp, 0.0);
+  }
+}
+
+/**
+ * @brief API PRIVATE Copies str into buffer at offset len if it fits, and returns the new length
+ */
+static size_t prom_exemplar_render_str(char *buffer, size_t len, const char *str) {
+  size_t n = strlen(str);
+  if (len + n <= PROM_EXEMPLAR_LABELS_SIZE) memcpy(buffer + len, str, n);
+  return len + n;
+}
+
+int prom_exemplar_store(prom_exemplar_t *self, double value, double timestamp, size_t label_count,
+                        const char **label_keys, const char **label_values) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL) return 1;
+
+  // Rendered before taking the slot, so a writer holds it only for the stores. Values are escaped like sample label
+  // values; the extra byte is the one prom_metric_formatter_render_label_value keeps for a null byte
+  char buffer[PROM_EXEMPLAR_LABELS_SIZE + 1];
+  memset(buffer, 0, sizeof(buffer));
+  size_t len = 0;
+  for (size_t i = 0; i < label_count; i++) {
+    if (i > 0) len = prom_exemplar_render_str(buffer, len, ",");
+    len = prom_exemplar_render_str(buffer, len, label_keys[i]);
+    len = prom_exemplar_render_str(buffer, len, "=\"");
+    len = prom_metric_formatter_render_label_value(buffer, sizeof(buffer), len, label_values[i]);
+    len = prom_exemplar_render_str(buffer, len, "\"");
+  }
+  if (len > PROM_EXEMPLAR_LABELS_SIZE) return 1;
+
+  uint64_t sequence = atomic_load_explicit(&self->sequence, memory_order_relaxed);
+  if (sequence & 1) return 0;
+  if (!atomic_compare_exchange_strong_explicit(&self->sequence, &sequence, sequence + 1, memory_order_acquire,
+                                               memory_order_relaxed)) {
+    return 0;
+  }
+
+  for (size_t i = 0; i < PROM_EXEMPLAR_WORDS; i++) {
+    uint64_t word;
+    memcpy(&word, buffer + i * sizeof(word), sizeof(word));
+    atomic_store_explicit(&self->labels[i], word, memory_order_relaxed);
+  }
+  atomic_store_explicit(&self->value, value, memory_order_relaxed);
+  atomic_store_explicit(&self->timestamp, timestamp, memory_order_relaxed);
+  atomic_store_explicit(&self->sequence, sequence + 2, memory_order_release);
+  return 0;
+}
+
+int prom_exemplar_load(prom_exemplar_t *self, char *labels, double *value, double *timestamp) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL) return 1;
+
+  for (int attempt = 0; attempt < PROM_EXEMPLAR_READ_ATTEMPTS; attempt++) {
+    uint64_t before = atomic_load_explicit(&self->sequence, memory_order_acquire);
+    if (before == 0) return 1;
+    if (before & 1) continue;
+
+    for (size_t i = 0; i < PROM_EXEMPLAR_WORDS; i++) {
+      uint64_t word = atomic_load_explicit(&self->labels[i], memory_order_relaxed);
+      memcpy(labels + i * sizeof(word), &word, sizeof(word));
+    }
+    *value = atomic_load_explicit(&self->value, memory_order_relaxed);
+    *timestamp = atomic_load_explicit(&self->timestamp, memory_order_relaxed);
+
+    // Orders the copies above before the second read of sequence
+    atomic_thread_fence(memory_order_acquire);
+    if (atomic_load_explicit(&self->sequence, memory_order_relaxed) == before) {
+      labels[PROM_EXEMPLAR_LABELS_SIZE] = '\0';
+      return 0;
+    }
+  }
+  return 1;
+}
@@ -0,0 +1,50 @@
+/**
+ * Copyright 2019-2020 DigitalOcean Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PROM_EXEMPLAR_I_H
+#define PROM_EXEMPLAR_I_H
+
+#include <stddef.h>
+
+// Private
+#include "prom_exemplar_t.h"
+
+/**
+ * @brief API PRIVATE Initializes count empty exemplar slots
+ */
+void prom_exemplar_init(prom_exemplar_t *self, size_t count);
+
+/**
+ * @brief API PRIVATE Records value and its labels in the slot, replacing the previous exemplar. Allocation-free.
+ *
+ * When another thread is writing the same slot at that moment this exemplar is dropped instead of waiting for it.
+ *
+ * Label values are escaped as in sample label values, so a value may hold any character.
+ *
+ * @return Non-zero if the rendered labels do not fit in PROM_EXEMPLAR_LABELS_SIZE bytes
+ */
+int prom_exemplar_store(prom_exemplar_t *self, double value, double timestamp, size_t label_count,
+                        const char **label_keys, const char **label_values);
+
+/**
+ * @brief API PRIVATE Copies the exemplar in the slot
+ * @param labels Receives the rendered label set, null-terminated. Must have room for PROM_EXEMPLAR_LABELS_SIZE + 1
+ *               bytes.
+ * @return Non-zero if the slot is empty or kept changing while it was read
+ */
+int prom_exemplar_load(prom_exemplar_t *self, char *labels, double *value, double *timestamp);
+
+#endif  // PROM_EXEMPLAR_I_H
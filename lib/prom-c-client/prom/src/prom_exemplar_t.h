@@ -0,0 +1,41 @@
+/**
+ * Copyright 2019-2020 DigitalOcean Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdatomic.h>
+#include <stdint.h>
+
+#ifndef PROM_EXEMPLAR_T_H
+#define PROM_EXEMPLAR_T_H
+
+// Room for the rendered label set of an exemplar, e.g. trace_id="4bf92f3577b34da6a3ce929d0e0e4736". OpenMetrics caps
+// the names and values of an exemplar's labels at 128 characters in total
+#define PROM_EXEMPLAR_LABELS_SIZE 128
+
+/**
+ * @brief API PRIVATE The last exemplar recorded for a histogram bucket.
+ *
+ * A fixed-size slot written without locks or allocation, in the manner of a seqlock: a writer makes sequence odd, fills
+ * the slot and makes it even again, and a reader keeps what it copied only if sequence was the same even number before
+ * and after. Every field is atomic so a torn read is detected rather than undefined.
+ */
+typedef struct prom_exemplar {
+  _Atomic uint64_t sequence;                                             /**< 0 while empty, odd while being written */
+  _Atomic uint64_t labels[PROM_EXEMPLAR_LABELS_SIZE / sizeof(uint64_t)]; /**< rendered label set, padded with '\0' */
+  _Atomic double value;                                                  /**< the observed value */
+  _Atomic double timestamp;                                              /**< seconds since the epoch */
+} prom_exemplar_t;
+
+#endif  // PROM_EXEMPLAR_T_H
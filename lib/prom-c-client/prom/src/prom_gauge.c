@@ -40,62 +40,72 @@ int prom_gauge_destroy(prom_gauge_t *self) {
   return r;
 }
 
-int prom_gauge_inc(prom_gauge_t *self, const char **label_values) {
+prom_gauge_handle_t *prom_gauge_handle(prom_gauge_t *self, const char **label_values) {
   PROM_ASSERT(self != NULL);
-  if (self == NULL) return 1;
+  if (self == NULL) return NULL;
   if (self->type != PROM_GAUGE) {
     PROM_LOG(PROM_METRIC_INCORRECT_TYPE);
-    return 1;
+    return NULL;
   }
-  prom_metric_sample_t *sample = prom_metric_sample_from_labels(self, label_values);
-  if (sample == NULL) return 1;
-  return prom_metric_sample_add(sample, 1.0);
+  return prom_metric_sample_from_labels(self, label_values);
+}
+
+int prom_gauge_handle_inc(prom_gauge_handle_t *handle) {
+  PROM_ASSERT(handle != NULL);
+  if (handle == NULL) return 1;
+  return prom_metric_sample_add(handle, 1.0);
+}
+
+int prom_gauge_handle_dec(prom_gauge_handle_t *handle) {
+  PROM_ASSERT(handle != NULL);
+  if (handle == NULL) return 1;
+  return prom_metric_sample_sub(handle, 1.0);
+}
+
+int prom_gauge_handle_add(prom_gauge_handle_t *handle, double r_value) {
+  PROM_ASSERT(handle != NULL);
+  if (handle == NULL) return 1;
+  return prom_metric_sample_add(handle, r_value);
+}
+
+int prom_gauge_handle_sub(prom_gauge_handle_t *handle, double r_value) {
+  PROM_ASSERT(handle != NULL);
+  if (handle == NULL) return 1;
+  return prom_metric_sample_sub(handle, r_value);
+}
+
+int prom_gauge_handle_set(prom_gauge_handle_t *handle, double r_value) {
+  PROM_ASSERT(handle != NULL);
+  if (handle == NULL) return 1;
+  return prom_metric_sample_set(handle, r_value);
+}
+
+int prom_gauge_inc(prom_gauge_t *self, const char **label_values) {
+  prom_gauge_handle_t *handle = prom_gauge_handle(self, label_values);
+  if (handle == NULL) return 1;
+  return prom_gauge_handle_inc(handle);
 }
 
 int prom_gauge_dec(prom_gauge_t *self, const char **label_values) {
-  PROM_ASSERT(self != NULL);
-  if (self == NULL) return 1;
-  if (self->type != PROM_GAUGE) {
-    PROM_LOG(PROM_METRIC_INCORRECT_TYPE);
-    return 1;
-  }
-  prom_metric_sample_t *sample = prom_metric_sample_from_labels(self, label_values);
-  if (sample == NULL) return 1;
-  return prom_metric_sample_sub(sample, 1.0);
+  prom_gauge_handle_t *handle = prom_gauge_handle(self, label_values);
+  if (handle == NULL) return 1;
+  return prom_gauge_handle_dec(handle);
 }
 
 int prom_gauge_add(prom_gauge_t *self, double r_value, const char **label_values) {
-  PROM_ASSERT(self != NULL);
-  if (self == NULL) return 1;
-  if (self->type != PROM_GAUGE) {
-    PROM_LOG(PROM_METRIC_INCORRECT_TYPE);
-    return 1;
-  }
-  prom_metric_sample_t *sample = prom_metric_sample_from_labels(self, label_values);
-  if (sample == NULL) return 1;
-  return prom_metric_sample_add(sample, r_value);
+  prom_gauge_handle_t *handle = prom_gauge_handle(self, label_values);
+  if (handle == NULL) return 1;
+  return prom_gauge_handle_add(handle, r_value);
 }
 
 int prom_gauge_sub(prom_gauge_t *self, double r_value, const char **label_values) {
-  PROM_ASSERT(self != NULL);
-  if (self == NULL) return 1;
-  if (self->type != PROM_GAUGE) {
-    PROM_LOG(PROM_METRIC_INCORRECT_TYPE);
-    return 1;
-  }
-  prom_metric_sample_t *sample = prom_metric_sample_from_labels(self, label_values);
-  if (sample == NULL) return 1;
-  return prom_metric_sample_sub(sample, r_value);
+  prom_gauge_handle_t *handle = prom_gauge_handle(self, label_values);
+  if (handle == NULL) return 1;
+  return prom_gauge_handle_sub(handle, r_value);
 }
 
 int prom_gauge_set(prom_gauge_t *self, double r_value, const char **label_values) {
-  PROM_ASSERT(self != NULL);
-  if (self == NULL) return 1;
-  if (self->type != PROM_GAUGE) {
-    PROM_LOG(PROM_METRIC_INCORRECT_TYPE);
-    return 1;
-  }
-  prom_metric_sample_t *sample = prom_metric_sample_from_labels(self, label_values);
-  if (sample == NULL) return 1;
-  return prom_metric_sample_set(sample, r_value);
+  prom_gauge_handle_t *handle = prom_gauge_handle(self, label_values);
+  if (handle == NULL) return 1;
+  return prom_gauge_handle_set(handle, r_value);
 }
@@ -54,6 +54,18 @@ prom_histogram_t *prom_histogram_new(const char *name, const char *help, prom_hi
   return self;
 }
 
+prom_histogram_t *prom_histogram_new_sparse(const char *name, const char *help, int schema, size_t label_key_count,
+                                            const char **label_keys) {
+  if (schema < 0 || schema > PROM_HISTOGRAM_SPARSE_MAX_SCHEMA) {
+    PROM_LOG("schema must be between 0 and 8");
+    return NULL;
+  }
+  prom_histogram_t *self = (prom_histogram_t *)prom_metric_new(PROM_HISTOGRAM, name, help, label_key_count, label_keys);
+  if (self == NULL) return NULL;
+  self->sparse_schema = schema;
+  return self;
+}
+
 int prom_histogram_destroy(prom_histogram_t *self) {
   PROM_ASSERT(self != NULL);
 
@@ -66,14 +78,42 @@ int prom_histogram_destroy(prom_histogram_t *self) {
   return r;
 }
 
-int prom_histogram_observe(prom_histogram_t *self, double value, const char **label_values) {
+prom_histogram_handle_t *prom_histogram_handle(prom_histogram_t *self, const char **label_values) {
   PROM_ASSERT(self != NULL);
-  if (self == NULL) return 1;
+  if (self == NULL) return NULL;
   if (self->type != PROM_HISTOGRAM) {
     PROM_LOG(PROM_METRIC_INCORRECT_TYPE);
-    return 1;
+    return NULL;
   }
-  prom_metric_sample_histogram_t *h_sample = prom_metric_sample_histogram_from_labels(self, label_values);
-  if (h_sample == NULL) return 1;
-  return prom_metric_sample_histogram_observe(h_sample, value);
+  return prom_metric_sample_histogram_from_labels(self, label_values);
+}
+
+int prom_histogram_handle_observe(prom_histogram_handle_t *handle, double value) {
+  PROM_ASSERT(handle != NULL);
+  if (handle == NULL) return 1;
+  return prom_metric_sample_histogram_observe(handle, value);
+}
+
+int prom_histogram_handle_observe_with_exemplar(prom_histogram_handle_t *handle, double value,
+                                                size_t exemplar_label_count, const char **exemplar_label_keys,
+                                                const char **exemplar_label_values) {
+  PROM_ASSERT(handle != NULL);
+  if (handle == NULL) return 1;
+  return prom_metric_sample_histogram_observe_with_exemplar(handle, value, exemplar_label_count, exemplar_label_keys,
+                                                            exemplar_label_values);
+}
+
+int prom_histogram_observe(prom_histogram_t *self, double value, const char **label_values) {
+  prom_histogram_handle_t *handle = prom_histogram_handle(self, label_values);
+  if (handle == NULL) return 1;
+  return prom_histogram_handle_observe(handle, value);
+}
+
+int prom_histogram_observe_with_exemplar(prom_histogram_t *self, double value, const char **label_values,
+                                         size_t exemplar_label_count, const char **exemplar_label_keys,
+                                         const char **exemplar_label_values) {
+  prom_histogram_handle_t *handle = prom_histogram_handle(self, label_values);
+  if (handle == NULL) return 1;
+  return prom_histogram_handle_observe_with_exemplar(handle, value, exemplar_label_count, exemplar_label_keys,
+                                                     exemplar_label_values);
 }
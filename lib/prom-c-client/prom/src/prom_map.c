@@ -16,6 +16,8 @@
 
 #include <pthread.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include <sys/types.h>
 
 // Public
 #include "prom_alloc.h"
@@ -29,8 +31,13 @@
 #include "prom_map_i.h"
 #include "prom_map_t.h"
 
+// Must be a power of two
 #define PROM_MAP_INITIAL_SIZE 32
 
+// The table grows once it is more than PROM_MAP_MAX_LOAD_NUM / PROM_MAP_MAX_LOAD_DEN full
+#define PROM_MAP_MAX_LOAD_NUM 3
+#define PROM_MAP_MAX_LOAD_DEN 4
+
 static void destroy_map_node_value_no_op(void *value) {}
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -57,18 +64,6 @@ int prom_map_node_destroy(prom_map_node_t *self) {
   return 0;
 }
 
-void prom_map_node_free(void *item) {
-  prom_map_node_t *map_node = (prom_map_node_t *)item;
-  prom_map_node_destroy(map_node);
-}
-
-prom_linked_list_compare_t prom_map_node_compare(void *item_a, void *item_b) {
-  prom_map_node_t *map_node_a = (prom_map_node_t *)item_a;
-  prom_map_node_t *map_node_b = (prom_map_node_t *)item_b;
-
-  return strcmp(map_node_a->key, map_node_b->key);
-}
-
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // prom_map
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -79,39 +74,33 @@ prom_map_t *prom_map_new() {
   prom_map_t *self = (prom_map_t *)prom_malloc(sizeof(prom_map_t));
   self->size = 0;
   self->max_size = PROM_MAP_INITIAL_SIZE;
+  self->slots = NULL;
+  self->rwlock = NULL;
 
   self->keys = prom_linked_list_new();
-  if (self->keys == NULL) return NULL;
+  if (self->keys == NULL) {
+    prom_map_destroy(self);
+    return NULL;
+  }
 
-  // These each key will be allocated once by prom_map_node_new and used here as well to save memory. With that said
-  // we will only have to deallocate each key once. That will happen on prom_map_node_destroy.
+  // Each key is allocated once when it is inserted and shared by its slot and the keys list. With that said we will
+  // only have to deallocate each key once. That will happen when the slot is cleared.
   r = prom_linked_list_set_free_fn(self->keys, prom_linked_list_no_op_free);
   if (r) {
     prom_map_destroy(self);
     return NULL;
   }
 
-  self->addrs = prom_malloc(sizeof(prom_linked_list_t) * self->max_size);
+  self->slots = (prom_map_slot_t *)prom_malloc(sizeof(prom_map_slot_t) * self->max_size);
+  memset(self->slots, 0, sizeof(prom_map_slot_t) * self->max_size);
   self->free_value_fn = destroy_map_node_value_no_op;
 
-  for (int i = 0; i < self->max_size; i++) {
-    self->addrs[i] = prom_linked_list_new();
-    r = prom_linked_list_set_free_fn(self->addrs[i], prom_map_node_free);
-    if (r) {
-      prom_map_destroy(self);
-      return NULL;
-    }
-    r = prom_linked_list_set_compare_fn(self->addrs[i], prom_map_node_compare);
-    if (r) {
-      prom_map_destroy(self);
-      return NULL;
-    }
-  }
-
   self->rwlock = (pthread_rwlock_t *)prom_malloc(sizeof(pthread_rwlock_t));
   r = pthread_rwlock_init(self->rwlock, NULL);
   if (r) {
     PROM_LOG(PROM_PTHREAD_RWLOCK_INIT_ERROR);
+    prom_free(self->rwlock);
+    self->rwlock = NULL;
     prom_map_destroy(self);
     return NULL;
   }
@@ -124,90 +113,111 @@ int prom_map_destroy(prom_map_t *self) {
   int r = 0;
   int ret = 0;
 
-  r = prom_linked_list_destroy(self->keys);
-  if (r) ret = r;
-  self->keys = NULL;
-
-  for (size_t i = 0; i < self->max_size; i++) {
-    r = prom_linked_list_destroy(self->addrs[i]);
+  if (self->keys != NULL) {
+    r = prom_linked_list_destroy(self->keys);
     if (r) ret = r;
-    self->addrs[i] = NULL;
+    self->keys = NULL;
   }
-  prom_free(self->addrs);
-  self->addrs = NULL;
 
-  r = pthread_rwlock_destroy(self->rwlock);
-  if (r) {
-    PROM_LOG(PROM_PTHREAD_RWLOCK_DESTROY_ERROR)
-    ret = r;
+  if (self->slots != NULL) {
+    for (size_t i = 0; i < self->max_size; i++) {
+      prom_map_slot_t *slot = &self->slots[i];
+      if (slot->key == NULL) continue;
+      if (slot->value != NULL) (*self->free_value_fn)(slot->value);
+      prom_free((void *)slot->key);
+    }
+    prom_free(self->slots);
+    self->slots = NULL;
+  }
+
+  if (self->rwlock != NULL) {
+    r = pthread_rwlock_destroy(self->rwlock);
+    if (r) {
+      PROM_LOG(PROM_PTHREAD_RWLOCK_DESTROY_ERROR)
+      ret = r;
+    }
+    prom_free(self->rwlock);
+    self->rwlock = NULL;
   }
 
-  prom_free(self->rwlock);
-  self->rwlock = NULL;
   prom_free(self);
   self = NULL;
 
   return ret;
 }
 
-static size_t prom_map_get_index_internal(const char *key, size_t *size, size_t *max_size) {
-  size_t index;
-  size_t a = 31415, b = 27183;
-  for (index = 0; *key != '\0'; key++, a = a * b % (*max_size - 1)) {
-    index = (a * index + *key) % *max_size;
+/**
+ * @brief API PRIVATE 64-bit FNV-1a hash of the key.
+ *
+ * The full hash is stored in each slot. Lookups compare hashes before keys, so a probe only runs strcmp on a likely
+ * match, and resizing never has to hash a key again.
+ */
+static uint64_t prom_map_hash(const char *key) {
+  uint64_t hash = 14695981039346656037ULL;
+  for (; *key != '\0'; key++) {
+    hash ^= (unsigned char)*key;
+    hash *= 1099511628211ULL;
   }
-  return index;
+  return hash;
 }
 
 /**
- * @brief API PRIVATE hash function that returns an array index from the given key and prom_map.
- *
- * The algorithm is based off of Horner's method. In a simpler version, you set the return value to 0. Next, for each
- * character in the string, you add the integer value of the current character to the product of the prime number and
- * the current return value, set the result to the return value, then finally return the return value.
- *
- * In this version of the algorithm, we attempt to achieve a probabily of key to index conversion collisions to
- * 1/M (with M being the max_size of the map). This optimizes dispersion and consequently, evens out the performance
- * for gets and sets for each item. Instead of using a fixed prime number, we generate a coefficient for each iteration
- * through the loop.
+ * @brief API PRIVATE Distance of the slot at index from the home slot of the hash it holds.
+ */
+static inline size_t prom_map_probe_distance(prom_map_t *self, uint64_t hash, size_t index) {
+  return (index - (size_t)(hash & (self->max_size - 1))) & (self->max_size - 1);
+}
+
+/**
+ * @brief API PRIVATE Returns the index of the slot holding key, or -1 if the key is absent.
  *
- * Reference:
- *   * Algorithms in C: Third Edition by Robert Sedgewick, p579
+ * Robin Hood probing keeps every run ordered by distance from the home slot, so the search stops as soon as it meets
+ * an empty slot or an entry closer to its home than the key would be. Lookups never allocate.
  */
-size_t prom_map_get_index(prom_map_t *self, const char *key) {
-  return prom_map_get_index_internal(key, &self->size, &self->max_size);
+static ssize_t prom_map_find(prom_map_t *self, const char *key, uint64_t hash) {
+  size_t mask = self->max_size - 1;
+  size_t index = (size_t)(hash & mask);
+  for (size_t distance = 0;; distance++, index = (index + 1) & mask) {
+    prom_map_slot_t *slot = &self->slots[index];
+    if (slot->key == NULL) return -1;
+    if (prom_map_probe_distance(self, slot->hash, index) < distance) return -1;
+    if (slot->hash == hash && strcmp(slot->key, key) == 0) return (ssize_t)index;
+  }
 }
 
-static void *prom_map_get_internal(const char *key, size_t *size, size_t *max_size, prom_linked_list_t *keys,
-                                   prom_linked_list_t **addrs, prom_map_node_free_value_fn free_value_fn) {
-  size_t index = prom_map_get_index_internal(key, size, max_size);
-  prom_linked_list_t *list = addrs[index];
-  prom_map_node_t *temp_map_node = prom_map_node_new(key, NULL, free_value_fn);
-
-  for (prom_linked_list_node_t *current_node = list->head; current_node != NULL; current_node = current_node->next) {
-    prom_map_node_t *current_map_node = (prom_map_node_t *)current_node->item;
-    prom_linked_list_compare_t result = prom_linked_list_compare(list, current_map_node, temp_map_node);
-    if (result == PROM_EQUAL) {
-      prom_map_node_destroy(temp_map_node);
-      temp_map_node = NULL;
-      return current_map_node->value;
+/**
+ * @brief API PRIVATE Places an entry that is known to be absent, displacing entries closer to their home slot.
+ */
+static void prom_map_place(prom_map_t *self, prom_map_slot_t entry) {
+  size_t mask = self->max_size - 1;
+  size_t index = (size_t)(entry.hash & mask);
+  for (size_t distance = 0;; distance++, index = (index + 1) & mask) {
+    prom_map_slot_t *slot = &self->slots[index];
+    if (slot->key == NULL) {
+      *slot = entry;
+      return;
+    }
+    size_t slot_distance = prom_map_probe_distance(self, slot->hash, index);
+    if (slot_distance < distance) {
+      prom_map_slot_t displaced = *slot;
+      *slot = entry;
+      entry = displaced;
+      distance = slot_distance;
     }
   }
-  prom_map_node_destroy(temp_map_node);
-  temp_map_node = NULL;
-  return NULL;
 }
 
 void *prom_map_get(prom_map_t *self, const char *key) {
   PROM_ASSERT(self != NULL);
   int r = 0;
-  r = pthread_rwlock_wrlock(self->rwlock);
+  // Lookups only read the table, so any number of them run in parallel. Only set and delete take the write lock
+  r = pthread_rwlock_rdlock(self->rwlock);
   if (r) {
     PROM_LOG(PROM_PTHREAD_RWLOCK_LOCK_ERROR);
-    NULL;
+    return NULL;
   }
-  void *payload =
-      prom_map_get_internal(key, &self->size, &self->max_size, self->keys, self->addrs, self->free_value_fn);
+  ssize_t index = prom_map_find(self, key, prom_map_hash(key));
+  void *payload = index < 0 ? NULL : self->slots[index].value;
   r = pthread_rwlock_unlock(self->rwlock);
   if (r) {
     PROM_LOG(PROM_PTHREAD_RWLOCK_UNLOCK_ERROR);
@@ -216,106 +226,35 @@ void *prom_map_get(prom_map_t *self, const char *key) {
   return payload;
 }
 
-static int prom_map_set_internal(const char *key, void *value, size_t *size, size_t *max_size, prom_linked_list_t *keys,
-                                 prom_linked_list_t **addrs, prom_map_node_free_value_fn free_value_fn,
-                                 bool destroy_current_value) {
-  prom_map_node_t *map_node = prom_map_node_new(key, value, free_value_fn);
-  if (map_node == NULL) return 1;
-
-  size_t index = prom_map_get_index_internal(key, size, max_size);
-  prom_linked_list_t *list = addrs[index];
-  for (prom_linked_list_node_t *current_node = list->head; current_node != NULL; current_node = current_node->next) {
-    prom_map_node_t *current_map_node = (prom_map_node_t *)current_node->item;
-    prom_linked_list_compare_t result = prom_linked_list_compare(list, current_map_node, map_node);
-    if (result == PROM_EQUAL) {
-      if (destroy_current_value) {
-        free_value_fn(current_map_node->value);
-        current_map_node->value = NULL;
-      }
-      prom_free((char *)current_map_node->key);
-      current_map_node->key = NULL;
-      prom_free(current_map_node);
-      current_map_node = NULL;
-      current_node->item = map_node;
-      return 0;
-    }
-  }
-  prom_linked_list_append(list, map_node);
-  prom_linked_list_append(keys, (char *)map_node->key);
-  (*size)++;
-  return 0;
-}
-
-int prom_map_ensure_space(prom_map_t *self) {
+/**
+ * @brief API PRIVATE Doubles the table once the load factor would exceed the maximum.
+ *
+ * Entries move with their stored hash and key pointer, so resizing neither hashes nor copies keys, and the keys list
+ * is left untouched.
+ */
+static int prom_map_ensure_space(prom_map_t *self) {
   PROM_ASSERT(self != NULL);
-  int r = 0;
 
-  if (self->size <= self->max_size / 2) {
+  if ((self->size + 1) * PROM_MAP_MAX_LOAD_DEN <= self->max_size * PROM_MAP_MAX_LOAD_NUM) {
     return 0;
   }
 
-  // Increase the max size
-  size_t new_max = self->max_size * 2;
-  size_t new_size = 0;
+  size_t old_max = self->max_size;
+  prom_map_slot_t *old_slots = self->slots;
 
-  // Create a new list of keys
-  prom_linked_list_t *new_keys = prom_linked_list_new();
-  if (new_keys == NULL) return 1;
-
-  r = prom_linked_list_set_free_fn(new_keys, prom_linked_list_no_op_free);
-  if (r) return r;
-
-  // Create a new array of addrs
-  prom_linked_list_t **new_addrs = prom_malloc(sizeof(prom_linked_list_t) * new_max);
-
-  // Initialize the new array
-  for (int i = 0; i < new_max; i++) {
-    new_addrs[i] = prom_linked_list_new();
-    r = prom_linked_list_set_free_fn(new_addrs[i], prom_map_node_free);
-    if (r) return r;
-    r = prom_linked_list_set_compare_fn(new_addrs[i], prom_map_node_compare);
-    if (r) return r;
+  self->max_size = old_max * 2;
+  self->slots = (prom_map_slot_t *)prom_malloc(sizeof(prom_map_slot_t) * self->max_size);
+  if (self->slots == NULL) {
+    self->slots = old_slots;
+    self->max_size = old_max;
+    return 1;
   }
+  memset(self->slots, 0, sizeof(prom_map_slot_t) * self->max_size);
 
-  // Iterate through each linked-list at each memory region in the map's backbone
-  for (int i = 0; i < self->max_size; i++) {
-    // Create a new map node for each node in the linked list and insert it into the new map. Afterwards, deallocate
-    // the old map node
-    prom_linked_list_t *list = self->addrs[i];
-    prom_linked_list_node_t *current_node = list->head;
-    while (current_node != NULL) {
-      prom_map_node_t *map_node = (prom_map_node_t *)current_node->item;
-      r = prom_map_set_internal(map_node->key, map_node->value, &new_size, &new_max, new_keys, new_addrs,
-                                self->free_value_fn, false);
-      if (r) return r;
-
-      prom_linked_list_node_t *next = current_node->next;
-      prom_free(current_node);
-      current_node = NULL;
-      prom_free((void *)map_node->key);
-      map_node->key = NULL;
-      prom_free(map_node);
-      map_node = NULL;
-      current_node = next;
-    }
-    // We're done deallocating each map node in the linked list, so deallocate the linked-list object
-    prom_free(self->addrs[i]);
-    self->addrs[i] = NULL;
+  for (size_t i = 0; i < old_max; i++) {
+    if (old_slots[i].key != NULL) prom_map_place(self, old_slots[i]);
   }
-  // Destroy the collection of keys in the map
-  prom_linked_list_destroy(self->keys);
-  self->keys = NULL;
-
-  // Deallocate the backbone of the map
-  prom_free(self->addrs);
-  self->addrs = NULL;
-
-  // Update the members of the current map
-  self->size = new_size;
-  self->max_size = new_max;
-  self->keys = new_keys;
-  self->addrs = new_addrs;
-
+  prom_free(old_slots);
   return 0;
 }
 
@@ -328,59 +267,32 @@ int prom_map_set(prom_map_t *self, const char *key, void *value) {
     return r;
   }
 
-  r = prom_map_ensure_space(self);
-  if (r) {
-    int rr = 0;
-    rr = pthread_rwlock_unlock(self->rwlock);
-    if (rr) {
-      PROM_LOG(PROM_PTHREAD_RWLOCK_UNLOCK_ERROR);
-      return rr;
-    } else {
-      return r;
-    }
-  }
-  r = prom_map_set_internal(key, value, &self->size, &self->max_size, self->keys, self->addrs, self->free_value_fn,
-                            true);
-  if (r) {
-    int rr = 0;
-    rr = pthread_rwlock_unlock(self->rwlock);
-    if (rr) {
-      PROM_LOG(PROM_PTHREAD_RWLOCK_UNLOCK_ERROR);
-      return rr;
-    } else {
-      return r;
+  uint64_t hash = prom_map_hash(key);
+  ssize_t index = prom_map_find(self, key, hash);
+  if (index >= 0) {
+    // Replace the value in place. The key keeps its slot and its position in the keys list
+    prom_map_slot_t *slot = &self->slots[index];
+    if (slot->value != NULL && slot->value != value) (*self->free_value_fn)(slot->value);
+    slot->value = value;
+  } else {
+    r = prom_map_ensure_space(self);
+    if (!r) {
+      prom_map_slot_t entry = {.hash = hash, .key = prom_strdup(key), .value = value};
+      r = prom_linked_list_append(self->keys, (char *)entry.key);
+      if (r) {
+        prom_free((void *)entry.key);
+      } else {
+        prom_map_place(self, entry);
+        self->size++;
+      }
     }
   }
-  r = pthread_rwlock_unlock(self->rwlock);
-  if (r) {
-    PROM_LOG(PROM_PTHREAD_RWLOCK_UNLOCK_ERROR);
-  }
-  return r;
-}
 
-static int prom_map_delete_internal(const char *key, size_t *size, size_t *max_size, prom_linked_list_t *keys,
-                                    prom_linked_list_t **addrs, prom_map_node_free_value_fn free_value_fn) {
-  int r = 0;
-  size_t index = prom_map_get_index_internal(key, size, max_size);
-  prom_linked_list_t *list = addrs[index];
-  prom_map_node_t *temp_map_node = prom_map_node_new(key, NULL, free_value_fn);
-
-  for (prom_linked_list_node_t *current_node = list->head; current_node != NULL; current_node = current_node->next) {
-    prom_map_node_t *current_map_node = (prom_map_node_t *)current_node->item;
-    prom_linked_list_compare_t result = prom_linked_list_compare(list, current_map_node, temp_map_node);
-    if (result == PROM_EQUAL) {
-      r = prom_linked_list_remove(list, current_node);
-      if (r) return r;
-
-      r = prom_linked_list_remove(keys, (char *)current_map_node->key);
-      if (r) return r;
-
-      (*size)--;
-      break;
-    }
+  int rr = pthread_rwlock_unlock(self->rwlock);
+  if (rr) {
+    PROM_LOG(PROM_PTHREAD_RWLOCK_UNLOCK_ERROR);
+    return rr;
   }
-  r = prom_map_node_destroy(temp_map_node);
-  temp_map_node = NULL;
   return r;
 }
 
@@ -391,10 +303,30 @@ int prom_map_delete(prom_map_t *self, const char *key) {
   r = pthread_rwlock_wrlock(self->rwlock);
   if (r) {
     PROM_LOG(PROM_PTHREAD_RWLOCK_LOCK_ERROR);
-    ret = r;
+    return r;
   }
-  r = prom_map_delete_internal(key, &self->size, &self->max_size, self->keys, self->addrs, self->free_value_fn);
-  if (r) ret = r;
+
+  ssize_t index = prom_map_find(self, key, prom_map_hash(key));
+  if (index >= 0) {
+    size_t mask = self->max_size - 1;
+    size_t i = (size_t)index;
+    prom_map_slot_t *slot = &self->slots[i];
+
+    r = prom_linked_list_remove(self->keys, (char *)slot->key);
+    if (r) ret = r;
+    if (slot->value != NULL) (*self->free_value_fn)(slot->value);
+    prom_free((void *)slot->key);
+    self->size--;
+
+    // Backward shift deletion: pull the rest of the run one slot closer to home, so no tombstones are needed
+    for (size_t next = (i + 1) & mask;; i = next, next = (next + 1) & mask) {
+      prom_map_slot_t *next_slot = &self->slots[next];
+      if (next_slot->key == NULL || prom_map_probe_distance(self, next_slot->hash, next) == 0) break;
+      self->slots[i] = *next_slot;
+    }
+    memset(&self->slots[i], 0, sizeof(prom_map_slot_t));
+  }
+
   r = pthread_rwlock_unlock(self->rwlock);
   if (r) {
     PROM_LOG(PROM_PTHREAD_RWLOCK_UNLOCK_ERROR);
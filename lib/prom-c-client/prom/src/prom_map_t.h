@@ -18,6 +18,7 @@
 #define PROM_MAP_T_H
 
 #include <pthread.h>
+#include <stdint.h>
 
 // Public
 #include "prom_map.h"
@@ -33,11 +34,20 @@ struct prom_map_node {
   prom_map_node_free_value_fn free_value_fn;
 };
 
+/**
+ * @brief API PRIVATE A slot of the open-addressing table. A NULL key marks an empty slot.
+ */
+typedef struct prom_map_slot {
+  uint64_t hash;   /**< full hash of key, so probes and resizes never rehash */
+  const char *key; /**< owned copy of the key, shared with the keys list */
+  void *value;
+} prom_map_slot_t;
+
 struct prom_map {
-  size_t size;                /**< contains the size of the map */
-  size_t max_size;            /**< stores the current max_size */
-  prom_linked_list_t *keys;   /**< linked list containing containing all keys present */
-  prom_linked_list_t **addrs; /**< Sequence of linked lists. Each list contains nodes with the same index */
+  size_t size;              /**< contains the size of the map */
+  size_t max_size;          /**< number of slots, always a power of two */
+  prom_linked_list_t *keys; /**< linked list containing all keys present, in insertion order */
+  prom_map_slot_t *slots;   /**< Robin Hood hash table */
   pthread_rwlock_t *rwlock;
   prom_map_node_free_value_fn free_value_fn;
 };
@@ -15,6 +15,7 @@
  */
 
 #include <pthread.h>
+#include <string.h>
 
 // Public
 #include "prom_alloc.h"
@@ -29,9 +30,28 @@
 #include "prom_metric_i.h"
 #include "prom_metric_sample_histogram_i.h"
 #include "prom_metric_sample_i.h"
+#include "prom_metric_sample_summary_i.h"
+#include "prom_string_builder_i.h"
+
+// L-values up to this length are rendered on the stack when looking up a sample
+#define PROM_METRIC_L_VALUE_STACK_SIZE 256
 
 char *prom_metric_type_map[4] = {"counter", "gauge", "histogram", "summary"};
 
+/**
+ * @brief API PRIVATE Makes room for one more sample in sample_list, so appending after the sample is in the map cannot
+ *        fail. The caller must hold the write lock once the metric is shared.
+ */
+static int prom_metric_reserve_sample(prom_metric_t *self) {
+  if (self->sample_count < self->sample_capacity) return 0;
+  size_t capacity = self->sample_capacity > 0 ? self->sample_capacity * 2 : 16;
+  void **sample_list = (void **)prom_realloc(self->sample_list, sizeof(void *) * capacity);
+  if (sample_list == NULL) return 1;
+  self->sample_list = sample_list;
+  self->sample_capacity = capacity;
+  return 0;
+}
+
 prom_metric_t *prom_metric_new(prom_metric_type_t metric_type, const char *name, const char *help,
                                size_t label_key_count, const char **label_keys) {
   int r = 0;
@@ -40,6 +60,16 @@ prom_metric_t *prom_metric_new(prom_metric_type_t metric_type, const char *name,
   self->name = name;
   self->help = help;
   self->buckets = NULL;
+  self->sample_list = NULL;
+  self->sample_count = 0;
+  self->sample_capacity = 0;
+  self->default_sample = NULL;
+  self->shard_count = 0;
+  self->sparse_schema = -1;
+  self->summary_opts = NULL;
+  self->header = NULL;
+  self->exposition = NULL;
+  pthread_mutex_init(&self->cache_mutex, NULL);
 
   const char **k = (const char **)prom_malloc(sizeof(const char *) * label_key_count);
 
@@ -66,6 +96,12 @@ prom_metric_t *prom_metric_new(prom_metric_type_t metric_type, const char *name,
       prom_metric_destroy(self);
       return NULL;
     }
+  } else if (metric_type == PROM_SUMMARY) {
+    r = prom_map_set_free_value_fn(self->samples, &prom_metric_sample_summary_free_generic);
+    if (r) {
+      prom_metric_destroy(self);
+      return NULL;
+    }
   } else {
     r = prom_map_set_free_value_fn(self->samples, &prom_metric_sample_free_generic);
     if (r) {
@@ -74,8 +110,31 @@ prom_metric_t *prom_metric_new(prom_metric_type_t metric_type, const char *name,
     }
   }
 
-  self->formatter = prom_metric_formatter_new();
-  if (self->formatter == NULL) {
+  // Counters and gauges without labels have a single sample. It is created up front so lookups never take the lock
+  if ((metric_type == PROM_COUNTER || metric_type == PROM_GAUGE) && label_key_count == 0) {
+    self->default_sample = prom_metric_sample_new(metric_type, name, 0.0);
+    r = prom_metric_reserve_sample(self);
+    if (!r) r = prom_map_set(self->samples, name, self->default_sample);
+    if (r) {
+      prom_metric_sample_destroy(self->default_sample);
+      self->default_sample = NULL;
+      prom_metric_destroy(self);
+      return NULL;
+    }
+    self->sample_list[self->sample_count++] = self->default_sample;
+  }
+
+  // The HELP and TYPE lines never change, so they are rendered once for every text scrape to copy
+  prom_metric_formatter_t *formatter = prom_metric_formatter_new();
+  if (formatter == NULL) {
+    prom_metric_destroy(self);
+    return NULL;
+  }
+  r = prom_metric_formatter_load_help(formatter, name, help);
+  if (!r) r = prom_metric_formatter_load_type(formatter, name, metric_type);
+  if (!r) self->header = prom_string_builder_dump(formatter->string_builder);
+  prom_metric_formatter_destroy(formatter);
+  if (self->header == NULL) {
     prom_metric_destroy(self);
     return NULL;
   }
@@ -88,6 +147,74 @@ prom_metric_t *prom_metric_new(prom_metric_type_t metric_type, const char *name,
   return self;
 }
 
+int prom_metric_set_shard_count(prom_metric_t *self, size_t shard_count) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL || shard_count == 0) return 1;
+  int r = 0;
+  if (self->type != PROM_COUNTER) {
+    PROM_LOG(PROM_METRIC_INCORRECT_TYPE);
+    return 1;
+  }
+
+  // Only samples created afterwards are sharded, so the count cannot change once labeled samples exist
+  r = pthread_rwlock_wrlock(self->rwlock);
+  if (r) {
+    PROM_LOG(PROM_PTHREAD_RWLOCK_LOCK_ERROR);
+    return r;
+  }
+  if (self->sample_count > (self->default_sample != NULL ? 1 : 0)) {
+    PROM_LOG(PROM_METRIC_SHARDING_AFTER_SAMPLES);
+    r = 1;
+  } else {
+    self->shard_count = shard_count;
+    if (self->default_sample != NULL) r = prom_metric_sample_shard(self->default_sample, shard_count);
+  }
+  int rr = pthread_rwlock_unlock(self->rwlock);
+  if (rr) {
+    PROM_LOG(PROM_PTHREAD_RWLOCK_UNLOCK_ERROR);
+    return rr;
+  }
+  return r;
+}
+
+int prom_metric_set_summary_opts(prom_metric_t *self, const prom_summary_opts_t *opts) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL || opts == NULL) return 1;
+  if (self->type != PROM_SUMMARY) {
+    PROM_LOG(PROM_METRIC_INCORRECT_TYPE);
+    return 1;
+  }
+
+  prom_summary_opts_t *copy = (prom_summary_opts_t *)prom_malloc(sizeof(prom_summary_opts_t));
+  double *quantiles = (double *)prom_malloc(sizeof(double) * opts->quantile_count);
+  double *errors = (double *)prom_malloc(sizeof(double) * opts->quantile_count);
+  memcpy(quantiles, opts->quantiles, sizeof(double) * opts->quantile_count);
+  memcpy(errors, opts->errors, sizeof(double) * opts->quantile_count);
+  *copy = *opts;
+  copy->quantiles = quantiles;
+  copy->errors = errors;
+  self->summary_opts = copy;
+  return 0;
+}
+
+int prom_metric_generation(prom_metric_t *self, uint64_t *generation) {
+  PROM_ASSERT(self != NULL);
+
+  uint64_t sum = self->sample_count;
+  for (size_t i = 0; i < self->sample_count; i++) {
+    void *sample = self->sample_list[i];
+    if (self->type == PROM_HISTOGRAM) {
+      sum += prom_metric_sample_histogram_generation((prom_metric_sample_histogram_t *)sample);
+    } else if (self->type == PROM_SUMMARY) {
+      sum += prom_metric_sample_summary_generation((prom_metric_sample_summary_t *)sample);
+    } else {
+      sum += prom_metric_sample_generation((prom_metric_sample_t *)sample);
+    }
+  }
+  *generation = sum;
+  return self->type == PROM_SUMMARY;
+}
+
 int prom_metric_destroy(prom_metric_t *self) {
   PROM_ASSERT(self != NULL);
   if (self == NULL) return 0;
@@ -105,9 +232,23 @@ int prom_metric_destroy(prom_metric_t *self) {
   self->samples = NULL;
   if (r) ret = r;
 
-  r = prom_metric_formatter_destroy(self->formatter);
-  self->formatter = NULL;
-  if (r) ret = r;
+  // The samples themselves belong to the map
+  prom_free(self->sample_list);
+  self->sample_list = NULL;
+
+  // After the samples, which point to it
+  if (self->summary_opts != NULL) {
+    prom_free((void *)self->summary_opts->quantiles);
+    prom_free((void *)self->summary_opts->errors);
+    prom_free(self->summary_opts);
+    self->summary_opts = NULL;
+  }
+
+  prom_free(self->header);
+  self->header = NULL;
+  prom_free(self->exposition);
+  self->exposition = NULL;
+  pthread_mutex_destroy(&self->cache_mutex);
 
   r = pthread_rwlock_destroy(self->rwlock);
   if (r) {
@@ -144,95 +285,141 @@ void prom_metric_free_generic(void *item) {
   prom_metric_destroy(self);
 }
 
-prom_metric_sample_t *prom_metric_sample_from_labels(prom_metric_t *self, const char **label_values) {
-  PROM_ASSERT(self != NULL);
-  int r = 0;
-  r = pthread_rwlock_wrlock(self->rwlock);
+/**
+ * @brief API PRIVATE Renders the l_value of a sample into stack when it fits, otherwise into a heap buffer that the
+ *        caller must release with prom_free.
+ */
+static char *prom_metric_render_l_value(prom_metric_t *self, const char **label_values, char *stack, size_t size) {
+  size_t len = prom_metric_formatter_render_l_value(stack, size, self->name, NULL, self->label_key_count,
+                                                    self->label_keys, label_values);
+  if (len < size) return stack;
+
+  char *l_value = (char *)prom_malloc(len + 1);
+  prom_metric_formatter_render_l_value(l_value, len + 1, self->name, NULL, self->label_key_count, self->label_keys,
+                                       label_values);
+  return l_value;
+}
+
+/**
+ * @brief API PRIVATE Creates the sample for l_value and adds it to the samples map. The caller must hold the write
+ *        lock.
+ */
+static void *prom_metric_add_sample(prom_metric_t *self, const char *l_value, const char **label_values) {
+  int r = prom_metric_reserve_sample(self);
+  if (r) return NULL;
+
+  if (self->type == PROM_HISTOGRAM) {
+    prom_metric_sample_histogram_t *sample =
+        self->sparse_schema >= 0
+            ? prom_metric_sample_histogram_new_sparse(self->name, self->sparse_schema, self->label_key_count,
+                                                      self->label_keys, label_values)
+            : prom_metric_sample_histogram_new(self->name, self->buckets, self->label_key_count, self->label_keys,
+                                               label_values);
+    if (sample == NULL) return NULL;
+    r = prom_map_set(self->samples, l_value, sample);
+    if (r) {
+      prom_metric_sample_histogram_destroy(sample);
+      return NULL;
+    }
+    self->sample_list[self->sample_count++] = sample;
+    return sample;
+  }
+  if (self->type == PROM_SUMMARY) {
+    prom_metric_sample_summary_t *sample = prom_metric_sample_summary_new(
+        self->name, self->summary_opts, self->label_key_count, self->label_keys, label_values);
+    if (sample == NULL) return NULL;
+    r = prom_map_set(self->samples, l_value, sample);
+    if (r) {
+      prom_metric_sample_summary_destroy(sample);
+      return NULL;
+    }
+    self->sample_list[self->sample_count++] = sample;
+    return sample;
+  }
+
+  prom_metric_sample_t *sample = prom_metric_sample_new(self->type, l_value, 0.0);
+  if (sample == NULL) return NULL;
+  if ((self->shard_count > 0 && prom_metric_sample_shard(sample, self->shard_count)) ||
+      prom_metric_sample_set_label_values(sample, self->label_key_count, label_values)) {
+    prom_metric_sample_destroy(sample);
+    return NULL;
+  }
+  r = prom_map_set(self->samples, l_value, sample);
   if (r) {
-    PROM_LOG(PROM_PTHREAD_RWLOCK_LOCK_ERROR);
+    prom_metric_sample_destroy(sample);
     return NULL;
   }
+  self->sample_list[self->sample_count++] = sample;
+  return sample;
+}
 
-#define PROM_METRIC_SAMPLE_FROM_LABELS_HANDLE_UNLOCK() \
-  r = pthread_rwlock_unlock(self->rwlock);             \
-  if (r) PROM_LOG(PROM_PTHREAD_RWLOCK_UNLOCK_ERROR);   \
-  return NULL;
+/**
+ * @brief API PRIVATE Returns the sample for the given label values, creating it on first use.
+ *
+ * Samples are never removed from a metric, so the common case of an existing label set is served under the read
+ * lock, with the l_value rendered on the stack. Only a miss takes the write lock, and checks again before inserting
+ * because another thread may have added the same label set in between.
+ */
+static void *prom_metric_sample_lookup(prom_metric_t *self, const char **label_values) {
+  int r = 0;
+  char stack[PROM_METRIC_L_VALUE_STACK_SIZE];
+  char *l_value = prom_metric_render_l_value(self, label_values, stack, sizeof(stack));
 
-  // Get l_value
-  r = prom_metric_formatter_load_l_value(self->formatter, self->name, NULL, self->label_key_count, self->label_keys,
-                                         label_values);
+  r = pthread_rwlock_rdlock(self->rwlock);
   if (r) {
-    PROM_METRIC_SAMPLE_FROM_LABELS_HANDLE_UNLOCK();
-  }
-
-  // This must be freed before returning
-  const char *l_value = prom_metric_formatter_dump(self->formatter);
-  if (l_value == NULL) {
-    PROM_METRIC_SAMPLE_FROM_LABELS_HANDLE_UNLOCK();
+    PROM_LOG(PROM_PTHREAD_RWLOCK_LOCK_ERROR);
+    if (l_value != stack) prom_free(l_value);
+    return NULL;
   }
+  void *sample = prom_map_get(self->samples, l_value);
+  r = pthread_rwlock_unlock(self->rwlock);
+  if (r) PROM_LOG(PROM_PTHREAD_RWLOCK_UNLOCK_ERROR);
 
-  // Get sample
-  prom_metric_sample_t *sample = (prom_metric_sample_t *)prom_map_get(self->samples, l_value);
   if (sample == NULL) {
-    sample = prom_metric_sample_new(self->type, l_value, 0.0);
-    r = prom_map_set(self->samples, l_value, sample);
+    r = pthread_rwlock_wrlock(self->rwlock);
     if (r) {
-      PROM_METRIC_SAMPLE_FROM_LABELS_HANDLE_UNLOCK();
+      PROM_LOG(PROM_PTHREAD_RWLOCK_LOCK_ERROR);
+      if (l_value != stack) prom_free(l_value);
+      return NULL;
     }
+    sample = prom_map_get(self->samples, l_value);
+    if (sample == NULL) sample = prom_metric_add_sample(self, l_value, label_values);
+    r = pthread_rwlock_unlock(self->rwlock);
+    if (r) PROM_LOG(PROM_PTHREAD_RWLOCK_UNLOCK_ERROR);
   }
-  pthread_rwlock_unlock(self->rwlock);
-  prom_free((void *)l_value);
+
+  if (l_value != stack) prom_free(l_value);
   return sample;
 }
 
-prom_metric_sample_histogram_t *prom_metric_sample_histogram_from_labels(prom_metric_t *self,
-                                                                         const char **label_values) {
+prom_metric_sample_t *prom_metric_sample_from_labels(prom_metric_t *self, const char **label_values) {
   PROM_ASSERT(self != NULL);
-
-  int r = 0;
-  r = pthread_rwlock_wrlock(self->rwlock);
-  if (r) {
-    PROM_LOG(PROM_PTHREAD_RWLOCK_LOCK_ERROR);
+  if (self->type != PROM_COUNTER && self->type != PROM_GAUGE) {
+    PROM_LOG(PROM_METRIC_INCORRECT_TYPE);
     return NULL;
   }
 
-#define PROM_METRIC_SAMPLE_HISTOGRAM_FROM_LABELS_HANDLE_UNLOCK() \
-  r = pthread_rwlock_unlock(self->rwlock);                       \
-  if (r) {                                                       \
-    PROM_LOG(PROM_PTHREAD_RWLOCK_UNLOCK_ERROR);                  \
-    return NULL;                                                 \
-  }
+  // Fast path: the sample of a metric without labels never changes
+  if (self->default_sample != NULL) return self->default_sample;
 
-  // Load the l_value
-  r = prom_metric_formatter_load_l_value(self->formatter, self->name, NULL, self->label_key_count, self->label_keys,
-                                         label_values);
-  if (r) {
-    PROM_METRIC_SAMPLE_HISTOGRAM_FROM_LABELS_HANDLE_UNLOCK();
-  }
+  return (prom_metric_sample_t *)prom_metric_sample_lookup(self, label_values);
+}
 
-  // This must be freed before returning
-  const char *l_value = prom_metric_formatter_dump(self->formatter);
-  if (l_value == NULL) {
-    PROM_METRIC_SAMPLE_HISTOGRAM_FROM_LABELS_HANDLE_UNLOCK();
+prom_metric_sample_histogram_t *prom_metric_sample_histogram_from_labels(prom_metric_t *self,
+                                                                         const char **label_values) {
+  PROM_ASSERT(self != NULL);
+  if (self->type != PROM_HISTOGRAM) {
+    PROM_LOG(PROM_METRIC_INCORRECT_TYPE);
+    return NULL;
   }
+  return (prom_metric_sample_histogram_t *)prom_metric_sample_lookup(self, label_values);
+}
 
-  // Get sample
-  prom_metric_sample_histogram_t *sample = (prom_metric_sample_histogram_t *)prom_map_get(self->samples, l_value);
-  if (sample == NULL) {
-    sample = prom_metric_sample_histogram_new(self->name, self->buckets, self->label_key_count, self->label_keys,
-                                              label_values);
-    if (sample == NULL) {
-      prom_free((void *)l_value);
-      PROM_METRIC_SAMPLE_HISTOGRAM_FROM_LABELS_HANDLE_UNLOCK();
-    }
-    r = prom_map_set(self->samples, l_value, sample);
-    if (r) {
-      prom_free((void *)l_value);
-      pthread_rwlock_unlock(self->rwlock);
-      PROM_METRIC_SAMPLE_HISTOGRAM_FROM_LABELS_HANDLE_UNLOCK();
-    }
+prom_metric_sample_summary_t *prom_metric_sample_summary_from_labels(prom_metric_t *self, const char **label_values) {
+  PROM_ASSERT(self != NULL);
+  if (self->type != PROM_SUMMARY) {
+    PROM_LOG(PROM_METRIC_INCORRECT_TYPE);
+    return NULL;
   }
-  pthread_rwlock_unlock(self->rwlock);
-  prom_free((void *)l_value);
-  return sample;
+  return (prom_metric_sample_summary_t *)prom_metric_sample_lookup(self, label_values);
 }
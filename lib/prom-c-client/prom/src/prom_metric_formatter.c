@@ -14,7 +14,12 @@
  * limitations under the License.
  */
 
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 // Public
 #include "prom_alloc.h"
@@ -22,16 +27,25 @@
 // Private
 #include "prom_assert.h"
 #include "prom_collector_t.h"
+#include "prom_dtoa_i.h"
+#include "prom_errors.h"
 #include "prom_linked_list_t.h"
+#include "prom_log.h"
 #include "prom_map_i.h"
 #include "prom_metric_formatter_i.h"
+#include "prom_metric_i.h"
+#include "prom_metric_sample_histogram_i.h"
 #include "prom_metric_sample_histogram_t.h"
+#include "prom_metric_sample_i.h"
+#include "prom_metric_sample_summary_i.h"
 #include "prom_metric_sample_t.h"
+#include "prom_metric_snapshot_i.h"
 #include "prom_metric_t.h"
 #include "prom_string_builder_i.h"
 
 prom_metric_formatter_t *prom_metric_formatter_new() {
   prom_metric_formatter_t *self = (prom_metric_formatter_t *)prom_malloc(sizeof(prom_metric_formatter_t));
+  self->snapshot = NULL;
   self->string_builder = prom_string_builder_new();
   if (self->string_builder == NULL) {
     prom_metric_formatter_destroy(self);
@@ -42,6 +56,11 @@ prom_metric_formatter_t *prom_metric_formatter_new() {
     prom_metric_formatter_destroy(self);
     return NULL;
   }
+  self->snapshot = prom_metric_snapshot_new();
+  if (self->snapshot == NULL) {
+    prom_metric_formatter_destroy(self);
+    return NULL;
+  }
   return self;
 }
 
@@ -60,6 +79,10 @@ int prom_metric_formatter_destroy(prom_metric_formatter_t *self) {
   self->err_builder = NULL;
   if (r) ret = r;
 
+  r = prom_metric_snapshot_destroy(self->snapshot);
+  self->snapshot = NULL;
+  if (r) ret = r;
+
   prom_free(self);
   self = NULL;
   return ret;
@@ -107,6 +130,30 @@ int prom_metric_formatter_load_type(prom_metric_formatter_t *self, const char *n
   return prom_string_builder_add_char(self->string_builder, '\n');
 }
 
+/**
+ * @brief API PRIVATE Characters that must be escaped in a label value, as \\, \" and \n
+ */
+#define PROM_METRIC_FORMATTER_LABEL_ESCAPES "\\\"\n"
+
+/**
+ * @brief API PRIVATE Loads a label value, escaping backslashes, double quotes and line feeds
+ */
+static int prom_metric_formatter_load_label_value(prom_metric_formatter_t *self, const char *value) {
+  int r = 0;
+  for (;;) {
+    size_t n = strcspn(value, PROM_METRIC_FORMATTER_LABEL_ESCAPES);
+    r = prom_string_builder_add_strn(self->string_builder, value, n);
+    if (r) return r;
+    if (value[n] == '\0') return 0;
+
+    r = prom_string_builder_add_char(self->string_builder, '\\');
+    if (r) return r;
+    r = prom_string_builder_add_char(self->string_builder, value[n] == '\n' ? 'n' : value[n]);
+    if (r) return r;
+    value += n + 1;
+  }
+}
+
 int prom_metric_formatter_load_l_value(prom_metric_formatter_t *self, const char *name, const char *suffix,
                                        size_t label_count, const char **label_keys, const char **label_values) {
   PROM_ASSERT(self != NULL);
@@ -141,7 +188,7 @@ int prom_metric_formatter_load_l_value(prom_metric_formatter_t *self, const char
     r = prom_string_builder_add_char(self->string_builder, '"');
     if (r) return r;
 
-    r = prom_string_builder_add_str(self->string_builder, (const char *)label_values[i]);
+    r = prom_metric_formatter_load_label_value(self, label_values[i]);
     if (r) return r;
 
     r = prom_string_builder_add_char(self->string_builder, '"');
@@ -158,26 +205,195 @@ int prom_metric_formatter_load_l_value(prom_metric_formatter_t *self, const char
   return 0;
 }
 
-int prom_metric_formatter_load_sample(prom_metric_formatter_t *self, prom_metric_sample_t *sample) {
+/**
+ * @brief API PRIVATE Copies the first n bytes of str into buffer at offset len, as far as they fit, and returns the new
+ * length
+ */
+static size_t prom_metric_formatter_render_strn(char *buffer, size_t size, size_t len, const char *str, size_t n) {
+  if (len < size) {
+    size_t avail = size - len - 1;
+    memcpy(buffer + len, str, n < avail ? n : avail);
+  }
+  return len + n;
+}
+
+/**
+ * @brief API PRIVATE Copies str into buffer at offset len, as far as it fits, and returns the new length
+ */
+static size_t prom_metric_formatter_render_str(char *buffer, size_t size, size_t len, const char *str) {
+  return prom_metric_formatter_render_strn(buffer, size, len, str, strlen(str));
+}
+
+/**
+ * @brief API PRIVATE Copies c into buffer at offset len, if it fits, and returns the new length
+ */
+static size_t prom_metric_formatter_render_char(char *buffer, size_t size, size_t len, char c) {
+  if (len + 1 < size) buffer[len] = c;
+  return len + 1;
+}
+
+size_t prom_metric_formatter_render_label_value(char *buffer, size_t size, size_t len, const char *value) {
+  for (;;) {
+    size_t n = strcspn(value, PROM_METRIC_FORMATTER_LABEL_ESCAPES);
+    len = prom_metric_formatter_render_strn(buffer, size, len, value, n);
+    if (value[n] == '\0') return len;
+
+    len = prom_metric_formatter_render_char(buffer, size, len, '\\');
+    len = prom_metric_formatter_render_char(buffer, size, len, value[n] == '\n' ? 'n' : value[n]);
+    value += n + 1;
+  }
+}
+
+size_t prom_metric_formatter_render_l_value(char *buffer, size_t size, const char *name, const char *suffix,
+                                            size_t label_count, const char **label_keys, const char **label_values) {
+  size_t len = 0;
+
+  len = prom_metric_formatter_render_str(buffer, size, len, name);
+  if (suffix != NULL) {
+    len = prom_metric_formatter_render_char(buffer, size, len, '_');
+    len = prom_metric_formatter_render_str(buffer, size, len, suffix);
+  }
+
+  // Must produce exactly the same string as prom_metric_formatter_load_l_value, which keys the samples map
+  for (size_t i = 0; i < label_count; i++) {
+    len = prom_metric_formatter_render_char(buffer, size, len, i == 0 ? '{' : ',');
+    len = prom_metric_formatter_render_str(buffer, size, len, label_keys[i]);
+    len = prom_metric_formatter_render_char(buffer, size, len, '=');
+    len = prom_metric_formatter_render_char(buffer, size, len, '"');
+    len = prom_metric_formatter_render_label_value(buffer, size, len, label_values[i]);
+    len = prom_metric_formatter_render_char(buffer, size, len, '"');
+  }
+  if (label_count > 0) len = prom_metric_formatter_render_char(buffer, size, len, '}');
+
+  if (size > 0) buffer[len < size ? len : size - 1] = '\0';
+  return len;
+}
+
+int prom_metric_formatter_load_r_value(prom_metric_formatter_t *self, double r_value) {
   PROM_ASSERT(self != NULL);
   if (self == NULL) return 1;
 
   int r = 0;
 
-  r = prom_string_builder_add_str(self->string_builder, sample->l_value);
-  if (r) return r;
-
   r = prom_string_builder_add_char(self->string_builder, ' ');
   if (r) return r;
 
-  char buffer[50];
-  sprintf(buffer, "%.17g", sample->r_value);
-  r = prom_string_builder_add_str(self->string_builder, buffer);
+  char buffer[PROM_DTOA_BUFFER_SIZE];
+  size_t len = prom_dtoa(r_value, buffer);
+  r = prom_string_builder_add_strn(self->string_builder, buffer, len);
   if (r) return r;
 
   return prom_string_builder_add_char(self->string_builder, '\n');
 }
 
+int prom_metric_formatter_load_value(prom_metric_formatter_t *self, const char *l_value, double r_value) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL) return 1;
+
+  int r = prom_string_builder_add_str(self->string_builder, l_value);
+  if (r) return r;
+
+  return prom_metric_formatter_load_r_value(self, r_value);
+}
+
+int prom_metric_formatter_load_sample(prom_metric_formatter_t *self, prom_metric_sample_t *sample) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL) return 1;
+  return prom_metric_formatter_load_value(self, sample->l_value, prom_metric_sample_get(sample));
+}
+
+/**
+ * @brief API PRIVATE Formats a bucket bound with the fewest digits that read back as the same double
+ */
+static void prom_metric_formatter_format_bound(char *buffer, size_t size, double bound) {
+  for (int precision = 6; precision <= 17; precision++) {
+    snprintf(buffer, size, "%.*g", precision, bound);
+    if (strtod(buffer, NULL) == bound) break;
+  }
+  if (!strpbrk(buffer, ".ein") && strlen(buffer) + 2 < size) strcat(buffer, ".0");
+}
+
+/**
+ * @brief API PRIVATE Loads a sparse histogram sample: one le bucket per allocated sub-bucket, then +Inf, count and sum.
+ *
+ * The counters are read once, in bucket order, so the cumulative values never decrease and +Inf and count always
+ * match the last bucket plus the overflow.
+ */
+static int prom_metric_formatter_load_sparse_histogram_sample(prom_metric_formatter_t *self,
+                                                              prom_metric_sample_histogram_t *sample) {
+  int r = 0;
+  size_t label_count = sample->label_count;
+  const char **label_values = (const char **)prom_malloc(sizeof(char *) * (label_count + 1));
+  if (label_values == NULL) return 1;
+  memcpy(label_values, sample->bucket_label_values, sizeof(char *) * label_count);
+
+  char le[50];
+  label_values[label_count] = le;
+  uint64_t cumulative = atomic_load_explicit(&sample->zero_count, memory_order_relaxed);
+  strcpy(le, "0.0");
+  r = prom_metric_formatter_load_l_value(self, sample->name, "bucket", label_count + 1, sample->bucket_label_keys,
+                                         label_values);
+  if (!r) r = prom_metric_formatter_load_r_value(self, (double)cumulative);
+
+  size_t sub_buckets = (size_t)1 << sample->schema;
+  for (size_t i = 0; !r && i < PROM_HISTOGRAM_SPARSE_OCTAVES; i++) {
+    _Atomic uint64_t *counts = atomic_load_explicit(&sample->octaves[i], memory_order_acquire);
+    for (size_t j = 0; !r && counts != NULL && j < sub_buckets; j++) {
+      cumulative += atomic_load_explicit(&counts[j], memory_order_relaxed);
+      int exponent = (int)i + PROM_HISTOGRAM_SPARSE_MIN_EXP;
+      double bound = prom_metric_sample_histogram_sparse_bound(sample->schema, exponent, j);
+      prom_metric_formatter_format_bound(le, sizeof(le), bound);
+      r = prom_metric_formatter_load_l_value(self, sample->name, "bucket", label_count + 1, sample->bucket_label_keys,
+                                             label_values);
+      if (!r) r = prom_metric_formatter_load_r_value(self, (double)cumulative);
+    }
+  }
+  prom_free(label_values);
+  if (r) return r;
+
+  cumulative += atomic_load_explicit(&sample->overflow_count, memory_order_relaxed);
+  r = prom_metric_formatter_load_value(self, sample->l_values[0], (double)cumulative);
+  if (r) return r;
+  r = prom_metric_formatter_load_value(self, sample->l_values[1], (double)cumulative);
+  if (r) return r;
+  return prom_metric_formatter_load_value(self, sample->l_values[2],
+                                          atomic_load_explicit(&sample->sum, memory_order_relaxed));
+}
+
+int prom_metric_formatter_load_histogram_sample(prom_metric_formatter_t *self,
+                                                prom_metric_sample_histogram_t *sample) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL) return 1;
+  if (sample->octaves != NULL) return prom_metric_formatter_load_sparse_histogram_sample(self, sample);
+
+  int r = 0;
+  double *values = (double *)prom_malloc(sizeof(double) * sample->l_value_count);
+  if (values == NULL) return 1;
+
+  r = prom_metric_sample_histogram_snapshot(sample, values);
+  for (size_t i = 0; !r && i < sample->l_value_count; i++) {
+    r = prom_metric_formatter_load_value(self, sample->l_values[i], values[i]);
+  }
+  prom_free(values);
+  return r;
+}
+
+int prom_metric_formatter_load_summary_sample(prom_metric_formatter_t *self, prom_metric_sample_summary_t *sample) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL) return 1;
+
+  int r = 0;
+  double *values = (double *)prom_malloc(sizeof(double) * sample->l_value_count);
+  if (values == NULL) return 1;
+
+  r = prom_metric_sample_summary_snapshot(sample, values);
+  for (size_t i = 0; !r && i < sample->l_value_count; i++) {
+    r = prom_metric_formatter_load_value(self, sample->l_values[i], values[i]);
+  }
+  prom_free(values);
+  return r;
+}
+
 int prom_metric_formatter_clear(prom_metric_formatter_t *self) {
   PROM_ASSERT(self != NULL);
   return prom_string_builder_clear(self->string_builder);
@@ -197,43 +413,108 @@ char *prom_metric_formatter_dump(prom_metric_formatter_t *self) {
   return data;
 }
 
+/**
+ * @brief API PRIVATE Drops a reference to exposition, freeing it with the last one
+ */
+static void prom_metric_exposition_release(prom_metric_exposition_t *exposition) {
+  if (atomic_fetch_sub_explicit(&exposition->refcount, 1, memory_order_acq_rel) == 1) prom_free(exposition);
+}
+
+/**
+ * @brief API PRIVATE Publishes the exposition rendered at generation as the metric's cached one, unless another scrape
+ *        already published the same or a newer generation
+ */
+static void prom_metric_exposition_publish(prom_metric_t *metric, const char *data, size_t len, uint64_t generation) {
+  // Allocated and filled outside the mutex; a failure only means the next scrape renders again
+  prom_metric_exposition_t *fresh = (prom_metric_exposition_t *)prom_malloc(sizeof(prom_metric_exposition_t) + len);
+  if (fresh == NULL) return;
+  atomic_init(&fresh->refcount, 1);
+  fresh->generation = generation;
+  fresh->len = len;
+  memcpy(fresh->data, data, len);
+
+  pthread_mutex_lock(&metric->cache_mutex);
+  prom_metric_exposition_t *old = metric->exposition;
+  if (old == NULL || old->generation < generation) {
+    metric->exposition = fresh;
+    fresh = old;
+  }
+  pthread_mutex_unlock(&metric->cache_mutex);
+
+  // The one not kept: the replaced exposition, which scrapes still copying it may outlive, or the unused fresh one
+  if (fresh != NULL) prom_metric_exposition_release(fresh);
+}
+
 int prom_metric_formatter_load_metric(prom_metric_formatter_t *self, prom_metric_t *metric) {
   PROM_ASSERT(self != NULL);
   if (self == NULL) return 1;
 
   int r = 0;
 
-  r = prom_metric_formatter_load_help(self, metric->name, metric->help);
+  // The read lock is only held while the samples are copied, so updates that add samples never wait on the
+  // formatting below
+  r = prom_metric_snapshot_take(self->snapshot, metric);
   if (r) return r;
 
-  r = prom_metric_formatter_load_type(self, metric->name, metric->type);
+  // The last exposition is reused as long as no sample was added or updated since it was rendered. The mutex is only
+  // held to take a reference, and the copy is made after releasing it, so concurrent scrapes do not wait on each other
+  prom_metric_snapshot_t *snapshot = self->snapshot;
+  int cacheable = !snapshot->ages;
+  if (cacheable) {
+    pthread_mutex_lock(&metric->cache_mutex);
+    prom_metric_exposition_t *cached = metric->exposition;
+    if (cached != NULL && cached->generation == snapshot->generation) {
+      atomic_fetch_add_explicit(&cached->refcount, 1, memory_order_relaxed);
+    } else {
+      cached = NULL;
+    }
+    pthread_mutex_unlock(&metric->cache_mutex);
+
+    if (cached != NULL) {
+      r = prom_string_builder_add_strn(self->string_builder, cached->data, cached->len);
+      prom_metric_exposition_release(cached);
+      return r;
+    }
+  }
+
+  // Rendered into the scrape's own formatter without any lock held
+  size_t start = prom_string_builder_len(self->string_builder);
+  r = prom_string_builder_add_str(self->string_builder, metric->header);
   if (r) return r;
 
-  for (prom_linked_list_node_t *current_node = metric->samples->keys->head; current_node != NULL;
-       current_node = current_node->next) {
-    const char *key = (const char *)current_node->item;
+  r = prom_metric_formatter_load_samples(self, metric, snapshot);
+  if (r) return r;
+
+  r = prom_string_builder_add_char(self->string_builder, '\n');
+  if (r) return r;
+
+  if (cacheable) {
+    prom_metric_exposition_publish(metric, prom_string_builder_str(self->string_builder) + start,
+                                   prom_string_builder_len(self->string_builder) - start, snapshot->generation);
+  }
+  return 0;
+}
+
+int prom_metric_formatter_load_samples(prom_metric_formatter_t *self, prom_metric_t *metric,
+                                       prom_metric_snapshot_t *snapshot) {
+  int r = 0;
+
+  for (size_t i = 0; i < snapshot->count; i++) {
+    prom_metric_snapshot_entry_t *entry = &snapshot->entries[i];
     if (metric->type == PROM_HISTOGRAM) {
-      prom_metric_sample_histogram_t *hist_sample =
-          (prom_metric_sample_histogram_t *)prom_map_get(metric->samples, key);
-
-      if (hist_sample == NULL) return 1;
-
-      for (prom_linked_list_node_t *current_hist_node = hist_sample->l_value_list->head; current_hist_node != NULL;
-           current_hist_node = current_hist_node->next) {
-        const char *hist_key = (const char *)current_hist_node->item;
-        prom_metric_sample_t *sample = (prom_metric_sample_t *)prom_map_get(hist_sample->samples, hist_key);
-        if (sample == NULL) return 1;
-        r = prom_metric_formatter_load_sample(self, sample);
-        if (r) return r;
-      }
+      r = prom_metric_formatter_load_histogram_sample(self, (prom_metric_sample_histogram_t *)entry->sample);
+      if (r) return r;
+    } else if (metric->type == PROM_SUMMARY) {
+      r = prom_metric_formatter_load_summary_sample(self, (prom_metric_sample_summary_t *)entry->sample);
+      if (r) return r;
     } else {
-      prom_metric_sample_t *sample = (prom_metric_sample_t *)prom_map_get(metric->samples, key);
-      if (sample == NULL) return 1;
-      r = prom_metric_formatter_load_sample(self, sample);
+      // The value copied with the snapshot is written, not the current one, so it matches the generation
+      prom_metric_sample_t *sample = (prom_metric_sample_t *)entry->sample;
+      r = prom_metric_formatter_load_value(self, sample->l_value, entry->value);
       if (r) return r;
     }
   }
-  return prom_string_builder_add_char(self->string_builder, '\n');
+  return r;
 }
 
 int prom_metric_formatter_load_metrics(prom_metric_formatter_t *self, prom_map_t *collectors) {
@@ -56,16 +56,68 @@ int prom_metric_formatter_load_type(prom_metric_formatter_t *self, const char *n
 int prom_metric_formatter_load_l_value(prom_metric_formatter_t *metric_formatter, const char *name, const char *suffix,
                                        size_t label_count, const char **label_keys, const char **label_values);
 
+/**
+ * @brief API PRIVATE Renders a metric sample L-value into a caller supplied buffer without allocating
+ * @param buffer The destination. May be NULL when size is 0.
+ * @param size The size of buffer in bytes.
+ * @param name The metric name
+ * @param suffix The metric suffix or NULL.
+ * @param label_count The number of labels for the given metric.
+ * @param label_keys An array of constant strings.
+ * @param label_values An array of constant strings.
+ * @return The length of the complete L-value, not counting the terminating null byte. If the return value is greater
+ *         than or equal to size, the output was truncated and the caller must retry with a larger buffer.
+ */
+size_t prom_metric_formatter_render_l_value(char *buffer, size_t size, const char *name, const char *suffix,
+                                            size_t label_count, const char **label_keys, const char **label_values);
+
+/**
+ * @brief API PRIVATE Writes value into buffer at offset len as a label value, escaping backslashes, double quotes and
+ * line feeds, and returns the new length. Writes only what fits before the last byte of buffer, which is left for the
+ * terminating null byte, but the returned length always counts the complete escaped value.
+ */
+size_t prom_metric_formatter_render_label_value(char *buffer, size_t size, size_t len, const char *value);
+
+/**
+ * @brief API PRIVATE Loads the formatter with the value that follows an l_value, and the end of the line
+ */
+int prom_metric_formatter_load_r_value(prom_metric_formatter_t *metric_formatter, double r_value);
+
+/**
+ * @brief API PRIVATE Loads the formatter with an l_value and its value
+ */
+int prom_metric_formatter_load_value(prom_metric_formatter_t *metric_formatter, const char *l_value, double r_value);
+
 /**
  * @brief API PRIVATE Loads the formatter with a metric sample
  */
 int prom_metric_formatter_load_sample(prom_metric_formatter_t *metric_formatter, prom_metric_sample_t *sample);
 
 /**
- * @brief API PRIVATE Loads a metric in the string exposition format
+ * @brief API PRIVATE Loads the formatter with the buckets, count and sum of a histogram sample
+ */
+int prom_metric_formatter_load_histogram_sample(prom_metric_formatter_t *metric_formatter,
+                                                prom_metric_sample_histogram_t *sample);
+
+/**
+ * @brief API PRIVATE Loads the formatter with the quantiles, sum and count of a summary sample
+ */
+int prom_metric_formatter_load_summary_sample(prom_metric_formatter_t *metric_formatter,
+                                              prom_metric_sample_summary_t *sample);
+
+/**
+ * @brief API PRIVATE Loads a metric in the string exposition format. The metric's read lock is held only while its
+ *        samples are copied into self->snapshot; they are formatted into self after it is released. When no sample
+ *        changed since the metric's cached exposition was rendered, that exposition is copied instead.
  */
 int prom_metric_formatter_load_metric(prom_metric_formatter_t *self, prom_metric_t *metric);
 
+/**
+ * @brief API PRIVATE Loads the samples of a metric as copied by snapshot. The metric's rwlock need not be held
+ */
+int prom_metric_formatter_load_samples(prom_metric_formatter_t *self, prom_metric_t *metric,
+                                       prom_metric_snapshot_t *snapshot);
+
 /**
  * @brief API PRIVATE Loads the given metrics
  */
@@ -17,11 +17,13 @@
 #ifndef PROM_METRIC_FORMATTER_T_H
 #define PROM_METRIC_FORMATTER_T_H
 
+#include "prom_metric_snapshot_t.h"
 #include "prom_string_builder_t.h"
 
 typedef struct prom_metric_formatter {
   prom_string_builder_t *string_builder;
   prom_string_builder_t *err_builder;
+  prom_metric_snapshot_t *snapshot; /**< samples of the metric being loaded, reused from one metric to the next */
 } prom_metric_formatter_t;
 
 #endif  // PROM_METRIC_FORMATTER_T_H
@@ -27,6 +27,33 @@
 prom_metric_t *prom_metric_new(prom_metric_type_t type, const char *name, const char *help, size_t label_key_count,
                                const char **label_keys);
 
+/**
+ * @brief API PRIVATE Makes every sample of a counter sharded over shard_count per-CPU slots. Must be called right
+ *        after prom_metric_new, before any sample is shared with other threads. Existing samples are not converted,
+ *        so a non-zero value is returned and nothing changes once the metric has a labeled sample, or when the
+ *        sample of a metric without labels is already sharded.
+ */
+int prom_metric_set_shard_count(prom_metric_t *self, size_t shard_count);
+
+/**
+ * @brief API PRIVATE Gives a summary its quantiles and window, copying opts. Must be called right after
+ *        prom_metric_new, before any sample is created.
+ */
+int prom_metric_set_summary_opts(prom_metric_t *self, const prom_summary_opts_t *opts);
+
+/**
+ * @brief API PRIVATE Returns the summary sample for the given label values, creating it on first use
+ */
+prom_metric_sample_summary_t *prom_metric_sample_summary_from_labels(prom_metric_t *self, const char **label_values);
+
+/**
+ * @brief API PRIVATE Adds up the generations of every sample, plus the sample count, into generation. The same value
+ *        on two scrapes means no sample was added or updated in between. For a summary the generation counts the
+ *        observations. The caller must hold the read lock.
+ * @return Non-zero if the exposition of the metric changes without updates, as with the sliding window of a summary
+ */
+int prom_metric_generation(prom_metric_t *self, uint64_t *generation);
+
 /**
  * @brief API PRIVATE Destroys a *prom_metric
  */
@@ -14,7 +14,11 @@
  * limitations under the License.
  */
 
+#define _GNU_SOURCE
+#include <sched.h>
 #include <stdatomic.h>
+#include <stdint.h>
+#include <time.h>
 
 // Public
 #include "prom_alloc.h"
@@ -26,19 +30,110 @@
 #include "prom_metric_sample_i.h"
 #include "prom_metric_sample_t.h"
 
+// Fallback slot of the calling thread when sched_getcpu is not available, assigned round robin on first use
+static _Thread_local size_t prom_metric_sample_thread_shard = SIZE_MAX;
+static atomic_size_t prom_metric_sample_next_thread_shard = ATOMIC_VAR_INIT(0);
+
 prom_metric_sample_t *prom_metric_sample_new(prom_metric_type_t type, const char *l_value, double r_value) {
   prom_metric_sample_t *self = (prom_metric_sample_t *)prom_malloc(sizeof(prom_metric_sample_t));
   self->type = type;
   self->l_value = prom_strdup(l_value);
   self->r_value = ATOMIC_VAR_INIT(r_value);
+  atomic_init(&self->generation, 0);
+  self->shards = NULL;
+  self->shard_count = 0;
+  self->shards_alloc = NULL;
+  self->label_values = NULL;
+  self->label_count = 0;
+  self->created = prom_metric_sample_now();
   return self;
 }
 
+double prom_metric_sample_now(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_REALTIME, &now);
+  return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+int prom_metric_sample_shard(prom_metric_sample_t *self, size_t shard_count) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL || shard_count == 0 || self->shards != NULL) return 1;
+  if (self->type != PROM_COUNTER) {
+    PROM_LOG(PROM_METRIC_INCORRECT_TYPE);
+    return 1;
+  }
+
+  // Over-allocate by one slot and align by hand so a custom prom_malloc still works
+  size_t size = sizeof(prom_metric_sample_shard_t) * (shard_count + 1);
+  self->shards_alloc = prom_malloc(size);
+  if (self->shards_alloc == NULL) return 1;
+  uintptr_t aligned = ((uintptr_t)self->shards_alloc + PROM_METRIC_SAMPLE_SHARD_SIZE - 1) &
+                      ~(uintptr_t)(PROM_METRIC_SAMPLE_SHARD_SIZE - 1);
+  self->shards = (prom_metric_sample_shard_t *)aligned;
+  for (size_t i = 0; i < shard_count; i++) {
+    atomic_init(&self->shards[i].value, 0.0);
+    atomic_init(&self->shards[i].generation, 0);
+  }
+  self->shard_count = shard_count;
+  return 0;
+}
+
+/**
+ * @brief API PRIVATE Returns the slot the calling thread should update
+ */
+static prom_metric_sample_shard_t *prom_metric_sample_shard_slot(prom_metric_sample_t *self) {
+  int cpu = sched_getcpu();
+  size_t index;
+  if (cpu >= 0) {
+    index = (size_t)cpu;
+  } else {
+    if (prom_metric_sample_thread_shard == SIZE_MAX) {
+      prom_metric_sample_thread_shard = atomic_fetch_add(&prom_metric_sample_next_thread_shard, 1);
+    }
+    index = prom_metric_sample_thread_shard;
+  }
+  return &self->shards[index % self->shard_count];
+}
+
+double prom_metric_sample_get(prom_metric_sample_t *self) {
+  PROM_ASSERT(self != NULL);
+  double value = atomic_load(&self->r_value);
+  for (size_t i = 0; i < self->shard_count; i++) value += atomic_load(&self->shards[i].value);
+  return value;
+}
+
+uint64_t prom_metric_sample_generation(prom_metric_sample_t *self) {
+  PROM_ASSERT(self != NULL);
+  uint64_t generation = atomic_load_explicit(&self->generation, memory_order_acquire);
+  for (size_t i = 0; i < self->shard_count; i++) {
+    generation += atomic_load_explicit(&self->shards[i].generation, memory_order_acquire);
+  }
+  return generation;
+}
+
+int prom_metric_sample_set_label_values(prom_metric_sample_t *self, size_t label_count, const char **label_values) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL || self->label_values != NULL) return 1;
+  if (label_count == 0) return 0;
+
+  self->label_values = (char **)prom_malloc(sizeof(char *) * label_count);
+  if (self->label_values == NULL) return 1;
+  for (size_t i = 0; i < label_count; i++) self->label_values[i] = prom_strdup(label_values[i]);
+  self->label_count = label_count;
+  return 0;
+}
+
 int prom_metric_sample_destroy(prom_metric_sample_t *self) {
   PROM_ASSERT(self != NULL);
   if (self == NULL) return 0;
   prom_free((void *)self->l_value);
   self->l_value = NULL;
+  for (size_t i = 0; i < self->label_count; i++) prom_free(self->label_values[i]);
+  prom_free(self->label_values);
+  self->label_values = NULL;
+  if (self->shards_alloc != NULL) prom_free(self->shards_alloc);
+  self->shards_alloc = NULL;
+  self->shards = NULL;
   prom_free((void *)self);
   self = NULL;
   return 0;
@@ -63,10 +158,19 @@ int prom_metric_sample_add(prom_metric_sample_t *self, double r_value) {
   if (r_value < 0) {
     return 1;
   }
-  _Atomic double old = atomic_load(&self->r_value);
+  // A sharded sample only contends with writers running on the same CPU
+  _Atomic double *target = &self->r_value;
+  _Atomic uint64_t *generation = &self->generation;
+  if (self->shards != NULL) {
+    prom_metric_sample_shard_t *shard = prom_metric_sample_shard_slot(self);
+    target = &shard->value;
+    generation = &shard->generation;
+  }
+  _Atomic double old = atomic_load(target);
   for (;;) {
     _Atomic double new = ATOMIC_VAR_INIT(old + r_value);
-    if (atomic_compare_exchange_weak(&self->r_value, &old, new)) {
+    if (atomic_compare_exchange_weak(target, &old, new)) {
+      atomic_fetch_add_explicit(generation, 1, memory_order_release);
       return 0;
     }
   }
@@ -82,6 +186,7 @@ int prom_metric_sample_sub(prom_metric_sample_t *self, double r_value) {
   for (;;) {
     _Atomic double new = ATOMIC_VAR_INIT(old - r_value);
     if (atomic_compare_exchange_weak(&self->r_value, &old, new)) {
+      atomic_fetch_add_explicit(&self->generation, 1, memory_order_release);
       return 0;
     }
   }
@@ -93,5 +198,6 @@ int prom_metric_sample_set(prom_metric_sample_t *self, double r_value) {
     return 1;
   }
   atomic_store(&self->r_value, r_value);
+  atomic_fetch_add_explicit(&self->generation, 1, memory_order_release);
   return 0;
 }
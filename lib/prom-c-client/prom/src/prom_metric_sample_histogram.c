@@ -14,8 +14,10 @@
  * limitations under the License.
  */
 
-#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
 #include <stdio.h>
+#include <string.h>
 
 // Public
 #include "prom_alloc.h"
@@ -24,9 +26,8 @@
 // Private
 #include "prom_assert.h"
 #include "prom_errors.h"
-#include "prom_linked_list_i.h"
+#include "prom_exemplar_i.h"
 #include "prom_log.h"
-#include "prom_map_i.h"
 #include "prom_metric_formatter_i.h"
 #include "prom_metric_sample_histogram_i.h"
 #include "prom_metric_sample_i.h"
@@ -35,32 +36,11 @@
 // Static Declarations
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-static const char *prom_metric_sample_histogram_l_value_for_bucket(prom_metric_sample_histogram_t *self,
-                                                                   const char *name, size_t label_count,
-                                                                   const char **label_keys, const char **label_values,
-                                                                   double bucket);
+static char *prom_metric_sample_histogram_l_value(const char *name, const char *suffix, size_t label_count,
+                                                  const char **label_keys, const char **label_values, const char *le);
 
-static const char *prom_metric_sample_histogram_l_value_for_inf(prom_metric_sample_histogram_t *self, const char *name,
-                                                                size_t label_count, const char **label_keys,
-                                                                const char **label_values);
-
-static void prom_metric_sample_histogram_free_str_generic(void *gen);
-
-static int prom_metric_sample_histogram_init_bucket_samples(prom_metric_sample_histogram_t *self, const char *name,
-                                                            size_t label_count, const char **label_keys,
-                                                            const char **label_values);
-
-static int prom_metric_sample_histogram_init_inf(prom_metric_sample_histogram_t *self, const char *name,
-                                                 size_t label_count, const char **label_keys,
-                                                 const char **label_values);
-
-static int prom_metric_sample_histogram_init_count(prom_metric_sample_histogram_t *self, const char *name,
-                                                   size_t label_count, const char **label_keys,
-                                                   const char **label_values);
-
-static int prom_metric_sample_histogram_init_summary(prom_metric_sample_histogram_t *self, const char *name,
-                                                     size_t label_count, const char **label_keys,
-                                                     const char **label_values);
+static void prom_metric_sample_histogram_copy_labels(prom_metric_sample_histogram_t *self, size_t label_count,
+                                                     const char **label_keys, const char **label_values);
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // End static declarations
@@ -69,237 +49,110 @@ static int prom_metric_sample_histogram_init_summary(prom_metric_sample_histogra
 prom_metric_sample_histogram_t *prom_metric_sample_histogram_new(const char *name, prom_histogram_buckets_t *buckets,
                                                                  size_t label_count, const char **label_keys,
                                                                  const char **label_values) {
-  // Capture return codes
-  int r = 0;
+  PROM_ASSERT(buckets != NULL);
+  size_t bucket_count = prom_histogram_buckets_count(buckets);
 
   // Allocate and set self
   prom_metric_sample_histogram_t *self =
       (prom_metric_sample_histogram_t *)prom_malloc(sizeof(prom_metric_sample_histogram_t));
-
-  // Allocate and set the l_value_list
-  self->l_value_list = prom_linked_list_new();
-  if (self->l_value_list == NULL) {
-    prom_metric_sample_histogram_destroy(self);
-    return NULL;
-  }
-
-  // Allocate and set the metric formatter
-  self->metric_formatter = prom_metric_formatter_new();
-  if (self->metric_formatter == NULL) {
-    prom_metric_sample_histogram_destroy(self);
-    return NULL;
-  }
-
-  // Store map of l_value/prom_metric_sample_t
-  self->samples = prom_map_new();
-  if (self->samples == NULL) {
-    prom_metric_sample_histogram_destroy(self);
-    return NULL;
-  }
-
-  // Set the free value function on the samples map
-  r = prom_map_set_free_value_fn(self->samples, &prom_metric_sample_free_generic);
-  if (r) {
-    prom_metric_sample_histogram_destroy(self);
-    return NULL;
-  }
-
-  // Set a map of bucket: l_value
-  self->l_values = prom_map_new();  // Store map of bucket/l_value
-  if (self->l_values == NULL) {
-    prom_metric_sample_histogram_destroy(self);
-    return NULL;
-  }
-
-  // Set the free value function for thhe l_values map
-  r = prom_map_set_free_value_fn(self->l_values, prom_metric_sample_histogram_free_str_generic);
-  if (r) {
-    prom_metric_sample_histogram_destroy(self);
-    return NULL;
-  }
-
+  memset(self, 0, sizeof(prom_metric_sample_histogram_t));
   self->buckets = buckets;
-
-  // Allocate and initialize the lock
-  self->rwlock = (pthread_rwlock_t *)prom_malloc(sizeof(pthread_rwlock_t));
-  r = pthread_rwlock_init(self->rwlock, NULL);
-  if (r) {
-    prom_metric_sample_histogram_destroy(self);
-    return NULL;
-  }
-
-  // Allocate and initialize bucket metric samples
-  r = prom_metric_sample_histogram_init_bucket_samples(self, name, label_count, label_keys, label_values);
-  if (r) {
-    prom_metric_sample_histogram_destroy(self);
-    return NULL;
-  }
-
-  // Allocate and initialize the +Inf metric sample
-  r = prom_metric_sample_histogram_init_inf(self, name, label_count, label_keys, label_values);
-  if (r) {
-    prom_metric_sample_histogram_destroy(self);
-    return NULL;
-  }
-
-  // Allocate and initialize the count metric sample
-  r = prom_metric_sample_histogram_init_count(self, name, label_count, label_keys, label_values);
-  if (r) {
-    prom_metric_sample_histogram_destroy(self);
-    return NULL;
-  }
-
-  // Add summary sample
-  r = prom_metric_sample_histogram_init_summary(self, name, label_count, label_keys, label_values);
-  if (r) {
-    prom_metric_sample_histogram_destroy(self);
-    return NULL;
+  atomic_init(&self->sum, 0.0);
+  atomic_init(&self->generation, 0);
+  atomic_init(&self->exemplars, NULL);
+  prom_metric_sample_histogram_copy_labels(self, label_count, label_keys, label_values);
+
+  // One counter per upper bound plus the +Inf bucket. Counts are per bucket and only made cumulative on scrape
+  self->bucket_counts = (_Atomic uint64_t *)prom_malloc(sizeof(_Atomic uint64_t) * (bucket_count + 1));
+  for (size_t i = 0; i <= bucket_count; i++) atomic_init(&self->bucket_counts[i], 0);
+
+  // Render every l_value up front: the buckets, +Inf, count and sum, in exposition order
+  self->l_values = (char **)prom_malloc(sizeof(char *) * (bucket_count + 3));
+  for (size_t i = 0; i < bucket_count; i++) {
+    char *le = prom_metric_sample_histogram_bucket_to_str(buckets->upper_bounds[i]);
+    self->l_values[self->l_value_count] =
+        prom_metric_sample_histogram_l_value(name, "bucket", label_count, label_keys, label_values, le);
+    prom_free(le);
+    if (self->l_values[self->l_value_count++] == NULL) {
+      prom_metric_sample_histogram_destroy(self);
+      return NULL;
+    }
   }
-
-  // The value of nodes in this map will be simple prom_metric_sample pointers.
-  r = prom_map_set_free_value_fn(self->samples, &prom_metric_sample_free_generic);
-  if (r) {
-    prom_metric_sample_histogram_destroy(self);
-    return NULL;
+  const char *suffixes[3] = {"bucket", "count", "sum"};
+  for (size_t i = 0; i < 3; i++) {
+    self->l_values[self->l_value_count] = prom_metric_sample_histogram_l_value(
+        name, suffixes[i], label_count, label_keys, label_values, i == 0 ? "+Inf" : NULL);
+    if (self->l_values[self->l_value_count++] == NULL) {
+      prom_metric_sample_histogram_destroy(self);
+      return NULL;
+    }
   }
   return self;
 }
 
-static int prom_metric_sample_histogram_init_bucket_samples(prom_metric_sample_histogram_t *self, const char *name,
-                                                            size_t label_count, const char **label_keys,
-                                                            const char **label_values) {
-  PROM_ASSERT(self);
-  int r = 0;
-  int bucket_count = prom_histogram_buckets_count(self->buckets);
-
-  // For each bucket, create an prom_metric_sample_t with an appropriate l_value and default value of 0.0. The
-  // l_value will contain the metric name, user labels, and finally, the le label and bucket value.
-  for (int i = 0; i < bucket_count; i++) {
-    const char *l_value = prom_metric_sample_histogram_l_value_for_bucket(self, name, label_count, label_keys,
-                                                                          label_values, self->buckets->upper_bounds[i]);
-    if (l_value == NULL) return 1;
-
-    r = prom_linked_list_append(self->l_value_list, prom_strdup(l_value));
-    if (r) return r;
-
-    const char *bucket_key = prom_metric_sample_histogram_bucket_to_str(self->buckets->upper_bounds[i]);
-    if (bucket_key == NULL) return 1;
-
-    r = prom_map_set(self->l_values, bucket_key, (char *)l_value);
-    if (r) return r;
+prom_metric_sample_histogram_t *prom_metric_sample_histogram_new_sparse(const char *name, int schema,
+                                                                        size_t label_count, const char **label_keys,
+                                                                        const char **label_values) {
+  if (schema < 0 || schema > PROM_HISTOGRAM_SPARSE_MAX_SCHEMA) return NULL;
 
-    prom_metric_sample_t *sample = prom_metric_sample_new(PROM_HISTOGRAM, l_value, 0.0);
-    if (sample == NULL) return 1;
-
-    r = prom_map_set(self->samples, l_value, sample);
-    if (r) return r;
-
-    prom_free((void *)bucket_key);
+  prom_metric_sample_histogram_t *self =
+      (prom_metric_sample_histogram_t *)prom_malloc(sizeof(prom_metric_sample_histogram_t));
+  memset(self, 0, sizeof(prom_metric_sample_histogram_t));
+  self->schema = schema;
+  atomic_init(&self->sum, 0.0);
+  atomic_init(&self->generation, 0);
+  atomic_init(&self->exemplars, NULL);
+  atomic_init(&self->zero_count, 0);
+  atomic_init(&self->overflow_count, 0);
+
+  self->octaves = (_Atomic(_Atomic uint64_t *) *)prom_malloc(sizeof(*self->octaves) * PROM_HISTOGRAM_SPARSE_OCTAVES);
+  for (size_t i = 0; i < PROM_HISTOGRAM_SPARSE_OCTAVES; i++) atomic_init(&self->octaves[i], NULL);
+
+  // Bucket l_values depend on which buckets exist, so they are rendered at scrape time from a copy of the labels
+  self->name = prom_strdup(name);
+  prom_metric_sample_histogram_copy_labels(self, label_count, label_keys, label_values);
+
+  self->l_values = (char **)prom_malloc(sizeof(char *) * 3);
+  const char *suffixes[3] = {"bucket", "count", "sum"};
+  for (size_t i = 0; i < 3; i++) {
+    self->l_values[self->l_value_count] = prom_metric_sample_histogram_l_value(
+        name, suffixes[i], label_count, label_keys, label_values, i == 0 ? "+Inf" : NULL);
+    if (self->l_values[self->l_value_count++] == NULL) {
+      prom_metric_sample_histogram_destroy(self);
+      return NULL;
+    }
   }
-  return 0;
-}
-
-static int prom_metric_sample_histogram_init_inf(prom_metric_sample_histogram_t *self, const char *name,
-                                                 size_t label_count, const char **label_keys,
-                                                 const char **label_values) {
-  PROM_ASSERT(self != NULL);
-  int r = 0;
-  const char *inf_l_value =
-      prom_metric_sample_histogram_l_value_for_inf(self, name, label_count, label_keys, label_values);
-  if (inf_l_value == NULL) return 1;
-
-  r = prom_linked_list_append(self->l_value_list, prom_strdup(inf_l_value));
-  if (r) return r;
-
-  r = prom_map_set(self->l_values, "+Inf", (char *)inf_l_value);
-  if (r) return r;
-
-  prom_metric_sample_t *inf_sample = prom_metric_sample_new(PROM_HISTOGRAM, (char *)inf_l_value, 0.0);
-  if (inf_sample == NULL) return 1;
-
-  return prom_map_set(self->samples, inf_l_value, inf_sample);
-}
-
-static int prom_metric_sample_histogram_init_count(prom_metric_sample_histogram_t *self, const char *name,
-                                                   size_t label_count, const char **label_keys,
-                                                   const char **label_values) {
-  PROM_ASSERT(self != NULL);
-  int r = 0;
-
-  r = prom_metric_formatter_load_l_value(self->metric_formatter, name, "count", label_count, label_keys, label_values);
-  if (r) return r;
-
-  const char *count_l_value = prom_metric_formatter_dump(self->metric_formatter);
-  if (count_l_value == NULL) return 1;
-
-  r = prom_linked_list_append(self->l_value_list, prom_strdup(count_l_value));
-  if (r) return r;
-
-  r = prom_map_set(self->l_values, "count", (char *)count_l_value);
-  if (r) return r;
-
-  prom_metric_sample_t *count_sample = prom_metric_sample_new(PROM_HISTOGRAM, count_l_value, 0.0);
-  if (count_sample == NULL) return 1;
-
-  return prom_map_set(self->samples, count_l_value, count_sample);
-}
-
-static int prom_metric_sample_histogram_init_summary(prom_metric_sample_histogram_t *self, const char *name,
-                                                     size_t label_count, const char **label_keys,
-                                                     const char **label_values) {
-  PROM_ASSERT(self != NULL);
-  int r = 0;
-
-  r = prom_metric_formatter_load_l_value(self->metric_formatter, name, "sum", label_count, label_keys, label_values);
-  if (r) return r;
-
-  const char *sum_l_value = prom_metric_formatter_dump(self->metric_formatter);
-  if (sum_l_value == NULL) return 1;
-
-  r = prom_linked_list_append(self->l_value_list, prom_strdup(sum_l_value));
-  if (r) return r;
-
-  r = prom_map_set(self->l_values, "sum", (char *)sum_l_value);
-  if (r) return r;
-
-  prom_metric_sample_t *sum_sample = prom_metric_sample_new(PROM_HISTOGRAM, sum_l_value, 0.0);
-  if (sum_sample == NULL) return 1;
-
-  return prom_map_set(self->samples, sum_l_value, sum_sample);
+  return self;
 }
 
 int prom_metric_sample_histogram_destroy(prom_metric_sample_histogram_t *self) {
   PROM_ASSERT(self != NULL);
-  int r = 0;
-  int ret = 0;
-
   if (self == NULL) return 0;
 
-  r = prom_linked_list_destroy(self->l_value_list);
-  self->l_value_list = NULL;
-  if (r) ret = r;
-
-  r = prom_map_destroy(self->samples);
-  if (r) ret = r;
-  self->samples = NULL;
-
-  r = prom_map_destroy(self->l_values);
-  if (r) ret = r;
+  for (size_t i = 0; i < self->l_value_count; i++) prom_free(self->l_values[i]);
+  prom_free(self->l_values);
   self->l_values = NULL;
 
-  r = prom_metric_formatter_destroy(self->metric_formatter);
-  if (r) ret = r;
-  self->metric_formatter = NULL;
-
-  r = pthread_rwlock_destroy(self->rwlock);
-  if (r) ret = r;
+  prom_free((void *)self->bucket_counts);
+  self->bucket_counts = NULL;
+  prom_free((void *)atomic_load(&self->exemplars));
 
-  prom_free(self->rwlock);
-  self->rwlock = NULL;
+  if (self->octaves != NULL) {
+    for (size_t i = 0; i < PROM_HISTOGRAM_SPARSE_OCTAVES; i++) prom_free((void *)atomic_load(&self->octaves[i]));
+    prom_free((void *)self->octaves);
+    self->octaves = NULL;
+  }
+  for (size_t i = 0; self->bucket_label_keys != NULL && i < self->label_count; i++) {
+    prom_free((void *)self->bucket_label_keys[i]);
+    prom_free((void *)self->bucket_label_values[i]);
+  }
+  prom_free(self->bucket_label_keys);
+  prom_free(self->bucket_label_values);
+  prom_free((void *)self->name);
 
   prom_free(self);
   self = NULL;
-  return ret;
+  return 0;
 }
 
 int prom_metric_sample_histogram_destroy_generic(void *gen) {
@@ -316,194 +169,212 @@ void prom_metric_sample_histogram_free_generic(void *gen) {
   prom_metric_sample_histogram_destroy(self);
 }
 
-int prom_metric_sample_histogram_observe(prom_metric_sample_histogram_t *self, double value) {
-  int r = 0;
-
-  r = pthread_rwlock_wrlock(self->rwlock);
-  if (r) {
-    printf("RETURN CODE: %d\n", r);
-    PROM_LOG(PROM_PTHREAD_RWLOCK_LOCK_ERROR);
-    return r;
-  }
-
-#define PROM_METRIC_SAMPLE_HISTOGRAM_OBSERVE_HANDLE_UNLOCK(r) \
-  int rr = 0;                                                 \
-  rr = pthread_rwlock_unlock(self->rwlock);                   \
-  if (rr) {                                                   \
-    PROM_LOG(PROM_PTHREAD_RWLOCK_UNLOCK_ERROR);               \
-    return rr;                                                \
-  } else {                                                    \
-    return r;                                                 \
-  }
-
-  // Update the counter for the proper bucket if found
-  int bucket_count = prom_histogram_buckets_count(self->buckets);
-  for (int i = (bucket_count - 1); i >= 0; i--) {
-    if (value > self->buckets->upper_bounds[i]) {
-      break;
-    }
-
-    const char *bucket_key = prom_metric_sample_histogram_bucket_to_str(self->buckets->upper_bounds[i]);
-    if (bucket_key == NULL) {
-      PROM_METRIC_SAMPLE_HISTOGRAM_OBSERVE_HANDLE_UNLOCK(1)
-    }
-
-    const char *l_value = prom_map_get(self->l_values, bucket_key);
-    if (l_value == NULL) {
-      prom_free((void *)bucket_key);
-      PROM_METRIC_SAMPLE_HISTOGRAM_OBSERVE_HANDLE_UNLOCK(1)
-    }
-
-    prom_metric_sample_t *sample = prom_map_get(self->samples, l_value);
-    if (sample == NULL) {
-      prom_free((void *)bucket_key);
-      PROM_METRIC_SAMPLE_HISTOGRAM_OBSERVE_HANDLE_UNLOCK(1)
+size_t prom_metric_sample_histogram_bucket_index(prom_histogram_buckets_t *buckets, double value) {
+  // Binary search for the first upper bound greater than or equal to value. The bounds are sorted on construction
+  size_t low = 0;
+  size_t high = (size_t)buckets->count;
+  while (low < high) {
+    size_t mid = low + (high - low) / 2;
+    if (value <= buckets->upper_bounds[mid]) {
+      high = mid;
+    } else {
+      low = mid + 1;
     }
+  }
+  return low;
+}
 
-    prom_free((void *)bucket_key);
-    r = prom_metric_sample_add(sample, 1.0);
-    if (r) {
-      PROM_METRIC_SAMPLE_HISTOGRAM_OBSERVE_HANDLE_UNLOCK(r);
+/**
+ * @brief API PRIVATE Counts value in a sparse histogram.
+ *
+ * The bucket comes straight from the bits of the double: the exponent selects the power of two and the top schema
+ * bits of the mantissa select the sub-bucket. Buckets include their upper bound, so a value sitting exactly on a
+ * boundary moves down one bucket. The counters of a power of two are allocated the first time it is observed and
+ * published with a compare-and-swap; every later observation there is allocation-free.
+ */
+static int prom_metric_sample_histogram_observe_sparse(prom_metric_sample_histogram_t *self, double value) {
+  if (!(value > 0)) {
+    if (value <= 0) {
+      atomic_fetch_add_explicit(&self->zero_count, 1, memory_order_relaxed);
+    } else {
+      atomic_fetch_add_explicit(&self->overflow_count, 1, memory_order_relaxed);
     }
+    return 0;
   }
 
-  // Update the +Inf and count samples
-  const char *inf_l_value = prom_map_get(self->l_values, "+Inf");
-  if (inf_l_value == NULL) {
-    PROM_METRIC_SAMPLE_HISTOGRAM_OBSERVE_HANDLE_UNLOCK(1);
+  uint64_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  int exponent = (int)((bits >> 52) & 0x7ff) - 1023;
+  uint64_t mantissa = bits & ((UINT64_C(1) << 52) - 1);
+  size_t sub_bucket = (size_t)(mantissa >> (52 - self->schema));
+  if ((mantissa & ((UINT64_C(1) << (52 - self->schema)) - 1)) == 0) {
+    // Exactly on the lower bound of this bucket, which is the upper bound of the previous one
+    if (sub_bucket == 0) {
+      exponent--;
+      sub_bucket = ((size_t)1 << self->schema) - 1;
+    } else {
+      sub_bucket--;
+    }
   }
 
-  prom_metric_sample_t *inf_sample = prom_map_get(self->samples, inf_l_value);
-  if (inf_sample == NULL) {
-    PROM_METRIC_SAMPLE_HISTOGRAM_OBSERVE_HANDLE_UNLOCK(1);
+  if (exponent > PROM_HISTOGRAM_SPARSE_MAX_EXP) {
+    atomic_fetch_add_explicit(&self->overflow_count, 1, memory_order_relaxed);
+    return 0;
   }
-
-  r = prom_metric_sample_add(inf_sample, 1.0);
-  if (r) {
-    PROM_METRIC_SAMPLE_HISTOGRAM_OBSERVE_HANDLE_UNLOCK(1);
+  if (exponent < PROM_HISTOGRAM_SPARSE_MIN_EXP) {
+    // Still below the upper bound of the lowest bucket
+    exponent = PROM_HISTOGRAM_SPARSE_MIN_EXP;
+    sub_bucket = 0;
   }
 
-  const char *count_l_value = prom_map_get(self->l_values, "count");
-  if (count_l_value == NULL) {
-    PROM_METRIC_SAMPLE_HISTOGRAM_OBSERVE_HANDLE_UNLOCK(1);
+  _Atomic(_Atomic uint64_t *) *slot = &self->octaves[exponent - PROM_HISTOGRAM_SPARSE_MIN_EXP];
+  _Atomic uint64_t *counts = atomic_load_explicit(slot, memory_order_acquire);
+  if (counts == NULL) {
+    size_t sub_buckets = (size_t)1 << self->schema;
+    _Atomic uint64_t *fresh = (_Atomic uint64_t *)prom_malloc(sizeof(_Atomic uint64_t) * sub_buckets);
+    if (fresh == NULL) return 1;
+    for (size_t i = 0; i < sub_buckets; i++) atomic_init(&fresh[i], 0);
+    if (atomic_compare_exchange_strong_explicit(slot, &counts, fresh, memory_order_acq_rel, memory_order_acquire)) {
+      counts = fresh;
+    } else {
+      prom_free((void *)fresh);
+    }
   }
+  atomic_fetch_add_explicit(&counts[sub_bucket], 1, memory_order_relaxed);
+  return 0;
+}
 
-  prom_metric_sample_t *count_sample = prom_map_get(self->samples, count_l_value);
-  if (count_sample == NULL) {
-    PROM_METRIC_SAMPLE_HISTOGRAM_OBSERVE_HANDLE_UNLOCK(1);
-  }
+double prom_metric_sample_histogram_sparse_bound(int schema, int exponent, size_t sub_bucket) {
+  // 2^exponent built from its bits; exact for the whole sparse range, and avoids pulling in libm for ldexp
+  uint64_t bits = (uint64_t)(exponent + 1023) << 52;
+  double scale;
+  memcpy(&scale, &bits, sizeof(scale));
+  return (1.0 + (double)(sub_bucket + 1) / (double)((size_t)1 << schema)) * scale;
+}
 
-  r = prom_metric_sample_add(count_sample, 1.0);
-  if (r) {
-    PROM_METRIC_SAMPLE_HISTOGRAM_OBSERVE_HANDLE_UNLOCK(1);
-  }
+int prom_metric_sample_histogram_observe(prom_metric_sample_histogram_t *self, double value) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL) return 1;
 
-  // Update the sum sample
-  const char *sum_l_value = prom_map_get(self->l_values, "sum");
-  if (sum_l_value == NULL) {
-    PROM_METRIC_SAMPLE_HISTOGRAM_OBSERVE_HANDLE_UNLOCK(1);
+  // Lock-free and allocation-free: one bucket counter and the sum. The count is the total of the buckets
+  if (self->octaves != NULL) {
+    int r = prom_metric_sample_histogram_observe_sparse(self, value);
+    if (r) return r;
+  } else {
+    size_t index = prom_metric_sample_histogram_bucket_index(self->buckets, value);
+    atomic_fetch_add_explicit(&self->bucket_counts[index], 1, memory_order_relaxed);
   }
 
-  prom_metric_sample_t *sum_sample = prom_map_get(self->samples, sum_l_value);
-  if (sum_sample == NULL) {
-    PROM_METRIC_SAMPLE_HISTOGRAM_OBSERVE_HANDLE_UNLOCK(1);
+  double old = atomic_load_explicit(&self->sum, memory_order_relaxed);
+  while (!atomic_compare_exchange_weak_explicit(&self->sum, &old, old + value, memory_order_relaxed,
+                                                memory_order_relaxed)) {
   }
-
-  r = prom_metric_sample_add(sum_sample, value);
-  PROM_METRIC_SAMPLE_HISTOGRAM_OBSERVE_HANDLE_UNLOCK(r);
-  return r;
+  atomic_fetch_add_explicit(&self->generation, 1, memory_order_release);
+  return 0;
 }
 
-static const char *prom_metric_sample_histogram_l_value_for_bucket(prom_metric_sample_histogram_t *self,
-                                                                   const char *name, size_t label_count,
-                                                                   const char **label_keys, const char **label_values,
-                                                                   double bucket) {
+int prom_metric_sample_histogram_observe_with_exemplar(prom_metric_sample_histogram_t *self, double value,
+                                                       size_t label_count, const char **label_keys,
+                                                       const char **label_values) {
   PROM_ASSERT(self != NULL);
-  int r = 0;
-
-#define PROM_METRIC_SAMPLE_HISTOGRAM_L_VALUE_FOR_BUCKET_CLEANUP() \
-  for (size_t i = 0; i < label_count + 1; i++) {                  \
-    prom_free((char *)new_keys[i]);                               \
-    prom_free((char *)new_values[i]);                             \
-  }                                                               \
-  prom_free(new_keys);                                            \
-  prom_free(new_values);
+  if (self == NULL) return 1;
 
-  // Make new array to hold label_keys with le label key
-  const char **new_keys = (const char **)prom_malloc((label_count + 1) * sizeof(char *));
-  for (size_t i = 0; i < label_count; i++) {
-    new_keys[i] = prom_strdup(label_keys[i]);
-  }
-  new_keys[label_count] = prom_strdup("le");
+  int r = prom_metric_sample_histogram_observe(self, value);
+  if (r) return r;
 
-  // Make new array to hold label_values with le label value
-  const char **new_values = (const char **)prom_malloc((label_count + 1) * sizeof(char *));
-  for (size_t i = 0; i < label_count; i++) {
-    new_values[i] = prom_strdup(label_values[i]);
+  // Sparse buckets are created on demand and have no exemplar slots. The value is observed, the exemplar is not kept
+  if (self->octaves != NULL) return 1;
+
+  // The slots are allocated by the first exemplar and published with a compare-and-swap, like sparse buckets
+  prom_exemplar_t *exemplars = atomic_load_explicit(&self->exemplars, memory_order_acquire);
+  if (exemplars == NULL) {
+    size_t count = prom_histogram_buckets_count(self->buckets) + 1;
+    prom_exemplar_t *fresh = (prom_exemplar_t *)prom_malloc(sizeof(prom_exemplar_t) * count);
+    if (fresh == NULL) return 1;
+    prom_exemplar_init(fresh, count);
+    if (atomic_compare_exchange_strong_explicit(&self->exemplars, &exemplars, fresh, memory_order_acq_rel,
+                                                memory_order_acquire)) {
+      exemplars = fresh;
+    } else {
+      prom_free(fresh);
+    }
   }
+  size_t index = prom_metric_sample_histogram_bucket_index(self->buckets, value);
+  return prom_exemplar_store(&exemplars[index], value, prom_metric_sample_now(), label_count, label_keys,
+                             label_values);
+}
 
-  new_values[label_count] = prom_metric_sample_histogram_bucket_to_str(bucket);
-
-  r = prom_metric_formatter_load_l_value(self->metric_formatter, name, NULL, label_count + 1, new_keys, new_values);
-  if (r) {
-    PROM_METRIC_SAMPLE_HISTOGRAM_L_VALUE_FOR_BUCKET_CLEANUP();
-    return NULL;
-  }
-  const char *ret = (const char *)prom_metric_formatter_dump(self->metric_formatter);
-  PROM_METRIC_SAMPLE_HISTOGRAM_L_VALUE_FOR_BUCKET_CLEANUP();
-  return ret;
+uint64_t prom_metric_sample_histogram_generation(prom_metric_sample_histogram_t *self) {
+  PROM_ASSERT(self != NULL);
+  return atomic_load_explicit(&self->generation, memory_order_acquire);
 }
 
-static const char *prom_metric_sample_histogram_l_value_for_inf(prom_metric_sample_histogram_t *self, const char *name,
-                                                                size_t label_count, const char **label_keys,
-                                                                const char **label_values) {
+int prom_metric_sample_histogram_snapshot(prom_metric_sample_histogram_t *self, double *values) {
   PROM_ASSERT(self != NULL);
-  int r = 0;
+  if (self == NULL) return 1;
 
-#define PROM_METRIC_SAMPLE_HISTOGRAM_L_VALUE_FOR_INF_CLEANUP() \
-  for (size_t i = 0; i < label_count + 1; i++) {               \
-    prom_free((char *)new_keys[i]);                            \
-    prom_free((char *)new_values[i]);                          \
-  }                                                            \
-  prom_free(new_keys);                                         \
-  prom_free(new_values);
+  if (self->octaves != NULL) return 1;
 
-  // Make new array to hold label_keys with le label key
-  const char **new_keys = (const char **)prom_malloc((label_count + 1) * sizeof(char *));
-  for (size_t i = 0; i < label_count; i++) {
-    new_keys[i] = prom_strdup(label_keys[i]);
+  size_t bucket_count = prom_histogram_buckets_count(self->buckets);
+  uint64_t cumulative = 0;
+  for (size_t i = 0; i <= bucket_count; i++) {
+    cumulative += atomic_load_explicit(&self->bucket_counts[i], memory_order_relaxed);
+    values[i] = (double)cumulative;
   }
-  new_keys[label_count] = prom_strdup("le");
+  values[bucket_count + 1] = (double)cumulative;
+  values[bucket_count + 2] = atomic_load_explicit(&self->sum, memory_order_relaxed);
+  return 0;
+}
 
-  // Make new array to hold label_values with le label value
-  const char **new_values = (const char **)prom_malloc((label_count + 1) * sizeof(char *));
+/**
+ * @brief API PRIVATE Renders name_suffix{labels} with an optional trailing le label into a new string
+ */
+static char *prom_metric_sample_histogram_l_value(const char *name, const char *suffix, size_t label_count,
+                                                  const char **label_keys, const char **label_values, const char *le) {
+  size_t count = le == NULL ? label_count : label_count + 1;
+  const char **keys = (const char **)prom_malloc(sizeof(char *) * (count + 1));
+  const char **values = (const char **)prom_malloc(sizeof(char *) * (count + 1));
   for (size_t i = 0; i < label_count; i++) {
-    new_values[i] = prom_strdup(label_values[i]);
+    keys[i] = label_keys[i];
+    values[i] = label_values[i];
   }
-
-  new_values[label_count] = prom_strdup("+Inf");
-
-  r = prom_metric_formatter_load_l_value(self->metric_formatter, name, NULL, label_count + 1, new_keys, new_values);
-  if (r) {
-    PROM_METRIC_SAMPLE_HISTOGRAM_L_VALUE_FOR_INF_CLEANUP()
-    return NULL;
+  if (le != NULL) {
+    keys[label_count] = "le";
+    values[label_count] = le;
   }
-  const char *ret = (const char *)prom_metric_formatter_dump(self->metric_formatter);
-  PROM_METRIC_SAMPLE_HISTOGRAM_L_VALUE_FOR_INF_CLEANUP()
-  return ret;
-}
 
-static void prom_metric_sample_histogram_free_str_generic(void *gen) {
-  char *str = (char *)gen;
-  prom_free((void *)str);
-  str = NULL;
+  size_t len = prom_metric_formatter_render_l_value(NULL, 0, name, suffix, count, keys, values);
+  char *l_value = (char *)prom_malloc(len + 1);
+  if (l_value != NULL) prom_metric_formatter_render_l_value(l_value, len + 1, name, suffix, count, keys, values);
+
+  prom_free(keys);
+  prom_free(values);
+  return l_value;
 }
 
 char *prom_metric_sample_histogram_bucket_to_str(double bucket) {
   char *buf = (char *)prom_malloc(sizeof(char) * 50);
   sprintf(buf, "%g", bucket);
-  if (!strchr(buf, '.')) {
+  if (!strpbrk(buf, ".ein")) {
     strcat(buf, ".0");
   }
   return buf;
 }
+
+/**
+ * @brief API PRIVATE Keeps a copy of the labels, followed by "le", for rendering bucket l_values at scrape time and for
+ * exposition formats that carry labels apart from the name
+ */
+static void prom_metric_sample_histogram_copy_labels(prom_metric_sample_histogram_t *self, size_t label_count,
+                                                     const char **label_keys, const char **label_values) {
+  self->label_count = label_count;
+  self->created = prom_metric_sample_now();
+  self->bucket_label_keys = (const char **)prom_malloc(sizeof(char *) * (label_count + 1));
+  self->bucket_label_values = (const char **)prom_malloc(sizeof(char *) * (label_count + 1));
+  for (size_t i = 0; i < label_count; i++) {
+    self->bucket_label_keys[i] = prom_strdup(label_keys[i]);
+    self->bucket_label_values[i] = prom_strdup(label_values[i]);
+  }
+  self->bucket_label_keys[label_count] = "le";
+  self->bucket_label_values[label_count] = NULL;
+}
@@ -30,6 +30,13 @@ prom_metric_sample_histogram_t *prom_metric_sample_histogram_new(const char *nam
                                                                  size_t label_count, const char **label_keys,
                                                                  const char **label_vales);
 
+/**
+ * @brief API PRIVATE Create a sparse prom_metric_sample_histogram_t. See prom_histogram_new_sparse.
+ */
+prom_metric_sample_histogram_t *prom_metric_sample_histogram_new_sparse(const char *name, int schema,
+                                                                        size_t label_count, const char **label_keys,
+                                                                        const char **label_values);
+
 /**
  * @brief API PRIVATE Destroy a prom_metric_sample_histogram_t
  */
@@ -40,6 +47,28 @@ int prom_metric_sample_histogram_destroy(prom_metric_sample_histogram_t *self);
  */
 int prom_metric_sample_histogram_destroy_generic(void *gen);
 
+/**
+ * @brief API PRIVATE Returns the index of the bucket value falls in; prom_histogram_buckets_count(buckets) for +Inf
+ */
+size_t prom_metric_sample_histogram_bucket_index(prom_histogram_buckets_t *buckets, double value);
+
+/**
+ * @brief API PRIVATE Fills values with the current cumulative bucket counts, +Inf, count and sum, matching l_values.
+ *        values must have room for l_value_count entries. Fixed-bucket histograms only; a sparse one returns non-zero.
+ */
+int prom_metric_sample_histogram_snapshot(prom_metric_sample_histogram_t *self, double *values);
+
+/**
+ * @brief API PRIVATE Returns the number of completed observations. A scrape that sees the same generation twice also
+ *        sees the same buckets and sum.
+ */
+uint64_t prom_metric_sample_histogram_generation(prom_metric_sample_histogram_t *self);
+
+/**
+ * @brief API PRIVATE Upper bound of a sub-bucket of a sparse histogram
+ */
+double prom_metric_sample_histogram_sparse_bound(int schema, int exponent, size_t sub_bucket);
+
 char *prom_metric_sample_histogram_bucket_to_str(double bucket);
 
 void prom_metric_sample_histogram_free_generic(void *gen);
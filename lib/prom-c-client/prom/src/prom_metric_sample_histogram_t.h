@@ -14,26 +14,47 @@
  * limitations under the License.
  */
 
-#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
 
 // Public
 #include "prom_histogram_buckets.h"
 #include "prom_metric_sample_histogram.h"
 
 // Private
-#include "prom_map_t.h"
-#include "prom_metric_formatter_t.h"
+#include "prom_exemplar_t.h"
 
 #ifndef PROM_METRIC_HISTOGRAM_SAMPLE_T_H
 #define PROM_METRIC_HISTOGRAM_SAMPLE_T_H
 
+// Sub-bucket bits of the finest sparse histogram schema
+#define PROM_HISTOGRAM_SPARSE_MAX_SCHEMA 8
+
+// Powers of two covered by a sparse histogram: [2^MIN_EXP, 2^(MAX_EXP + 1)). Smaller positive values are counted in
+// the lowest bucket and larger ones only in +Inf
+#define PROM_HISTOGRAM_SPARSE_MIN_EXP -64
+#define PROM_HISTOGRAM_SPARSE_MAX_EXP 63
+#define PROM_HISTOGRAM_SPARSE_OCTAVES (PROM_HISTOGRAM_SPARSE_MAX_EXP - PROM_HISTOGRAM_SPARSE_MIN_EXP + 1)
+
 struct prom_metric_sample_histogram {
-  prom_linked_list_t *l_value_list;
-  prom_map_t *l_values;
-  prom_map_t *samples;
-  prom_metric_formatter_t *metric_formatter;
-  prom_histogram_buckets_t *buckets;
-  pthread_rwlock_t *rwlock;
+  prom_histogram_buckets_t *buckets;    /**< upper bounds, shared with the metric; NULL for a sparse histogram */
+  _Atomic uint64_t *bucket_counts;      /**< observations per bucket, not cumulative; the last one is +Inf */
+  _Atomic double sum;                   /**< sum of all observed values */
+  _Atomic uint64_t generation;          /**< bumped after every observation has updated its bucket and the sum */
+  char **l_values;                      /**< l_values of the buckets, +Inf, count and sum, in exposition order */
+  size_t l_value_count;                 /**< number of entries in l_values */
+  const char **bucket_label_keys;       /**< label keys followed by "le", for rendering bucket l_values */
+  const char **bucket_label_values;     /**< label values; the last entry is filled in at scrape time */
+  size_t label_count;                   /**< number of user labels */
+  double created;                       /**< creation time in seconds since the epoch */
+  _Atomic(prom_exemplar_t *) exemplars; /**< one per bucket and +Inf, allocated with the first exemplar, or NULL */
+
+  // Sparse histograms only. Each power of two is split into 2^schema equal sub-buckets, allocated on first use
+  int schema;                                 /**< log2 of the sub-buckets per power of two */
+  _Atomic(_Atomic uint64_t *) *octaves;       /**< sub-bucket counters per power of two, NULL until first used */
+  _Atomic uint64_t zero_count;                /**< observations less than or equal to zero */
+  _Atomic uint64_t overflow_count;            /**< observations above the largest bucket, or NaN */
+  const char *name;                           /**< metric name */
 };
 
 #endif  // PROM_METRIC_HISTOGRAM_SAMPLE_T_H
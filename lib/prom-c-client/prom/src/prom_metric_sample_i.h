@@ -29,6 +29,42 @@
  */
 prom_metric_sample_t *prom_metric_sample_new(prom_metric_type_t type, const char *l_value, double r_value);
 
+/**
+ * @brief API PRIVATE Spread the sample over shard_count cache-line padded slots.
+ *
+ * prom_metric_sample_add then updates the slot of the calling CPU instead of the single r_value, and
+ * prom_metric_sample_get sums the slots. Must be called before the sample is shared with other threads. Only
+ * counters may be sharded, since set and sub cannot be applied to a sum of slots.
+ *
+ * @param self The target prom_metric_sample_t*
+ * @param shard_count The number of slots
+ * @return A non-zero integer value upon failure
+ */
+int prom_metric_sample_shard(prom_metric_sample_t *self, size_t shard_count);
+
+/**
+ * @brief API PRIVATE Keeps a copy of the label values, for exposition formats that carry labels apart from the name
+ * @return A non-zero integer value upon failure
+ */
+int prom_metric_sample_set_label_values(prom_metric_sample_t *self, size_t label_count, const char **label_values);
+
+/**
+ * @brief API PRIVATE Returns the current CLOCK_REALTIME in seconds since the epoch, for _created series and exemplar
+ *        timestamps
+ */
+double prom_metric_sample_now(void);
+
+/**
+ * @brief API PRIVATE Returns the current value of the sample, adding up the slots of a sharded sample
+ */
+double prom_metric_sample_get(prom_metric_sample_t *self);
+
+/**
+ * @brief API PRIVATE Returns a number that grows with every update of the sample. A scrape that sees the same
+ *        generation twice also sees the same value.
+ */
+uint64_t prom_metric_sample_generation(prom_metric_sample_t *self);
+
 /**
  * @brief API PRIVATE Destroy the prom_metric_sample**
  */
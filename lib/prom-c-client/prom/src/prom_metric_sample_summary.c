@@ -0,0 +1,433 @@
+/**
+ * Copyright 2019-2020 DigitalOcean Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define _GNU_SOURCE
+#include <float.h>
+#include <math.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+// Public
+#include "prom_alloc.h"
+#include "prom_summary.h"
+
+// Private
+#include "prom_assert.h"
+#include "prom_errors.h"
+#include "prom_log.h"
+#include "prom_metric_formatter_i.h"
+#include "prom_metric_sample_i.h"
+#include "prom_metric_sample_summary_i.h"
+
+// Fallback buffer of the calling thread when sched_getcpu is not available, assigned round robin on first use
+static _Thread_local size_t prom_metric_sample_summary_thread_buffer = SIZE_MAX;
+static atomic_size_t prom_metric_sample_summary_next_thread_buffer = ATOMIC_VAR_INIT(0);
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Static Declarations
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static char *prom_metric_sample_summary_l_value(const char *name, const char *suffix, size_t label_count,
+                                                const char **label_keys, const char **label_values,
+                                                const char *quantile);
+
+static double prom_metric_sample_summary_now(void);
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// End static declarations
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+prom_metric_sample_summary_t *prom_metric_sample_summary_new(const char *name, const prom_summary_opts_t *opts,
+                                                             size_t label_count, const char **label_keys,
+                                                             const char **label_values) {
+  PROM_ASSERT(opts != NULL);
+
+  prom_metric_sample_summary_t *self =
+      (prom_metric_sample_summary_t *)prom_malloc(sizeof(prom_metric_sample_summary_t));
+  if (self == NULL) return NULL;
+  memset(self, 0, sizeof(prom_metric_sample_summary_t));
+  self->opts = opts;
+  pthread_mutex_init(&self->mutex, NULL);
+  atomic_init(&self->count, 0);
+  atomic_init(&self->sum, 0.0);
+
+  self->streams = (prom_summary_stream_t *)prom_malloc(sizeof(prom_summary_stream_t) * opts->age_buckets);
+  memset(self->streams, 0, sizeof(prom_summary_stream_t) * opts->age_buckets);
+  self->head = 0;
+  self->head_expires = prom_metric_sample_summary_now() + opts->max_age / (double)opts->age_buckets;
+
+  long cpus = sysconf(_SC_NPROCESSORS_CONF);
+  self->buffer_count = cpus > 0 ? (size_t)cpus : 1;
+  if (self->buffer_count > PROM_SUMMARY_MAX_BUFFERS) self->buffer_count = PROM_SUMMARY_MAX_BUFFERS;
+  self->buffers = (prom_summary_buffer_t *)prom_malloc(sizeof(prom_summary_buffer_t) * self->buffer_count);
+  for (size_t i = 0; i < self->buffer_count; i++) {
+    pthread_mutex_init(&self->buffers[i].mutex, NULL);
+    self->buffers[i].length = 0;
+  }
+
+  self->label_values = (char **)prom_malloc(sizeof(char *) * (label_count + 1));
+  for (size_t i = 0; i < label_count; i++) self->label_values[i] = prom_strdup(label_values[i]);
+  self->label_count = label_count;
+  self->created = prom_metric_sample_now();
+
+  // Render every l_value up front: the quantiles, sum and count, in exposition order
+  self->l_values = (char **)prom_malloc(sizeof(char *) * (opts->quantile_count + 2));
+  for (size_t i = 0; i < opts->quantile_count; i++) {
+    char quantile[50];
+    snprintf(quantile, sizeof(quantile), "%g", opts->quantiles[i]);
+    self->l_values[self->l_value_count] =
+        prom_metric_sample_summary_l_value(name, NULL, label_count, label_keys, label_values, quantile);
+    if (self->l_values[self->l_value_count++] == NULL) {
+      prom_metric_sample_summary_destroy(self);
+      return NULL;
+    }
+  }
+  const char *suffixes[2] = {"sum", "count"};
+  for (size_t i = 0; i < 2; i++) {
+    self->l_values[self->l_value_count] =
+        prom_metric_sample_summary_l_value(name, suffixes[i], label_count, label_keys, label_values, NULL);
+    if (self->l_values[self->l_value_count++] == NULL) {
+      prom_metric_sample_summary_destroy(self);
+      return NULL;
+    }
+  }
+  return self;
+}
+
+int prom_metric_sample_summary_destroy(prom_metric_sample_summary_t *self) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL) return 0;
+
+  for (size_t i = 0; i < self->l_value_count; i++) prom_free(self->l_values[i]);
+  prom_free(self->l_values);
+  self->l_values = NULL;
+
+  for (size_t i = 0; i < self->label_count; i++) prom_free(self->label_values[i]);
+  prom_free(self->label_values);
+  self->label_values = NULL;
+
+  for (size_t i = 0; i < self->opts->age_buckets; i++) prom_free(self->streams[i].entries);
+  prom_free(self->streams);
+  self->streams = NULL;
+
+  for (size_t i = 0; i < self->buffer_count; i++) pthread_mutex_destroy(&self->buffers[i].mutex);
+  prom_free(self->buffers);
+  self->buffers = NULL;
+
+  pthread_mutex_destroy(&self->mutex);
+  prom_free(self);
+  self = NULL;
+  return 0;
+}
+
+void prom_metric_sample_summary_free_generic(void *gen) {
+  prom_metric_sample_summary_t *self = (prom_metric_sample_summary_t *)gen;
+  prom_metric_sample_summary_destroy(self);
+}
+
+/**
+ * @brief API PRIVATE Seconds on CLOCK_MONOTONIC
+ */
+static double prom_metric_sample_summary_now(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+/**
+ * @brief API PRIVATE floor and ceil for the ranks of a sketch, which are non-negative and far below 2^53. Done by hand
+ *        because libprom does not link libm
+ */
+static double prom_metric_sample_summary_floor(double x) { return x > 0 ? (double)(uint64_t)x : 0.0; }
+
+static double prom_metric_sample_summary_ceil(double x) {
+  double f = prom_metric_sample_summary_floor(x);
+  return f < x ? f + 1.0 : f;
+}
+
+/**
+ * @brief API PRIVATE The CKMS targeted-quantile invariant: how much rank uncertainty an entry at rank r may carry in
+ *        a sketch of n observations while every configured quantile stays within its error
+ */
+static double prom_metric_sample_summary_invariant(const prom_summary_opts_t *opts, double n, double r) {
+  double min = DBL_MAX;
+  for (size_t i = 0; i < opts->quantile_count; i++) {
+    double q = opts->quantiles[i];
+    double e = opts->errors[i];
+    double f = q * n <= r ? (2 * e * r) / q : (2 * e * (n - r)) / (1 - q);
+    if (f < min) min = f;
+  }
+  return min;
+}
+
+/**
+ * @brief API PRIVATE Merges adjacent entries whose combined uncertainty still satisfies the invariant
+ *
+ * Walks from the largest value down, folding each entry into the one after it when allowed. The survivors are
+ * written from the back and moved to the front once at the end.
+ */
+static void prom_metric_sample_summary_compress(prom_summary_stream_t *stream, const prom_summary_opts_t *opts) {
+  if (stream->length < 2) return;
+
+  prom_summary_entry_t *entries = stream->entries;
+  size_t write = stream->length - 1;
+  prom_summary_entry_t x = entries[write];
+  double r = stream->count - 1 - x.width;
+
+  for (size_t i = stream->length - 1; i-- > 0;) {
+    prom_summary_entry_t c = entries[i];
+    if (c.width + x.width + x.delta <= prom_metric_sample_summary_invariant(opts, stream->count, r)) {
+      x.width += c.width;
+    } else {
+      entries[write--] = x;
+      x = c;
+    }
+    r -= c.width;
+  }
+  entries[write] = x;
+
+  stream->length -= write;
+  if (write > 0) memmove(entries, entries + write, sizeof(prom_summary_entry_t) * stream->length);
+}
+
+/**
+ * @brief API PRIVATE Inserts sorted values into a sketch and compresses it
+ *
+ * The sketch and the values are merged in place from the back, so existing entries are moved at most once. A new
+ * entry placed before an existing one starts with the largest uncertainty the invariant allows at its rank; one
+ * placed after every existing entry is exact.
+ */
+static int prom_metric_sample_summary_stream_insert(prom_summary_stream_t *stream, const prom_summary_opts_t *opts,
+                                                    const double *values, size_t count) {
+  size_t length = stream->length + count;
+  if (length > stream->capacity) {
+    size_t capacity = stream->capacity > 0 ? stream->capacity : PROM_SUMMARY_BUFFER_SIZE;
+    while (capacity < length) capacity *= 2;
+    prom_summary_entry_t *entries =
+        (prom_summary_entry_t *)prom_realloc(stream->entries, sizeof(prom_summary_entry_t) * capacity);
+    if (entries == NULL) return 1;
+    stream->entries = entries;
+    stream->capacity = capacity;
+  }
+
+  prom_summary_entry_t *entries = stream->entries;
+  size_t i = stream->length;
+  size_t j = count;
+  size_t k = length;
+  double existing_after = 0;  // width of the existing entries already moved behind the insertion point
+  while (j > 0) {
+    if (i > 0 && entries[i - 1].value > values[j - 1]) {
+      entries[--k] = entries[--i];
+      existing_after += entries[k].width;
+    } else {
+      j--;
+      double delta = 0;
+      if (i < stream->length) {
+        // Rank of the new entry and size of the sketch at the time it would have been inserted in order
+        double n = stream->count + (double)j;
+        double r = stream->count - existing_after + (double)j;
+        delta = prom_metric_sample_summary_floor(prom_metric_sample_summary_invariant(opts, n, r)) - 1;
+        if (delta < 0) delta = 0;
+      }
+      entries[--k] = (prom_summary_entry_t){values[j], 1.0, delta};
+    }
+  }
+
+  stream->length = length;
+  stream->count += (double)count;
+  prom_metric_sample_summary_compress(stream, opts);
+  return 0;
+}
+
+/**
+ * @brief API PRIVATE Answers quantile q from a sketch; NaN if it is empty
+ */
+static double prom_metric_sample_summary_stream_query(prom_summary_stream_t *stream, const prom_summary_opts_t *opts,
+                                                      double q) {
+  if (stream->length == 0) return NAN;
+
+  double t = prom_metric_sample_summary_ceil(q * stream->count);
+  t += prom_metric_sample_summary_ceil(prom_metric_sample_summary_invariant(opts, stream->count, t) / 2);
+  double r = 0;
+  for (size_t i = 1; i < stream->length; i++) {
+    prom_summary_entry_t *p = &stream->entries[i - 1];
+    prom_summary_entry_t *c = &stream->entries[i];
+    r += p->width;
+    if (r + c->width + c->delta > t) return p->value;
+  }
+  return stream->entries[stream->length - 1].value;
+}
+
+/**
+ * @brief API PRIVATE Slides the window: while the head sketch has expired, it is reset and the next one, started one
+ *        age bucket later, takes over. The caller must hold the sample mutex.
+ */
+static void prom_metric_sample_summary_rotate(prom_metric_sample_summary_t *self, double now) {
+  double duration = self->opts->max_age / (double)self->opts->age_buckets;
+  if (now - self->head_expires >= self->opts->max_age) {
+    // Idle for longer than the window: nothing left in it
+    for (size_t i = 0; i < self->opts->age_buckets; i++) {
+      self->streams[i].length = 0;
+      self->streams[i].count = 0;
+    }
+    self->head_expires = now + duration;
+    return;
+  }
+  while (now >= self->head_expires) {
+    self->streams[self->head].length = 0;
+    self->streams[self->head].count = 0;
+    self->head = (self->head + 1) % self->opts->age_buckets;
+    self->head_expires += duration;
+  }
+}
+
+static int prom_metric_sample_summary_compare(const void *a, const void *b) {
+  double x = *(const double *)a;
+  double y = *(const double *)b;
+  return (x > y) - (x < y);
+}
+
+/**
+ * @brief API PRIVATE Sorts a batch of observations and inserts it into every sketch of the window
+ */
+static int prom_metric_sample_summary_merge(prom_metric_sample_summary_t *self, double *values, size_t count) {
+  qsort(values, count, sizeof(double), prom_metric_sample_summary_compare);
+
+  int r = 0;
+  pthread_mutex_lock(&self->mutex);
+  prom_metric_sample_summary_rotate(self, prom_metric_sample_summary_now());
+  for (size_t i = 0; !r && i < self->opts->age_buckets; i++) {
+    r = prom_metric_sample_summary_stream_insert(&self->streams[i], self->opts, values, count);
+  }
+  pthread_mutex_unlock(&self->mutex);
+  return r;
+}
+
+/**
+ * @brief API PRIVATE Returns the buffer the calling thread should append to
+ */
+static prom_summary_buffer_t *prom_metric_sample_summary_buffer(prom_metric_sample_summary_t *self) {
+  int cpu = sched_getcpu();
+  size_t index;
+  if (cpu >= 0) {
+    index = (size_t)cpu;
+  } else {
+    if (prom_metric_sample_summary_thread_buffer == SIZE_MAX) {
+      prom_metric_sample_summary_thread_buffer = atomic_fetch_add(&prom_metric_sample_summary_next_thread_buffer, 1);
+    }
+    index = prom_metric_sample_summary_thread_buffer;
+  }
+  return &self->buffers[index % self->buffer_count];
+}
+
+int prom_metric_sample_summary_observe(prom_metric_sample_summary_t *self, double value) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL) return 1;
+
+  int r = 0;
+
+  // NaN has no rank: it is counted in _count and _sum but kept out of the sketches
+  if (!isnan(value)) {
+    double batch[PROM_SUMMARY_BUFFER_SIZE];
+    int full = 0;
+    prom_summary_buffer_t *buffer = prom_metric_sample_summary_buffer(self);
+    pthread_mutex_lock(&buffer->mutex);
+    buffer->values[buffer->length++] = value;
+    if (buffer->length == PROM_SUMMARY_BUFFER_SIZE) {
+      memcpy(batch, buffer->values, sizeof(batch));
+      buffer->length = 0;
+      full = 1;
+    }
+    pthread_mutex_unlock(&buffer->mutex);
+    if (full) r = prom_metric_sample_summary_merge(self, batch, PROM_SUMMARY_BUFFER_SIZE);
+  }
+
+  atomic_fetch_add_explicit(&self->count, 1, memory_order_relaxed);
+  double old = atomic_load_explicit(&self->sum, memory_order_relaxed);
+  while (!atomic_compare_exchange_weak_explicit(&self->sum, &old, old + value, memory_order_relaxed,
+                                                memory_order_relaxed)) {
+  }
+  return r;
+}
+
+int prom_metric_sample_summary_snapshot(prom_metric_sample_summary_t *self, double *values) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL) return 1;
+
+  int r = 0;
+  double batch[PROM_SUMMARY_BUFFER_SIZE];
+  for (size_t i = 0; !r && i < self->buffer_count; i++) {
+    prom_summary_buffer_t *buffer = &self->buffers[i];
+    pthread_mutex_lock(&buffer->mutex);
+    size_t length = buffer->length;
+    memcpy(batch, buffer->values, sizeof(double) * length);
+    buffer->length = 0;
+    pthread_mutex_unlock(&buffer->mutex);
+    if (length > 0) r = prom_metric_sample_summary_merge(self, batch, length);
+  }
+  if (r) return r;
+
+  const prom_summary_opts_t *opts = self->opts;
+  pthread_mutex_lock(&self->mutex);
+  prom_metric_sample_summary_rotate(self, prom_metric_sample_summary_now());
+  for (size_t i = 0; i < opts->quantile_count; i++) {
+    values[i] = prom_metric_sample_summary_stream_query(&self->streams[self->head], opts, opts->quantiles[i]);
+  }
+  pthread_mutex_unlock(&self->mutex);
+
+  values[opts->quantile_count] = atomic_load_explicit(&self->sum, memory_order_relaxed);
+  values[opts->quantile_count + 1] = (double)atomic_load_explicit(&self->count, memory_order_relaxed);
+  return 0;
+}
+
+/**
+ * @brief API PRIVATE Renders name_suffix{labels} with an optional trailing quantile label into a new string
+ */
+static char *prom_metric_sample_summary_l_value(const char *name, const char *suffix, size_t label_count,
+                                                const char **label_keys, const char **label_values,
+                                                const char *quantile) {
+  size_t count = quantile == NULL ? label_count : label_count + 1;
+  const char **keys = (const char **)prom_malloc(sizeof(char *) * (count + 1));
+  const char **values = (const char **)prom_malloc(sizeof(char *) * (count + 1));
+  for (size_t i = 0; i < label_count; i++) {
+    keys[i] = label_keys[i];
+    values[i] = label_values[i];
+  }
+  if (quantile != NULL) {
+    keys[label_count] = "quantile";
+    values[label_count] = quantile;
+  }
+
+  size_t len = prom_metric_formatter_render_l_value(NULL, 0, name, suffix, count, keys, values);
+  char *l_value = (char *)prom_malloc(len + 1);
+  if (l_value != NULL) prom_metric_formatter_render_l_value(l_value, len + 1, name, suffix, count, keys, values);
+
+  prom_free(keys);
+  prom_free(values);
+  return l_value;
+}
+
+uint64_t prom_metric_sample_summary_generation(prom_metric_sample_summary_t *self) {
+  PROM_ASSERT(self != NULL);
+  return atomic_load_explicit(&self->count, memory_order_acquire);
+}
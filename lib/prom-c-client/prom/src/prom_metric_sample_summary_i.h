@@ -0,0 +1,56 @@
+/**
+ * Copyright 2019-2020 DigitalOcean Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PROM_METRIC_SAMPLE_SUMMARY_I_H
+#define PROM_METRIC_SAMPLE_SUMMARY_I_H
+
+// Public
+#include "prom_metric_sample_summary.h"
+
+// Private
+#include "prom_metric_sample_summary_t.h"
+
+/**
+ * @brief API PRIVATE Create a pointer to a prom_metric_sample_summary_t
+ */
+prom_metric_sample_summary_t *prom_metric_sample_summary_new(const char *name, const prom_summary_opts_t *opts,
+                                                             size_t label_count, const char **label_keys,
+                                                             const char **label_values);
+
+/**
+ * @brief API PRIVATE Destroy a prom_metric_sample_summary_t
+ */
+int prom_metric_sample_summary_destroy(prom_metric_sample_summary_t *self);
+
+/**
+ * @brief API PRIVATE Destroy a void pointer that is cast to a prom_metric_sample_summary_t*, discarding errors
+ */
+void prom_metric_sample_summary_free_generic(void *gen);
+
+/**
+ * @brief API PRIVATE Merges the buffered observations and fills values with the quantiles, sum and count, matching
+ *        l_values. values must have room for l_value_count entries. A quantile with no observation in the window is
+ *        NaN.
+ */
+int prom_metric_sample_summary_snapshot(prom_metric_sample_summary_t *self, double *values);
+
+/**
+ * @brief API PRIVATE Returns the number of observations since creation. Unlike the quantiles, it does not change as
+ *        the window slides.
+ */
+uint64_t prom_metric_sample_summary_generation(prom_metric_sample_summary_t *self);
+
+#endif  // PROM_METRIC_SAMPLE_SUMMARY_I_H
@@ -0,0 +1,80 @@
+/**
+ * Copyright 2019-2020 DigitalOcean Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+
+// Public
+#include "prom_metric_sample_summary.h"
+#include "prom_summary.h"
+
+#ifndef PROM_METRIC_SAMPLE_SUMMARY_T_H
+#define PROM_METRIC_SAMPLE_SUMMARY_T_H
+
+// Observations held by each per-CPU buffer before it is merged into the sketches
+#define PROM_SUMMARY_BUFFER_SIZE 64
+
+// Upper bound on the per-CPU buffers of each sample
+#define PROM_SUMMARY_MAX_BUFFERS 16
+
+/**
+ * @brief API PRIVATE An entry of a CKMS sketch: a value, the number of observations it stands for (g) and the
+ *        uncertainty of its rank (delta)
+ */
+typedef struct prom_summary_entry {
+  double value;
+  double width;
+  double delta;
+} prom_summary_entry_t;
+
+/**
+ * @brief API PRIVATE A CKMS sketch, entries sorted by value
+ */
+typedef struct prom_summary_stream {
+  prom_summary_entry_t *entries; /**< entries sorted by value */
+  size_t length;                 /**< number of entries in use */
+  size_t capacity;               /**< number of entries allocated */
+  double count;                  /**< number of observations merged since the last reset */
+} prom_summary_stream_t;
+
+/**
+ * @brief API PRIVATE Observations not yet merged into the sketches
+ */
+typedef struct prom_summary_buffer {
+  pthread_mutex_t mutex;                    /**< held while appending or draining */
+  size_t length;                            /**< number of buffered values */
+  double values[PROM_SUMMARY_BUFFER_SIZE];  /**< buffered values */
+} prom_summary_buffer_t;
+
+struct prom_metric_sample_summary {
+  const prom_summary_opts_t *opts;  /**< quantiles and window, shared with the metric */
+  pthread_mutex_t mutex;            /**< protects the sketches and the window */
+  prom_summary_stream_t *streams;   /**< one sketch per age bucket */
+  size_t head;                      /**< sketch covering the whole window, answered on scrape */
+  double head_expires;              /**< monotonic time at which the head sketch is reset and the next one answers */
+  prom_summary_buffer_t *buffers;   /**< per-CPU buffers */
+  size_t buffer_count;              /**< number of buffers */
+  _Atomic uint64_t count;           /**< observations since creation */
+  _Atomic double sum;               /**< sum of the observations since creation */
+  char **l_values;                  /**< l_values of the quantiles, sum and count, in exposition order */
+  size_t l_value_count;             /**< number of entries in l_values */
+  char **label_values;              /**< copies of the label values, in label key order */
+  size_t label_count;               /**< number of entries in label_values */
+  double created;                   /**< creation time in seconds since the epoch */
+};
+
+#endif  // PROM_METRIC_SAMPLE_SUMMARY_T_H
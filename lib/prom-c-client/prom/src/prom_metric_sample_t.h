@@ -17,13 +17,43 @@
 #ifndef PROM_METRIC_SAMPLE_T_H
 #define PROM_METRIC_SAMPLE_T_H
 
+#include <stdatomic.h>
+#include <stdint.h>
+
 #include "prom_metric_sample.h"
 #include "prom_metric_t.h"
 
+// Size of the slots of a sharded sample. Each slot owns a full cache line so writers on different CPUs never share one
+#define PROM_METRIC_SAMPLE_SHARD_SIZE 64
+
+/**
+ * @brief API PRIVATE A per-CPU slot of a sharded sample
+ */
+typedef struct prom_metric_sample_shard {
+  _Atomic double value;
+  _Atomic uint64_t generation;
+  char padding[PROM_METRIC_SAMPLE_SHARD_SIZE - sizeof(_Atomic double) - sizeof(_Atomic uint64_t)];
+} prom_metric_sample_shard_t;
+
+/**
+ * @brief API PRIVATE A counter or gauge sample
+ *
+ * r_value and generation share a cache line, so an update of an unsharded sample does two atomic read-modify-writes
+ * on the same line: the compare-and-swap of the value and the generation bump that tells scrapes the cached exposition
+ * is stale. Under contention both of them bounce the line between CPUs; sharded counters move both to the writer's
+ * own slot instead.
+ */
 struct prom_metric_sample {
-  prom_metric_type_t type; /**< type is the metric type for the sample */
-  char *l_value;           /**< l_value is the full metric name and label set represeted as a string */
-  _Atomic double r_value;  /**< r_value is the value of the metric sample */
+  prom_metric_type_t type;            /**< type is the metric type for the sample */
+  char *l_value;                      /**< l_value is the full metric name and label set represeted as a string */
+  _Atomic double r_value;             /**< r_value is the value of the metric sample */
+  _Atomic uint64_t generation;        /**< generation is bumped after every update of r_value */
+  prom_metric_sample_shard_t *shards; /**< shards are the cache-line aligned slots of a sharded sample, or NULL */
+  size_t shard_count;                 /**< shard_count is the number of slots in shards */
+  void *shards_alloc;                 /**< shards_alloc is the allocation shards was aligned within */
+  char **label_values;                /**< label_values are copies of the label values in label key order, or NULL */
+  size_t label_count;                 /**< label_count is the number of entries in label_values */
+  double created;                     /**< created is when the sample was created, in seconds since the epoch */
 };
 
 #endif  // PROM_METRIC_SAMPLE_T_H
@@ -0,0 +1,114 @@
+/**
+ * Copyright 2019-2020 DigitalOcean Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <pthread.h>
+
+// Public
+#include "prom_alloc.h"
+
+// Private
+#include "prom_assert.h"
+#include "prom_errors.h"
+#include "prom_log.h"
+#include "prom_metric_sample_histogram_i.h"
+#include "prom_metric_sample_i.h"
+#include "prom_metric_sample_summary_i.h"
+#include "prom_metric_snapshot_i.h"
+
+prom_metric_snapshot_t *prom_metric_snapshot_new(void) {
+  prom_metric_snapshot_t *self = (prom_metric_snapshot_t *)prom_malloc(sizeof(prom_metric_snapshot_t));
+  if (self == NULL) return NULL;
+  self->entries = NULL;
+  self->count = 0;
+  self->capacity = 0;
+  self->generation = 0;
+  self->ages = 0;
+  return self;
+}
+
+int prom_metric_snapshot_destroy(prom_metric_snapshot_t *self) {
+  if (self == NULL) return 0;
+  prom_free(self->entries);
+  self->entries = NULL;
+  prom_free(self);
+  return 0;
+}
+
+/**
+ * @brief API PRIVATE Grows the entries to hold at least count samples. Called without the metric's lock held.
+ */
+static int prom_metric_snapshot_reserve(prom_metric_snapshot_t *self, size_t count) {
+  if (count <= self->capacity) return 0;
+  size_t capacity = self->capacity > 0 ? self->capacity : 16;
+  while (capacity < count) capacity *= 2;
+  prom_metric_snapshot_entry_t *entries =
+      (prom_metric_snapshot_entry_t *)prom_realloc(self->entries, sizeof(prom_metric_snapshot_entry_t) * capacity);
+  if (entries == NULL) return 1;
+  self->entries = entries;
+  self->capacity = capacity;
+  return 0;
+}
+
+int prom_metric_snapshot_take(prom_metric_snapshot_t *self, prom_metric_t *metric) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL) return 1;
+
+  int r = 0;
+  for (;;) {
+    r = pthread_rwlock_rdlock(metric->rwlock);
+    if (r) {
+      PROM_LOG(PROM_PTHREAD_RWLOCK_LOCK_ERROR);
+      return r;
+    }
+    if (metric->sample_count <= self->capacity) break;
+
+    // Samples were added since the entries were sized: grow them outside the lock and try again
+    size_t count = metric->sample_count;
+    r = pthread_rwlock_unlock(metric->rwlock);
+    if (r) {
+      PROM_LOG(PROM_PTHREAD_RWLOCK_UNLOCK_ERROR);
+      return r;
+    }
+    r = prom_metric_snapshot_reserve(self, count);
+    if (r) return r;
+  }
+
+  // Each generation is read before the value it covers, so the values are never older than the generation says
+  uint64_t generation = metric->sample_count;
+  for (size_t i = 0; i < metric->sample_count; i++) {
+    void *sample = metric->sample_list[i];
+    self->entries[i].sample = sample;
+    switch (metric->type) {
+      case PROM_HISTOGRAM:
+        generation += prom_metric_sample_histogram_generation((prom_metric_sample_histogram_t *)sample);
+        break;
+      case PROM_SUMMARY:
+        generation += prom_metric_sample_summary_generation((prom_metric_sample_summary_t *)sample);
+        break;
+      default:
+        generation += prom_metric_sample_generation((prom_metric_sample_t *)sample);
+        self->entries[i].value = prom_metric_sample_get((prom_metric_sample_t *)sample);
+        break;
+    }
+  }
+  self->count = metric->sample_count;
+  self->generation = generation;
+  self->ages = metric->type == PROM_SUMMARY;
+
+  r = pthread_rwlock_unlock(metric->rwlock);
+  if (r) PROM_LOG(PROM_PTHREAD_RWLOCK_UNLOCK_ERROR);
+  return r;
+}
@@ -0,0 +1,41 @@
+/**
+ * Copyright 2019-2020 DigitalOcean Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PROM_METRIC_SNAPSHOT_I_H
+#define PROM_METRIC_SNAPSHOT_I_H
+
+// Private
+#include "prom_metric_snapshot_t.h"
+#include "prom_metric_t.h"
+
+/**
+ * @brief API PRIVATE prom_metric_snapshot constructor
+ */
+prom_metric_snapshot_t *prom_metric_snapshot_new(void);
+
+/**
+ * @brief API PRIVATE prom_metric_snapshot destructor
+ */
+int prom_metric_snapshot_destroy(prom_metric_snapshot_t *self);
+
+/**
+ * @brief API PRIVATE Copies the samples of metric and their generation, and the values of counters and gauges, holding
+ *        the metric's read lock only for the copy. Histograms and summaries are read when they are formatted.
+ * @return Non-zero upon failure
+ */
+int prom_metric_snapshot_take(prom_metric_snapshot_t *self, prom_metric_t *metric);
+
+#endif  // PROM_METRIC_SNAPSHOT_I_H
@@ -0,0 +1,46 @@
+/**
+ * Copyright 2019-2020 DigitalOcean Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PROM_METRIC_SNAPSHOT_T_H
+#define PROM_METRIC_SNAPSHOT_T_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief API PRIVATE A sample as copied by a snapshot
+ */
+typedef struct prom_metric_snapshot_entry {
+  void *sample; /**< prom_metric_sample_t*, prom_metric_sample_histogram_t* or prom_metric_sample_summary_t* */
+  double value; /**< value of a counter or gauge sample when the snapshot was taken */
+} prom_metric_snapshot_entry_t;
+
+/**
+ * @brief API PRIVATE The samples of a metric, copied under its read lock so they can be formatted without it.
+ *
+ * Samples are never removed from a metric, so the pointers stay valid after the lock is released. The entries are
+ * kept from one snapshot to the next and only grow, so a scrape allocates only when a metric has more samples than
+ * any metric it loaded before.
+ */
+typedef struct prom_metric_snapshot {
+  prom_metric_snapshot_entry_t *entries; /**< samples in exposition order */
+  size_t count;                          /**< number of entries in use */
+  size_t capacity;                       /**< number of entries allocated */
+  uint64_t generation;                   /**< generation of the metric, read before any value */
+  int ages;                              /**< non-zero if the exposition changes even at the same generation */
+} prom_metric_snapshot_t;
+
+#endif  // PROM_METRIC_SNAPSHOT_T_H
@@ -18,10 +18,13 @@
 #define PROM_METRIC_T_H
 
 #include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
 
 // Public
 #include "prom_histogram_buckets.h"
 #include "prom_metric.h"
+#include "prom_summary.h"
 
 // Private
 #include "prom_map_i.h"
@@ -38,20 +41,40 @@ typedef enum prom_metric_type { PROM_COUNTER, PROM_GAUGE, PROM_HISTOGRAM, PROM_S
  */
 extern char *prom_metric_type_map[4];
 
+/**
+ * @brief API PRIVATE A rendered text exposition of a metric. It is never modified once published: a scrape that renders
+ * a newer generation swaps in a new one, and the last reference frees it.
+ */
+typedef struct prom_metric_exposition {
+  atomic_size_t refcount; /**< refcount   References held by the metric and by the scrapes copying it */
+  uint64_t generation;    /**< generation Generation of the samples it was rendered from */
+  size_t len;             /**< len        Length of data */
+  char data[];            /**< data       The exposition, without a terminating null byte */
+} prom_metric_exposition_t;
+
 /**
  * @brief API PRIVATE An opaque struct to users containing metric metadata; one or more metric samples; and a metric
  * formatter for locating metric samples and exporting metric data
  */
 struct prom_metric {
-  prom_metric_type_t type;            /**< metric_type      The type of metric */
-  const char *name;                   /**< name             The name of the metric */
-  const char *help;                   /**< help             The help output for the metric */
-  prom_map_t *samples;                /**< samples          Map comprised of samples for the given metric */
-  prom_histogram_buckets_t *buckets;  /**< buckets          Array of histogram bucket upper bound values */
-  size_t label_key_count;             /**< label_keys_count The count of labe_keys*/
-  prom_metric_formatter_t *formatter; /**< formatter        The metric formatter  */
-  pthread_rwlock_t *rwlock;           /**< rwlock           Required for locking on certain non-atomic operations */
-  const char **label_keys;            /**< labels           Array comprised of const char **/
+  prom_metric_type_t type;              /**< metric_type      The type of metric */
+  const char *name;                     /**< name             The name of the metric */
+  const char *help;                     /**< help             The help output for the metric */
+  prom_map_t *samples;                  /**< samples          Map comprised of samples for the given metric */
+  void **sample_list;                   /**< sample_list      The same samples in insertion order, for scrapes */
+  size_t sample_count;                  /**< sample_count     The count of sample_list */
+  size_t sample_capacity;               /**< sample_capacity  The allocated size of sample_list */
+  prom_histogram_buckets_t *buckets;    /**< buckets          Array of histogram bucket upper bound values */
+  size_t label_key_count;               /**< label_keys_count The count of labe_keys*/
+  pthread_rwlock_t *rwlock;             /**< rwlock           Required for locking on certain non-atomic operations */
+  const char **label_keys;              /**< labels           Array comprised of const char **/
+  prom_metric_sample_t *default_sample; /**< default_sample   Pre-created sample of a counter or gauge without labels */
+  size_t shard_count;                   /**< shard_count      Per-CPU slots of each sample of a sharded counter, or 0 */
+  int sparse_schema;                    /**< sparse_schema    Sub-bucket bits of a sparse histogram, or -1 */
+  prom_summary_opts_t *summary_opts;    /**< summary_opts     Quantiles and window of a summary, or NULL */
+  pthread_mutex_t cache_mutex;          /**< cache_mutex      Protects the exposition pointer, not its contents */
+  char *header;                         /**< header           Rendered HELP and TYPE lines */
+  prom_metric_exposition_t *exposition; /**< exposition       Last cacheable text exposition, or NULL */
 };
 
 #endif  // PROM_METRIC_T_H
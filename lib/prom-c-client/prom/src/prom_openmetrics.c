@@ -0,0 +1,168 @@
+/**
+ * Copyright 2019-2020 DigitalOcean Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdatomic.h>
+#include <string.h>
+
+// Public
+#include "prom_alloc.h"
+
+// Private
+#include "prom_assert.h"
+#include "prom_dtoa_i.h"
+#include "prom_exemplar_i.h"
+#include "prom_metric_formatter_i.h"
+#include "prom_metric_sample_histogram_i.h"
+#include "prom_metric_sample_histogram_t.h"
+#include "prom_metric_sample_i.h"
+#include "prom_metric_sample_summary_t.h"
+#include "prom_metric_sample_t.h"
+#include "prom_metric_snapshot_i.h"
+#include "prom_openmetrics_i.h"
+#include "prom_string_builder_i.h"
+
+#define PROM_OPENMETRICS_TOTAL "_total"
+
+/**
+ * @brief API PRIVATE Appends a space and value
+ */
+static int prom_openmetrics_add_value(prom_string_builder_t *self, double value) {
+  char buffer[PROM_DTOA_BUFFER_SIZE + 1];
+  buffer[0] = ' ';
+  size_t len = prom_dtoa(value, buffer + 1);
+  return prom_string_builder_add_strn(self, buffer, len + 1);
+}
+
+/**
+ * @brief API PRIVATE Loads the name_created line of a sample
+ */
+static int prom_openmetrics_load_created(prom_metric_formatter_t *self, const char *name, size_t label_count,
+                                         const char **label_keys, const char **label_values, double created) {
+  int r = prom_metric_formatter_load_l_value(self, name, "created", label_count, label_keys, label_values);
+  if (r) return r;
+  return prom_metric_formatter_load_r_value(self, created);
+}
+
+/**
+ * @brief API PRIVATE Loads the buckets of a fixed-bucket histogram sample, each followed by its exemplar if it has one,
+ *        then its count and sum
+ */
+static int prom_openmetrics_load_histogram_buckets(prom_metric_formatter_t *self,
+                                                   prom_metric_sample_histogram_t *sample) {
+  int r = 0;
+  double *values = (double *)prom_malloc(sizeof(double) * sample->l_value_count);
+  if (values == NULL) return 1;
+
+  r = prom_metric_sample_histogram_snapshot(sample, values);
+  prom_exemplar_t *exemplars = atomic_load_explicit(&sample->exemplars, memory_order_acquire);
+  size_t bucket_count = prom_histogram_buckets_count(sample->buckets);
+  for (size_t i = 0; !r && i < sample->l_value_count; i++) {
+    r = prom_string_builder_add_str(self->string_builder, sample->l_values[i]);
+    if (!r) r = prom_openmetrics_add_value(self->string_builder, values[i]);
+
+    // bucket # {labels} value timestamp
+    char labels[PROM_EXEMPLAR_LABELS_SIZE + 1];
+    double value = 0.0;
+    double timestamp = 0.0;
+    if (!r && exemplars != NULL && i <= bucket_count &&
+        !prom_exemplar_load(&exemplars[i], labels, &value, &timestamp)) {
+      r = prom_string_builder_add_str(self->string_builder, " # {");
+      if (!r) r = prom_string_builder_add_str(self->string_builder, labels);
+      if (!r) r = prom_string_builder_add_char(self->string_builder, '}');
+      if (!r) r = prom_openmetrics_add_value(self->string_builder, value);
+      if (!r) r = prom_openmetrics_add_value(self->string_builder, timestamp);
+    }
+    if (!r) r = prom_string_builder_add_char(self->string_builder, '\n');
+  }
+  prom_free(values);
+  return r;
+}
+
+/**
+ * @brief API PRIVATE Loads every line of one sample. family is the metric name without the _total of a counter; the
+ *        value of a counter or gauge is the one copied by the snapshot
+ */
+static int prom_openmetrics_load_sample(prom_metric_formatter_t *self, prom_metric_t *metric, const char *family,
+                                        prom_metric_snapshot_entry_t *entry) {
+  int r = 0;
+  void *item = entry->sample;
+
+  switch (metric->type) {
+    case PROM_COUNTER: {
+      prom_metric_sample_t *sample = (prom_metric_sample_t *)item;
+      const char **label_values = (const char **)sample->label_values;
+      r = prom_metric_formatter_load_l_value(self, family, "total", sample->label_count, metric->label_keys,
+                                             label_values);
+      if (!r) r = prom_metric_formatter_load_r_value(self, entry->value);
+      if (!r) {
+        r = prom_openmetrics_load_created(self, family, sample->label_count, metric->label_keys, label_values,
+                                          sample->created);
+      }
+      return r;
+    }
+    case PROM_GAUGE:
+      return prom_metric_formatter_load_value(self, ((prom_metric_sample_t *)item)->l_value, entry->value);
+    case PROM_HISTOGRAM: {
+      prom_metric_sample_histogram_t *sample = (prom_metric_sample_histogram_t *)item;
+      if (sample->octaves != NULL) {
+        r = prom_metric_formatter_load_histogram_sample(self, sample);
+      } else {
+        r = prom_openmetrics_load_histogram_buckets(self, sample);
+      }
+      if (r) return r;
+      return prom_openmetrics_load_created(self, family, sample->label_count, sample->bucket_label_keys,
+                                           sample->bucket_label_values, sample->created);
+    }
+    case PROM_SUMMARY: {
+      prom_metric_sample_summary_t *sample = (prom_metric_sample_summary_t *)item;
+      r = prom_metric_formatter_load_summary_sample(self, sample);
+      if (r) return r;
+      return prom_openmetrics_load_created(self, family, sample->label_count, metric->label_keys,
+                                           (const char **)sample->label_values, sample->created);
+    }
+  }
+  return 1;
+}
+
+int prom_openmetrics_load_metric(prom_metric_formatter_t *self, prom_metric_t *metric) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL) return 1;
+
+  // The family of a counter is named without _total, which only its samples carry
+  char *family = prom_strdup(metric->name);
+  if (family == NULL) return 1;
+  size_t name_len = strlen(family);
+  size_t total_len = strlen(PROM_OPENMETRICS_TOTAL);
+  if (metric->type == PROM_COUNTER && name_len > total_len &&
+      strcmp(family + name_len - total_len, PROM_OPENMETRICS_TOTAL) == 0) {
+    family[name_len - total_len] = '\0';
+  }
+
+  int r = prom_metric_formatter_load_help(self, family, metric->help);
+  if (!r) r = prom_metric_formatter_load_type(self, family, metric->type);
+  if (r) {
+    prom_free(family);
+    return r;
+  }
+
+  // Samples added while the family is written are left for the next scrape
+  r = prom_metric_snapshot_take(self->snapshot, metric);
+  for (size_t i = 0; !r && i < self->snapshot->count; i++) {
+    r = prom_openmetrics_load_sample(self, metric, family, &self->snapshot->entries[i]);
+  }
+  prom_free(family);
+  return r;
+}
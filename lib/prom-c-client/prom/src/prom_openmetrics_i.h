@@ -0,0 +1,36 @@
+/**
+ * Copyright 2019-2020 DigitalOcean Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Reference: https://github.com/OpenObservability/OpenMetrics/blob/main/specification/OpenMetrics.md
+
+#ifndef PROM_OPENMETRICS_I_H
+#define PROM_OPENMETRICS_I_H
+
+// Private
+#include "prom_metric_formatter_t.h"
+#include "prom_metric_t.h"
+
+// Ends an OpenMetrics exposition, after the last metric family
+#define PROM_OPENMETRICS_EOF "# EOF\n"
+
+/**
+ * @brief API PRIVATE Loads metric in the OpenMetrics 1.0 text format: counters named with _total, a _created series
+ *        for counters, histograms and summaries, and the exemplars of histogram buckets. Unlike the Prometheus text
+ *        format no blank line follows the family.
+ */
+int prom_openmetrics_load_metric(prom_metric_formatter_t *formatter, prom_metric_t *metric);
+
+#endif  // PROM_OPENMETRICS_I_H
@@ -0,0 +1,319 @@
+/**
+ * Copyright 2019-2020 DigitalOcean Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+// Public
+#include "prom_alloc.h"
+
+// Private
+#include "prom_assert.h"
+#include "prom_metric_sample_histogram_i.h"
+#include "prom_metric_sample_histogram_t.h"
+#include "prom_metric_sample_i.h"
+#include "prom_metric_sample_summary_i.h"
+#include "prom_metric_sample_summary_t.h"
+#include "prom_metric_sample_t.h"
+#include "prom_metric_snapshot_i.h"
+#include "prom_protobuf_i.h"
+#include "prom_string_builder_i.h"
+
+// Wire types
+#define PROM_PROTOBUF_VARINT 0
+#define PROM_PROTOBUF_FIXED64 1
+#define PROM_PROTOBUF_LEN 2
+
+// A varint takes at most 10 bytes; a tag followed by a length at most 15
+#define PROM_PROTOBUF_VARINT_SIZE 10
+#define PROM_PROTOBUF_HEADER_SIZE 15
+
+// MetricType values
+#define PROM_PROTOBUF_COUNTER 0
+#define PROM_PROTOBUF_GAUGE 1
+#define PROM_PROTOBUF_SUMMARY 2
+#define PROM_PROTOBUF_HISTOGRAM 4
+
+// Field numbers
+#define PROM_PROTOBUF_FAMILY_NAME 1
+#define PROM_PROTOBUF_FAMILY_HELP 2
+#define PROM_PROTOBUF_FAMILY_TYPE 3
+#define PROM_PROTOBUF_FAMILY_METRIC 4
+#define PROM_PROTOBUF_METRIC_LABEL 1
+#define PROM_PROTOBUF_METRIC_GAUGE 2
+#define PROM_PROTOBUF_METRIC_COUNTER 3
+#define PROM_PROTOBUF_METRIC_SUMMARY 4
+#define PROM_PROTOBUF_METRIC_HISTOGRAM 7
+#define PROM_PROTOBUF_LABEL_NAME 1
+#define PROM_PROTOBUF_LABEL_VALUE 2
+#define PROM_PROTOBUF_VALUE 1
+#define PROM_PROTOBUF_SAMPLE_COUNT 1
+#define PROM_PROTOBUF_SAMPLE_SUM 2
+#define PROM_PROTOBUF_SUMMARY_QUANTILE 3
+#define PROM_PROTOBUF_QUANTILE_QUANTILE 1
+#define PROM_PROTOBUF_QUANTILE_VALUE 2
+#define PROM_PROTOBUF_HISTOGRAM_BUCKET 3
+#define PROM_PROTOBUF_BUCKET_CUMULATIVE_COUNT 1
+#define PROM_PROTOBUF_BUCKET_UPPER_BOUND 2
+
+static size_t prom_protobuf_render_varint(char *buffer, uint64_t value) {
+  size_t len = 0;
+  while (value >= 0x80) {
+    buffer[len++] = (char)(value | 0x80);
+    value >>= 7;
+  }
+  buffer[len++] = (char)value;
+  return len;
+}
+
+static size_t prom_protobuf_varint_size(uint64_t value) {
+  size_t len = 1;
+  while (value >= 0x80) {
+    value >>= 7;
+    len++;
+  }
+  return len;
+}
+
+static size_t prom_protobuf_render_tag(char *buffer, unsigned field, unsigned wire_type) {
+  return prom_protobuf_render_varint(buffer, (uint64_t)field << 3 | wire_type);
+}
+
+static size_t prom_protobuf_render_uint64(char *buffer, unsigned field, uint64_t value) {
+  size_t len = prom_protobuf_render_tag(buffer, field, PROM_PROTOBUF_VARINT);
+  return len + prom_protobuf_render_varint(buffer + len, value);
+}
+
+static size_t prom_protobuf_render_double(char *buffer, unsigned field, double value) {
+  size_t len = prom_protobuf_render_tag(buffer, field, PROM_PROTOBUF_FIXED64);
+
+  // Little-endian whatever the host byte order
+  uint64_t bits = 0;
+  memcpy(&bits, &value, sizeof(bits));
+  for (size_t i = 0; i < sizeof(bits); i++) buffer[len++] = (char)(bits >> (8 * i));
+  return len;
+}
+
+static int prom_protobuf_add_uint64(prom_string_builder_t *self, unsigned field, uint64_t value) {
+  char buffer[PROM_PROTOBUF_HEADER_SIZE];
+  return prom_string_builder_add_strn(self, buffer, prom_protobuf_render_uint64(buffer, field, value));
+}
+
+static int prom_protobuf_add_double(prom_string_builder_t *self, unsigned field, double value) {
+  char buffer[PROM_PROTOBUF_HEADER_SIZE];
+  return prom_string_builder_add_strn(self, buffer, prom_protobuf_render_double(buffer, field, value));
+}
+
+static int prom_protobuf_add_string(prom_string_builder_t *self, unsigned field, const char *value) {
+  char buffer[PROM_PROTOBUF_HEADER_SIZE];
+  size_t value_len = strlen(value);
+  size_t len = prom_protobuf_render_tag(buffer, field, PROM_PROTOBUF_LEN);
+  len += prom_protobuf_render_varint(buffer + len, value_len);
+  int r = prom_string_builder_add_strn(self, buffer, len);
+  if (r) return r;
+  return prom_string_builder_add_strn(self, value, value_len);
+}
+
+/**
+ * @brief API PRIVATE Adds an embedded message whose content was rendered in body, with its tag and length
+ */
+static int prom_protobuf_add_message(prom_string_builder_t *self, unsigned field, const char *body, size_t body_len) {
+  char buffer[2 * PROM_PROTOBUF_HEADER_SIZE + PROM_PROTOBUF_VARINT_SIZE];
+  PROM_ASSERT(body_len <= sizeof(buffer) - PROM_PROTOBUF_HEADER_SIZE);
+  size_t len = prom_protobuf_render_tag(buffer, field, PROM_PROTOBUF_LEN);
+  len += prom_protobuf_render_varint(buffer + len, body_len);
+  memcpy(buffer + len, body, body_len);
+  return prom_string_builder_add_strn(self, buffer, len + body_len);
+}
+
+/**
+ * @brief API PRIVATE Turns the bytes written since start into an embedded message: its tag and length are inserted in
+ *        front of them. A field of 0 inserts the length alone, as in front of each delimited MetricFamily.
+ *
+ * Writing the message first and moving it by the few bytes of its header avoids computing the size of messages that
+ * hold values ahead of time, which would mean reading each atomic value twice and could disagree with what is then
+ * written. Small messages of known size are rendered whole instead.
+ */
+static int prom_protobuf_end_message(prom_string_builder_t *self, size_t start, unsigned field) {
+  char header[PROM_PROTOBUF_HEADER_SIZE];
+  size_t len = 0;
+  if (field != 0) len = prom_protobuf_render_varint(header, (uint64_t)field << 3 | PROM_PROTOBUF_LEN);
+  len += prom_protobuf_render_varint(header + len, prom_string_builder_len(self) - start);
+  return prom_string_builder_insert(self, start, header, len);
+}
+
+static int prom_protobuf_add_labels(prom_string_builder_t *self, size_t label_count, const char **label_keys,
+                                    char *const *label_values) {
+  int r = 0;
+  for (size_t i = 0; !r && i < label_count; i++) {
+    // Both fields have one-byte tags
+    size_t name_len = strlen(label_keys[i]);
+    size_t value_len = strlen(label_values[i]);
+    size_t body_len =
+        2 + prom_protobuf_varint_size(name_len) + name_len + prom_protobuf_varint_size(value_len) + value_len;
+
+    char header[PROM_PROTOBUF_HEADER_SIZE];
+    size_t len = prom_protobuf_render_tag(header, PROM_PROTOBUF_METRIC_LABEL, PROM_PROTOBUF_LEN);
+    len += prom_protobuf_render_varint(header + len, body_len);
+    r = prom_string_builder_add_strn(self, header, len);
+    if (!r) r = prom_protobuf_add_string(self, PROM_PROTOBUF_LABEL_NAME, label_keys[i]);
+    if (!r) r = prom_protobuf_add_string(self, PROM_PROTOBUF_LABEL_VALUE, label_values[i]);
+  }
+  return r;
+}
+
+static int prom_protobuf_add_bucket(prom_string_builder_t *self, uint64_t cumulative_count, double upper_bound) {
+  char body[2 * PROM_PROTOBUF_HEADER_SIZE];
+  size_t len = prom_protobuf_render_uint64(body, PROM_PROTOBUF_BUCKET_CUMULATIVE_COUNT, cumulative_count);
+  len += prom_protobuf_render_double(body + len, PROM_PROTOBUF_BUCKET_UPPER_BOUND, upper_bound);
+  return prom_protobuf_add_message(self, PROM_PROTOBUF_HISTOGRAM_BUCKET, body, len);
+}
+
+/**
+ * @brief API PRIVATE Adds the fields of a Histogram message. The +Inf bucket is left out, as sample_count holds it.
+ */
+static int prom_protobuf_add_histogram(prom_string_builder_t *self, prom_metric_sample_histogram_t *sample) {
+  int r = 0;
+  uint64_t count = 0;
+  double sum = 0.0;
+
+  if (sample->octaves != NULL) {
+    // Same reading order as the text format, so that cumulative counts never decrease
+    uint64_t cumulative = atomic_load_explicit(&sample->zero_count, memory_order_relaxed);
+    r = prom_protobuf_add_bucket(self, cumulative, 0.0);
+    size_t sub_buckets = (size_t)1 << sample->schema;
+    for (size_t i = 0; !r && i < PROM_HISTOGRAM_SPARSE_OCTAVES; i++) {
+      _Atomic uint64_t *counts = atomic_load_explicit(&sample->octaves[i], memory_order_acquire);
+      for (size_t j = 0; !r && counts != NULL && j < sub_buckets; j++) {
+        cumulative += atomic_load_explicit(&counts[j], memory_order_relaxed);
+        int exponent = (int)i + PROM_HISTOGRAM_SPARSE_MIN_EXP;
+        r = prom_protobuf_add_bucket(self, cumulative,
+                                     prom_metric_sample_histogram_sparse_bound(sample->schema, exponent, j));
+      }
+    }
+    count = cumulative + atomic_load_explicit(&sample->overflow_count, memory_order_relaxed);
+    sum = atomic_load_explicit(&sample->sum, memory_order_relaxed);
+  } else {
+    double *values = (double *)prom_malloc(sizeof(double) * sample->l_value_count);
+    if (values == NULL) return 1;
+    r = prom_metric_sample_histogram_snapshot(sample, values);
+    size_t bucket_count = prom_histogram_buckets_count(sample->buckets);
+    for (size_t i = 0; !r && i < bucket_count; i++) {
+      r = prom_protobuf_add_bucket(self, (uint64_t)values[i], sample->buckets->upper_bounds[i]);
+    }
+    count = (uint64_t)values[bucket_count + 1];
+    sum = values[bucket_count + 2];
+    prom_free(values);
+  }
+  if (r) return r;
+
+  r = prom_protobuf_add_uint64(self, PROM_PROTOBUF_SAMPLE_COUNT, count);
+  if (r) return r;
+  return prom_protobuf_add_double(self, PROM_PROTOBUF_SAMPLE_SUM, sum);
+}
+
+/**
+ * @brief API PRIVATE Adds the fields of a Summary message
+ */
+static int prom_protobuf_add_summary(prom_string_builder_t *self, prom_metric_sample_summary_t *sample) {
+  double *values = (double *)prom_malloc(sizeof(double) * sample->l_value_count);
+  if (values == NULL) return 1;
+
+  // values holds the quantiles, then the sum and the count
+  size_t quantile_count = sample->opts->quantile_count;
+  int r = prom_metric_sample_summary_snapshot(sample, values);
+  if (!r) r = prom_protobuf_add_uint64(self, PROM_PROTOBUF_SAMPLE_COUNT, (uint64_t)values[quantile_count + 1]);
+  if (!r) r = prom_protobuf_add_double(self, PROM_PROTOBUF_SAMPLE_SUM, values[quantile_count]);
+  for (size_t i = 0; !r && i < quantile_count; i++) {
+    char body[2 * PROM_PROTOBUF_HEADER_SIZE];
+    size_t len = prom_protobuf_render_double(body, PROM_PROTOBUF_QUANTILE_QUANTILE, sample->opts->quantiles[i]);
+    len += prom_protobuf_render_double(body + len, PROM_PROTOBUF_QUANTILE_VALUE, values[i]);
+    r = prom_protobuf_add_message(self, PROM_PROTOBUF_SUMMARY_QUANTILE, body, len);
+  }
+  prom_free(values);
+  return r;
+}
+
+/**
+ * @brief API PRIVATE Adds one Metric message: the labels of the sample and its typed value, which for a counter or
+ *        gauge is the one copied by the snapshot
+ */
+static int prom_protobuf_add_sample(prom_string_builder_t *self, prom_metric_t *metric,
+                                    prom_metric_snapshot_entry_t *entry) {
+  void *item = entry->sample;
+  int r = 0;
+  size_t metric_start = prom_string_builder_len(self);
+  size_t value_start = 0;
+  unsigned value_field = 0;
+
+  switch (metric->type) {
+    case PROM_HISTOGRAM: {
+      prom_metric_sample_histogram_t *sample = (prom_metric_sample_histogram_t *)item;
+      r = prom_protobuf_add_labels(self, sample->label_count, sample->bucket_label_keys,
+                                   (char *const *)sample->bucket_label_values);
+      value_start = prom_string_builder_len(self);
+      if (!r) r = prom_protobuf_add_histogram(self, sample);
+      value_field = PROM_PROTOBUF_METRIC_HISTOGRAM;
+      break;
+    }
+    case PROM_SUMMARY: {
+      prom_metric_sample_summary_t *sample = (prom_metric_sample_summary_t *)item;
+      r = prom_protobuf_add_labels(self, sample->label_count, metric->label_keys, sample->label_values);
+      value_start = prom_string_builder_len(self);
+      if (!r) r = prom_protobuf_add_summary(self, sample);
+      value_field = PROM_PROTOBUF_METRIC_SUMMARY;
+      break;
+    }
+    default: {
+      prom_metric_sample_t *sample = (prom_metric_sample_t *)item;
+      r = prom_protobuf_add_labels(self, sample->label_count, metric->label_keys, sample->label_values);
+      char body[PROM_PROTOBUF_HEADER_SIZE];
+      size_t len = prom_protobuf_render_double(body, PROM_PROTOBUF_VALUE, entry->value);
+      unsigned field = metric->type == PROM_COUNTER ? PROM_PROTOBUF_METRIC_COUNTER : PROM_PROTOBUF_METRIC_GAUGE;
+      if (!r) r = prom_protobuf_add_message(self, field, body, len);
+      break;
+    }
+  }
+  // Counter and gauge values are written whole, histograms and summaries still need their header
+  if (!r && value_field) r = prom_protobuf_end_message(self, value_start, value_field);
+  if (!r) r = prom_protobuf_end_message(self, metric_start, PROM_PROTOBUF_FAMILY_METRIC);
+  return r;
+}
+
+int prom_protobuf_load_metric(prom_metric_formatter_t *formatter, prom_metric_t *metric) {
+  PROM_ASSERT(formatter != NULL);
+  if (formatter == NULL) return 1;
+  prom_string_builder_t *self = formatter->string_builder;
+
+  static const unsigned types[] = {[PROM_COUNTER] = PROM_PROTOBUF_COUNTER,
+                                   [PROM_GAUGE] = PROM_PROTOBUF_GAUGE,
+                                   [PROM_HISTOGRAM] = PROM_PROTOBUF_HISTOGRAM,
+                                   [PROM_SUMMARY] = PROM_PROTOBUF_SUMMARY};
+  size_t start = prom_string_builder_len(self);
+  int r = prom_protobuf_add_string(self, PROM_PROTOBUF_FAMILY_NAME, metric->name);
+  if (!r) r = prom_protobuf_add_string(self, PROM_PROTOBUF_FAMILY_HELP, metric->help);
+  if (!r) r = prom_protobuf_add_uint64(self, PROM_PROTOBUF_FAMILY_TYPE, types[metric->type]);
+  if (r) return r;
+
+  // Samples added while the family is written are left for the next scrape
+  r = prom_metric_snapshot_take(formatter->snapshot, metric);
+  for (size_t i = 0; !r && i < formatter->snapshot->count; i++) {
+    r = prom_protobuf_add_sample(self, metric, &formatter->snapshot->entries[i]);
+  }
+  if (r) return r;
+
+  return prom_protobuf_end_message(self, start, 0);
+}
@@ -0,0 +1,33 @@
+/**
+ * Copyright 2019-2020 DigitalOcean Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Reference: https://github.com/prometheus/client_model/blob/master/io/prometheus/client/metrics.proto
+
+#ifndef PROM_PROTOBUF_I_H
+#define PROM_PROTOBUF_I_H
+
+// Private
+#include "prom_metric_formatter_t.h"
+#include "prom_metric_t.h"
+
+/**
+ * @brief API PRIVATE Appends metric to the string builder of formatter as an io.prometheus.client.MetricFamily message
+ *        preceded by its varint length, as in the delimited protobuf exposition format. The samples are copied into
+ *        formatter->snapshot under the metric's read lock and encoded after it is released.
+ */
+int prom_protobuf_load_metric(prom_metric_formatter_t *formatter, prom_metric_t *metric);
+
+#endif  // PROM_PROTOBUF_I_H
@@ -87,13 +87,19 @@ static int prom_string_builder_ensure_space(prom_string_builder_t *self, size_t
 }
 
 int prom_string_builder_add_str(prom_string_builder_t *self, const char *str) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL) return 1;
+  if (str == NULL || *str == '\0') return 0;
+  return prom_string_builder_add_strn(self, str, strlen(str));
+}
+
+int prom_string_builder_add_strn(prom_string_builder_t *self, const char *str, size_t len) {
   PROM_ASSERT(self != NULL);
   int r = 0;
 
   if (self == NULL) return 1;
-  if (str == NULL || *str == '\0') return 0;
+  if (str == NULL || len == 0) return 0;
 
-  size_t len = strlen(str);
   r = prom_string_builder_ensure_space(self, len);
   if (r) return r;
 
@@ -103,6 +109,23 @@ int prom_string_builder_add_str(prom_string_builder_t *self, const char *str) {
   return 0;
 }
 
+int prom_string_builder_insert(prom_string_builder_t *self, size_t pos, const char *str, size_t len) {
+  PROM_ASSERT(self != NULL);
+  int r = 0;
+
+  if (self == NULL || pos > self->len) return 1;
+  if (str == NULL || len == 0) return 0;
+
+  r = prom_string_builder_ensure_space(self, len);
+  if (r) return r;
+
+  // The terminating null byte moves too
+  memmove(self->str + pos + len, self->str + pos, self->len - pos + 1);
+  memcpy(self->str + pos, str, len);
+  self->len += len;
+  return 0;
+}
+
 int prom_string_builder_add_char(prom_string_builder_t *self, char c) {
   PROM_ASSERT(self != NULL);
   int r = 0;
@@ -129,9 +152,10 @@ int prom_string_builder_truncate(prom_string_builder_t *self, size_t len) {
 
 int prom_string_builder_clear(prom_string_builder_t *self) {
   PROM_ASSERT(self != NULL);
-  prom_free(self->str);
-  self->str = NULL;
-  return prom_string_builder_init(self);
+  if (self == NULL) return 1;
+  self->len = 0;
+  self->str[0] = '\0';
+  return 0;
 }
 
 size_t prom_string_builder_len(prom_string_builder_t *self) {
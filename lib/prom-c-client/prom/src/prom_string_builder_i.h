@@ -39,6 +39,18 @@ int prom_string_builder_destroy(prom_string_builder_t *self);
  */
 int prom_string_builder_add_str(prom_string_builder_t *self, const char *str);
 
+/**
+ * API PRIVATE
+ * @brief Adds the first len bytes of str
+ */
+int prom_string_builder_add_strn(prom_string_builder_t *self, const char *str, size_t len);
+
+/**
+ * API PRIVATE
+ * @brief Inserts the first len bytes of str at position pos, moving the rest of the string after them
+ */
+int prom_string_builder_insert(prom_string_builder_t *self, size_t pos, const char *str, size_t len);
+
 /**
  * API PRIVATE
  * @brief Adds a char
@@ -47,7 +59,7 @@ int prom_string_builder_add_char(prom_string_builder_t *self, char c);
 
 /**
  * API PRIVATE
- * @brief Clear the string
+ * @brief Clear the string. The allocation is kept, so rebuilding a string of similar size does not grow it again
  */
 int prom_string_builder_clear(prom_string_builder_t *self);
 
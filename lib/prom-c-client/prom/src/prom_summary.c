@@ -0,0 +1,93 @@
+/**
+ * Copyright 2019-2020 DigitalOcean Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Public
+#include "prom_summary.h"
+
+#include "prom_alloc.h"
+
+// Private
+#include "prom_assert.h"
+#include "prom_errors.h"
+#include "prom_log.h"
+#include "prom_metric_i.h"
+#include "prom_metric_sample_summary_i.h"
+#include "prom_metric_t.h"
+
+// Defaults for a summary constructed without opts
+static const double prom_summary_default_quantiles[4] = {0.5, 0.9, 0.99, 0.999};
+static const double prom_summary_default_errors[4] = {0.05, 0.01, 0.001, 0.0001};
+static const prom_summary_opts_t prom_summary_default_opts = {4, prom_summary_default_quantiles,
+                                                              prom_summary_default_errors, 600.0, 5};
+
+prom_summary_t *prom_summary_new(const char *name, const char *help, const prom_summary_opts_t *opts,
+                                 size_t label_key_count, const char **label_keys) {
+  if (opts == NULL) opts = &prom_summary_default_opts;
+
+  if (opts->max_age <= 0 || opts->age_buckets == 0) {
+    PROM_LOG("summary needs a positive max_age and at least one age bucket");
+    return NULL;
+  }
+  // Quantiles 0 and 1 divide by zero in the sketch invariant, and a zero error would keep every observation
+  for (size_t i = 0; i < opts->quantile_count; i++) {
+    if (!(opts->quantiles[i] > 0 && opts->quantiles[i] < 1) || !(opts->errors[i] > 0 && opts->errors[i] < 1)) {
+      PROM_LOG("summary quantiles and errors must be between 0 and 1, exclusive");
+      return NULL;
+    }
+  }
+
+  prom_summary_t *self = (prom_summary_t *)prom_metric_new(PROM_SUMMARY, name, help, label_key_count, label_keys);
+  if (self == NULL) return NULL;
+  if (prom_metric_set_summary_opts(self, opts)) {
+    prom_metric_destroy(self);
+    return NULL;
+  }
+  return self;
+}
+
+int prom_summary_destroy(prom_summary_t *self) {
+  PROM_ASSERT(self != NULL);
+
+  int r = 0;
+
+  if (self == NULL) return r;
+  r = prom_metric_destroy(self);
+  if (r) return r;
+  self = NULL;
+  return r;
+}
+
+prom_summary_handle_t *prom_summary_handle(prom_summary_t *self, const char **label_values) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL) return NULL;
+  if (self->type != PROM_SUMMARY) {
+    PROM_LOG(PROM_METRIC_INCORRECT_TYPE);
+    return NULL;
+  }
+  return prom_metric_sample_summary_from_labels(self, label_values);
+}
+
+int prom_summary_handle_observe(prom_summary_handle_t *handle, double value) {
+  PROM_ASSERT(handle != NULL);
+  if (handle == NULL) return 1;
+  return prom_metric_sample_summary_observe(handle, value);
+}
+
+int prom_summary_observe(prom_summary_t *self, double value, const char **label_values) {
+  prom_summary_handle_t *handle = prom_summary_handle(self, label_values);
+  if (handle == NULL) return 1;
+  return prom_summary_handle_observe(handle, value);
+}
@@ -0,0 +1,207 @@
+/**
+ * Copyright 2019-2020 DigitalOcean Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Round-trip test for prom_dtoa. Every output must parse back to the same bits, have as few significant digits as the
+// shortest "%.*e" that parses back, and be laid out byte for byte as the fixed/exponent rules below say.
+
+#include <float.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Private
+#include "prom_dtoa_i.h"
+
+#define PROM_DTOA_TEST_RANDOM_COUNT 100000
+
+static int failures = 0;
+
+/**
+ * @brief Expected output for values whose exposition spelling is fixed
+ */
+static const struct {
+  double value;
+  const char *expected;
+} prom_dtoa_test_cases[] = {
+    {0.0, "0"},
+    {-0.0, "-0"},
+    {1.0, "1"},
+    {-1.0, "-1"},
+    {42.0, "42"},
+    {9007199254740991.0, "9007199254740991"},
+    {9007199254740992.0, "9007199254740992"},
+    {12.55, "12.55"},
+    {12.3, "12.3"},
+    {0.1, "0.1"},
+    {0.3, "0.3"},
+    {0.1 + 0.2, "0.30000000000000004"},
+    {-2.5, "-2.5"},
+    {0.001, "0.001"},
+    {0.0001, "0.0001"},
+    {0.000689496, "0.000689496"},
+    {5190293939.797647, "5190293939.797647"},
+    {1.5e-07, "1.5e-07"},
+    {1e20, "100000000000000000000"},
+    {1e21, "1e+21"},
+    {2e21, "2e+21"},
+    {1.2345e30, "1.2345e+30"},
+    {DBL_MAX, "1.7976931348623157e+308"},
+    {DBL_MIN, "2.2250738585072014e-308"},
+    {-DBL_MIN, "-2.2250738585072014e-308"},
+    {5e-324, "5e-324"},
+    {NAN, "NaN"},
+    {INFINITY, "+Inf"},
+    {-INFINITY, "-Inf"},
+};
+
+/**
+ * @brief Fewest significant digits that parse back to value, found with "%.*e"
+ */
+static int prom_dtoa_test_shortest_length(double value) {
+  char text[64];
+  for (int precision = 0; precision < 17; precision++) {
+    snprintf(text, sizeof(text), "%.*e", precision, value);
+    if (strtod(text, NULL) == value) return precision + 1;
+  }
+  return 17;
+}
+
+/**
+ * @brief Splits a formatted finite value into its significant digits and the decimal exponent of the first one
+ */
+static void prom_dtoa_test_split(const char *text, char *digits, int *length, int *exponent) {
+  const char *p = text;
+  if (*p == '-') p++;
+
+  int count = 0;
+  int point = -1;
+  for (; *p != '\0' && *p != 'e'; p++) {
+    if (*p == '.') {
+      point = count;
+    } else {
+      digits[count++] = *p;
+    }
+  }
+  if (point < 0) point = count;
+  int e = *p == 'e' ? atoi(p + 1) : 0;
+
+  int skip = 0;
+  while (skip < count - 1 && digits[skip] == '0') skip++;
+  memmove(digits, digits + skip, (size_t)(count - skip));
+  count -= skip;
+  point -= skip;
+  while (count > 1 && digits[count - 1] == '0') count--;
+  digits[count] = '\0';
+
+  *length = count;
+  *exponent = point - 1 + e;
+}
+
+/**
+ * @brief Lays out digits * 10^(exponent - length + 1): fixed notation when the value is below 10^21 and not below
+ * 10^-4, exponent notation with at least two exponent digits otherwise
+ */
+static void prom_dtoa_test_layout(int negative, const char *digits, int length, int exponent, char *out, size_t size) {
+  const char *sign = negative ? "-" : "";
+  int kk = exponent + 1;
+  if (length <= kk && kk <= 21) {
+    size_t len = (size_t)snprintf(out, size, "%s%s", sign, digits);
+    memset(out + len, '0', (size_t)(kk - length));
+    out[len + (size_t)(kk - length)] = '\0';
+  } else if (kk > 0 && kk <= 21) {
+    snprintf(out, size, "%s%.*s.%s", sign, kk, digits, digits + kk);
+  } else if (kk > -4 && kk <= 0) {
+    size_t len = (size_t)snprintf(out, size, "%s0.", sign);
+    memset(out + len, '0', (size_t)-kk);
+    snprintf(out + len + (size_t)-kk, size - len - (size_t)-kk, "%s", digits);
+  } else if (length == 1) {
+    snprintf(out, size, "%s%se%+03d", sign, digits, exponent);
+  } else {
+    snprintf(out, size, "%s%c.%se%+03d", sign, digits[0], digits + 1, exponent);
+  }
+}
+
+/**
+ * @brief Checks one finite value
+ */
+static void prom_dtoa_test_value(double value) {
+  char buffer[PROM_DTOA_BUFFER_SIZE];
+  size_t len = prom_dtoa(value, buffer);
+
+  char digits[PROM_DTOA_BUFFER_SIZE];
+  int length;
+  int exponent;
+  prom_dtoa_test_split(buffer, digits, &length, &exponent);
+  char expected[64];
+  prom_dtoa_test_layout(buffer[0] == '-', digits, length, exponent, expected, sizeof(expected));
+
+  double parsed = strtod(buffer, NULL);
+  int shortest = value == 0.0 ? 1 : prom_dtoa_test_shortest_length(value);
+  if (len != strlen(buffer) || memcmp(&parsed, &value, sizeof(value)) != 0 || length != shortest ||
+      strcmp(buffer, expected) != 0) {
+    if (failures++ < 20) {
+      fprintf(stderr, "%a: got \"%s\" (%d digits, %d needed), laid out as \"%s\"\n", value, buffer, length, shortest,
+              expected);
+    }
+  }
+}
+
+/**
+ * @brief xorshift64*, so that every run checks the same values
+ */
+static uint64_t prom_dtoa_test_next(uint64_t *state) {
+  *state ^= *state >> 12;
+  *state ^= *state << 25;
+  *state ^= *state >> 27;
+  return *state * UINT64_C(2685821657736338717);
+}
+
+int main(void) {
+  for (size_t i = 0; i < sizeof(prom_dtoa_test_cases) / sizeof(prom_dtoa_test_cases[0]); i++) {
+    char buffer[PROM_DTOA_BUFFER_SIZE];
+    size_t len = prom_dtoa(prom_dtoa_test_cases[i].value, buffer);
+    if (len != strlen(buffer) || strcmp(buffer, prom_dtoa_test_cases[i].expected) != 0) {
+      failures++;
+      fprintf(stderr, "case %zu: got \"%s\", expected \"%s\"\n", i, buffer, prom_dtoa_test_cases[i].expected);
+    }
+  }
+
+  uint64_t state = UINT64_C(0x9E3779B97F4A7C15);
+  for (int i = 0; i < PROM_DTOA_TEST_RANDOM_COUNT; i++) {
+    // Any finite bit pattern
+    uint64_t bits = prom_dtoa_test_next(&state);
+    double value;
+    memcpy(&value, &bits, sizeof(value));
+    if (isfinite(value)) prom_dtoa_test_value(value);
+
+    // Values shaped like samples: ratios, percentages, byte counts and latencies in seconds
+    uint64_t r = prom_dtoa_test_next(&state);
+    prom_dtoa_test_value((double)(r % 100000) / 100.0);
+    prom_dtoa_test_value((double)(r >> 20) / (double)(1 + r % 1000));
+    prom_dtoa_test_value((double)(r % 1000000) * 1e-6);
+    prom_dtoa_test_value((double)(r >> 11) * 0x1p-53);
+    prom_dtoa_test_value((double)(r % (UINT64_C(1) << 53)));
+  }
+
+  if (failures > 0) {
+    fprintf(stderr, "%d values failed\n", failures);
+    return EXIT_FAILURE;
+  }
+  printf("prom_dtoa: all values round-tripped\n");
+  return EXIT_SUCCESS;
+}
@@ -23,6 +23,9 @@
  * https://www.gnu.org/software/libmicrohttpd/manual/libmicrohttpd.html#index-_002aMHD_005fAcceptPolicyCallback
  */
 
+#ifndef PROMHTTP_INCLUDED
+#define PROMHTTP_INCLUDED
+
 #include <string.h>
 
 #include "microhttpd.h"
@@ -36,6 +39,31 @@
  */
 void promhttp_set_active_collector_registry(prom_collector_registry_t *active_registry);
 
+/**
+ * @brief Sets how long a gzip-compressed /metrics body may be sent again to later scrapes.
+ *
+ * Clients sending Accept-Encoding: gzip get a compressed body. It is reused while no sample of the active registry
+ * changes and for at most the given time, which also bounds how stale process metrics and summary quantiles can be.
+ * The default is one second.
+ *
+ * @param milliseconds The maximum age of a reused body. 0 compresses every scrape.
+ */
+void promhttp_set_gzip_cache_max_age(unsigned int milliseconds);
+
+/**
+ * @brief Tuning of the daemon started by promhttp_start_daemon_with_opts. A field left at 0 keeps the libmicrohttpd
+ *        default.
+ */
+typedef struct promhttp_daemon_opts {
+  unsigned int thread_pool_size;        /**< Threads that each poll their share of the connections, so a slow scrape
+                                             only holds up the connections of its thread. Requires an internal polling
+                                             mode such as MHD_USE_EPOLL_INTERNALLY; 0 or 1 for a single thread. */
+  unsigned int connection_limit;        /**< Maximum number of connections open at once */
+  unsigned int per_ip_connection_limit; /**< Maximum number of connections open at once from one IP address */
+  unsigned int connection_timeout;      /**< Seconds a connection may stay idle, such as a keep-alive connection
+                                             between two scrapes, before it is closed */
+} promhttp_daemon_opts_t;
+
 /**
  *  @brief Starts a daemon in the background and returns a pointer to an HMD_Daemon.
  *
@@ -46,3 +74,23 @@ void promhttp_set_active_collector_registry(prom_collector_registry_t *active_re
  */
 struct MHD_Daemon *promhttp_start_daemon(unsigned int flags, unsigned short port, MHD_AcceptPolicyCallback apc,
                                          void *apc_cls);
+
+/**
+ * @brief Starts a daemon in the background like promhttp_start_daemon, tuned by opts.
+ *
+ * Every request renders the active registry through its own stream, so several scrapes may be served at once by a
+ * thread pool.
+ *
+ * *Example*
+ *
+ *     promhttp_daemon_opts_t opts = {.thread_pool_size = 4, .connection_limit = 64, .connection_timeout = 30};
+ *     promhttp_start_daemon_with_opts(MHD_USE_EPOLL_INTERNALLY, 8000, NULL, NULL, &opts);
+ *
+ * @param opts The daemon options, or NULL for the libmicrohttpd defaults
+ * @return struct MHD_Daemon*, or NULL if the daemon could not be started, e.g. because the flags and opts conflict
+ */
+struct MHD_Daemon *promhttp_start_daemon_with_opts(unsigned int flags, unsigned short port,
+                                                   MHD_AcceptPolicyCallback apc, void *apc_cls,
+                                                   const promhttp_daemon_opts_t *opts);
+
+#endif  // PROMHTTP_INCLUDED
@@ -18,6 +18,18 @@
 
 #include "microhttpd.h"
 #include "prom.h"
+#include "promhttp.h"
+#include "promhttp_gzip_i.h"
+#include "promhttp_negotiate_i.h"
+
+// Size of the buffer libmicrohttpd fills from promhttp_stream_reader before each write
+#define PROMHTTP_STREAM_BLOCK_SIZE (32 * 1024)
+
+// The body depends on the format and the compression the client asked for
+#define PROMHTTP_VARY "Accept, Accept-Encoding"
+
+// Options promhttp_start_daemon_with_opts may pass to libmicrohttpd
+#define PROMHTTP_DAEMON_MAX_OPTIONS 4
 
 prom_collector_registry_t *PROM_ACTIVE_REGISTRY;
 
@@ -29,6 +41,17 @@ void promhttp_set_active_collector_registry(prom_collector_registry_t *active_re
   }
 }
 
+static ssize_t promhttp_stream_reader(void *cls, uint64_t pos, char *buf, size_t max) {
+  ssize_t n = prom_collector_registry_stream_read((prom_collector_registry_stream_t *)cls, buf, max);
+  if (n < 0) return MHD_CONTENT_READER_END_WITH_ERROR;
+  if (n == 0) return MHD_CONTENT_READER_END_OF_STREAM;
+  return n;
+}
+
+static void promhttp_stream_free(void *cls) {
+  prom_collector_registry_stream_destroy((prom_collector_registry_stream_t *)cls);
+}
+
 enum MHD_Result promhttp_handler(void *cls, struct MHD_Connection *connection, const char *url, const char *method,
                      const char *version, const char *upload_data, size_t *upload_data_size, void **con_cls) {
   if (strcmp(method, "GET") != 0) {
@@ -46,8 +69,36 @@ enum MHD_Result promhttp_handler(void *cls, struct MHD_Connection *connection, c
     return ret;
   }
   if (strcmp(url, "/metrics") == 0) {
-    const char *buf = prom_collector_registry_bridge(PROM_ACTIVE_REGISTRY);
-    struct MHD_Response *response = MHD_create_response_from_buffer(strlen(buf), (void *)buf, MHD_RESPMEM_MUST_FREE);
+    prom_exposition_format_t format =
+        promhttp_negotiate_format(MHD_lookup_connection_value(connection, MHD_HEADER_KIND, MHD_HTTP_HEADER_ACCEPT));
+    if (promhttp_negotiate_gzip(MHD_lookup_connection_value(connection, MHD_HEADER_KIND,
+                                                            MHD_HTTP_HEADER_ACCEPT_ENCODING))) {
+      struct MHD_Response *response = promhttp_gzip_response(PROM_ACTIVE_REGISTRY, format);
+      if (response == NULL) return MHD_NO;
+      MHD_add_response_header(response, MHD_HTTP_HEADER_CONTENT_TYPE, promhttp_negotiate_content_type(format));
+      MHD_add_response_header(response, MHD_HTTP_HEADER_VARY, PROMHTTP_VARY);
+      int ret = MHD_queue_response(connection, MHD_HTTP_OK, response);
+      MHD_destroy_response(response);
+      return ret;
+    }
+
+    // The body is rendered one metric family at a time while it is sent instead of being built in full first
+    prom_collector_registry_stream_t *stream = prom_collector_registry_stream_new(PROM_ACTIVE_REGISTRY, format);
+    if (stream == NULL) {
+      char *buf = "Internal Server Error\n";
+      struct MHD_Response *response = MHD_create_response_from_buffer(strlen(buf), (void *)buf, MHD_RESPMEM_PERSISTENT);
+      int ret = MHD_queue_response(connection, MHD_HTTP_INTERNAL_SERVER_ERROR, response);
+      MHD_destroy_response(response);
+      return ret;
+    }
+    struct MHD_Response *response = MHD_create_response_from_callback(
+        MHD_SIZE_UNKNOWN, PROMHTTP_STREAM_BLOCK_SIZE, &promhttp_stream_reader, stream, &promhttp_stream_free);
+    if (response == NULL) {
+      prom_collector_registry_stream_destroy(stream);
+      return MHD_NO;
+    }
+    MHD_add_response_header(response, MHD_HTTP_HEADER_CONTENT_TYPE, promhttp_negotiate_content_type(format));
+    MHD_add_response_header(response, MHD_HTTP_HEADER_VARY, PROMHTTP_VARY);
     int ret = MHD_queue_response(connection, MHD_HTTP_OK, response);
     MHD_destroy_response(response);
     return ret;
@@ -61,5 +112,31 @@ enum MHD_Result promhttp_handler(void *cls, struct MHD_Connection *connection, c
 
 struct MHD_Daemon *promhttp_start_daemon(unsigned int flags, unsigned short port, MHD_AcceptPolicyCallback apc,
                                          void *apc_cls) {
-  return MHD_start_daemon(flags, port, apc, apc_cls, &promhttp_handler, NULL, MHD_OPTION_END);
+  return promhttp_start_daemon_with_opts(flags, port, apc, apc_cls, NULL);
+}
+
+struct MHD_Daemon *promhttp_start_daemon_with_opts(unsigned int flags, unsigned short port,
+                                                   MHD_AcceptPolicyCallback apc, void *apc_cls,
+                                                   const promhttp_daemon_opts_t *opts) {
+  // Only the options that were set are passed, so libmicrohttpd keeps its own defaults for the others
+  struct MHD_OptionItem options[PROMHTTP_DAEMON_MAX_OPTIONS + 1];
+  size_t count = 0;
+  if (opts != NULL) {
+    if (opts->thread_pool_size > 1) {
+      options[count++] = (struct MHD_OptionItem){MHD_OPTION_THREAD_POOL_SIZE, opts->thread_pool_size, NULL};
+    }
+    if (opts->connection_limit > 0) {
+      options[count++] = (struct MHD_OptionItem){MHD_OPTION_CONNECTION_LIMIT, opts->connection_limit, NULL};
+    }
+    if (opts->per_ip_connection_limit > 0) {
+      options[count++] =
+          (struct MHD_OptionItem){MHD_OPTION_PER_IP_CONNECTION_LIMIT, opts->per_ip_connection_limit, NULL};
+    }
+    if (opts->connection_timeout > 0) {
+      options[count++] = (struct MHD_OptionItem){MHD_OPTION_CONNECTION_TIMEOUT, opts->connection_timeout, NULL};
+    }
+  }
+  options[count] = (struct MHD_OptionItem){MHD_OPTION_END, 0, NULL};
+  return MHD_start_daemon(flags, port, apc, apc_cls, &promhttp_handler, NULL, MHD_OPTION_ARRAY, options,
+                          MHD_OPTION_END);
 }
@@ -0,0 +1,251 @@
+/**
+ * Copyright 2019-2020 DigitalOcean Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <time.h>
+#include <zlib.h>
+
+#include "prom_alloc.h"
+#include "promhttp.h"
+#include "promhttp_gzip_i.h"
+
+// Size of the buffer libmicrohttpd fills from the readers before each write
+#define PROMHTTP_GZIP_BLOCK_SIZE (32 * 1024)
+
+// Plain text read from the registry stream before each deflate call
+#define PROMHTTP_GZIP_INPUT_SIZE (16 * 1024)
+
+// windowBits for deflateInit2: the default 32 KiB window, with a gzip header and trailer
+#define PROMHTTP_GZIP_WINDOW_BITS (15 + 16)
+
+#define PROMHTTP_GZIP_DEFAULT_CACHE_MAX_AGE_MS 1000
+
+/**
+ * @brief A compressed exposition, shared by the cache and by the responses sending it
+ */
+typedef struct promhttp_gzip_body {
+  atomic_uint refs;                     /**< The cache and each response hold a reference */
+  prom_collector_registry_t *registry;  /**< The registry it was rendered from */
+  prom_exposition_format_t format;      /**< The format it was rendered in */
+  uint64_t generation;                  /**< The registry generation before rendering */
+  long long created;                    /**< CLOCK_MONOTONIC nanoseconds before rendering */
+  unsigned char *data;                  /**< The gzip bytes */
+  size_t len;                           /**< Number of bytes in data */
+  size_t allocated;                     /**< Size of data */
+} promhttp_gzip_body_t;
+
+/**
+ * @brief Compression state of a response rendered for its request
+ */
+typedef struct promhttp_gzip_stream {
+  prom_collector_registry_stream_t *source; /**< The plain text exposition */
+  z_stream z;                               /**< The deflate state */
+  bool eof;                                 /**< source has been read completely */
+  bool finished;                            /**< deflate wrote the gzip trailer */
+  promhttp_gzip_body_t *body;               /**< Copy of the output for the cache, or NULL */
+  char in[PROMHTTP_GZIP_INPUT_SIZE];        /**< Plain text waiting to be compressed */
+} promhttp_gzip_stream_t;
+
+static struct {
+  pthread_mutex_t mutex;      /**< Protects body */
+  promhttp_gzip_body_t *body; /**< The last complete body, or NULL */
+  atomic_uint max_age_ms;     /**< How long body may be reused; 0 disables the cache */
+} promhttp_gzip_cache = {.mutex = PTHREAD_MUTEX_INITIALIZER, .max_age_ms = PROMHTTP_GZIP_DEFAULT_CACHE_MAX_AGE_MS};
+
+void promhttp_set_gzip_cache_max_age(unsigned int milliseconds) {
+  atomic_store(&promhttp_gzip_cache.max_age_ms, milliseconds);
+}
+
+static long long promhttp_gzip_now(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (long long)now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+static void promhttp_gzip_body_release(promhttp_gzip_body_t *self) {
+  if (atomic_fetch_sub(&self->refs, 1) != 1) return;
+  prom_free(self->data);
+  prom_free(self);
+}
+
+static void promhttp_gzip_body_release_generic(void *cls) { promhttp_gzip_body_release((promhttp_gzip_body_t *)cls); }
+
+static int promhttp_gzip_body_append(promhttp_gzip_body_t *self, const char *data, size_t len) {
+  if (self->len + len > self->allocated) {
+    size_t allocated = self->allocated * 2;
+    while (allocated < self->len + len) allocated *= 2;
+    unsigned char *grown = (unsigned char *)prom_realloc(self->data, allocated);
+    if (grown == NULL) return 1;
+    self->data = grown;
+    self->allocated = allocated;
+  }
+  memcpy(self->data + self->len, data, len);
+  self->len += len;
+  return 0;
+}
+
+static ssize_t promhttp_gzip_body_reader(void *cls, uint64_t pos, char *buf, size_t max) {
+  promhttp_gzip_body_t *self = (promhttp_gzip_body_t *)cls;
+  if (pos >= self->len) return MHD_CONTENT_READER_END_OF_STREAM;
+  size_t n = self->len - pos < max ? self->len - pos : max;
+  memcpy(buf, self->data + pos, n);
+  return (ssize_t)n;
+}
+
+/**
+ * @brief Makes body the cached one unless a body rendered later is already there. A single body is kept: scrapers of
+ * one deployment normally all ask for the same format.
+ */
+static void promhttp_gzip_cache_store(promhttp_gzip_body_t *body) {
+  promhttp_gzip_body_t *old = NULL;
+  pthread_mutex_lock(&promhttp_gzip_cache.mutex);
+  if (promhttp_gzip_cache.body == NULL || promhttp_gzip_cache.body->created <= body->created) {
+    old = promhttp_gzip_cache.body;
+    atomic_fetch_add(&body->refs, 1);
+    promhttp_gzip_cache.body = body;
+  }
+  pthread_mutex_unlock(&promhttp_gzip_cache.mutex);
+  if (old != NULL) promhttp_gzip_body_release(old);
+}
+
+/**
+ * @brief Returns a reference to the cached body if it is still valid for registry and format at generation, or NULL
+ */
+static promhttp_gzip_body_t *promhttp_gzip_cache_lookup(prom_collector_registry_t *registry,
+                                                        prom_exposition_format_t format, uint64_t generation,
+                                                        long long now, long long max_age) {
+  pthread_mutex_lock(&promhttp_gzip_cache.mutex);
+  promhttp_gzip_body_t *body = promhttp_gzip_cache.body;
+  if (body != NULL && body->registry == registry && body->format == format && body->generation == generation &&
+      now - body->created < max_age) {
+    atomic_fetch_add(&body->refs, 1);
+  } else {
+    body = NULL;
+  }
+  pthread_mutex_unlock(&promhttp_gzip_cache.mutex);
+  return body;
+}
+
+static ssize_t promhttp_gzip_stream_reader(void *cls, uint64_t pos, char *buf, size_t max) {
+  promhttp_gzip_stream_t *self = (promhttp_gzip_stream_t *)cls;
+  if (self->finished) return MHD_CONTENT_READER_END_OF_STREAM;
+
+  self->z.next_out = (Bytef *)buf;
+  self->z.avail_out = (uInt)(max < PROMHTTP_GZIP_BLOCK_SIZE ? max : PROMHTTP_GZIP_BLOCK_SIZE);
+  size_t avail = self->z.avail_out;
+  while (self->z.avail_out > 0 && !self->finished) {
+    if (self->z.avail_in == 0 && !self->eof) {
+      ssize_t n = prom_collector_registry_stream_read(self->source, self->in, sizeof(self->in));
+      if (n < 0) return MHD_CONTENT_READER_END_WITH_ERROR;
+      self->eof = n == 0;
+      self->z.next_in = (Bytef *)self->in;
+      self->z.avail_in = (uInt)n;
+    }
+    int r = deflate(&self->z, self->eof ? Z_FINISH : Z_NO_FLUSH);
+    if (r == Z_STREAM_END) {
+      self->finished = true;
+    } else if (r != Z_OK && r != Z_BUF_ERROR) {
+      return MHD_CONTENT_READER_END_WITH_ERROR;
+    }
+  }
+
+  size_t n = avail - self->z.avail_out;
+  if (self->body != NULL && promhttp_gzip_body_append(self->body, buf, n)) {
+    // Not worth failing the scrape over: this body just is not cached
+    promhttp_gzip_body_release(self->body);
+    self->body = NULL;
+  }
+  if (self->finished && self->body != NULL) promhttp_gzip_cache_store(self->body);
+  return n > 0 ? (ssize_t)n : MHD_CONTENT_READER_END_OF_STREAM;
+}
+
+static void promhttp_gzip_stream_free(void *cls) {
+  promhttp_gzip_stream_t *self = (promhttp_gzip_stream_t *)cls;
+  deflateEnd(&self->z);
+  prom_collector_registry_stream_destroy(self->source);
+  if (self->body != NULL) promhttp_gzip_body_release(self->body);
+  prom_free(self);
+}
+
+static promhttp_gzip_body_t *promhttp_gzip_body_new(prom_collector_registry_t *registry,
+                                                    prom_exposition_format_t format, uint64_t generation,
+                                                    long long created) {
+  promhttp_gzip_body_t *self = (promhttp_gzip_body_t *)prom_malloc(sizeof(promhttp_gzip_body_t));
+  if (self == NULL) return NULL;
+  atomic_init(&self->refs, 1);
+  self->registry = registry;
+  self->format = format;
+  self->generation = generation;
+  self->created = created;
+  self->len = 0;
+  self->allocated = PROMHTTP_GZIP_BLOCK_SIZE;
+  self->data = (unsigned char *)prom_malloc(self->allocated);
+  if (self->data == NULL) {
+    prom_free(self);
+    return NULL;
+  }
+  return self;
+}
+
+struct MHD_Response *promhttp_gzip_response(prom_collector_registry_t *registry, prom_exposition_format_t format) {
+  struct MHD_Response *response = NULL;
+  long long now = promhttp_gzip_now();
+  long long max_age = (long long)atomic_load(&promhttp_gzip_cache.max_age_ms) * 1000000LL;
+  uint64_t generation = 0;
+  bool cacheable = max_age > 0 && prom_collector_registry_generation(registry, &generation) == 0;
+
+  if (cacheable) {
+    promhttp_gzip_body_t *body = promhttp_gzip_cache_lookup(registry, format, generation, now, max_age);
+    if (body != NULL) {
+      response = MHD_create_response_from_callback(body->len, PROMHTTP_GZIP_BLOCK_SIZE, &promhttp_gzip_body_reader,
+                                                   body, &promhttp_gzip_body_release_generic);
+      if (response == NULL) {
+        promhttp_gzip_body_release(body);
+        return NULL;
+      }
+      MHD_add_response_header(response, MHD_HTTP_HEADER_CONTENT_ENCODING, "gzip");
+      return response;
+    }
+  }
+
+  promhttp_gzip_stream_t *stream = (promhttp_gzip_stream_t *)prom_malloc(sizeof(promhttp_gzip_stream_t));
+  if (stream == NULL) return NULL;
+  memset(&stream->z, 0, sizeof(stream->z));
+  if (deflateInit2(&stream->z, Z_DEFAULT_COMPRESSION, Z_DEFLATED, PROMHTTP_GZIP_WINDOW_BITS, 8, Z_DEFAULT_STRATEGY) !=
+      Z_OK) {
+    prom_free(stream);
+    return NULL;
+  }
+  stream->eof = false;
+  stream->finished = false;
+  stream->body = cacheable ? promhttp_gzip_body_new(registry, format, generation, now) : NULL;
+  stream->source = prom_collector_registry_stream_new(registry, format);
+  if (stream->source == NULL) {
+    promhttp_gzip_stream_free(stream);
+    return NULL;
+  }
+
+  response = MHD_create_response_from_callback(MHD_SIZE_UNKNOWN, PROMHTTP_GZIP_BLOCK_SIZE,
+                                               &promhttp_gzip_stream_reader, stream, &promhttp_gzip_stream_free);
+  if (response == NULL) {
+    promhttp_gzip_stream_free(stream);
+    return NULL;
+  }
+  MHD_add_response_header(response, MHD_HTTP_HEADER_CONTENT_ENCODING, "gzip");
+  return response;
+}
@@ -0,0 +1,34 @@
+/**
+ * Copyright 2019-2020 DigitalOcean Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PROMHTTP_GZIP_I_H
+#define PROMHTTP_GZIP_I_H
+
+#include "microhttpd.h"
+#include "prom.h"
+
+/**
+ * @brief API PRIVATE Creates a response carrying the gzip-compressed exposition of registry in the given format.
+ *
+ * The body is compressed while it is streamed to the client. When it completes, it is kept for the next scrapes as
+ * long as the registry generation does not change and it is younger than the maximum age set with
+ * promhttp_set_gzip_cache_max_age.
+ *
+ * @return The response, or NULL upon failure
+ */
+struct MHD_Response *promhttp_gzip_response(prom_collector_registry_t *registry, prom_exposition_format_t format);
+
+#endif  // PROMHTTP_GZIP_I_H
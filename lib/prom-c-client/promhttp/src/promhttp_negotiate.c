@@ -0,0 +1,175 @@
+/**
+ * Copyright 2019-2020 DigitalOcean Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+#include <strings.h>
+
+#include "promhttp_negotiate_i.h"
+
+#define PROMHTTP_NEGOTIATE_TEXT_TYPE "text/plain; version=0.0.4; charset=utf-8"
+#define PROMHTTP_NEGOTIATE_PROTOBUF_TYPE \
+  "application/vnd.google.protobuf; proto=io.prometheus.client.MetricFamily; encoding=delimited"
+#define PROMHTTP_NEGOTIATE_OPENMETRICS_TYPE "application/openmetrics-text; version=1.0.0; charset=utf-8"
+
+static bool promhttp_negotiate_is_space(char c) { return c == ' ' || c == '\t'; }
+
+static bool promhttp_negotiate_equals(const char *token, size_t token_len, const char *expected) {
+  return token_len == strlen(expected) && strncasecmp(token, expected, token_len) == 0;
+}
+
+/**
+ * @brief Parses a q-value such as 0, 0.5 or 1.000 into thousandths, without depending on the locale
+ */
+static int promhttp_negotiate_qvalue(const char *value, size_t len) {
+  int q = 0;
+  size_t i = 0;
+  for (; i < len && value[i] >= '0' && value[i] <= '9'; i++) q = q * 10 + (value[i] - '0');
+  q = q > 1 ? 1000 : q * 1000;
+  if (i < len && value[i] == '.') {
+    int scale = 100;
+    for (i++; i < len && value[i] >= '0' && value[i] <= '9' && scale > 0; i++, scale /= 10) {
+      q += (value[i] - '0') * scale;
+    }
+  }
+  return q > 1000 ? 1000 : q;
+}
+
+/**
+ * @brief Tells whether params, as set by promhttp_negotiate_next, contains the parameter name=value
+ */
+static bool promhttp_negotiate_has_param(const char *params, size_t params_len, const char *param) {
+  const char *end = params + params_len;
+  for (const char *p = params; p < end;) {
+    while (p < end && (*p == ';' || promhttp_negotiate_is_space(*p))) p++;
+    const char *start = p;
+    while (p < end && *p != ';') p++;
+    const char *stop = p;
+    while (stop > start && promhttp_negotiate_is_space(stop[-1])) stop--;
+    if (promhttp_negotiate_equals(start, (size_t)(stop - start), param)) return true;
+  }
+  return false;
+}
+
+/**
+ * @brief Tells whether the parameters of an application/openmetrics-text range allow the version written by libprom.
+ *        1.0.0 and the earlier 0.0.1 draft describe the same text, and no version means the latest.
+ */
+static bool promhttp_negotiate_openmetrics_version(const char *params, size_t params_len) {
+  const char *end = params + params_len;
+  for (const char *p = params; p + 8 <= end; p++) {
+    if (strncasecmp(p, "version=", 8) == 0 && (p == params || p[-1] == ';' || promhttp_negotiate_is_space(p[-1]))) {
+      return promhttp_negotiate_has_param(params, params_len, "version=1.0.0") ||
+             promhttp_negotiate_has_param(params, params_len, "version=0.0.1");
+    }
+  }
+  return true;
+}
+
+bool promhttp_negotiate_next(const char **cursor, const char **token, size_t *token_len, const char **params,
+                             size_t *params_len, int *q) {
+  const char *p = *cursor;
+  while (*p == ',' || promhttp_negotiate_is_space(*p)) p++;
+  if (*p == '\0') {
+    *cursor = p;
+    return false;
+  }
+
+  *token = p;
+  while (*p != '\0' && *p != ',' && *p != ';' && !promhttp_negotiate_is_space(*p)) p++;
+  *token_len = (size_t)(p - *token);
+  while (promhttp_negotiate_is_space(*p)) p++;
+
+  *params = p;
+  *q = 1000;
+  while (*p != '\0' && *p != ',') {
+    if (*p++ != ';') continue;
+    while (promhttp_negotiate_is_space(*p)) p++;
+    if ((*p == 'q' || *p == 'Q') && p[1] == '=') {
+      const char *value = p + 2;
+      while (*p != '\0' && *p != ',' && *p != ';') p++;
+      *q = promhttp_negotiate_qvalue(value, (size_t)(p - value));
+    }
+  }
+  *params_len = (size_t)(p - *params);
+  *cursor = p;
+  return true;
+}
+
+bool promhttp_negotiate_gzip(const char *accept_encoding) {
+  if (accept_encoding == NULL) return false;
+
+  // An explicit gzip entry wins over the * wildcard
+  int gzip = -1;
+  int wildcard = -1;
+  const char *token = NULL;
+  const char *params = NULL;
+  size_t token_len = 0;
+  size_t params_len = 0;
+  int q = 0;
+  while (promhttp_negotiate_next(&accept_encoding, &token, &token_len, &params, &params_len, &q)) {
+    if (promhttp_negotiate_equals(token, token_len, "gzip") || promhttp_negotiate_equals(token, token_len, "x-gzip")) {
+      gzip = q > 0;
+    } else if (promhttp_negotiate_equals(token, token_len, "*")) {
+      wildcard = q > 0;
+    }
+  }
+  return gzip != -1 ? gzip : wildcard == 1;
+}
+
+prom_exposition_format_t promhttp_negotiate_format(const char *accept) {
+  if (accept == NULL) return PROM_EXPOSITION_TEXT;
+
+  prom_exposition_format_t best = PROM_EXPOSITION_TEXT;
+  int best_q = 0;
+  const char *token = NULL;
+  const char *params = NULL;
+  size_t token_len = 0;
+  size_t params_len = 0;
+  int q = 0;
+  while (promhttp_negotiate_next(&accept, &token, &token_len, &params, &params_len, &q)) {
+    prom_exposition_format_t format;
+    if (promhttp_negotiate_equals(token, token_len, "application/vnd.google.protobuf") &&
+        promhttp_negotiate_has_param(params, params_len, "proto=io.prometheus.client.MetricFamily") &&
+        promhttp_negotiate_has_param(params, params_len, "encoding=delimited")) {
+      format = PROM_EXPOSITION_PROTOBUF;
+    } else if (promhttp_negotiate_equals(token, token_len, "application/openmetrics-text") &&
+               promhttp_negotiate_openmetrics_version(params, params_len)) {
+      format = PROM_EXPOSITION_OPENMETRICS;
+    } else if (promhttp_negotiate_equals(token, token_len, "text/plain") ||
+               promhttp_negotiate_equals(token, token_len, "text/*") ||
+               promhttp_negotiate_equals(token, token_len, "*/*")) {
+      format = PROM_EXPOSITION_TEXT;
+    } else {
+      continue;
+    }
+    if (q > best_q) {
+      best = format;
+      best_q = q;
+    }
+  }
+  return best;
+}
+
+const char *promhttp_negotiate_content_type(prom_exposition_format_t format) {
+  switch (format) {
+    case PROM_EXPOSITION_PROTOBUF:
+      return PROMHTTP_NEGOTIATE_PROTOBUF_TYPE;
+    case PROM_EXPOSITION_OPENMETRICS:
+      return PROMHTTP_NEGOTIATE_OPENMETRICS_TYPE;
+    default:
+      return PROMHTTP_NEGOTIATE_TEXT_TYPE;
+  }
+}
@@ -0,0 +1,56 @@
+/**
+ * Copyright 2019-2020 DigitalOcean Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PROMHTTP_NEGOTIATE_I_H
+#define PROMHTTP_NEGOTIATE_I_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "prom.h"
+
+/**
+ * @brief API PRIVATE Reads the next element of a comma-separated header such as Accept or Accept-Encoding
+ * @param cursor Position in the header, moved past the element
+ * @param token Set to the start of the element without its parameters, e.g. text/plain or gzip
+ * @param token_len Set to the length of token
+ * @param params Set to the parameters that follow token, starting at its first ';', or to an empty string
+ * @param params_len Set to the length of params
+ * @param q Set to the q-value of the element in thousandths, 1000 when it has none
+ * @return false once the header has no element left
+ */
+bool promhttp_negotiate_next(const char **cursor, const char **token, size_t *token_len, const char **params,
+                             size_t *params_len, int *q);
+
+/**
+ * @brief API PRIVATE Tells whether an Accept-Encoding header allows a gzip body
+ * @param accept_encoding The header value, or NULL when the request has none
+ */
+bool promhttp_negotiate_gzip(const char *accept_encoding);
+
+/**
+ * @brief API PRIVATE Picks the exposition format preferred by an Accept header: the supported media range with the
+ *        highest q-value, the earliest one on ties. The text format is used when nothing else is acceptable.
+ * @param accept The header value, or NULL when the request has none
+ */
+prom_exposition_format_t promhttp_negotiate_format(const char *accept);
+
+/**
+ * @brief API PRIVATE Returns the Content-Type of a response body in the given format
+ */
+const char *promhttp_negotiate_content_type(prom_exposition_format_t format);
+
+#endif  // PROMHTTP_NEGOTIATE_I_H
@@ -1,8 +1,5 @@
 #include "expose_metrics.h"
 
-/** Mutex para sincronizacion de hilos */
-pthread_mutex_t lock;
-
 /** Metrica de Prometheus para el uso de CPU */
 static prom_gauge_t* cpu_usage_metric;
 
@@ -27,12 +24,71 @@ static prom_gauge_t* stopped_processes_metric;
 static prom_gauge_t* zombie_processes_metric;
 static prom_gauge_t* running_processes_metric;
 
-/** Metrica de Prometheus para la velocidad de descarga */
-static prom_gauge_t* downloaded_bytes_metric;
+/** Metricas de Prometheus para los eventos de procesos del proc connector */
+static prom_counter_t* process_forks_metric;
+static prom_counter_t* process_execs_metric;
+static prom_counter_t* process_exits_metric;
+
+/** Metricas de Prometheus para las tasas de red por interfaz, indexadas por net_counter_t */
+static prom_gauge_t* network_metrics[NET_COUNTER_COUNT];
+
+/** Nombres de las metricas de red, indexados por net_counter_t */
+static const char* const network_metric_names[NET_COUNTER_COUNT] = {
+    "network_receive_bytes_per_second",
+    "network_receive_packets_per_second",
+    "network_receive_errors_per_second",
+    "network_receive_drops_per_second",
+    "network_transmit_bytes_per_second",
+    "network_transmit_packets_per_second",
+    "network_transmit_errors_per_second",
+    "network_transmit_drops_per_second"};
+
+/** Descripciones de las metricas de red, indexadas por net_counter_t */
+static const char* const network_metric_help[NET_COUNTER_COUNT] = {
+    "Bytes recibidos por segundo",
+    "Paquetes recibidos por segundo",
+    "Errores de recepcion por segundo",
+    "Paquetes descartados al recibir por segundo",
+    "Bytes transmitidos por segundo",
+    "Paquetes transmitidos por segundo",
+    "Errores de transmision por segundo",
+    "Paquetes descartados al transmitir por segundo"};
 
 /** Metrica de Prometheus para la potencia entregada por la bateria */
 static prom_gauge_t* battery_power_metric;
 
+/** Metrica de Prometheus para los plazos perdidos por cada coleccionista */
+static prom_counter_t* missed_deadlines_metric;
+
+/** Metrica de Prometheus para las ejecuciones que superaron su tiempo maximo */
+static prom_counter_t* collector_timeouts_metric;
+
+/** Metrica de Prometheus para la duracion de cada coleccionista */
+static prom_histogram_t* collector_duration_metric;
+
+/** Metrica de Prometheus para los cuantiles de la duracion de cada coleccionista */
+static prom_summary_t* collector_latency_metric;
+
+/**
+ * Handles de las metricas sin etiquetas, resueltos una sola vez en init_metrics(). Se actualizan con operaciones
+ * atomicas sobre el valor de la muestra, sin mutex ni busqueda en el mapa de muestras.
+ */
+static prom_gauge_handle_t* memory_usage_handle;
+static prom_gauge_handle_t* disk_usage_handle;
+static prom_gauge_handle_t* battery_percentage_handle;
+static prom_gauge_handle_t* cpu_temperature_handle;
+static prom_gauge_handle_t* total_processes_handle;
+static prom_gauge_handle_t* suspended_processes_handle;
+static prom_gauge_handle_t* ready_processes_handle;
+static prom_gauge_handle_t* uninterruptible_processes_handle;
+static prom_gauge_handle_t* stopped_processes_handle;
+static prom_gauge_handle_t* zombie_processes_handle;
+static prom_gauge_handle_t* running_processes_handle;
+static prom_gauge_handle_t* battery_power_handle;
+static prom_counter_handle_t* process_forks_handle;
+static prom_counter_handle_t* process_execs_handle;
+static prom_counter_handle_t* process_exits_handle;
+
 /** Arreglo de metricas de Prometheus */
 prom_metric_t* metrics[METRICS_COUNT];
 
@@ -50,8 +106,18 @@ void register_metrics()
     metrics[9] = stopped_processes_metric;
     metrics[10] = zombie_processes_metric;
     metrics[11] = running_processes_metric;
-    metrics[12] = downloaded_bytes_metric;
-    metrics[13] = battery_power_metric;
+    metrics[12] = battery_power_metric;
+    metrics[13] = process_forks_metric;
+    metrics[14] = process_execs_metric;
+    metrics[15] = process_exits_metric;
+    for (int counter = 0; counter < NET_COUNTER_COUNT; counter++)
+    {
+        metrics[16 + counter] = network_metrics[counter];
+    }
+    metrics[24] = missed_deadlines_metric;
+    metrics[25] = collector_timeouts_metric;
+    metrics[26] = collector_duration_metric;
+    metrics[27] = collector_latency_metric;
 
     int i;
     for (i = 0; i < METRICS_COUNT; i++)
@@ -65,17 +131,70 @@ void register_metrics()
 
 void update_cpu_gauge()
 {
-    double usage = get_cpu_usage();
-    if (usage >= 0)
+    static cpu_usage_t usage;
+    // Handles por modo y por entrada, junto con el numero de CPU para el que se resolvieron
+    static prom_gauge_handle_t* handles[PROCFS_CPU_MODE_COUNT][PROCFS_CPU_MAX_CPUS + 1];
+    static int handle_id[PROCFS_CPU_MAX_CPUS + 1];
+    static size_t handle_count;
+
+    if (get_cpu_usage(&usage) != 0)
     {
-        pthread_mutex_lock(&lock);
-        prom_gauge_set(cpu_usage_metric, usage, NULL);
-        pthread_mutex_unlock(&lock);
+        fprintf(stderr, "Error al obtener el uso de CPU\n");
+        return;
     }
-    else
+    if (usage.count == 0)
     {
-        fprintf(stderr, "Error al obtener el uso de CPU\n");
+        return; // Primera lectura o cambio de las CPU en linea: no hay datos en este ciclo
+    }
+
+    // Las series de las CPU que ya no estan en linea pasan a NaN para no quedar con su ultimo valor
+    for (size_t j = 0; j < handle_count; j++)
+    {
+        if (j < usage.count && handle_id[j] == usage.id[j])
+        {
+            continue;
+        }
+        int online = 0;
+        for (size_t i = 0; i < usage.count && !online; i++)
+        {
+            online = usage.id[i] == handle_id[j];
+        }
+        if (!online)
+        {
+            for (int mode = 0; mode < PROCFS_CPU_MODE_COUNT; mode++)
+            {
+                prom_gauge_handle_set(handles[mode][j], NAN);
+            }
+        }
+    }
+
+    for (size_t i = 0; i < usage.count; i++)
+    {
+        if (i >= handle_count || handle_id[i] != usage.id[i])
+        {
+            char cpu[16];
+            const char* labels[2] = {cpu, NULL};
+            if (usage.id[i] < 0)
+            {
+                strcpy(cpu, "all");
+            }
+            else
+            {
+                snprintf(cpu, sizeof(cpu), "%d", usage.id[i]);
+            }
+            for (int mode = 0; mode < PROCFS_CPU_MODE_COUNT; mode++)
+            {
+                labels[1] = procfs_cpu_mode_names[mode];
+                handles[mode][i] = prom_gauge_handle(cpu_usage_metric, labels);
+            }
+            handle_id[i] = usage.id[i];
+        }
+        for (int mode = 0; mode < PROCFS_CPU_MODE_COUNT; mode++)
+        {
+            prom_gauge_handle_set(handles[mode][i], usage.percentage[mode][i]);
+        }
     }
+    handle_count = usage.count;
 }
 
 void update_memory_gauge()
@@ -83,9 +202,7 @@ void update_memory_gauge()
     double usage = get_memory_usage();
     if (usage >= 0)
     {
-        pthread_mutex_lock(&lock);
-        prom_gauge_set(memory_usage_metric, usage, NULL);
-        pthread_mutex_unlock(&lock);
+        prom_gauge_handle_set(memory_usage_handle, usage);
     }
     else
     {
@@ -98,9 +215,7 @@ void update_disk_gauge()
     double usage = get_disk_usage();
     if (usage >= 0)
     {
-        pthread_mutex_lock(&lock);
-        prom_gauge_set(disk_usage_metric, usage, NULL);
-        pthread_mutex_unlock(&lock);
+        prom_gauge_handle_set(disk_usage_handle, usage);
     }
     else
     {
@@ -113,9 +228,7 @@ void update_battery_gauge()
     double percentage = get_battery_percentage();
     if (percentage >= 0)
     {
-        pthread_mutex_lock(&lock);
-        prom_gauge_set(battery_percentage_metric, percentage, NULL);
-        pthread_mutex_unlock(&lock);
+        prom_gauge_handle_set(battery_percentage_handle, percentage);
     }
     else
     {
@@ -128,9 +241,7 @@ void update_cpu_temperature_gauge()
     int temperature = get_cpu_temperature();
     if (temperature >= 0)
     {
-        pthread_mutex_lock(&lock);
-        prom_gauge_set(cpu_temperature_metric, temperature, NULL);
-        pthread_mutex_unlock(&lock);
+        prom_gauge_handle_set(cpu_temperature_handle, temperature);
     }
     else
     {
@@ -148,15 +259,13 @@ void update_process_states_gauge()
 
     if (total >= 0 && suspended >= 0 && ready >= 0)
     {
-        pthread_mutex_lock(&lock);
-        prom_gauge_set(total_processes_metric, total, NULL);                     // Total de procesos
-        prom_gauge_set(suspended_processes_metric, suspended, NULL);             // Procesos suspendidos
-        prom_gauge_set(ready_processes_metric, ready, NULL);                     // Procesos listos
-        prom_gauge_set(uninterruptible_processes_metric, uninterruptible, NULL); // Procesos en estado uninterruptible
-        prom_gauge_set(stopped_processes_metric, stopped, NULL);                 // Procesos detenidos
-        prom_gauge_set(zombie_processes_metric, zombie, NULL);                   // Procesos zombie
-        prom_gauge_set(running_processes_metric, running, NULL);                 // Procesos en ejecucion
-        pthread_mutex_unlock(&lock);
+        prom_gauge_handle_set(total_processes_handle, total);                     // Total de procesos
+        prom_gauge_handle_set(suspended_processes_handle, suspended);             // Procesos suspendidos
+        prom_gauge_handle_set(ready_processes_handle, ready);                     // Procesos listos
+        prom_gauge_handle_set(uninterruptible_processes_handle, uninterruptible); // Procesos en estado uninterruptible
+        prom_gauge_handle_set(stopped_processes_handle, stopped);                 // Procesos detenidos
+        prom_gauge_handle_set(zombie_processes_handle, zombie);                   // Procesos zombie
+        prom_gauge_handle_set(running_processes_handle, running);                 // Procesos en ejecucion
     }
     else
     {
@@ -164,19 +273,82 @@ void update_process_states_gauge()
     }
 }
 
-void update_downloaded_bytes()
+void update_process_events_counters()
 {
-    double speed = get_downloaded_bytes(RED_INTERFACE, 1); // Intervalo de 1 segundo
-    if (speed >= 0)
+    // Ultimos valores publicados, para sumar solo la diferencia
+    static proc_events_counters_t published;
+
+    if (!proc_events_running())
     {
-        pthread_mutex_lock(&lock);
-        prom_gauge_set(downloaded_bytes_metric, speed, NULL);
-        pthread_mutex_unlock(&lock);
+        return;
     }
-    else
+
+    proc_events_counters_t counters;
+    proc_events_get_counters(&counters);
+
+    prom_counter_handle_add(process_forks_handle, (double)(counters.forks - published.forks));
+    prom_counter_handle_add(process_execs_handle, (double)(counters.execs - published.execs));
+    prom_counter_handle_add(process_exits_handle, (double)(counters.exits - published.exits));
+
+    published = counters;
+}
+
+void update_network_gauges()
+{
+    static network_rates_t rates;
+    // Handles por contador y por posicion, junto con la interfaz para la que se resolvieron
+    static prom_gauge_handle_t* handles[NET_COUNTER_COUNT][PROCFS_NET_DEV_MAX_INTERFACES];
+    static char handle_name[PROCFS_NET_DEV_MAX_INTERFACES][PROCFS_NET_DEV_NAME_SIZE];
+    static size_t handle_count;
+
+    if (get_network_rates(&rates) != 0)
+    {
+        fprintf(stderr, "Error al obtener las tasas de red\n");
+        return;
+    }
+    if (rates.count == 0)
     {
-        fprintf(stderr, "Error al obtener los bytes descargados\n");
+        return; // Primera lectura: no hay tasas en este ciclo
     }
+
+    // Las series de las interfaces que desaparecieron pasan a NaN para no quedar con su ultima tasa
+    for (size_t j = 0; j < handle_count; j++)
+    {
+        if (j < rates.count && strcmp(handle_name[j], rates.name[j]) == 0)
+        {
+            continue;
+        }
+        int present = 0;
+        for (size_t i = 0; i < rates.count && !present; i++)
+        {
+            present = strcmp(rates.name[i], handle_name[j]) == 0;
+        }
+        if (!present)
+        {
+            for (int counter = 0; counter < NET_COUNTER_COUNT; counter++)
+            {
+                prom_gauge_handle_set(handles[counter][j], NAN);
+            }
+        }
+    }
+
+    for (size_t i = 0; i < rates.count; i++)
+    {
+        if (i >= handle_count || strcmp(handle_name[i], rates.name[i]) != 0)
+        {
+            const char* labels[1] = {rates.name[i]};
+            for (int counter = 0; counter < NET_COUNTER_COUNT; counter++)
+            {
+                handles[counter][i] = prom_gauge_handle(network_metrics[counter], labels);
+            }
+            strcpy(handle_name[i], rates.name[i]);
+        }
+        for (int counter = 0; counter < NET_COUNTER_COUNT; counter++)
+        {
+            prom_gauge_handle_set(handles[counter][i], rates.rate[counter][i]);
+        }
+    }
+    handle_count = rates.count;
 }
 
 void update_battery_power_gauge()
@@ -184,9 +356,7 @@ void update_battery_power_gauge()
     double power = get_battery_power_consumption(); // Obtener la potencia en vatios
     if (power >= 0)
     {
-        pthread_mutex_lock(&lock);
-        prom_gauge_set(battery_power_metric, power, NULL);
-        pthread_mutex_unlock(&lock);
+        prom_gauge_handle_set(battery_power_handle, power);
     }
     else
     {
@@ -194,6 +364,47 @@ void update_battery_power_gauge()
     }
 }
 
+void update_scheduler_counters()
+{
+    // Ultimos valores publicados, para sumar solo la diferencia
+    static unsigned long long published_missed[SCHEDULER_MAX_TASKS];
+    static unsigned long long published_timeouts[SCHEDULER_MAX_TASKS];
+    static prom_counter_handle_t* missed_handles[SCHEDULER_MAX_TASKS];
+    static prom_counter_handle_t* timeout_handles[SCHEDULER_MAX_TASKS];
+
+    for (size_t i = 0; i < scheduler_task_count(); i++)
+    {
+        if (missed_handles[i] == NULL)
+        {
+            const char* labels[1] = {scheduler_task_name(i)};
+            missed_handles[i] = prom_counter_handle(missed_deadlines_metric, labels);
+            timeout_handles[i] = prom_counter_handle(collector_timeouts_metric, labels);
+        }
+        unsigned long long missed = scheduler_missed_deadlines(i);
+        unsigned long long timeouts = scheduler_timeouts(i);
+        prom_counter_handle_add(missed_handles[i], (double)(missed - published_missed[i]));
+        prom_counter_handle_add(timeout_handles[i], (double)(timeouts - published_timeouts[i]));
+        published_missed[i] = missed;
+        published_timeouts[i] = timeouts;
+    }
+}
+
+void observe_collector_duration(size_t index, double seconds)
+{
+    // Un coleccionista nunca corre dos veces a la vez, por lo que cada posicion la escribe un solo hilo por vez
+    static prom_histogram_handle_t* handles[SCHEDULER_MAX_TASKS];
+    static prom_summary_handle_t* latency_handles[SCHEDULER_MAX_TASKS];
+
+    if (handles[index] == NULL)
+    {
+        const char* labels[1] = {scheduler_task_name(index)};
+        handles[index] = prom_histogram_handle(collector_duration_metric, labels);
+        latency_handles[index] = prom_summary_handle(collector_latency_metric, labels);
+    }
+    prom_histogram_handle_observe(handles[index], seconds);
+    prom_summary_handle_observe(latency_handles[index], seconds);
+}
+
 void* expose_metrics(void* arg)
 {
     (void)arg; // Argumento no utilizado
@@ -201,11 +412,25 @@ void* expose_metrics(void* arg)
     // Aseguramos que el manejador HTTP este adjunto al registro por defecto
     promhttp_set_active_collector_registry(NULL);
 
-    // Iniciamos el servidor HTTP en el puerto 8000
-    struct MHD_Daemon* daemon = promhttp_start_daemon(MHD_USE_SELECT_INTERNALLY, 8000, NULL, NULL);
+    // Iniciamos el servidor HTTP con un pool de hilos que atienden las conexiones con epoll
+    promhttp_daemon_opts_t opts = {.thread_pool_size = HTTP_THREADS,
+                                   .connection_limit = HTTP_CONNECTION_LIMIT,
+                                   .per_ip_connection_limit = HTTP_PER_IP_CONNECTION_LIMIT,
+                                   .connection_timeout = HTTP_CONNECTION_TIMEOUT};
+    // Si libmicrohttpd fue compilada sin soporte de epoll se usa select con el mismo pool. Se decide antes de
+    // iniciar para no reintentar ante otros errores, como un puerto en uso
+    int epoll = MHD_is_feature_supported(MHD_FEATURE_EPOLL) == MHD_YES;
+    if (!epoll)
+    {
+        fprintf(stderr, "libmicrohttpd no soporta epoll, el servidor HTTP usa select\n");
+    }
+    errno = 0;
+    struct MHD_Daemon* daemon = promhttp_start_daemon_with_opts(
+        epoll ? MHD_USE_EPOLL_INTERNALLY : MHD_USE_SELECT_INTERNALLY, HTTP_PORT, NULL, NULL, &opts);
     if (daemon == NULL)
     {
-        fprintf(stderr, "Error al iniciar el servidor HTTP\n");
+        fprintf(stderr, "Error al iniciar el servidor HTTP en el puerto %d con %s: %s\n", HTTP_PORT,
+                epoll ? "epoll" : "select", errno != 0 ? strerror(errno) : "opciones no validas");
     }
 
     // Mantenemos el servidor en ejecucion
@@ -220,20 +445,27 @@ void* expose_metrics(void* arg)
 
 void init_metrics()
 {
-    // Inicializamos el mutex
-    if (pthread_mutex_init(&lock, NULL) != 0)
-    {
-        fprintf(stderr, "Error al inicializar el mutex\n");
-    }
-
     // Inicializamos el registro de coleccionistas de Prometheus
     if (prom_collector_registry_default_init() != 0)
     {
         fprintf(stderr, "Error al inicializar el registro de Prometheus\n");
     }
 
+    // Creamos el pool de hilos que recorre /proc
+    if (process_scan_init(PROCESS_SCAN_THREADS) != 0)
+    {
+        fprintf(stderr, "Error al inicializar el escaner de procesos\n");
+    }
+
+    // Nos suscribimos a los eventos de procesos; sin permisos se usa solo el recorrido de /proc
+    if (proc_events_start() != 0)
+    {
+        fprintf(stderr, "Proc connector no disponible, se recorre /proc en cada ciclo\n");
+    }
+
     // Creamos la metrica para el uso de CPU
-    cpu_usage_metric = prom_gauge_new("cpu_usage_percentage", "Porcentaje de uso de CPU", 0, NULL);
+    cpu_usage_metric = prom_gauge_new("cpu_usage_percentage", "Porcentaje de tiempo de CPU por nucleo y modo", 2,
+                                      (const char*[]){"cpu", "mode"});
     if (cpu_usage_metric == NULL)
     {
         fprintf(stderr, "Error al crear la metrica de uso de CPU\n");
@@ -306,11 +538,15 @@ void init_metrics()
         fprintf(stderr, "Error al crear la metrica de cantidad de procesos en ejecucion\n");
     }
 
-    // Creamos la metrica para la velocidad de descarga
-    downloaded_bytes_metric = prom_gauge_new("downloaded_bytes_per_second", "Bytes descargados por segundo", 0, NULL);
-    if (downloaded_bytes_metric == NULL)
+    // Creamos las metricas de red por interfaz
+    for (int counter = 0; counter < NET_COUNTER_COUNT; counter++)
     {
-        fprintf(stderr, "Error al crear la metrica de velocidad de descarga\n");
+        network_metrics[counter] = prom_gauge_new(network_metric_names[counter], network_metric_help[counter], 1,
+                                                  (const char*[]){"interface"});
+        if (network_metrics[counter] == NULL)
+        {
+            fprintf(stderr, "Error al crear la metrica %s\n", network_metric_names[counter]);
+        }
     }
 
     // Creamos la metrica para la potencia entregada por la bateria
@@ -321,11 +557,88 @@ void init_metrics()
         fprintf(stderr, "Error al crear la metrica de potencia entregada por la bateria\n");
     }
 
+    // Creamos las metricas para los eventos de procesos
+    process_forks_metric = prom_counter_new("process_forks_total", "Procesos creados", 0, NULL);
+    if (process_forks_metric == NULL)
+    {
+        fprintf(stderr, "Error al crear la metrica de procesos creados\n");
+    }
+
+    process_execs_metric = prom_counter_new("process_execs_total", "Llamadas a exec", 0, NULL);
+    if (process_execs_metric == NULL)
+    {
+        fprintf(stderr, "Error al crear la metrica de llamadas a exec\n");
+    }
+
+    process_exits_metric = prom_counter_new("process_exits_total", "Procesos terminados", 0, NULL);
+    if (process_exits_metric == NULL)
+    {
+        fprintf(stderr, "Error al crear la metrica de procesos terminados\n");
+    }
+
+    // Creamos la metrica para los plazos perdidos por los coleccionistas
+    missed_deadlines_metric = prom_counter_new("collector_missed_deadlines_total",
+                                               "Plazos de recoleccion perdidos por cada coleccionista", 1,
+                                               (const char*[]){"collector"});
+    if (missed_deadlines_metric == NULL)
+    {
+        fprintf(stderr, "Error al crear la metrica de plazos perdidos\n");
+    }
+
+    // Creamos la metrica para las ejecuciones que superaron su tiempo maximo
+    collector_timeouts_metric =
+        prom_counter_new("collector_timeouts_total", "Ejecuciones de cada coleccionista que superaron su tiempo maximo",
+                         1, (const char*[]){"collector"});
+    if (collector_timeouts_metric == NULL)
+    {
+        fprintf(stderr, "Error al crear la metrica de ejecuciones vencidas\n");
+    }
+
+    // Creamos el histograma de duracion de los coleccionistas: disperso, con 4 buckets por potencia de 2 (error
+    // relativo < 19%) que solo se crean al observar un valor en su rango
+    collector_duration_metric =
+        prom_histogram_new_sparse("collector_duration_seconds",
+                                  "Duracion de cada ejecucion de un coleccionista en segundos", 2, 1,
+                                  (const char*[]){"collector"});
+    if (collector_duration_metric == NULL)
+    {
+        fprintf(stderr, "Error al crear la metrica de duracion de los coleccionistas\n");
+    }
+
+    // Creamos el resumen con la mediana, p99 y p999 de la duracion de los coleccionistas en los ultimos 10 minutos
+    prom_summary_opts_t latency_opts = {3, (const double[]){0.5, 0.99, 0.999}, (const double[]){0.05, 0.001, 0.0001},
+                                        600.0, 5};
+    collector_latency_metric =
+        prom_summary_new("collector_latency_seconds", "Cuantiles de la duracion de cada ejecucion de un coleccionista",
+                         &latency_opts, 1, (const char*[]){"collector"});
+    if (collector_latency_metric == NULL)
+    {
+        fprintf(stderr, "Error al crear la metrica de cuantiles de duracion de los coleccionistas\n");
+    }
+
     // Registramos las metricas en el registro de coleccionistas de Prometheus
     register_metrics();
+
+    // Resolvemos los handles de las metricas sin etiquetas
+    memory_usage_handle = prom_gauge_handle(memory_usage_metric, NULL);
+    disk_usage_handle = prom_gauge_handle(disk_usage_metric, NULL);
+    battery_percentage_handle = prom_gauge_handle(battery_percentage_metric, NULL);
+    cpu_temperature_handle = prom_gauge_handle(cpu_temperature_metric, NULL);
+    total_processes_handle = prom_gauge_handle(total_processes_metric, NULL);
+    suspended_processes_handle = prom_gauge_handle(suspended_processes_metric, NULL);
+    ready_processes_handle = prom_gauge_handle(ready_processes_metric, NULL);
+    uninterruptible_processes_handle = prom_gauge_handle(uninterruptible_processes_metric, NULL);
+    stopped_processes_handle = prom_gauge_handle(stopped_processes_metric, NULL);
+    zombie_processes_handle = prom_gauge_handle(zombie_processes_metric, NULL);
+    running_processes_handle = prom_gauge_handle(running_processes_metric, NULL);
+    battery_power_handle = prom_gauge_handle(battery_power_metric, NULL);
+    process_forks_handle = prom_counter_handle(process_forks_metric, NULL);
+    process_execs_handle = prom_counter_handle(process_execs_metric, NULL);
+    process_exits_handle = prom_counter_handle(process_exits_metric, NULL);
 }
 
-void destroy_mutex()
+void destroy_metrics()
 {
-    pthread_mutex_destroy(&lock);
+    proc_events_stop();
+    process_scan_destroy();
 }
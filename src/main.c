@@ -4,7 +4,6 @@
  */
 
 #include "expose_metrics.h"
-#include <stdbool.h>
 
 /**
  * @brief Programa principal.
@@ -15,7 +14,7 @@
  */
 int main(int argc, char* argv[])
 {
-    // Inicializamos las metricas y el mutex
+    // Inicializamos las metricas
     init_metrics();
 
     // Creamos un hilo para exponer las metricas via HTTP
@@ -26,19 +25,33 @@ int main(int argc, char* argv[])
         return EXIT_FAILURE;
     }
 
-    // Bucle principal para actualizar las metricas cada segundo
-    while (true)
+    // Los coleccionistas que leen /sys comparten un limite de hilos para que una lectura colgada no tome el pool
+    int sysfs = scheduler_add_group(SYSFS_MAX_WORKERS);
+
+    // Registramos cada coleccionista con su propio intervalo y tiempo maximo
+    scheduler_register("cpu", update_cpu_gauge, CPU_INTERVAL_MS, 0, SCHEDULER_NO_GROUP);
+    scheduler_register("memory", update_memory_gauge, MEMORY_INTERVAL_MS, 0, SCHEDULER_NO_GROUP);
+    scheduler_register("disk", update_disk_gauge, DISK_INTERVAL_MS, 0, SCHEDULER_NO_GROUP);
+    scheduler_register("battery", update_battery_gauge, BATTERY_INTERVAL_MS, SYSFS_TIMEOUT_MS, sysfs);
+    scheduler_register("cpu_temperature", update_cpu_temperature_gauge, CPU_TEMPERATURE_INTERVAL_MS, SYSFS_TIMEOUT_MS,
+                       sysfs);
+    scheduler_register("process_states", update_process_states_gauge, PROCESS_STATES_INTERVAL_MS, 0,
+                       SCHEDULER_NO_GROUP);
+    scheduler_register("process_events", update_process_events_counters, PROCESS_EVENTS_INTERVAL_MS, 0,
+                       SCHEDULER_NO_GROUP);
+    scheduler_register("network", update_network_gauges, NETWORK_INTERVAL_MS, 0, SCHEDULER_NO_GROUP);
+    scheduler_register("battery_power", update_battery_power_gauge, BATTERY_POWER_INTERVAL_MS, SYSFS_TIMEOUT_MS,
+                       sysfs);
+    scheduler_register("scheduler", update_scheduler_counters, SCHEDULER_INTERVAL_MS, 0, SCHEDULER_NO_GROUP);
+    scheduler_set_observer(observe_collector_duration);
+
+    // Un despachador encola los coleccionistas vencidos y un pool de hilos los ejecuta
+    if (scheduler_start(COLLECTOR_WORKERS) != 0)
     {
-        update_cpu_gauge();
-        update_memory_gauge();
-        update_disk_gauge();
-        update_battery_gauge();
-        update_cpu_temperature_gauge();
-        update_process_states_gauge();
-        update_downloaded_bytes();
-        update_battery_power_gauge();
-        sleep(SLEEP_TIME);
+        fprintf(stderr, "Error al iniciar el planificador de coleccionistas\n");
+        return EXIT_FAILURE;
     }
+    scheduler_wait();
 
     return EXIT_SUCCESS;
 }
@@ -1,115 +1,147 @@
+#define _GNU_SOURCE
 #include "metrics.h"
+#include "proc_events.h"
+#include "process_scan.h"
+#include "procfs_parse.h"
+#include "procfs_source.h"
+
+/** Fuente persistente para /proc/meminfo */
+static procfs_source_t meminfo_source = PROCFS_SOURCE_INIT("/proc/meminfo");
+
+/** Fuente persistente para /proc/stat */
+static procfs_source_t stat_source = PROCFS_SOURCE_INIT("/proc/stat");
+
+/** Instantaneas alternadas de los tiempos de CPU de /proc/stat */
+static procfs_cpu_snapshot_t cpu_snapshots[2];
+
+/** Indice de la instantanea con la ultima lectura */
+static int cpu_snapshot_current;
+
+/**
+ * @brief Lectura de /proc/net/dev y el momento en que se tomo.
+ */
+typedef struct
+{
+    procfs_net_dev_t net_dev; /**< Contadores de todas las interfaces */
+    struct timespec time;     /**< Momento de la lectura segun CLOCK_MONOTONIC */
+} net_dev_snapshot_t;
+
+/** Instantaneas alternadas de /proc/net/dev */
+static net_dev_snapshot_t net_dev_snapshots[2];
+
+/** Indice de la instantanea con la ultima lectura */
+static int net_dev_snapshot_current;
+
+/** Fuente persistente para /proc/net/dev */
+static procfs_source_t net_dev_source = PROCFS_SOURCE_INIT("/proc/net/dev");
+
+/** Fuente persistente para la capacidad de la bateria */
+static procfs_source_t battery_capacity_source = PROCFS_SOURCE_INIT("/sys/class/power_supply/BAT0/capacity");
+
+/** Fuente persistente para la potencia de la bateria */
+static procfs_source_t battery_power_source = PROCFS_SOURCE_INIT("/sys/class/power_supply/BAT0/power_now");
+
+/** Fuente persistente para la temperatura de la CPU */
+static procfs_source_t cpu_temperature_source = PROCFS_SOURCE_INIT("/sys/class/thermal/thermal_zone1/temp");
 
 double get_memory_usage()
 {
-    FILE* fp;
-    char buffer[BUFFER_SIZE];
-    unsigned long long total_mem = 0, free_mem = 0;
+    procfs_meminfo_t meminfo;
 
-    /* Abrir el archivo /proc/meminfo */
-    fp = fopen("/proc/meminfo", "r");
-    if (fp == NULL)
+    /* Leer el contenido actual de /proc/meminfo */
+    if (procfs_source_read(&meminfo_source) < 0)
     {
-        perror("Error al abrir /proc/meminfo");
+        perror("Error al leer /proc/meminfo");
         return -1.0;
     }
 
     /* Leer los valores de memoria total y disponible */
-    while (fgets(buffer, sizeof(buffer), fp) != NULL)
-    {
-        if (sscanf(buffer, "MemTotal: %llu kB", &total_mem) == 1)
-        {
-            continue; /* MemTotal encontrado */
-        }
-        if (sscanf(buffer, "MemAvailable: %llu kB", &free_mem) == 1)
-        {
-            break; /* MemAvailable encontrado, podemos dejar de leer */
-        }
-    }
-
-    fclose(fp);
-
-    /* Verificar si se encontraron ambos valores */
-    if (total_mem == 0 || free_mem == 0)
+    if (procfs_parse_meminfo(meminfo_source.buffer, meminfo_source.length, &meminfo) != 0)
     {
         fprintf(stderr, "Error al leer la informacion de memoria desde /proc/meminfo\n");
         return -1.0;
     }
 
     /* Calcular el porcentaje de uso de memoria */
-    double used_mem = total_mem - free_mem;
-    double mem_usage_percent = (used_mem / total_mem) * 100.0;
+    double used_mem = meminfo.mem_total - meminfo.mem_available;
+    double mem_usage_percent = (used_mem / meminfo.mem_total) * 100.0;
 
     return mem_usage_percent;
 }
 
-double get_cpu_usage()
+int get_cpu_usage(cpu_usage_t* usage)
 {
-    static unsigned long long prev_user = 0, prev_nice = 0, prev_system = 0, prev_idle = 0, prev_iowait = 0,
-                              prev_irq = 0, prev_softirq = 0, prev_steal = 0;
-    unsigned long long user, nice, system, idle, iowait, irq, softirq, steal;
-    unsigned long long totald, idled;
-    double cpu_usage_percent;
-
-    /* Abrir el archivo /proc/stat */
-    FILE* fp = fopen("/proc/stat", "r");
-    if (fp == NULL)
-    {
-        perror("Error al abrir /proc/stat");
-        return -1.0;
-    }
+    static double scale[PROCFS_CPU_MAX_CPUS + 1];
 
-    char buffer[BUFFER_SIZE * 4];
-    if (fgets(buffer, sizeof(buffer), fp) == NULL)
+    /* Leer el contenido actual de /proc/stat */
+    if (procfs_source_read(&stat_source) < 0)
     {
         perror("Error al leer /proc/stat");
-        fclose(fp);
-        return -1.0;
+        return -1;
     }
-    fclose(fp);
 
-    /* Analizar los valores de tiempo de CPU */
-    int ret = sscanf(buffer, "cpu  %llu %llu %llu %llu %llu %llu %llu %llu", &user, &nice, &system, &idle, &iowait,
-                     &irq, &softirq, &steal);
-    if (ret < 8)
+    /* Analizar los tiempos de cada CPU sobre la instantanea que no es la actual */
+    const procfs_cpu_snapshot_t* prev = &cpu_snapshots[cpu_snapshot_current];
+    procfs_cpu_snapshot_t* curr = &cpu_snapshots[cpu_snapshot_current ^ 1];
+    if (procfs_parse_cpus(stat_source.buffer, stat_source.length, curr) != 0)
     {
         fprintf(stderr, "Error al parsear /proc/stat\n");
-        return -1.0;
+        return -1;
+    }
+    cpu_snapshot_current ^= 1;
+
+    /*
+     * En la primera lectura, o si cambiaron las CPU en linea, las entradas no se corresponden con las anteriores:
+     * la lectura nueva queda como referencia y en este ciclo no hay datos
+     */
+    size_t count = curr->count;
+    if (prev->count != count || memcmp(prev->id, curr->id, count * sizeof(int)) != 0)
+    {
+        usage->count = 0;
+        return 0;
     }
 
-    /* Calcular las diferencias entre las lecturas actuales y anteriores */
-    unsigned long long prev_idle_total = prev_idle + prev_iowait;
-    unsigned long long idle_total = idle + iowait;
-
-    unsigned long long prev_non_idle = prev_user + prev_nice + prev_system + prev_irq + prev_softirq + prev_steal;
-    unsigned long long non_idle = user + nice + system + irq + softirq + steal;
-
-    unsigned long long prev_total = prev_idle_total + prev_non_idle;
-    unsigned long long total = idle_total + non_idle;
-
-    totald = total - prev_total;
-    idled = idle_total - prev_idle_total;
+    /* Diferencias por modo y total por CPU; algunos contadores (iowait) pueden retroceder */
+    for (size_t i = 0; i < count; i++)
+    {
+        scale[i] = 0.0;
+    }
+    for (int mode = 0; mode < PROCFS_CPU_MODE_COUNT; mode++)
+    {
+        const unsigned long long* restrict now = curr->jiffies[mode];
+        const unsigned long long* restrict before = prev->jiffies[mode];
+        double* restrict delta = usage->percentage[mode];
+        for (size_t i = 0; i < count; i++)
+        {
+            double d = (double)(long long)(now[i] - before[i]);
+            delta[i] = d > 0.0 ? d : 0.0;
+            scale[i] += delta[i];
+        }
+    }
 
-    if (totald == 0)
+    if (scale[0] == 0.0)
     {
         fprintf(stderr, "Totald es cero, no se puede calcular el uso de CPU!\n");
-        return -1.0;
+        return -1;
     }
 
-    /* Calcular el porcentaje de uso de CPU */
-    cpu_usage_percent = ((double)(totald - idled) / totald) * 100.0;
-
-    /* Actualizar los valores anteriores para la siguiente lectura */
-    prev_user = user;
-    prev_nice = nice;
-    prev_system = system;
-    prev_idle = idle;
-    prev_iowait = iowait;
-    prev_irq = irq;
-    prev_softirq = softirq;
-    prev_steal = steal;
+    /* Calcular los porcentajes */
+    for (size_t i = 0; i < count; i++)
+    {
+        scale[i] = scale[i] > 0.0 ? 100.0 / scale[i] : 0.0;
+    }
+    for (int mode = 0; mode < PROCFS_CPU_MODE_COUNT; mode++)
+    {
+        double* restrict percentage = usage->percentage[mode];
+        for (size_t i = 0; i < count; i++)
+        {
+            percentage[i] *= scale[i];
+        }
+    }
 
-    return cpu_usage_percent;
+    usage->count = count;
+    memcpy(usage->id, curr->id, count * sizeof(int));
+    return 0;
 }
 
 double get_disk_usage()
@@ -131,44 +163,37 @@ double get_disk_usage()
 
 double get_battery_percentage()
 {
-    FILE* fp = fopen("/sys/class/power_supply/BAT0/capacity", "r");
-    if (fp == NULL)
+    if (procfs_source_read(&battery_capacity_source) < 0)
     {
-        perror("Error al abrir el archivo de capacidad de la bateria");
+        perror("Error al leer el archivo de capacidad de la bateria");
         return -1.0;
     }
 
     int battery_percentage;
-    if (fscanf(fp, "%d", &battery_percentage) != 1)
+    if (sscanf(battery_capacity_source.buffer, "%d", &battery_percentage) != 1)
     {
-        perror("Error al leer el porcentaje de bateria");
-        fclose(fp);
+        fprintf(stderr, "Error al leer el porcentaje de bateria\n");
         return -1.0;
     }
 
-    fclose(fp);
     return (double)battery_percentage;
 }
 
 double get_cpu_temperature()
 {
-    FILE* fp = fopen("/sys/class/thermal/thermal_zone1/temp", "r");
-    if (fp == NULL)
+    if (procfs_source_read(&cpu_temperature_source) < 0)
     {
-        perror("Error al abrir el archivo de temperatura de la CPU");
+        perror("Error al leer el archivo de temperatura de la CPU");
         return -1.0;
     }
 
     int temperature_millidegrees;
-    if (fscanf(fp, "%d", &temperature_millidegrees) != 1)
+    if (sscanf(cpu_temperature_source.buffer, "%d", &temperature_millidegrees) != 1)
     {
-        perror("Error al leer la temperatura de la CPU");
-        fclose(fp);
+        fprintf(stderr, "Error al leer la temperatura de la CPU\n");
         return -1.0;
     }
 
-    fclose(fp);
-
     /* Convertimos la temperatura de miligrados Celsius a grados Celsius */
     return temperature_millidegrees / 1000;
 }
@@ -176,131 +201,165 @@ double get_cpu_temperature()
 void get_process_states(int* total, int* suspended, int* ready, int* uninterruptible, int* stopped, int* zombie,
                         int* running)
 {
-    DIR* proc_dir = opendir("/proc");
-    if (proc_dir == NULL)
-    {
-        perror("Error al abrir /proc");
-        return;
-    }
-
-    struct dirent* entry;
-    *total = 0;
-    *suspended = 0;
-    *ready = 0;
-    *uninterruptible = 0; /* Uninterrumpible sleep */
-    *stopped = 0;
-    *zombie = 0;
-    *running = 0;
+    static process_states_t states;
+    static unsigned int ticks_since_reconcile = PROC_EVENTS_RECONCILE_INTERVAL;
 
-    while ((entry = readdir(proc_dir)) != NULL)
+    /* Con el proc connector activo el total se mantiene con los eventos y /proc solo se recorre para reconciliar */
+    int events = proc_events_running();
+    if (!events || ticks_since_reconcile >= PROC_EVENTS_RECONCILE_INTERVAL || proc_events_needs_reconcile())
     {
-        if (isdigit(entry->d_name[0]))
+        if (process_scan_run(&states) != 0)
+        {
+            fprintf(stderr, "Error al recorrer los procesos de /proc\n");
+        }
+        else if (events)
         {
-            char path[BUFFER_SIZE];
-            snprintf(path, sizeof(path), "/proc/%s/stat", entry->d_name);
-
-            FILE* fp = fopen(path, "r");
-            if (fp == NULL)
-            {
-                continue;
-            }
-
-            char state;
-            if (fscanf(fp, "%*d %*s %c", &state) == 1)
-            {
-                (*total)++;
-                switch (state)
-                {
-                case 'S':
-                    (*suspended)++;
-                    break;
-                case 'R':
-                    (*ready)++;
-                    break;
-                case 'D':
-                    (*uninterruptible)++;
-                    break;
-                case 'T':
-                    (*stopped)++;
-                    break;
-                case 'Z':
-                    (*zombie)++;
-                    break;
-                }
-            }
-
-            fclose(fp);
+            proc_events_reconcile(states.total);
         }
+        ticks_since_reconcile = 0;
     }
+    else
+    {
+        /*
+         * Los eventos solo dicen cuantos procesos hay, no en que estado estan: el total es el incremental y cada
+         * estado, incluido running, queda en el valor de la ultima reconciliacion
+         */
+        states.total = (int)proc_events_process_count();
+    }
+    ticks_since_reconcile++;
+
+    *total = states.total;
+    *suspended = states.suspended;
+    *ready = states.ready;
+    *uninterruptible = states.uninterruptible; /* Uninterrumpible sleep */
+    *stopped = states.stopped;
+    *zombie = states.zombie;
+    *running = states.running;
+}
 
-    closedir(proc_dir);
-
-    *running = *total - *suspended - *ready - *uninterruptible - *stopped - *zombie;
+/**
+ * @brief Copia los contadores de una interfaz en un arreglo indexado por net_counter_t.
+ *
+ * @param interface Contadores de la interfaz.
+ * @param values Arreglo donde se copian los contadores.
+ */
+static void net_dev_counters(const procfs_net_dev_interface_t* interface, unsigned long long values[NET_COUNTER_COUNT])
+{
+    values[NET_RX_BYTES] = interface->rx_bytes;
+    values[NET_RX_PACKETS] = interface->rx_packets;
+    values[NET_RX_ERRORS] = interface->rx_errors;
+    values[NET_RX_DROPS] = interface->rx_drops;
+    values[NET_TX_BYTES] = interface->tx_bytes;
+    values[NET_TX_PACKETS] = interface->tx_packets;
+    values[NET_TX_ERRORS] = interface->tx_errors;
+    values[NET_TX_DROPS] = interface->tx_drops;
 }
 
-unsigned long get_bytes_received(const char* interface)
+/**
+ * @brief Busca una interfaz por nombre en una lectura de /proc/net/dev.
+ *
+ * Primero prueba en la misma posicion, que es el caso habitual.
+ *
+ * @param net_dev Lectura donde se busca.
+ * @param name Nombre de la interfaz.
+ * @param hint Posicion donde se espera encontrarla.
+ * @return Contadores de la interfaz, o NULL si no esta.
+ */
+static const procfs_net_dev_interface_t* net_dev_find(const procfs_net_dev_t* net_dev, const char* name, size_t hint)
 {
-    FILE* fp = fopen("/proc/net/dev", "r");
-    if (fp == NULL)
+    if (hint < net_dev->count && strcmp(net_dev->interfaces[hint].name, name) == 0)
     {
-        perror("Error al abrir /proc/net/dev");
-        return -1;
+        return &net_dev->interfaces[hint];
     }
-    char buffer[BUFFER_SIZE];
-    unsigned long bytes_received = 0;
-    // Saltar las dos primeras lineas de encabezado
-    fgets(buffer, sizeof(buffer), fp);
-    fgets(buffer, sizeof(buffer), fp);
-    // Buscar la interfaz deseada
-    while (fgets(buffer, sizeof(buffer), fp) != NULL)
+    for (size_t i = 0; i < net_dev->count; i++)
     {
-        if (strstr(buffer, interface) != NULL)
+        if (strcmp(net_dev->interfaces[i].name, name) == 0)
         {
-            // Parsear la linea para obtener los bytes recibidos (el primer campo despues del nombre de la interfaz)
-            sscanf(buffer, "%*s %lu", &bytes_received);
-            break;
+            return &net_dev->interfaces[i];
         }
     }
-    fclose(fp);
-    return bytes_received;
+    return NULL;
 }
 
-double get_downloaded_bytes(const char* interface, int interval)
+int get_network_rates(network_rates_t* rates)
 {
-    unsigned long bytes1 = get_bytes_received(interface);
-    sleep(interval);
-    unsigned long bytes2 = get_bytes_received(interface);
+    if (procfs_source_read(&net_dev_source) < 0)
+    {
+        perror("Error al leer /proc/net/dev");
+        return -1;
+    }
 
-    if (bytes1 == (unsigned long)-1 || bytes2 == (unsigned long)-1)
+    /* La lectura nueva se guarda en la instantanea que no es la actual */
+    const net_dev_snapshot_t* prev = &net_dev_snapshots[net_dev_snapshot_current];
+    net_dev_snapshot_t* curr = &net_dev_snapshots[net_dev_snapshot_current ^ 1];
+    if (procfs_parse_net_dev(net_dev_source.buffer, net_dev_source.length, &curr->net_dev) != 0)
     {
-        return -1.0; /* Error al obtener los bytes descargados */
+        fprintf(stderr, "Error al parsear /proc/net/dev\n");
+        return -1;
     }
+    clock_gettime(CLOCK_MONOTONIC, &curr->time);
+    net_dev_snapshot_current ^= 1;
 
-    return (double)(bytes2 - bytes1) / interval; /* Bytes descargados por segundo */
+    rates->count = 0;
+    if (prev->time.tv_sec == 0 && prev->time.tv_nsec == 0)
+    {
+        return 0; /* Primera lectura */
+    }
+
+    double elapsed =
+        (double)(curr->time.tv_sec - prev->time.tv_sec) + (double)(curr->time.tv_nsec - prev->time.tv_nsec) / 1e9;
+    if (elapsed <= 0.0)
+    {
+        return 0;
+    }
+
+    for (size_t i = 0; i < curr->net_dev.count; i++)
+    {
+        const procfs_net_dev_interface_t* interface = &curr->net_dev.interfaces[i];
+        const procfs_net_dev_interface_t* before = net_dev_find(&prev->net_dev, interface->name, i);
+        unsigned long long now_values[NET_COUNTER_COUNT];
+        unsigned long long before_values[NET_COUNTER_COUNT];
+
+        net_dev_counters(interface, now_values);
+        if (before != NULL)
+        {
+            net_dev_counters(before, before_values);
+        }
+        else
+        {
+            memcpy(before_values, now_values, sizeof(now_values));
+        }
+
+        size_t index = rates->count++;
+        memcpy(rates->name[index], interface->name, PROCFS_NET_DEV_NAME_SIZE);
+        for (int counter = 0; counter < NET_COUNTER_COUNT; counter++)
+        {
+            /* Si el contador retrocedio (la interfaz se recreo) la tasa es 0 */
+            unsigned long long delta =
+                now_values[counter] >= before_values[counter] ? now_values[counter] - before_values[counter] : 0;
+            rates->rate[counter][index] = (double)delta / elapsed;
+        }
+    }
+
+    return 0;
 }
 
 double get_battery_power_consumption()
 {
-    FILE* fp;
     int power;
 
-    /* Abrir el archivo que contiene la potencia en microvatios */
-    fp = fopen("/sys/class/power_supply/BAT0/power_now", "r");
-    if (fp == NULL)
+    /* Leer la potencia en microvatios */
+    if (procfs_source_read(&battery_power_source) < 0)
     {
-        perror("Error al abrir el archivo de potencia");
+        perror("Error al leer el archivo de potencia");
         return -1.0;
     }
 
-    /* Leer la potencia en microvatios */
-    if (fscanf(fp, "%d", &power) != 1)
+    if (sscanf(battery_power_source.buffer, "%d", &power) != 1)
     {
-        perror("Error al leer la potencia");
-        fclose(fp);
+        fprintf(stderr, "Error al leer la potencia\n");
         return -1.0;
     }
 
-    fclose(fp);
-
     return (double)power / 1e6; /* Convertir microvatios a vatios */
 }
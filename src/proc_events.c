@@ -0,0 +1,255 @@
+#define _GNU_SOURCE
+#include "proc_events.h"
+#include <errno.h>
+#include <linux/cn_proc.h>
+#include <linux/connector.h>
+#include <linux/netlink.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+/**
+ * @brief Tamaño del buffer de recepcion de mensajes netlink.
+ */
+#define PROC_EVENTS_BUFFER_SIZE 8192
+
+/**
+ * @brief Tiempo maximo bloqueado en recv(), en segundos, antes de revisar si hay que detenerse.
+ */
+#define PROC_EVENTS_RECV_TIMEOUT 1
+
+/**
+ * @brief Estado global del colector.
+ */
+static struct
+{
+    int fd;               /**< Socket netlink, o -1 */
+    pthread_t thread;     /**< Hilo que recibe los eventos */
+    atomic_int running;   /**< Indica si el hilo esta en ejecucion */
+    atomic_int stopping;  /**< Indica al hilo que debe terminar */
+    atomic_int overrun;   /**< Indica que se perdieron eventos */
+    atomic_ullong forks;  /**< Procesos creados */
+    atomic_ullong execs;  /**< Llamadas a exec */
+    atomic_ullong exits;  /**< Procesos terminados */
+    atomic_long baseline; /**< Procesos vivos en la reconciliacion menos forks - exits */
+} events = {.fd = -1};
+
+/**
+ * @brief Envia la operacion de suscripcion o desuscripcion al proc connector.
+ *
+ * @param op PROC_CN_MCAST_LISTEN o PROC_CN_MCAST_IGNORE.
+ * @return 0 en caso de exito, -1 en caso de error.
+ */
+static int proc_events_send_op(enum proc_cn_mcast_op op)
+{
+    char buffer[NLMSG_SPACE(sizeof(struct cn_msg) + sizeof(enum proc_cn_mcast_op))]
+        __attribute__((aligned(NLMSG_ALIGNTO)));
+    memset(buffer, 0, sizeof(buffer));
+
+    struct nlmsghdr* header = (struct nlmsghdr*)buffer;
+    header->nlmsg_len = NLMSG_LENGTH(sizeof(struct cn_msg) + sizeof(enum proc_cn_mcast_op));
+    header->nlmsg_type = NLMSG_DONE;
+    header->nlmsg_pid = (__u32)getpid();
+
+    struct cn_msg* message = NLMSG_DATA(header);
+    message->id.idx = CN_IDX_PROC;
+    message->id.val = CN_VAL_PROC;
+    message->len = sizeof(enum proc_cn_mcast_op);
+    memcpy(message->data, &op, sizeof(op));
+
+    return send(events.fd, buffer, header->nlmsg_len, 0) < 0 ? -1 : 0;
+}
+
+/**
+ * @brief Procesa los mensajes netlink recibidos y actualiza los contadores.
+ *
+ * @param buffer Mensajes recibidos.
+ * @param length Cantidad de bytes recibidos.
+ * @return 0 si hubo eventos, -1 si el kernel rechazo la suscripcion.
+ */
+static int proc_events_handle(const char* buffer, size_t length)
+{
+    int len = (int)length;
+
+    for (const struct nlmsghdr* header = (const struct nlmsghdr*)buffer; NLMSG_OK(header, len);
+         header = NLMSG_NEXT(header, len))
+    {
+        if (header->nlmsg_type == NLMSG_NOOP || header->nlmsg_type == NLMSG_ERROR)
+        {
+            continue;
+        }
+
+        const struct cn_msg* message = NLMSG_DATA(header);
+        if (message->id.idx != CN_IDX_PROC || message->id.val != CN_VAL_PROC)
+        {
+            continue;
+        }
+
+        const struct proc_event* event = (const struct proc_event*)message->data;
+        switch (event->what)
+        {
+        case PROC_EVENT_NONE:
+            /* Respuesta a la suscripcion */
+            if (event->event_data.ack.err != 0)
+            {
+                return -1;
+            }
+            break;
+        case PROC_EVENT_FORK:
+            /* Los hilos nuevos tambien generan FORK: solo se cuentan los lideres de grupo */
+            if (event->event_data.fork.child_pid == event->event_data.fork.child_tgid)
+            {
+                atomic_fetch_add_explicit(&events.forks, 1, memory_order_relaxed);
+            }
+            break;
+        case PROC_EVENT_EXEC:
+            atomic_fetch_add_explicit(&events.execs, 1, memory_order_relaxed);
+            break;
+        case PROC_EVENT_EXIT:
+            if (event->event_data.exit.process_pid == event->event_data.exit.process_tgid)
+            {
+                atomic_fetch_add_explicit(&events.exits, 1, memory_order_relaxed);
+            }
+            break;
+        default:
+            break;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Funcion del hilo que recibe los eventos.
+ *
+ * @param arg Argumento no utilizado.
+ * @return NULL
+ */
+static void* proc_events_main(void* arg)
+{
+    (void)arg;
+    char buffer[PROC_EVENTS_BUFFER_SIZE] __attribute__((aligned(NLMSG_ALIGNTO)));
+
+    while (!atomic_load(&events.stopping))
+    {
+        ssize_t n = recv(events.fd, buffer, sizeof(buffer), 0);
+        if (n < 0)
+        {
+            if (errno == ENOBUFS)
+            {
+                /* El kernel descarto eventos: la cuenta incremental ya no es confiable */
+                atomic_store(&events.overrun, 1);
+            }
+            else if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+            {
+                perror("Error al recibir eventos de procesos");
+                break;
+            }
+            continue;
+        }
+        proc_events_handle(buffer, (size_t)n);
+    }
+
+    atomic_store(&events.running, 0);
+    return NULL;
+}
+
+int proc_events_start(void)
+{
+    if (atomic_load(&events.running))
+    {
+        return 0;
+    }
+
+    events.fd = socket(PF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC, NETLINK_CONNECTOR);
+    if (events.fd < 0)
+    {
+        return -1;
+    }
+
+    struct sockaddr_nl address;
+    memset(&address, 0, sizeof(address));
+    address.nl_family = AF_NETLINK;
+    address.nl_groups = CN_IDX_PROC;
+    address.nl_pid = 0; /* Lo asigna el kernel */
+
+    struct timeval timeout = {.tv_sec = PROC_EVENTS_RECV_TIMEOUT, .tv_usec = 0};
+    char buffer[PROC_EVENTS_BUFFER_SIZE] __attribute__((aligned(NLMSG_ALIGNTO)));
+    ssize_t n = -1;
+
+    if (bind(events.fd, (struct sockaddr*)&address, sizeof(address)) == 0 &&
+        setsockopt(events.fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)) == 0 &&
+        proc_events_send_op(PROC_CN_MCAST_LISTEN) == 0)
+    {
+        /* Sin permisos el kernel no envia nada: se espera la confirmacion o el primer evento */
+        n = recv(events.fd, buffer, sizeof(buffer), 0);
+    }
+    if (n <= 0 || proc_events_handle(buffer, (size_t)n) != 0)
+    {
+        close(events.fd);
+        events.fd = -1;
+        return -1;
+    }
+
+    atomic_store(&events.stopping, 0);
+    atomic_store(&events.overrun, 0);
+    atomic_store(&events.running, 1);
+    if (pthread_create(&events.thread, NULL, proc_events_main, NULL) != 0)
+    {
+        atomic_store(&events.running, 0);
+        close(events.fd);
+        events.fd = -1;
+        return -1;
+    }
+    return 0;
+}
+
+int proc_events_running(void)
+{
+    return atomic_load(&events.running);
+}
+
+void proc_events_get_counters(proc_events_counters_t* counters)
+{
+    counters->forks = atomic_load_explicit(&events.forks, memory_order_relaxed);
+    counters->execs = atomic_load_explicit(&events.execs, memory_order_relaxed);
+    counters->exits = atomic_load_explicit(&events.exits, memory_order_relaxed);
+}
+
+long proc_events_process_count(void)
+{
+    long forks = (long)atomic_load(&events.forks);
+    long exits = (long)atomic_load(&events.exits);
+    long count = atomic_load(&events.baseline) + forks - exits;
+    return count > 0 ? count : 0;
+}
+
+void proc_events_reconcile(long total)
+{
+    long forks = (long)atomic_load(&events.forks);
+    long exits = (long)atomic_load(&events.exits);
+    atomic_store(&events.baseline, total - (forks - exits));
+    atomic_store(&events.overrun, 0);
+}
+
+int proc_events_needs_reconcile(void)
+{
+    return atomic_load(&events.overrun);
+}
+
+void proc_events_stop(void)
+{
+    if (events.fd < 0)
+    {
+        return;
+    }
+
+    proc_events_send_op(PROC_CN_MCAST_IGNORE);
+    atomic_store(&events.stopping, 1);
+    pthread_join(events.thread, NULL);
+    close(events.fd);
+    events.fd = -1;
+}
@@ -0,0 +1,613 @@
+#define _GNU_SOURCE
+#include "process_scan.h"
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/**
+ * @brief Tamaño del buffer donde se lee /proc/<pid>/stat.
+ *
+ * Alcanza para los campos que se usan (hasta starttime, el 22).
+ */
+#define PROCESS_SCAN_STAT_SIZE 512
+
+/**
+ * @brief Capacidad inicial de la tabla de procesos (potencia de 2).
+ */
+#define PROCESS_TABLE_INITIAL_CAPACITY 1024
+
+/**
+ * @brief Hilo del pool y sus contadores parciales.
+ */
+typedef struct
+{
+    pthread_t thread;        /**< Hilo del trabajador */
+    size_t index;            /**< Indice de la porcion que procesa */
+    process_states_t states; /**< Contadores de la ultima pasada */
+} process_scan_worker_t;
+
+/**
+ * @brief Estado global del escaner.
+ */
+static struct
+{
+    int initialized;                /**< Indica si el escaner esta listo */
+    DIR* proc_dir;                  /**< Directorio /proc abierto una sola vez */
+    int proc_fd;                    /**< Descriptor de /proc para openat() */
+    pid_t* pids;                    /**< PID listados en la pasada actual */
+    size_t pid_count;               /**< Cantidad de PID listados */
+    size_t pid_capacity;            /**< Capacidad del arreglo de PID */
+    process_entry_t* table;         /**< Tabla de procesos con direccionamiento abierto */
+    size_t table_capacity;          /**< Capacidad de la tabla (potencia de 2) */
+    size_t table_size;              /**< Entradas ocupadas */
+    process_entry_t** work;         /**< Entradas a procesar en la pasada actual */
+    atomic_size_t cached_fds;       /**< Descriptores de stat abiertos */
+    process_scan_worker_t* workers; /**< Trabajadores (el 0 es el hilo que llama) */
+    size_t thread_count;            /**< Cantidad total de porciones */
+    pthread_mutex_t mutex;          /**< Protege generation, pending y stopping */
+    pthread_cond_t start_cond;      /**< Señala el comienzo de una pasada */
+    pthread_cond_t done_cond;       /**< Señala que todos los hilos terminaron */
+    unsigned long generation;       /**< Numero de pasada */
+    size_t pending;                 /**< Hilos que todavia no terminaron la pasada */
+    int stopping;                   /**< Indica a los hilos que deben terminar */
+} scan = {.proc_fd = -1};
+
+/**
+ * @brief Posicion inicial de un PID en la tabla.
+ *
+ * @param pid PID a ubicar.
+ * @return Indice de la tabla.
+ */
+static inline size_t process_table_home(pid_t pid)
+{
+    return ((size_t)pid * 2654435761u) & (scan.table_capacity - 1);
+}
+
+/**
+ * @brief Busca la entrada de un PID o la agrega si no existe.
+ *
+ * La tabla debe tener lugar libre (ver process_table_reserve()).
+ *
+ * @param pid PID a buscar.
+ * @return Entrada del PID.
+ */
+static process_entry_t* process_table_upsert(pid_t pid)
+{
+    size_t mask = scan.table_capacity - 1;
+
+    for (size_t i = process_table_home(pid);; i = (i + 1) & mask)
+    {
+        process_entry_t* entry = &scan.table[i];
+        if (entry->pid == pid)
+        {
+            return entry;
+        }
+        if (entry->pid == 0)
+        {
+            memset(entry, 0, sizeof(*entry));
+            entry->pid = pid;
+            entry->fd = -1;
+            scan.table_size++;
+            return entry;
+        }
+    }
+}
+
+/**
+ * @brief Asegura que la tabla pueda recibir la cantidad de entradas indicada sin superar la mitad de su capacidad.
+ *
+ * Si hace falta crecer, las entradas se reubican en una tabla nueva.
+ *
+ * @param count Cantidad de entradas que se podrian agregar.
+ * @return 0 en caso de exito, -1 si no hay memoria.
+ */
+static int process_table_reserve(size_t count)
+{
+    size_t needed = (scan.table_size + count) * 2;
+    size_t capacity = scan.table_capacity == 0 ? PROCESS_TABLE_INITIAL_CAPACITY : scan.table_capacity;
+
+    while (capacity < needed)
+    {
+        capacity *= 2;
+    }
+    if (capacity == scan.table_capacity)
+    {
+        return 0;
+    }
+
+    process_entry_t* table = calloc(capacity, sizeof(process_entry_t));
+    if (table == NULL)
+    {
+        return -1;
+    }
+
+    process_entry_t* old_table = scan.table;
+    size_t old_capacity = scan.table_capacity;
+    scan.table = table;
+    scan.table_capacity = capacity;
+    for (size_t i = 0; i < old_capacity; i++)
+    {
+        if (old_table[i].pid != 0)
+        {
+            size_t mask = capacity - 1;
+            size_t j = process_table_home(old_table[i].pid);
+            while (table[j].pid != 0)
+            {
+                j = (j + 1) & mask;
+            }
+            table[j] = old_table[i];
+        }
+    }
+    free(old_table);
+    return 0;
+}
+
+/**
+ * @brief Cierra el descriptor cacheado de una entrada.
+ *
+ * @param entry Entrada cuyo descriptor se cierra.
+ */
+static void process_entry_close(process_entry_t* entry)
+{
+    if (entry->fd >= 0)
+    {
+        close(entry->fd);
+        entry->fd = -1;
+        atomic_fetch_sub(&scan.cached_fds, 1);
+    }
+}
+
+/**
+ * @brief Elimina las entradas que no se vieron en la pasada actual.
+ *
+ * Usa borrado por desplazamiento hacia atras, por lo que la tabla no acumula
+ * marcas de borrado. Cuando una entrada se desplaza a la posicion liberada, esa
+ * posicion se vuelve a revisar.
+ */
+static void process_table_sweep(void)
+{
+    size_t mask = scan.table_capacity - 1;
+
+    for (size_t i = 0; i < scan.table_capacity;)
+    {
+        process_entry_t* entry = &scan.table[i];
+        if (entry->pid == 0 || entry->seen == scan.generation)
+        {
+            i++;
+            continue;
+        }
+
+        process_entry_close(entry);
+        scan.table_size--;
+
+        size_t hole = i;
+        for (size_t j = (hole + 1) & mask; scan.table[j].pid != 0; j = (j + 1) & mask)
+        {
+            size_t home = process_table_home(scan.table[j].pid);
+            /* La entrada j puede ocupar el hueco si su posicion inicial no esta entre el hueco y j */
+            if (((j - home) & mask) >= ((j - hole) & mask))
+            {
+                scan.table[hole] = scan.table[j];
+                hole = j;
+            }
+        }
+        scan.table[hole].pid = 0;
+        scan.table[hole].fd = -1;
+    }
+}
+
+/**
+ * @brief Analiza los campos de /proc/<pid>/stat que siguen al nombre del proceso.
+ *
+ * @param entry Entrada donde se guardan los campos.
+ * @param buffer Contenido de stat.
+ * @param length Cantidad de bytes validos.
+ * @param start_time Donde se guarda el tiempo de inicio (campo 22).
+ * @return 0 en caso de exito, -1 si el contenido no tiene el formato esperado.
+ */
+static int process_entry_parse(process_entry_t* entry, const char* buffer, size_t length,
+                               unsigned long long* start_time)
+{
+    const char* end = buffer + length;
+
+    /* El nombre puede contener espacios y parentesis: el estado sigue al ultimo ')' */
+    const char* pos = memrchr(buffer, ')', length);
+    if (pos == NULL || pos + 2 >= end)
+    {
+        return -1;
+    }
+    pos += 2;
+    entry->state = *pos;
+
+    *start_time = 0;
+    for (int field = 3; field < 22;)
+    {
+        while (pos < end && *pos != ' ')
+        {
+            pos++;
+        }
+        if (pos >= end)
+        {
+            return -1;
+        }
+        pos++;
+        field++;
+
+        unsigned long long value = 0;
+        while (pos < end && (unsigned char)(*pos - '0') < 10)
+        {
+            value = value * 10 + (unsigned long long)(*pos - '0');
+            pos++;
+        }
+
+        if (field == 22)
+        {
+            *start_time = value;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Lee /proc/<pid>/stat de una entrada, usando el descriptor cacheado si existe.
+ *
+ * @param entry Entrada a leer.
+ * @param buffer Buffer donde se guarda el contenido.
+ * @return Cantidad de bytes leidos, o -1 si el proceso ya no existe.
+ */
+static ssize_t process_entry_read(process_entry_t* entry, char* buffer)
+{
+    if (entry->fd >= 0)
+    {
+        ssize_t n = pread(entry->fd, buffer, PROCESS_SCAN_STAT_SIZE, 0);
+        if (n > 0)
+        {
+            return n;
+        }
+        /* El proceso termino: el PID pudo reutilizarse, se reintenta con openat() */
+        process_entry_close(entry);
+    }
+
+    char path[32];
+    snprintf(path, sizeof(path), "%d/stat", (int)entry->pid);
+    int fd = openat(scan.proc_fd, path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return -1;
+    }
+    ssize_t n = read(fd, buffer, PROCESS_SCAN_STAT_SIZE);
+
+    /* Los procesos de larga vida conservan el descriptor mientras haya cupo */
+    if (n > 0 && entry->age >= PROCESS_SCAN_FD_MIN_AGE &&
+        atomic_fetch_add(&scan.cached_fds, 1) < PROCESS_SCAN_MAX_CACHED_FDS)
+    {
+        entry->fd = fd;
+        return n;
+    }
+    if (n > 0 && entry->age >= PROCESS_SCAN_FD_MIN_AGE)
+    {
+        atomic_fetch_sub(&scan.cached_fds, 1);
+    }
+    close(fd);
+    return n > 0 ? n : -1;
+}
+
+/**
+ * @brief Actualiza una entrada de la tabla y la suma a los contadores.
+ *
+ * Si el tiempo de inicio cambio, el PID fue reutilizado por otro proceso y la
+ * entrada se reinicia como la de un proceso nuevo.
+ *
+ * @param entry Entrada a actualizar.
+ * @param states Contadores a actualizar.
+ */
+static void process_scan_one(process_entry_t* entry, process_states_t* states)
+{
+    char buffer[PROCESS_SCAN_STAT_SIZE];
+    unsigned long long start_time;
+
+    ssize_t n = process_entry_read(entry, buffer);
+    if (n <= 0 || process_entry_parse(entry, buffer, (size_t)n, &start_time) != 0)
+    {
+        entry->seen = 0; /* Se elimina en el barrido */
+        return;
+    }
+
+    if (entry->age == 0 || start_time != entry->start_time)
+    {
+        entry->start_time = start_time;
+        entry->age = 1;
+    }
+    else
+    {
+        entry->age++;
+    }
+
+    states->total++;
+    switch (entry->state)
+    {
+    case 'S':
+        states->suspended++;
+        break;
+    case 'R':
+        states->ready++;
+        break;
+    case 'D':
+        states->uninterruptible++;
+        break;
+    case 'T':
+        states->stopped++;
+        break;
+    case 'Z':
+        states->zombie++;
+        break;
+    }
+}
+
+/**
+ * @brief Procesa la porcion de la lista de entradas que le toca a un trabajador.
+ *
+ * @param worker Trabajador que procesa la porcion.
+ */
+static void process_scan_shard(process_scan_worker_t* worker)
+{
+    size_t begin = scan.pid_count * worker->index / scan.thread_count;
+    size_t end = scan.pid_count * (worker->index + 1) / scan.thread_count;
+
+    memset(&worker->states, 0, sizeof(worker->states));
+    for (size_t i = begin; i < end; i++)
+    {
+        process_scan_one(scan.work[i], &worker->states);
+    }
+}
+
+/**
+ * @brief Funcion de los hilos del pool: espera cada pasada y procesa su porcion.
+ *
+ * @param arg Puntero al process_scan_worker_t del hilo.
+ * @return NULL
+ */
+static void* process_scan_worker_main(void* arg)
+{
+    process_scan_worker_t* worker = arg;
+    unsigned long seen = 0;
+
+    for (;;)
+    {
+        pthread_mutex_lock(&scan.mutex);
+        while (scan.generation == seen && !scan.stopping)
+        {
+            pthread_cond_wait(&scan.start_cond, &scan.mutex);
+        }
+        if (scan.stopping)
+        {
+            pthread_mutex_unlock(&scan.mutex);
+            return NULL;
+        }
+        seen = scan.generation;
+        pthread_mutex_unlock(&scan.mutex);
+
+        process_scan_shard(worker);
+
+        pthread_mutex_lock(&scan.mutex);
+        if (--scan.pending == 0)
+        {
+            pthread_cond_signal(&scan.done_cond);
+        }
+        pthread_mutex_unlock(&scan.mutex);
+    }
+}
+
+/**
+ * @brief Lista los PID presentes en /proc.
+ *
+ * @return 0 en caso de exito, -1 en caso de error.
+ */
+static int process_scan_list_pids(void)
+{
+    struct dirent* entry;
+
+    scan.pid_count = 0;
+    rewinddir(scan.proc_dir);
+    while ((entry = readdir(scan.proc_dir)) != NULL)
+    {
+        const char* name = entry->d_name;
+        if ((unsigned char)(*name - '0') >= 10)
+        {
+            continue;
+        }
+
+        pid_t pid = 0;
+        for (; (unsigned char)(*name - '0') < 10; name++)
+        {
+            pid = pid * 10 + (*name - '0');
+        }
+
+        if (scan.pid_count == scan.pid_capacity)
+        {
+            size_t capacity = scan.pid_capacity == 0 ? 1024 : scan.pid_capacity * 2;
+            pid_t* pids = realloc(scan.pids, capacity * sizeof(pid_t));
+            process_entry_t** work = realloc(scan.work, capacity * sizeof(process_entry_t*));
+            if (pids != NULL)
+            {
+                scan.pids = pids;
+            }
+            if (work != NULL)
+            {
+                scan.work = work;
+            }
+            if (pids == NULL || work == NULL)
+            {
+                return -1;
+            }
+            scan.pid_capacity = capacity;
+        }
+        scan.pids[scan.pid_count++] = pid;
+    }
+    return 0;
+}
+
+int process_scan_init(size_t thread_count)
+{
+    if (scan.initialized)
+    {
+        return 0;
+    }
+    if (thread_count < 1)
+    {
+        thread_count = 1;
+    }
+    if (thread_count > PROCESS_SCAN_MAX_THREADS)
+    {
+        thread_count = PROCESS_SCAN_MAX_THREADS;
+    }
+
+    scan.proc_dir = opendir("/proc");
+    if (scan.proc_dir == NULL)
+    {
+        perror("Error al abrir /proc");
+        return -1;
+    }
+    scan.proc_fd = dirfd(scan.proc_dir);
+
+    scan.workers = calloc(thread_count, sizeof(process_scan_worker_t));
+    if (scan.workers == NULL || process_table_reserve(0) != 0)
+    {
+        free(scan.workers);
+        scan.workers = NULL;
+        closedir(scan.proc_dir);
+        scan.proc_dir = NULL;
+        return -1;
+    }
+
+    atomic_init(&scan.cached_fds, 0);
+    scan.thread_count = thread_count;
+    scan.generation = 0;
+    scan.stopping = 0;
+    pthread_mutex_init(&scan.mutex, NULL);
+    pthread_cond_init(&scan.start_cond, NULL);
+    pthread_cond_init(&scan.done_cond, NULL);
+
+    /* El trabajador 0 es el hilo que llama a process_scan_run() */
+    for (size_t i = 0; i < thread_count; i++)
+    {
+        scan.workers[i].index = i;
+        if (i > 0 && pthread_create(&scan.workers[i].thread, NULL, process_scan_worker_main, &scan.workers[i]) != 0)
+        {
+            fprintf(stderr, "Error al crear el hilo %zu del escaner de procesos\n", i);
+            scan.thread_count = i;
+            break;
+        }
+    }
+
+    scan.initialized = 1;
+    return 0;
+}
+
+int process_scan_run(process_states_t* states)
+{
+    if (!scan.initialized && process_scan_init(PROCESS_SCAN_DEFAULT_THREADS) != 0)
+    {
+        return -1;
+    }
+
+    if (process_scan_list_pids() != 0 || process_table_reserve(scan.pid_count) != 0)
+    {
+        fprintf(stderr, "Error al listar los procesos de /proc\n");
+        return -1;
+    }
+
+    /* La tabla ya tiene lugar para todos los PID, por lo que las entradas no se mueven durante la pasada */
+    unsigned long generation = scan.generation + 1;
+    for (size_t i = 0; i < scan.pid_count; i++)
+    {
+        process_entry_t* entry = process_table_upsert(scan.pids[i]);
+        entry->seen = generation;
+        scan.work[i] = entry;
+    }
+
+    /* Se despiertan los hilos del pool y el hilo actual procesa la porcion 0 */
+    pthread_mutex_lock(&scan.mutex);
+    scan.pending = scan.thread_count - 1;
+    scan.generation = generation;
+    pthread_cond_broadcast(&scan.start_cond);
+    pthread_mutex_unlock(&scan.mutex);
+
+    process_scan_shard(&scan.workers[0]);
+
+    pthread_mutex_lock(&scan.mutex);
+    while (scan.pending > 0)
+    {
+        pthread_cond_wait(&scan.done_cond, &scan.mutex);
+    }
+    pthread_mutex_unlock(&scan.mutex);
+
+    process_table_sweep();
+
+    /* Se suman los contadores parciales */
+    memset(states, 0, sizeof(*states));
+    for (size_t i = 0; i < scan.thread_count; i++)
+    {
+        const process_states_t* partial = &scan.workers[i].states;
+        states->total += partial->total;
+        states->suspended += partial->suspended;
+        states->ready += partial->ready;
+        states->uninterruptible += partial->uninterruptible;
+        states->stopped += partial->stopped;
+        states->zombie += partial->zombie;
+    }
+    states->running = states->total - states->suspended - states->ready - states->uninterruptible -
+                      states->stopped - states->zombie;
+    return 0;
+}
+
+void process_scan_destroy(void)
+{
+    if (!scan.initialized)
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&scan.mutex);
+    scan.stopping = 1;
+    pthread_cond_broadcast(&scan.start_cond);
+    pthread_mutex_unlock(&scan.mutex);
+    for (size_t i = 1; i < scan.thread_count; i++)
+    {
+        pthread_join(scan.workers[i].thread, NULL);
+    }
+
+    for (size_t i = 0; i < scan.table_capacity; i++)
+    {
+        if (scan.table[i].pid != 0)
+        {
+            process_entry_close(&scan.table[i]);
+        }
+    }
+    free(scan.table);
+    scan.table = NULL;
+    scan.table_capacity = 0;
+    scan.table_size = 0;
+
+    pthread_cond_destroy(&scan.done_cond);
+    pthread_cond_destroy(&scan.start_cond);
+    pthread_mutex_destroy(&scan.mutex);
+    free(scan.workers);
+    scan.workers = NULL;
+    free(scan.pids);
+    scan.pids = NULL;
+    free(scan.work);
+    scan.work = NULL;
+    scan.pid_count = 0;
+    scan.pid_capacity = 0;
+    closedir(scan.proc_dir);
+    scan.proc_dir = NULL;
+    scan.proc_fd = -1;
+    scan.initialized = 0;
+}
@@ -0,0 +1,246 @@
+#include "procfs_parse.h"
+#include <string.h>
+
+/**
+ * @brief Compara una clave de longitud conocida con un literal.
+ *
+ * Primero compara las longitudes y solo si coinciden recurre a memcmp.
+ */
+#define KEY_IS(key, key_length, literal)                                                                               \
+    ((key_length) == sizeof(literal) - 1 && memcmp((key), (literal), sizeof(literal) - 1) == 0)
+
+const char* const procfs_cpu_mode_names[PROCFS_CPU_MODE_COUNT] = {"user",   "nice", "system",  "idle",
+                                                                  "iowait", "irq",  "softirq", "steal"};
+
+/**
+ * @brief Cursor de lectura sobre un buffer que se recorre una sola vez hacia adelante.
+ */
+typedef struct
+{
+    const char* pos; /**< Posicion actual */
+    const char* end; /**< Fin del buffer (exclusivo) */
+} scanner_t;
+
+/**
+ * @brief Saltea espacios y tabulaciones.
+ *
+ * @param scanner Cursor a avanzar.
+ */
+static inline void scan_skip_blanks(scanner_t* scanner)
+{
+    while (scanner->pos < scanner->end && (*scanner->pos == ' ' || *scanner->pos == '\t'))
+    {
+        scanner->pos++;
+    }
+}
+
+/**
+ * @brief Avanza el cursor hasta el comienzo de la linea siguiente.
+ *
+ * @param scanner Cursor a avanzar.
+ */
+static inline void scan_next_line(scanner_t* scanner)
+{
+    const char* newline = memchr(scanner->pos, '\n', (size_t)(scanner->end - scanner->pos));
+    scanner->pos = newline == NULL ? scanner->end : newline + 1;
+}
+
+/**
+ * @brief Lee un entero decimal sin signo acumulando los digitos a mano.
+ *
+ * Saltea los espacios previos. Si no hay digitos devuelve 0 sin avanzar.
+ *
+ * @param scanner Cursor a avanzar.
+ * @return Valor leido.
+ */
+static inline unsigned long long scan_u64(scanner_t* scanner)
+{
+    unsigned long long value = 0;
+
+    scan_skip_blanks(scanner);
+    while (scanner->pos < scanner->end && (unsigned char)(*scanner->pos - '0') < 10)
+    {
+        value = value * 10 + (unsigned long long)(*scanner->pos - '0');
+        scanner->pos++;
+    }
+    return value;
+}
+
+/**
+ * @brief Lee una clave hasta un delimitador, un espacio o el fin de linea.
+ *
+ * Deja el cursor sobre el caracter siguiente al delimitador si lo encontro.
+ *
+ * @param scanner Cursor a avanzar.
+ * @param delimiter Caracter que termina la clave.
+ * @param key_length Longitud de la clave leida.
+ * @return Comienzo de la clave.
+ */
+static inline const char* scan_key(scanner_t* scanner, char delimiter, size_t* key_length)
+{
+    const char* key = scanner->pos;
+
+    while (scanner->pos < scanner->end && *scanner->pos != delimiter && *scanner->pos != ' ' &&
+           *scanner->pos != '\n')
+    {
+        scanner->pos++;
+    }
+    *key_length = (size_t)(scanner->pos - key);
+    if (scanner->pos < scanner->end && *scanner->pos == delimiter)
+    {
+        scanner->pos++;
+    }
+    return key;
+}
+
+int procfs_parse_cpus(const char* buffer, size_t length, procfs_cpu_snapshot_t* snapshot)
+{
+    scanner_t scanner = {buffer, buffer + length};
+
+    snapshot->count = 0;
+
+    /* Las lineas de CPU estan al comienzo del archivo: se termina en la primera que no lo sea */
+    while (scanner.pos < scanner.end && snapshot->count <= PROCFS_CPU_MAX_CPUS)
+    {
+        size_t key_length;
+        const char* key = scan_key(&scanner, ' ', &key_length);
+        if (key_length < 3 || memcmp(key, "cpu", 3) != 0)
+        {
+            break;
+        }
+
+        int id = -1;
+        if (key_length > 3)
+        {
+            id = 0;
+            for (size_t i = 3; i < key_length; i++)
+            {
+                id = id * 10 + (key[i] - '0');
+            }
+        }
+        if ((id < 0) != (snapshot->count == 0))
+        {
+            /* La primera linea debe ser el agregado */
+            break;
+        }
+
+        size_t index = snapshot->count++;
+        snapshot->id[index] = id;
+        for (int mode = 0; mode < PROCFS_CPU_MODE_COUNT; mode++)
+        {
+            snapshot->jiffies[mode][index] = scan_u64(&scanner);
+        }
+        scan_next_line(&scanner);
+    }
+
+    return snapshot->count > 0 ? 0 : -1;
+}
+
+int procfs_parse_meminfo(const char* buffer, size_t length, procfs_meminfo_t* meminfo)
+{
+    scanner_t scanner = {buffer, buffer + length};
+    unsigned int found = 0;
+    const unsigned int all_found = (1u << 7) - 1;
+
+    memset(meminfo, 0, sizeof(*meminfo));
+    while (scanner.pos < scanner.end && found != all_found)
+    {
+        size_t key_length;
+        const char* key = scan_key(&scanner, ':', &key_length);
+        unsigned long long* field = NULL;
+        unsigned int bit = 0;
+
+        if (KEY_IS(key, key_length, "MemTotal"))
+        {
+            field = &meminfo->mem_total, bit = 1u << 0;
+        }
+        else if (KEY_IS(key, key_length, "MemFree"))
+        {
+            field = &meminfo->mem_free, bit = 1u << 1;
+        }
+        else if (KEY_IS(key, key_length, "MemAvailable"))
+        {
+            field = &meminfo->mem_available, bit = 1u << 2;
+        }
+        else if (KEY_IS(key, key_length, "Buffers"))
+        {
+            field = &meminfo->buffers, bit = 1u << 3;
+        }
+        else if (KEY_IS(key, key_length, "Cached"))
+        {
+            field = &meminfo->cached, bit = 1u << 4;
+        }
+        else if (KEY_IS(key, key_length, "SwapTotal"))
+        {
+            field = &meminfo->swap_total, bit = 1u << 5;
+        }
+        else if (KEY_IS(key, key_length, "SwapFree"))
+        {
+            field = &meminfo->swap_free, bit = 1u << 6;
+        }
+
+        if (field != NULL)
+        {
+            *field = scan_u64(&scanner);
+            found |= bit;
+        }
+        scan_next_line(&scanner);
+    }
+
+    return (meminfo->mem_total != 0 && meminfo->mem_available != 0) ? 0 : -1;
+}
+
+int procfs_parse_net_dev(const char* buffer, size_t length, procfs_net_dev_t* net_dev)
+{
+    scanner_t scanner = {buffer, buffer + length};
+
+    net_dev->count = 0;
+
+    /* Las dos primeras lineas son encabezados */
+    scan_next_line(&scanner);
+    scan_next_line(&scanner);
+    if (scanner.pos >= scanner.end)
+    {
+        return -1;
+    }
+
+    while (scanner.pos < scanner.end && net_dev->count < PROCFS_NET_DEV_MAX_INTERFACES)
+    {
+        size_t name_length;
+        scan_skip_blanks(&scanner);
+        const char* name = scan_key(&scanner, ':', &name_length);
+        if (name_length == 0)
+        {
+            scan_next_line(&scanner);
+            continue;
+        }
+
+        procfs_net_dev_interface_t* interface = &net_dev->interfaces[net_dev->count++];
+        if (name_length >= PROCFS_NET_DEV_NAME_SIZE)
+        {
+            name_length = PROCFS_NET_DEV_NAME_SIZE - 1;
+        }
+        memcpy(interface->name, name, name_length);
+        interface->name[name_length] = '\0';
+
+        /* Recepcion: bytes packets errs drop fifo frame compressed multicast */
+        interface->rx_bytes = scan_u64(&scanner);
+        interface->rx_packets = scan_u64(&scanner);
+        interface->rx_errors = scan_u64(&scanner);
+        interface->rx_drops = scan_u64(&scanner);
+        for (int i = 0; i < 4; i++)
+        {
+            scan_u64(&scanner);
+        }
+
+        /* Transmision: bytes packets errs drop fifo colls carrier compressed */
+        interface->tx_bytes = scan_u64(&scanner);
+        interface->tx_packets = scan_u64(&scanner);
+        interface->tx_errors = scan_u64(&scanner);
+        interface->tx_drops = scan_u64(&scanner);
+
+        scan_next_line(&scanner);
+    }
+
+    return 0;
+}
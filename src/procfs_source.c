@@ -0,0 +1,105 @@
+#define _GNU_SOURCE
+#include "procfs_source.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+/**
+ * @brief Abre el archivo de la fuente y reserva el buffer si hace falta.
+ *
+ * @param source Fuente a abrir.
+ * @return 0 si la fuente quedo abierta, -1 en caso de error.
+ */
+static int procfs_source_open(procfs_source_t* source)
+{
+    if (source->buffer == NULL)
+    {
+        source->buffer = malloc(PROCFS_SOURCE_INITIAL_CAPACITY);
+        if (source->buffer == NULL)
+        {
+            return -1;
+        }
+        source->capacity = PROCFS_SOURCE_INITIAL_CAPACITY;
+    }
+
+    source->fd = open(source->path, O_RDONLY | O_CLOEXEC);
+    return source->fd < 0 ? -1 : 0;
+}
+
+/**
+ * @brief Duplica la capacidad del buffer de la fuente.
+ *
+ * @param source Fuente cuyo buffer se agranda.
+ * @return 0 si el buffer crecio, -1 si ya alcanzo el maximo o no hay memoria.
+ */
+static int procfs_source_grow(procfs_source_t* source)
+{
+    if (source->capacity >= PROCFS_SOURCE_MAX_CAPACITY)
+    {
+        return -1;
+    }
+
+    char* buffer = realloc(source->buffer, source->capacity * 2);
+    if (buffer == NULL)
+    {
+        return -1;
+    }
+    source->buffer = buffer;
+    source->capacity *= 2;
+    return 0;
+}
+
+ssize_t procfs_source_read(procfs_source_t* source)
+{
+    if (source->fd < 0 && procfs_source_open(source) != 0)
+    {
+        return -1;
+    }
+
+    int reopened = 0;
+    for (;;)
+    {
+        /* Se reserva un byte para el terminador */
+        ssize_t n = pread(source->fd, source->buffer, source->capacity - 1, 0);
+        if (n < 0)
+        {
+            /* El archivo pudo desaparecer (ENODEV, ESTALE...): se reabre una sola vez */
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            close(source->fd);
+            source->fd = -1;
+            if (reopened || procfs_source_open(source) != 0)
+            {
+                return -1;
+            }
+            reopened = 1;
+            continue;
+        }
+
+        /* Si el buffer se lleno, el archivo puede tener mas contenido: se agranda y se relee */
+        if ((size_t)n == source->capacity - 1 && procfs_source_grow(source) == 0)
+        {
+            continue;
+        }
+
+        source->buffer[n] = '\0';
+        source->length = (size_t)n;
+        return n;
+    }
+}
+
+void procfs_source_close(procfs_source_t* source)
+{
+    if (source->fd >= 0)
+    {
+        close(source->fd);
+        source->fd = -1;
+    }
+    free(source->buffer);
+    source->buffer = NULL;
+    source->capacity = 0;
+    source->length = 0;
+}
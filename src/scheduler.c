@@ -0,0 +1,379 @@
+#define _GNU_SOURCE
+#include "scheduler.h"
+#include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <time.h>
+
+/**
+ * @brief Nanosegundos por segundo.
+ */
+#define NSEC_PER_SEC 1000000000LL
+
+/**
+ * @brief Coleccionista registrado.
+ */
+typedef struct
+{
+    const char* name;            /**< Nombre del coleccionista */
+    scheduler_collect_t collect; /**< Funcion de recoleccion */
+    long long interval_ns;       /**< Intervalo en nanosegundos */
+    long long timeout_ns;        /**< Tiempo maximo de una ejecucion en nanosegundos */
+    int group;                   /**< Grupo que limita sus hilos, o SCHEDULER_NO_GROUP */
+    long long deadline;          /**< Proximo plazo (solo lo usa el despachador) */
+    int busy;                    /**< Encolado o en ejecucion (protegido por el mutex) */
+    int timed_out;               /**< La ejecucion en curso ya se conto como vencida */
+    long long started;           /**< Inicio de la ejecucion en curso, 0 si esta en cola (protegido por el mutex) */
+    atomic_ullong missed;        /**< Plazos perdidos */
+    atomic_ullong timeouts;      /**< Ejecuciones vencidas */
+} scheduler_task_t;
+
+/**
+ * @brief Estado global del planificador.
+ */
+static struct
+{
+    scheduler_task_t tasks[SCHEDULER_MAX_TASKS]; /**< Coleccionistas registrados */
+    size_t task_count;                           /**< Cantidad de coleccionistas registrados */
+    scheduler_observer_t observer;               /**< Funcion que recibe las duraciones */
+    pthread_t dispatcher;                        /**< Hilo despachador */
+    int dispatcher_started;                      /**< Indica si el despachador fue creado */
+    pthread_t workers[SCHEDULER_MAX_WORKERS];    /**< Hilos del pool */
+    size_t worker_count;                         /**< Hilos del pool creados */
+    pthread_mutex_t mutex;                       /**< Protege la cola y el estado de ejecucion */
+    pthread_cond_t queue_cond;                   /**< Señala que hay trabajo en la cola o hay que detenerse */
+    size_t queue[SCHEDULER_MAX_TASKS];           /**< Cola circular de indices de coleccionistas */
+    size_t queue_head;                           /**< Posicion del proximo a ejecutar */
+    size_t queue_length;                         /**< Coleccionistas en la cola */
+    size_t group_limit[SCHEDULER_MAX_GROUPS];    /**< Hilos que puede ocupar cada grupo a la vez */
+    size_t group_running[SCHEDULER_MAX_GROUPS];  /**< Coleccionistas de cada grupo en ejecucion */
+    size_t group_count;                          /**< Cantidad de grupos creados */
+    int stopping;                                /**< Indica a los hilos que deben terminar */
+} scheduler = {.mutex = PTHREAD_MUTEX_INITIALIZER, .queue_cond = PTHREAD_COND_INITIALIZER};
+
+/**
+ * @brief Convierte un timespec a nanosegundos.
+ *
+ * @param time Tiempo a convertir.
+ * @return Nanosegundos.
+ */
+static inline long long timespec_to_ns(const struct timespec* time)
+{
+    return (long long)time->tv_sec * NSEC_PER_SEC + time->tv_nsec;
+}
+
+/**
+ * @brief Lee CLOCK_MONOTONIC en nanosegundos.
+ *
+ * @return Nanosegundos.
+ */
+static inline long long monotonic_now(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return timespec_to_ns(&now);
+}
+
+/**
+ * @brief Saca de la cola el primer coleccionista cuyo grupo tiene un hilo libre. Se llama con el mutex tomado.
+ *
+ * @return Indice del coleccionista, o -1 si ninguno de los encolados puede ejecutarse ahora.
+ */
+static int scheduler_dequeue(void)
+{
+    for (size_t i = 0; i < scheduler.queue_length; i++)
+    {
+        size_t index = scheduler.queue[(scheduler.queue_head + i) % SCHEDULER_MAX_TASKS];
+        int group = scheduler.tasks[index].group;
+        if (group != SCHEDULER_NO_GROUP)
+        {
+            if (scheduler.group_running[group] >= scheduler.group_limit[group])
+            {
+                continue;
+            }
+            scheduler.group_running[group]++;
+        }
+
+        /* Los que quedan detras avanzan un lugar para conservar el orden de la cola */
+        for (size_t j = i; j + 1 < scheduler.queue_length; j++)
+        {
+            scheduler.queue[(scheduler.queue_head + j) % SCHEDULER_MAX_TASKS] =
+                scheduler.queue[(scheduler.queue_head + j + 1) % SCHEDULER_MAX_TASKS];
+        }
+        scheduler.queue_length--;
+        return (int)index;
+    }
+    return -1;
+}
+
+/**
+ * @brief Funcion de los hilos del pool: toma coleccionistas de la cola y los ejecuta.
+ *
+ * @param arg Argumento no utilizado.
+ * @return NULL
+ */
+static void* scheduler_worker_main(void* arg)
+{
+    (void)arg;
+
+    pthread_mutex_lock(&scheduler.mutex);
+    for (;;)
+    {
+        int index = -1;
+        while (!scheduler.stopping && (index = scheduler_dequeue()) < 0)
+        {
+            pthread_cond_wait(&scheduler.queue_cond, &scheduler.mutex);
+        }
+        if (scheduler.stopping)
+        {
+            break;
+        }
+
+        scheduler_task_t* task = &scheduler.tasks[index];
+        long long started = monotonic_now();
+        task->started = started;
+        pthread_mutex_unlock(&scheduler.mutex);
+
+        task->collect();
+
+        long long duration = monotonic_now() - started;
+        if (scheduler.observer != NULL)
+        {
+            scheduler.observer((size_t)index, (double)duration / NSEC_PER_SEC);
+        }
+
+        pthread_mutex_lock(&scheduler.mutex);
+        if (duration > task->timeout_ns && !task->timed_out)
+        {
+            atomic_fetch_add_explicit(&task->timeouts, 1, memory_order_relaxed);
+        }
+        task->busy = 0;
+        task->timed_out = 0;
+        if (task->group != SCHEDULER_NO_GROUP)
+        {
+            /* Se libero un lugar del grupo: puede haber otro del mismo grupo esperando en la cola */
+            scheduler.group_running[task->group]--;
+            pthread_cond_broadcast(&scheduler.queue_cond);
+        }
+    }
+    pthread_mutex_unlock(&scheduler.mutex);
+    return NULL;
+}
+
+/**
+ * @brief Encola los coleccionistas vencidos y revisa las ejecuciones que superaron su tiempo maximo.
+ *
+ * @param now Instante actual en nanosegundos.
+ * @return Proximo instante en que el despachador debe despertar.
+ */
+static long long scheduler_dispatch(long long now)
+{
+    long long wake = now + NSEC_PER_SEC;
+
+    pthread_mutex_lock(&scheduler.mutex);
+    for (size_t i = 0; i < scheduler.task_count; i++)
+    {
+        scheduler_task_t* task = &scheduler.tasks[i];
+
+        if (task->deadline <= now)
+        {
+            if (task->busy)
+            {
+                /* Sigue en ejecucion desde un plazo anterior: este plazo se saltea */
+                atomic_fetch_add_explicit(&task->missed, 1, memory_order_relaxed);
+            }
+            else
+            {
+                task->busy = 1;
+                task->started = 0; /* En cola: el tiempo maximo corre desde que empieza a ejecutarse */
+                scheduler.queue[(scheduler.queue_head + scheduler.queue_length) % SCHEDULER_MAX_TASKS] = i;
+                scheduler.queue_length++;
+                pthread_cond_signal(&scheduler.queue_cond);
+            }
+
+            /* El siguiente plazo se calcula desde el anterior, no desde ahora, para no acumular deriva */
+            task->deadline += task->interval_ns;
+            if (task->deadline <= now)
+            {
+                long long missed = (now - task->deadline) / task->interval_ns + 1;
+                atomic_fetch_add_explicit(&task->missed, (unsigned long long)missed, memory_order_relaxed);
+                task->deadline += missed * task->interval_ns;
+            }
+        }
+
+        if (task->busy && task->started != 0 && !task->timed_out)
+        {
+            long long limit = task->started + task->timeout_ns;
+            if (limit <= now)
+            {
+                task->timed_out = 1;
+                atomic_fetch_add_explicit(&task->timeouts, 1, memory_order_relaxed);
+                fprintf(stderr, "El coleccionista %s supero su tiempo maximo\n", task->name);
+            }
+            else if (limit < wake)
+            {
+                wake = limit;
+            }
+        }
+
+        if (task->deadline < wake)
+        {
+            wake = task->deadline;
+        }
+    }
+    pthread_mutex_unlock(&scheduler.mutex);
+    return wake;
+}
+
+/**
+ * @brief Funcion del hilo despachador: duerme hasta el proximo plazo y despacha.
+ *
+ * @param arg Argumento no utilizado.
+ * @return NULL
+ */
+static void* scheduler_dispatcher_main(void* arg)
+{
+    (void)arg;
+
+    for (;;)
+    {
+        /* El despachador solo se cancela mientras duerme, nunca con el mutex tomado */
+        pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, NULL);
+        long long wake = scheduler_dispatch(monotonic_now());
+        pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, NULL);
+        struct timespec until = {.tv_sec = wake / NSEC_PER_SEC, .tv_nsec = wake % NSEC_PER_SEC};
+        int rc;
+        while ((rc = clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &until, NULL)) == EINTR)
+        {
+        }
+        if (rc != 0)
+        {
+            fprintf(stderr, "Error en clock_nanosleep del despachador\n");
+            return NULL;
+        }
+    }
+}
+
+int scheduler_register(const char* name, scheduler_collect_t collect, long interval_ms, long timeout_ms, int group)
+{
+    if (scheduler.task_count >= SCHEDULER_MAX_TASKS || interval_ms <= 0 || timeout_ms < 0 || collect == NULL ||
+        group < SCHEDULER_NO_GROUP || group >= (int)scheduler.group_count)
+    {
+        return -1;
+    }
+
+    scheduler_task_t* task = &scheduler.tasks[scheduler.task_count];
+    task->name = name;
+    task->collect = collect;
+    task->interval_ns = (long long)interval_ms * 1000000LL;
+    task->timeout_ns = (long long)(timeout_ms > 0 ? timeout_ms : interval_ms) * 1000000LL;
+    task->group = group;
+    task->busy = 0;
+    task->timed_out = 0;
+    atomic_init(&task->missed, 0);
+    atomic_init(&task->timeouts, 0);
+    return (int)scheduler.task_count++;
+}
+
+int scheduler_add_group(size_t max_workers)
+{
+    if (scheduler.group_count >= SCHEDULER_MAX_GROUPS || max_workers == 0)
+    {
+        return -1;
+    }
+
+    scheduler.group_limit[scheduler.group_count] = max_workers;
+    scheduler.group_running[scheduler.group_count] = 0;
+    return (int)scheduler.group_count++;
+}
+
+void scheduler_set_observer(scheduler_observer_t observer)
+{
+    scheduler.observer = observer;
+}
+
+int scheduler_start(size_t worker_count)
+{
+    if (worker_count == 0)
+    {
+        worker_count = SCHEDULER_DEFAULT_WORKERS;
+    }
+    if (worker_count > SCHEDULER_MAX_WORKERS)
+    {
+        worker_count = SCHEDULER_MAX_WORKERS;
+    }
+
+    long long start = monotonic_now();
+    for (size_t i = 0; i < scheduler.task_count; i++)
+    {
+        scheduler.tasks[i].deadline = start;
+    }
+    scheduler.stopping = 0;
+
+    for (scheduler.worker_count = 0; scheduler.worker_count < worker_count; scheduler.worker_count++)
+    {
+        if (pthread_create(&scheduler.workers[scheduler.worker_count], NULL, scheduler_worker_main, NULL) != 0)
+        {
+            fprintf(stderr, "Error al crear el hilo %zu del pool de coleccionistas\n", scheduler.worker_count);
+            return -1;
+        }
+    }
+
+    if (pthread_create(&scheduler.dispatcher, NULL, scheduler_dispatcher_main, NULL) != 0)
+    {
+        fprintf(stderr, "Error al crear el hilo despachador\n");
+        return -1;
+    }
+    scheduler.dispatcher_started = 1;
+    return 0;
+}
+
+void scheduler_wait(void)
+{
+    if (scheduler.dispatcher_started)
+    {
+        pthread_join(scheduler.dispatcher, NULL);
+        scheduler.dispatcher_started = 0;
+    }
+
+    /* Sin despachador no llega mas trabajo: los hilos del pool terminan lo que tengan en curso */
+    pthread_mutex_lock(&scheduler.mutex);
+    scheduler.stopping = 1;
+    pthread_cond_broadcast(&scheduler.queue_cond);
+    pthread_mutex_unlock(&scheduler.mutex);
+    for (size_t i = 0; i < scheduler.worker_count; i++)
+    {
+        pthread_join(scheduler.workers[i], NULL);
+    }
+    scheduler.worker_count = 0;
+}
+
+void scheduler_stop(void)
+{
+    if (scheduler.dispatcher_started)
+    {
+        pthread_cancel(scheduler.dispatcher);
+    }
+    scheduler_wait();
+}
+
+size_t scheduler_task_count(void)
+{
+    return scheduler.task_count;
+}
+
+const char* scheduler_task_name(size_t index)
+{
+    return scheduler.tasks[index].name;
+}
+
+unsigned long long scheduler_missed_deadlines(size_t index)
+{
+    return atomic_load_explicit(&scheduler.tasks[index].missed, memory_order_relaxed);
+}
+
+unsigned long long scheduler_timeouts(size_t index)
+{
+    return atomic_load_explicit(&scheduler.tasks[index].timeouts, memory_order_relaxed);
+}